@@ -0,0 +1,1460 @@
+/**
+ * @file bench_string.c
+ * @brief Benchmark program for the custom C23 string library
+ *
+ * Run through `make bench`. The first part times every kernel-backed and
+ * allocating API at four size classes, once per SIMD level the CPU supports,
+ * next to the glibc routine doing the same job, and reports cycles per byte.
+ * The second part times whole workloads. Pass a substring as the only
+ * argument to run just the matching per-size rows.
+ */
+#define _GNU_SOURCE  // For memmem and mkstemp
+#include "string_lib.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// ========================= TIMING HELPERS =========================
+
+/**
+ * Get current time in nanoseconds
+ */
+static long long get_time_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * Print benchmark results
+ */
+static void print_benchmark_result(const char* operation, long long elapsed_ns, size_t iterations) {
+    double elapsed_ms = elapsed_ns / 1000000.0;
+    double ops_per_sec = (iterations * 1000.0) / elapsed_ms;
+    printf("%-20s | %10.3f ms | %12.0f ops/sec | %8zu iterations\n", 
+           operation, elapsed_ms, ops_per_sec, iterations);
+}
+
+// Write bytes to a fresh temporary file and return its path in path
+static bool write_temp_file(char* path, size_t path_size, const char* data, size_t length) {
+    snprintf(path, path_size, "/tmp/libstring_bench_XXXXXX");
+    int fd = mkstemp(path);
+    if (fd < 0) return false;
+    bool ok = write(fd, data, length) == (ssize_t)length;
+    close(fd);
+    return ok;
+}
+
+// ========================= PER-SIZE KERNEL MATRIX =========================
+
+// Cycle counter for per-byte costs: the TSC on x86, which ticks at the
+// nominal frequency, and the monotonic clock in nanoseconds elsewhere
+#if defined(__x86_64__) || defined(__i386__)
+#define CYCLE_UNIT "cyc/B"
+static inline uint64_t read_cycles(void) {
+    return __rdtsc();
+}
+#else
+#define CYCLE_UNIT "ns/B"
+static inline uint64_t read_cycles(void) {
+    return (uint64_t)get_time_ns();
+}
+#endif
+
+// Bytes each measurement processes, and how many measurements are made
+// before keeping the fastest
+#define MATRIX_TARGET_BYTES (16u << 20)
+#define MATRIX_REPEATS 3
+
+// Size classes: inline (SSO), just over one 16-byte vector, 1 KiB and 1 MiB
+static const size_t matrix_sizes[] = { 15, 17, 1024, 1 << 20 };
+
+typedef struct {
+    size_t length;
+    char* text;                 // Random lowercase letters, null-terminated
+    char* copy;                 // Equal copy of text in a different buffer
+    char* csv;                  // Same length, a comma every 8 bytes
+    char* utf8;                 // Same length, valid UTF-8 mixing 1 to 4 byte sequences
+    char* padded;               // text with its first and last quarter turned into whitespace
+    string* str;                // Holds text
+    string* other;              // Holds copy
+    string* work;               // Scratch target for mutating operations
+    string_view needle;         // Last bytes of text, found only at the end
+    string_searcher* searcher;  // Compiled needle
+    string_byte_set absent;     // Bytes that never occur in text
+    string_pool* pool;          // Pool with text already interned
+} bench_input;
+
+typedef uint64_t (*bench_fn)(bench_input* in, size_t iterations);
+
+typedef struct {
+    const char* name;
+    bench_fn run;
+    bool per_level;             // Goes through the dispatched SIMD kernels
+} bench_case;
+
+static bench_input* bench_input_new(size_t length) {
+    bench_input* in = calloc(1, sizeof(bench_input));
+    in->length = length;
+    in->text = malloc(length + 1);
+    in->copy = malloc(length + 1);
+    in->csv = malloc(length + 1);
+    in->utf8 = malloc(length + 1);
+    in->padded = malloc(length + 1);
+    
+    uint32_t seed = 2463534242u;
+    for (size_t i = 0; i < length; i++) {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        in->text[i] = (char)('a' + seed % 26);
+        in->csv[i] = (i % 8 == 7) ? ',' : in->text[i];
+    }
+    in->text[length] = in->csv[length] = '\0';
+    static const char utf8_cycle[] = "ab\xC3\xA9" "c\xE2\x82\xAC" "d\xF0\x9F\x98\x80";
+    for (size_t i = 0; i < length; ) {
+        size_t chunk = sizeof(utf8_cycle) - 1;
+        if (chunk > length - i) chunk = 1;
+        memcpy(in->utf8 + i, chunk == 1 ? "e" : utf8_cycle, chunk);
+        i += chunk;
+    }
+    in->utf8[length] = '\0';
+    memcpy(in->padded, in->text, length + 1);
+    memset(in->padded, ' ', length / 4);
+    memset(in->padded + length - length / 4, '\t', length / 4);
+    memcpy(in->copy, in->text, length + 1);
+    
+    in->str = string_new_n(in->text, length);
+    in->other = string_new_n(in->copy, length);
+    in->work = string_with_capacity(2 * length + 1);
+    size_t needle_len = length < 8 ? length : 8;
+    in->needle = (string_view){ in->text + length - needle_len, needle_len };
+    in->searcher = string_searcher_new_view(in->needle);
+    in->absent = string_byte_set_from(string_view_from_cstr(";\n\t"));
+    in->pool = string_pool_new();
+    (void)string_pool_intern_view(in->pool, string_as_view(in->str));
+    return in;
+}
+
+static void bench_input_free(bench_input* in) {
+    string_pool_free(in->pool);
+    string_searcher_free(in->searcher);
+    string_free(in->work);
+    string_free(in->other);
+    string_free(in->str);
+    free(in->csv);
+    free(in->utf8);
+    free(in->padded);
+    free(in->copy);
+    free(in->text);
+    free(in);
+}
+
+// Library operations. Each returns a value derived from its results so the
+// calls cannot be dropped.
+static uint64_t run_compare(bench_input* in, size_t n) {
+    uint64_t acc = 0;
+    for (size_t i = 0; i < n; i++) acc += (uint64_t)string_compare(in->str, in->other);
+    return acc;
+}
+
+static uint64_t run_equals(bench_input* in, size_t n) {
+    uint64_t acc = 0;
+    for (size_t i = 0; i < n; i++) acc += string_equals(in->str, in->other);
+    return acc;
+}
+
+static uint64_t run_compare_icase(bench_input* in, size_t n) {
+    uint64_t acc = 0;
+    for (size_t i = 0; i < n; i++) acc += (uint64_t)string_compare_icase(in->str, in->other);
+    return acc;
+}
+
+static uint64_t run_equals_icase(bench_input* in, size_t n) {
+    uint64_t acc = 0;
+    for (size_t i = 0; i < n; i++) acc += string_equals_icase(in->str, in->other);
+    return acc;
+}
+
+static uint64_t run_find_icase(bench_input* in, size_t n) {
+    uint64_t acc = 0;
+    for (size_t i = 0; i < n; i++) acc += (uint64_t)string_find_icase(in->str, in->needle);
+    return acc;
+}
+
+static uint64_t run_find(bench_input* in, size_t n) {
+    uint64_t acc = 0;
+    for (size_t i = 0; i < n; i++) acc += (uint64_t)string_view_find(string_as_view(in->str), in->needle);
+    return acc;
+}
+
+static uint64_t run_searcher_find(bench_input* in, size_t n) {
+    uint64_t acc = 0;
+    for (size_t i = 0; i < n; i++) acc += (uint64_t)string_searcher_find(in->searcher, string_as_view(in->str));
+    return acc;
+}
+
+static uint64_t run_find_any(bench_input* in, size_t n) {
+    uint64_t acc = 0;
+    for (size_t i = 0; i < n; i++) acc += (uint64_t)string_view_find_any(string_as_view(in->str), &in->absent);
+    return acc;
+}
+
+static uint64_t run_to_upper(bench_input* in, size_t n) {
+    if (!string_set_n(in->work, in->text, in->length)) return 0;
+    for (size_t i = 0; i < n; i++) string_to_upper(in->work);
+    return (unsigned char)string_char_at(in->work, 0);
+}
+
+static uint64_t run_to_lower(bench_input* in, size_t n) {
+    if (!string_set_n(in->work, in->text, in->length)) return 0;
+    for (size_t i = 0; i < n; i++) string_to_lower(in->work);
+    return (unsigned char)string_char_at(in->work, 0);
+}
+
+// Parallel kernels with one thread per online CPU; inputs under 1 MiB run inline
+static uint64_t run_to_upper_parallel(bench_input* in, size_t n) {
+    if (!string_set_n(in->work, in->text, in->length)) return 0;
+    for (size_t i = 0; i < n; i++) string_to_upper_parallel(in->work, 0);
+    return (unsigned char)string_char_at(in->work, 0);
+}
+
+static uint64_t run_find_parallel(bench_input* in, size_t n) {
+    uint64_t acc = 0;
+    for (size_t i = 0; i < n; i++) acc += (uint64_t)string_find_parallel(in->str, in->needle, 0);
+    return acc;
+}
+
+static uint64_t run_count_parallel(bench_input* in, size_t n) {
+    uint64_t acc = 0;
+    for (size_t i = 0; i < n; i++) acc += string_count_parallel(in->str, in->needle, 0);
+    return acc;
+}
+
+// Views, so the ASCII flag a validated string caches does not short-cut
+static uint64_t run_utf8_validate(bench_input* in, size_t n) {
+    uint64_t acc = 0;
+    string_view text = { in->utf8, in->length };
+    for (size_t i = 0; i < n; i++) acc += string_view_utf8_validate(text);
+    return acc;
+}
+
+static uint64_t run_utf8_length(bench_input* in, size_t n) {
+    uint64_t acc = 0;
+    string_view text = { in->utf8, in->length };
+    for (size_t i = 0; i < n; i++) acc += string_view_utf8_length(text);
+    return acc;
+}
+
+static uint64_t run_new_free(bench_input* in, size_t n) {
+    uint64_t acc = 0;
+    for (size_t i = 0; i < n; i++) {
+        string* str = string_new_n(in->text, in->length);
+        acc += string_length(str);
+        string_free(str);
+    }
+    return acc;
+}
+
+// The first share moves other to a shared buffer; every later one is O(1)
+static uint64_t run_share_free(bench_input* in, size_t n) {
+    uint64_t acc = 0;
+    for (size_t i = 0; i < n; i++) {
+        string* str = string_share(in->other);
+        acc += string_length(str);
+        string_free(str);
+    }
+    return acc;
+}
+
+static uint64_t run_set(bench_input* in, size_t n) {
+    uint64_t acc = 0;
+    for (size_t i = 0; i < n; i++) acc += string_set_n(in->work, in->text, in->length);
+    return acc;
+}
+
+static uint64_t run_append(bench_input* in, size_t n) {
+    uint64_t acc = 0;
+    for (size_t i = 0; i < n; i++) {
+        string_clear(in->work);
+        acc += string_append_n(in->work, in->text, in->length);
+    }
+    return acc;
+}
+
+static uint64_t run_substr(bench_input* in, size_t n) {
+    uint64_t acc = 0;
+    for (size_t i = 0; i < n; i++) {
+        string* sub = string_substr(in->str, 0, in->length);
+        acc += string_length(sub);
+        string_free(sub);
+    }
+    return acc;
+}
+
+static uint64_t run_hash(bench_input* in, size_t n) {
+    uint64_t acc = 0;
+    for (size_t i = 0; i < n; i++) acc += string_view_hash(string_as_view(in->str));
+    return acc;
+}
+
+static uint64_t run_replace(bench_input* in, size_t n) {
+    uint64_t acc = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (!string_set_n(in->work, in->csv, in->length) || !string_replace(in->work, ",", ";")) break;
+        acc += string_length(in->work);
+    }
+    return acc;
+}
+
+static uint64_t run_trim(bench_input* in, size_t n) {
+    uint64_t acc = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (!string_set_n(in->work, in->text, in->length)) break;
+        string_trim(in->work);
+        acc += string_length(in->work);
+    }
+    return acc;
+}
+
+// Fields trimmed in place in a reused buffer
+static uint64_t run_trim_keep(bench_input* in, size_t n) {
+    const string_byte_set spaces = string_byte_set_from(string_view_from_cstr(" \t\n\v\f\r"));
+    uint64_t acc = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (!string_set_n(in->work, in->padded, in->length)) break;
+        string_trim_set(in->work, &spaces, STRING_TRIM_BOTH | STRING_TRIM_KEEP_BUFFER);
+        acc += string_length(in->work);
+    }
+    return acc;
+}
+
+static uint64_t run_split_join(bench_input* in, size_t n) {
+    uint64_t acc = 0;
+    string* csv = string_new_n(in->csv, in->length);
+    for (size_t i = 0; i < n; i++) {
+        size_t count = 0;
+        string** parts = string_split(csv, ",", &count);
+        string* joined = string_join(parts, count, ",");
+        acc += string_length(joined);
+        string_free(joined);
+        for (size_t j = 0; j < count; j++) string_free(parts[j]);
+        free(parts);
+    }
+    string_free(csv);
+    return acc;
+}
+
+static uint64_t run_tokenize(bench_input* in, size_t n) {
+    uint64_t acc = 0;
+    for (size_t i = 0; i < n; i++) {
+        string_tokenizer tok;
+        string_tokenizer_init(&tok, (string_view){ in->csv, in->length }, string_view_from_cstr(","));
+        while (string_tokenizer_next(&tok, NULL)) acc++;
+    }
+    return acc;
+}
+
+static uint64_t run_intern(bench_input* in, size_t n) {
+    uint64_t acc = 0;
+    for (size_t i = 0; i < n; i++) acc += string_length(string_pool_intern_view(in->pool, string_as_view(in->str)));
+    return acc;
+}
+
+// glibc doing the same jobs, called through volatile pointers so the
+// compiler cannot hoist or fold the calls
+static int (*volatile libc_strcmp)(const char*, const char*) = strcmp;
+static int (*volatile libc_memcmp)(const void*, const void*, size_t) = memcmp;
+static void* (*volatile libc_memmem)(const void*, size_t, const void*, size_t) = memmem;
+static size_t (*volatile libc_strcspn)(const char*, const char*) = strcspn;
+
+static uint64_t run_libc_strcmp(bench_input* in, size_t n) {
+    uint64_t acc = 0;
+    for (size_t i = 0; i < n; i++) acc += (uint64_t)libc_strcmp(in->text, in->copy);
+    return acc;
+}
+
+static uint64_t run_libc_memcmp(bench_input* in, size_t n) {
+    uint64_t acc = 0;
+    for (size_t i = 0; i < n; i++) acc += (uint64_t)libc_memcmp(in->text, in->copy, in->length);
+    return acc;
+}
+
+static uint64_t run_libc_memmem(bench_input* in, size_t n) {
+    uint64_t acc = 0;
+    for (size_t i = 0; i < n; i++) {
+        acc += (uintptr_t)libc_memmem(in->text, in->length, in->needle.data, in->needle.length);
+    }
+    return acc;
+}
+
+static uint64_t run_libc_strcspn(bench_input* in, size_t n) {
+    uint64_t acc = 0;
+    for (size_t i = 0; i < n; i++) acc += libc_strcspn(in->text, ";\n\t");
+    return acc;
+}
+
+static uint64_t run_libc_toupper(bench_input* in, size_t n) {
+    char* buf = in->copy;
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = 0; j < in->length; j++) buf[j] = (char)toupper((unsigned char)buf[j]);
+        __asm__ volatile("" : : "r"(buf) : "memory");
+    }
+    uint64_t acc = (unsigned char)buf[0];
+    memcpy(in->copy, in->text, in->length);
+    return acc;
+}
+
+static const bench_case matrix_cases[] = {
+    { "compare", run_compare, true },
+    { "libc strcmp", run_libc_strcmp, false },
+    { "equals", run_equals, true },
+    { "libc memcmp", run_libc_memcmp, false },
+    { "compare_icase", run_compare_icase, true },
+    { "equals_icase", run_equals_icase, true },
+    { "find", run_find, true },
+    { "searcher_find", run_searcher_find, true },
+    { "libc memmem", run_libc_memmem, false },
+    { "find_icase", run_find_icase, true },
+    { "find_any", run_find_any, true },
+    { "libc strcspn", run_libc_strcspn, false },
+    { "to_upper", run_to_upper, true },
+    { "to_lower", run_to_lower, true },
+    { "to_upper_par", run_to_upper_parallel, false },
+    { "find_par", run_find_parallel, false },
+    { "count_par", run_count_parallel, false },
+    { "libc toupper", run_libc_toupper, false },
+    { "utf8_validate", run_utf8_validate, true },
+    { "utf8_length", run_utf8_length, true },
+    { "new+free", run_new_free, false },
+    { "share+free", run_share_free, false },
+    { "set_n", run_set, false },
+    { "append_n", run_append, false },
+    { "substr", run_substr, false },
+    { "hash", run_hash, false },
+    { "replace", run_replace, false },
+    { "trim", run_trim, true },
+    { "trim_keep", run_trim_keep, true },
+    { "split+join", run_split_join, false },
+    { "tokenize", run_tokenize, false },
+    { "pool_intern", run_intern, false },
+};
+
+static void run_matrix_case(const bench_case* bc, bench_input* in, const char* level) {
+    size_t iterations = MATRIX_TARGET_BYTES / in->length;
+    if (iterations == 0) iterations = 1;
+    
+    uint64_t best_cycles = UINT64_MAX;
+    long long best_ns = 0;
+    volatile uint64_t sink = 0;
+    for (int r = 0; r < MATRIX_REPEATS; r++) {
+        long long start_ns = get_time_ns();
+        uint64_t start = read_cycles();
+        sink += bc->run(in, iterations);
+        uint64_t cycles = read_cycles() - start;
+        if (cycles < best_cycles) {
+            best_cycles = cycles;
+            best_ns = get_time_ns() - start_ns;
+        }
+    }
+    (void)sink;
+    
+    double per_byte = (double)best_cycles / ((double)iterations * (double)in->length);
+    double ns_per_op = (double)best_ns / (double)iterations;
+    printf("%-14s | %8zu | %-7s | %9.3f | %12.1f\n", bc->name, in->length, level, per_byte, ns_per_op);
+}
+
+/**
+ * Time every case at every size class, and the kernel-backed ones once per
+ * supported SIMD level
+ */
+void run_kernel_matrix(const char* filter) {
+    printf("\n=== PER-SIZE BENCHMARKS ===\n");
+    printf("%-14s | %8s | %-7s | %9s | %12s\n", "Operation", "Bytes", "Level", CYCLE_UNIT, "ns/op");
+    printf("----------------------------------------------------------------\n");
+    
+    string_simd_level initial = string_simd_get_level();
+    const size_t case_count = sizeof(matrix_cases) / sizeof(matrix_cases[0]);
+    
+    for (size_t s = 0; s < sizeof(matrix_sizes) / sizeof(matrix_sizes[0]); s++) {
+        bench_input* in = bench_input_new(matrix_sizes[s]);
+        for (size_t c = 0; c < case_count; c++) {
+            const bench_case* bc = &matrix_cases[c];
+            if (filter && !strstr(bc->name, filter)) continue;
+            
+            if (!bc->per_level) {
+                run_matrix_case(bc, in, strncmp(bc->name, "libc", 4) == 0 ? "libc" : "-");
+                continue;
+            }
+            for (int level = STRING_SIMD_SCALAR; level <= STRING_SIMD_NEON; level++) {
+                if (!string_simd_set_level((string_simd_level)level)) continue;
+                run_matrix_case(bc, in, string_simd_level_name((string_simd_level)level));
+            }
+            (void)string_simd_set_level(initial);
+        }
+        bench_input_free(in);
+    }
+}
+
+// ========================= WORKLOAD BENCHMARKS =========================
+
+/**
+ * Benchmark string creation and destruction
+ */
+void benchmark_create_free() {
+    const size_t iterations = 100000;
+    long long start = get_time_ns();
+    
+    for (size_t i = 0; i < iterations; i++) {
+        string* str = string_new("Hello, World!");
+        string_free(str);
+    }
+    
+    long long end = get_time_ns();
+    print_benchmark_result("Create/Free", end - start, iterations);
+}
+
+/**
+ * Benchmark in-place initialization of a string stored by value
+ */
+void benchmark_init_destroy() {
+    const size_t iterations = 100000;
+    long long start = get_time_ns();
+    
+    for (size_t i = 0; i < iterations; i++) {
+        string str;
+        if (string_init(&str, "Hello, World!")) {
+            volatile size_t len = string_length(&str);
+            (void)len;
+        }
+        string_destroy(&str);
+    }
+    
+    long long end = get_time_ns();
+    print_benchmark_result("Init/Destroy", end - start, iterations);
+}
+
+/**
+ * Benchmark string append operations
+ */
+void benchmark_append() {
+    const size_t iterations = 50000;
+    const char* test_str = " additional text";
+    long long start = get_time_ns();
+    
+    string* str = string_new("Initial content");
+    for (size_t i = 0; i < iterations; i++) {
+        if (!string_append_cstr(str, test_str)) {
+            printf("Error: append failed at iteration %zu\n", i);
+            break;
+        }
+    }
+    string_free(str);
+    
+    long long end = get_time_ns();
+    print_benchmark_result("Append", end - start, iterations);
+}
+
+/**
+ * Benchmark appending a large payload by C string and by known length
+ */
+void benchmark_append_large() {
+    const size_t iterations = 2000;
+    const size_t payload_len = 64 * 1024;
+    char* payload = malloc(payload_len + 1);
+    memset(payload, 'p', payload_len);
+    payload[payload_len] = '\0';
+    
+    string* str = string_with_capacity(payload_len + 1);
+    long long start = get_time_ns();
+    for (size_t i = 0; i < iterations; i++) {
+        string_clear(str);
+        if (!string_append_cstr(str, payload)) break;
+    }
+    print_benchmark_result("Append 64KiB cstr", get_time_ns() - start, iterations);
+    
+    start = get_time_ns();
+    for (size_t i = 0; i < iterations; i++) {
+        string_clear(str);
+        if (!string_append_n(str, payload, payload_len)) break;
+    }
+    print_benchmark_result("Append 64KiB _n", get_time_ns() - start, iterations);
+    
+    string_free(str);
+    free(payload);
+}
+
+/**
+ * Benchmark string find operations
+ */
+void benchmark_find() {
+    const size_t iterations = 100000;
+    string* str = string_new("This is a test string to search for substrings within");
+    const char* needle = "string";
+    long long start = get_time_ns();
+    
+    for (size_t i = 0; i < iterations; i++) {
+        ptrdiff_t pos = string_find_cstr(str, needle);
+        // Using volatile to prevent compiler optimizing away the loop
+        volatile ptrdiff_t _ = pos;
+        (void)_;
+    }
+    string_free(str);
+    
+    long long end = get_time_ns();
+    print_benchmark_result("Find", end - start, iterations);
+}
+
+/**
+ * Benchmark long-haystack search against glibc memmem, including an input
+ * that degrades naive candidate verification
+ */
+void benchmark_find_long() {
+    const size_t hay_len = 1 << 20;
+    const size_t iterations = 20;
+    char* hay = malloc(hay_len);
+    char needle[257];
+    // Called through a volatile pointer so the pure call is not hoisted
+    void* (*volatile libc_memmem)(const void*, size_t, const void*, size_t) = memmem;
+    if (!hay) return;
+    
+    unsigned int seed = 42;
+    for (size_t i = 0; i < hay_len; i++) {
+        seed = seed * 1103515245u + 12345u;
+        hay[i] = (char)('a' + ((seed >> 16) % 26));
+    }
+    
+    static const size_t needle_lengths[] = {4, 16, 64, 256};
+    for (size_t n = 0; n < sizeof(needle_lengths) / sizeof(needle_lengths[0]); n++) {
+        size_t nlen = needle_lengths[n];
+        memcpy(needle, hay + hay_len - nlen, nlen);
+        char label[32];
+        
+        long long start = get_time_ns();
+        for (size_t i = 0; i < iterations; i++) {
+            volatile ptrdiff_t pos = string_view_find((string_view){ hay, hay_len }, (string_view){ needle, nlen });
+            (void)pos;
+        }
+        snprintf(label, sizeof(label), "Find 1MiB m=%zu", nlen);
+        print_benchmark_result(label, get_time_ns() - start, iterations);
+        
+        start = get_time_ns();
+        for (size_t i = 0; i < iterations; i++) {
+            volatile const void* pos = libc_memmem(hay, hay_len, needle, nlen);
+            (void)pos;
+        }
+        snprintf(label, sizeof(label), "memmem 1MiB m=%zu", nlen);
+        print_benchmark_result(label, get_time_ns() - start, iterations);
+    }
+    
+    // Every position passes the first/last byte filter until the budget runs out
+    memset(hay, 'a', hay_len);
+    memset(needle, 'a', 64);
+    needle[32] = 'b';
+    long long start = get_time_ns();
+    for (size_t i = 0; i < iterations; i++) {
+        volatile ptrdiff_t pos = string_view_find((string_view){ hay, hay_len }, (string_view){ needle, 64 });
+        (void)pos;
+    }
+    print_benchmark_result("Find worst m=64", get_time_ns() - start, iterations);
+    
+    start = get_time_ns();
+    for (size_t i = 0; i < iterations; i++) {
+        volatile const void* pos = libc_memmem(hay, hay_len, needle, 64);
+        (void)pos;
+    }
+    print_benchmark_result("memmem worst m=64", get_time_ns() - start, iterations);
+    
+    free(hay);
+}
+
+/**
+ * Benchmark one needle searched over many records, with and without a
+ * compiled searcher
+ */
+void benchmark_searcher() {
+    const size_t iterations = 100000;
+    static const char* records[] = {
+        "user=alice action=login status=ok latency=12ms",
+        "user=bob action=upload status=error latency=340ms",
+        "user=carol action=logout status=ok latency=3ms",
+        "user=dave action=download status=timeout latency=5000ms",
+    };
+    const size_t num_records = sizeof(records) / sizeof(records[0]);
+    string* strs[sizeof(records) / sizeof(records[0])];
+    for (size_t i = 0; i < num_records; i++) strs[i] = string_new(records[i]);
+    
+    long long start = get_time_ns();
+    for (size_t i = 0; i < iterations; i++) {
+        volatile ptrdiff_t pos = string_find_cstr(strs[i % num_records], "status=error");
+        (void)pos;
+    }
+    print_benchmark_result("Find (cstr needle)", get_time_ns() - start, iterations);
+    
+    string_searcher* searcher = string_searcher_new("status=error");
+    start = get_time_ns();
+    for (size_t i = 0; i < iterations; i++) {
+        volatile ptrdiff_t pos = string_searcher_find(searcher, string_as_view(strs[i % num_records]));
+        (void)pos;
+    }
+    print_benchmark_result("Find (searcher)", get_time_ns() - start, iterations);
+    string_searcher_free(searcher);
+    
+    for (size_t i = 0; i < num_records; i++) string_free(strs[i]);
+}
+
+/**
+ * Benchmark scrubbing a set of tokens with one string_replace call per
+ * pattern against a single string_replace_many pass
+ */
+void benchmark_replace_many() {
+    const size_t iterations = 200;
+    static const char* tokens[] = {
+        "<ssn>", "<card>", "<phone>", "<email>", "<ip>", "<token>", "<name>", "<addr>"
+    };
+    static const char* masks[] = { "#", "#", "#", "#", "#", "#", "#", "#" };
+    const size_t num_tokens = sizeof(tokens) / sizeof(tokens[0]);
+    
+    string* text = string_with_capacity(64 * 1024);
+    for (size_t i = 0; string_length(text) < 60 * 1024; i++) {
+        if (!string_append_cstr(text, "log line with some payload ") ||
+            !string_append_cstr(text, tokens[i % num_tokens])) break;
+    }
+    string_matcher* matcher = string_matcher_new(tokens, num_tokens);
+    
+    long long start = get_time_ns();
+    for (size_t i = 0; i < iterations; i++) {
+        string* copy = string_new(string_cstr(text));
+        for (size_t t = 0; t < num_tokens; t++) {
+            if (!string_replace(copy, tokens[t], masks[t])) break;
+        }
+        string_free(copy);
+    }
+    print_benchmark_result("Replace x8 patterns", get_time_ns() - start, iterations);
+    
+    start = get_time_ns();
+    for (size_t i = 0; i < iterations; i++) {
+        string* copy = string_new(string_cstr(text));
+        if (!string_replace_many(copy, matcher, masks)) break;
+        string_free(copy);
+    }
+    print_benchmark_result("Replace many", get_time_ns() - start, iterations);
+    
+    string_matcher_free(matcher);
+    string_free(text);
+}
+
+/**
+ * Benchmark expanding a template with thousands of placeholders
+ */
+void benchmark_replace_expand() {
+    const size_t iterations = 200;
+    string* tmpl = string_with_capacity(64 * 1024);
+    for (size_t i = 0; i < 4000; i++) {
+        if (!string_append_cstr(tmpl, "Dear {name}, ")) break;
+    }
+    
+    long long start = get_time_ns();
+    for (size_t i = 0; i < iterations; i++) {
+        string* copy = string_new(string_cstr(tmpl));
+        if (!string_replace(copy, "{name}", "Ada Lovelace")) break;
+        string_free(copy);
+    }
+    print_benchmark_result("Replace grow x4000", get_time_ns() - start, iterations);
+    
+    start = get_time_ns();
+    for (size_t i = 0; i < iterations; i++) {
+        string* copy = string_new(string_cstr(tmpl));
+        if (!string_replace(copy, "{name}", "Ada")) break;
+        string_free(copy);
+    }
+    print_benchmark_result("Replace shrink x4000", get_time_ns() - start, iterations);
+    
+    string_free(tmpl);
+}
+
+/**
+ * Benchmark splitting a large CSV buffer into allocated pieces against
+ * walking it with a tokenizer
+ */
+void benchmark_tokenizer() {
+    const size_t iterations = 20;
+    string* csv = string_with_capacity(1 << 20);
+    while (string_length(csv) < (1 << 20) - 64) {
+        if (!string_append_cstr(csv, "1234,some name,someone@example.com,42.5\n")) break;
+    }
+    
+    long long start = get_time_ns();
+    size_t fields = 0;
+    for (size_t i = 0; i < iterations; i++) {
+        size_t count = 0;
+        string** parts = string_split(csv, ",", &count);
+        for (size_t j = 0; j < count; j++) string_free(parts[j]);
+        free(parts);
+        fields += count;
+    }
+    print_benchmark_result("Split 1MiB CSV", get_time_ns() - start, iterations);
+    
+    start = get_time_ns();
+    for (size_t i = 0; i < iterations; i++) {
+        string_tokenizer tok;
+        string_tokenizer_init(&tok, string_as_view(csv), string_view_from_cstr(","));
+        while (string_tokenizer_next(&tok, NULL)) fields++;
+    }
+    print_benchmark_result("Tokenize 1MiB CSV", get_time_ns() - start, iterations);
+    
+    start = get_time_ns();
+    for (size_t i = 0; i < iterations; i++) {
+        string_tokenizer tok;
+        string_tokenizer_init_any(&tok, string_as_view(csv), string_view_from_cstr(",\n"));
+        while (string_tokenizer_next(&tok, NULL)) fields++;
+    }
+    print_benchmark_result("Tokenize any 1MiB", get_time_ns() - start, iterations);
+    
+    volatile size_t sink = fields;
+    (void)sink;
+    string_free(csv);
+}
+
+/**
+ * Benchmark splitting a large CSV buffer into a string** against a reused
+ * contiguous string_array, and a linear lookup over each
+ */
+void benchmark_string_array() {
+    const size_t iterations = 20;
+    string* csv = string_with_capacity(1 << 20);
+    while (string_length(csv) < (1 << 20) - 64) {
+        if (!string_append_cstr(csv, "1234,some name,someone@example.com,42.5\n")) break;
+    }
+    
+    long long start = get_time_ns();
+    size_t count = 0;
+    string** parts = NULL;
+    for (size_t i = 0; i < iterations; i++) {
+        if (parts) {
+            for (size_t j = 0; j < count; j++) string_free(parts[j]);
+            free(parts);
+        }
+        parts = string_split(csv, ",", &count);
+    }
+    print_benchmark_result("Split 1MiB string**", get_time_ns() - start, iterations);
+    
+    string_array* array = string_array_new();
+    start = get_time_ns();
+    for (size_t i = 0; i < iterations; i++) {
+        string_array_clear(array);
+        if (!string_split_into(array, csv, ",")) break;
+    }
+    print_benchmark_result("Split 1MiB array", get_time_ns() - start, iterations);
+    
+    string_view missing = string_view_from_cstr("someone@example.org");
+    size_t hits = 0;
+    start = get_time_ns();
+    for (size_t i = 0; i < iterations; i++) {
+        for (size_t j = 0; j < count; j++) {
+            if (string_view_equals(string_as_view(parts[j]), missing)) hits++;
+        }
+    }
+    print_benchmark_result("Find in string**", get_time_ns() - start, iterations);
+    
+    start = get_time_ns();
+    for (size_t i = 0; i < iterations; i++) hits += string_array_find(array, missing) >= 0;
+    print_benchmark_result("Find in array", get_time_ns() - start, iterations);
+    
+    volatile size_t sink = hits;
+    (void)sink;
+    for (size_t j = 0; parts && j < count; j++) string_free(parts[j]);
+    free(parts);
+    string_array_free(array);
+    string_free(csv);
+}
+
+/**
+ * Benchmark hashing a long key from scratch against reading its cached hash
+ */
+void benchmark_hash() {
+    const size_t iterations = 1000000;
+    string* key = string_with_capacity(256);
+    while (string_length(key) < 200) {
+        if (!string_append_cstr(key, "/api/v1/users/")) break;
+    }
+    string_view sv = string_as_view(key);
+    
+    long long start = get_time_ns();
+    uint64_t acc = 0;
+    for (size_t i = 0; i < iterations; i++) {
+        sv.length = 190 + (i & 7);
+        acc += string_view_hash(sv);
+    }
+    print_benchmark_result("Hash 190B view", get_time_ns() - start, iterations);
+    
+    start = get_time_ns();
+    for (size_t i = 0; i < iterations; i++) acc += string_hash(key);
+    print_benchmark_result("Hash 200B cached", get_time_ns() - start, iterations);
+    
+    volatile uint64_t sink = acc;
+    (void)sink;
+    string_free(key);
+}
+
+// Time writing count pieces of about piece_size bytes to fd, joined first
+// and gathered directly
+static void time_join_write(int fd, size_t count, size_t piece_size, size_t iterations,
+                            const char* join_label, const char* gather_label) {
+    string** pieces = malloc(count * sizeof(string*));
+    for (size_t i = 0; i < count; i++) {
+        pieces[i] = string_new("{\"id\":");
+        if (!string_append_uint(pieces[i], i) || !string_append_cstr(pieces[i], ",\"name\":\"")) break;
+        while (string_length(pieces[i]) + 2 < piece_size) {
+            if (!string_append_char(pieces[i], 'x')) break;
+        }
+        if (!string_append_cstr(pieces[i], "\"}")) break;
+    }
+    
+    long long start = get_time_ns();
+    for (size_t i = 0; i < iterations; i++) {
+        string* joined = string_join(pieces, count, ",\n");
+        if (!string_write_fd(fd, joined)) break;
+        string_free(joined);
+    }
+    print_benchmark_result(join_label, get_time_ns() - start, iterations);
+    
+    start = get_time_ns();
+    for (size_t i = 0; i < iterations; i++) {
+        if (!string_join_write_fd(fd, pieces, count, ",\n")) break;
+    }
+    print_benchmark_result(gather_label, get_time_ns() - start, iterations);
+    
+    for (size_t i = 0; i < count; i++) string_free(pieces[i]);
+    free(pieces);
+}
+
+/**
+ * Benchmark writing a joined response to /dev/null: flattened with
+ * string_join, or gathered straight from the pieces. /dev/null copies
+ * nothing, so this is the user-space cost alone.
+ */
+void benchmark_join_write() {
+    int fd = open("/dev/null", O_WRONLY);
+    if (fd < 0) return;
+    time_join_write(fd, 1000, 48, 2000, "Join+write 1k x48B", "Gather 1k x48B");
+    time_join_write(fd, 256, 4096, 500, "Join+write 256x4K", "Gather 256x4K");
+    close(fd);
+}
+
+// JSON-escape src one byte at a time, the way hand-written loops do
+static bool json_escape_bytewise(string* out, string_view src) {
+    static const char hex[] = "0123456789abcdef";
+    for (size_t i = 0; i < src.length; i++) {
+        unsigned char c = (unsigned char)src.data[i];
+        bool ok;
+        if (c == '"' || c == '\\') {
+            ok = string_append_char(out, '\\') && string_append_char(out, (char)c);
+        } else if (c == '\n') {
+            ok = string_append_char(out, '\\') && string_append_char(out, 'n');
+        } else if (c < 0x20) {
+            ok = string_append_cstr(out, "\\u00") && string_append_char(out, hex[c >> 4]) &&
+                 string_append_char(out, hex[c & 15]);
+        } else {
+            ok = string_append_char(out, (char)c);
+        }
+        if (!ok) return false;
+    }
+    return true;
+}
+
+/**
+ * Benchmark escaping a 64 KiB text field for JSON byte by byte against the
+ * vectorized escaper, and the CSV and URL round trips
+ */
+void benchmark_escape() {
+    const size_t iterations = 500;
+    string* text = string_with_capacity(1 << 16);
+    while (string_length(text) < (1 << 16) - 128) {
+        if (!string_append_cstr(text, "The \"quick\" brown fox jumps over the lazy dog, again.\n")) break;
+    }
+    string_view sv = string_as_view(text);
+    string* out = string_new("");
+    size_t total = 0;
+    
+    long long start = get_time_ns();
+    for (size_t i = 0; i < iterations; i++) {
+        string_clear(out);
+        if (!json_escape_bytewise(out, sv)) break;
+        total += string_length(out);
+    }
+    print_benchmark_result("JSON escape bytewise 64K", get_time_ns() - start, iterations);
+    
+    start = get_time_ns();
+    for (size_t i = 0; i < iterations; i++) {
+        string_clear(out);
+        if (!string_append_json_escaped(out, sv)) break;
+        total += string_length(out);
+    }
+    print_benchmark_result("JSON escape 64K", get_time_ns() - start, iterations);
+    
+    string* escaped = string_new("");
+    if (string_append_json_escaped(escaped, sv)) {
+        start = get_time_ns();
+        for (size_t i = 0; i < iterations; i++) {
+            string_clear(out);
+            if (!string_append_json_unescaped(out, string_as_view(escaped))) break;
+            total += string_length(out);
+        }
+        print_benchmark_result("JSON unescape 64K", get_time_ns() - start, iterations);
+    }
+    
+    start = get_time_ns();
+    for (size_t i = 0; i < iterations; i++) {
+        string_clear(out);
+        if (!string_append_csv_quoted(out, sv)) break;
+        total += string_length(out);
+    }
+    print_benchmark_result("CSV quote 64K", get_time_ns() - start, iterations);
+    
+    start = get_time_ns();
+    for (size_t i = 0; i < iterations; i++) {
+        string_clear(out);
+        if (!string_append_url_encoded(out, sv, STRING_URL_FORM) || !string_url_decode(out, STRING_URL_FORM)) break;
+        total += string_length(out);
+    }
+    print_benchmark_result("URL encode+decode 64K", get_time_ns() - start, iterations);
+    
+    volatile size_t sink = total;
+    (void)sink;
+    string_free(escaped);
+    string_free(out);
+    string_free(text);
+}
+
+/**
+ * Benchmark interning repeated labels against allocating a copy of each
+ */
+void benchmark_pool() {
+    const size_t iterations = 1000000;
+    const char* labels[] = { "host", "accept", "user-agent", "content-type", "content-length",
+                             "x-request-id", "authorization", "accept-encoding" };
+    const size_t label_count = sizeof(labels) / sizeof(labels[0]);
+    
+    long long start = get_time_ns();
+    size_t total = 0;
+    for (size_t i = 0; i < iterations; i++) {
+        string* copy = string_new(labels[i % label_count]);
+        total += string_length(copy);
+        string_free(copy);
+    }
+    print_benchmark_result("Copy label", get_time_ns() - start, iterations);
+    
+    string_pool* pool = string_pool_new();
+    start = get_time_ns();
+    for (size_t i = 0; i < iterations; i++) {
+        total += string_length(string_pool_intern(pool, labels[i % label_count]));
+    }
+    print_benchmark_result("Intern label", get_time_ns() - start, iterations);
+    
+    const string* first = string_pool_intern(pool, "accept-encoding");
+    const string* second = string_pool_intern(pool, "accept-encodinX");
+    start = get_time_ns();
+    for (size_t i = 0; i < iterations; i++) total += string_equals(first, second);
+    print_benchmark_result("Equals interned", get_time_ns() - start, iterations);
+    
+    volatile size_t sink = total;
+    (void)sink;
+    string_pool_free(pool);
+}
+
+/**
+ * Benchmark building a large document from small pieces and splicing into
+ * its middle, with a rope and with a flat string
+ */
+void benchmark_rope() {
+    const size_t pieces = 100000;
+    const char* line = "<tr><td>some cell</td><td>another cell</td></tr>\n";
+    
+    long long start = get_time_ns();
+    string* flat = string_new(NULL);
+    for (size_t i = 0; i < pieces; i++) {
+        if (!string_append_cstr(flat, line)) break;
+    }
+    print_benchmark_result("String append 5MiB", get_time_ns() - start, pieces);
+    
+    start = get_time_ns();
+    string_rope* rope = string_rope_new();
+    for (size_t i = 0; i < pieces; i++) {
+        if (!string_rope_append(rope, string_view_from_cstr(line))) break;
+    }
+    print_benchmark_result("Rope append 5MiB", get_time_ns() - start, pieces);
+    
+    // Inserting into the middle of the flat string moves the whole tail
+    const size_t inserts = 200;
+    string_view insert = string_view_from_cstr("<!-- inserted -->");
+    start = get_time_ns();
+    for (size_t i = 0; i < inserts; i++) {
+        size_t pos = string_length(flat) / 2;
+        string* head = string_substr(flat, 0, pos);
+        string* tail = string_substr(flat, pos, SIZE_MAX);
+        bool ok = head && tail && string_append_view(head, insert) && string_append(head, tail);
+        string_free(tail);
+        if (!ok) {
+            string_free(head);
+            break;
+        }
+        string_free(flat);
+        flat = head;
+    }
+    print_benchmark_result("String insert mid", get_time_ns() - start, inserts);
+    
+    start = get_time_ns();
+    for (size_t i = 0; i < inserts; i++) {
+        if (!string_rope_insert(rope, string_rope_length(rope) / 2, insert)) break;
+    }
+    print_benchmark_result("Rope insert mid", get_time_ns() - start, inserts);
+    
+    start = get_time_ns();
+    size_t chunks = 0;
+    string_rope_iter iter;
+    string_rope_iter_init(&iter, rope);
+    while (string_rope_iter_next(&iter, NULL)) chunks++;
+    print_benchmark_result("Rope chunk walk", get_time_ns() - start, chunks);
+    
+    start = get_time_ns();
+    const string* flattened = string_rope_flatten(rope);
+    print_benchmark_result("Rope flatten", get_time_ns() - start, 1);
+    if (flattened && string_length(flattened) != string_length(flat)) printf("rope length mismatch\n");
+    
+    string_rope_free(rope);
+    string_free(flat);
+}
+
+/**
+ * Benchmark loading a log file by copying and by mapping, then walking it
+ * line by line
+ */
+void benchmark_file_loading() {
+    const size_t size = 32 << 20;
+    const char* line = "2024-01-01T00:00:00Z INFO request served in 12ms path=/api/v1/items\n";
+    size_t line_len = strlen(line);
+    char* content = malloc(size);
+    for (size_t i = 0; i < size; i++) content[i] = line[i % line_len];
+    
+    char path[64];
+    if (!write_temp_file(path, sizeof(path), content, size)) {
+        free(content);
+        return;
+    }
+    free(content);
+    
+    const size_t iterations = 5;
+    long long start = get_time_ns();
+    for (size_t i = 0; i < iterations; i++) string_free(string_from_file(path, STRING_FILE_READ));
+    print_benchmark_result("Load 32MiB read", get_time_ns() - start, iterations);
+    
+    start = get_time_ns();
+    for (size_t i = 0; i < iterations; i++) string_free(string_from_file(path, STRING_FILE_MAP));
+    print_benchmark_result("Load 32MiB mmap", get_time_ns() - start, iterations);
+    
+    string* mapped = string_from_file(path, STRING_FILE_MAP);
+    size_t lines = 0;
+    start = get_time_ns();
+    for (size_t i = 0; i < iterations; i++) {
+        string_line_iter iter;
+        string_line_iter_init(&iter, string_as_view(mapped));
+        while (string_line_iter_next(&iter, NULL)) lines++;
+    }
+    print_benchmark_result("Lines 32MiB mmap", get_time_ns() - start, lines);
+    
+    string_free(mapped);
+    unlink(path);
+}
+
+static int compare_for_qsort(const void* a, const void* b) {
+    return string_compare(*(string* const*)a, *(string* const*)b);
+}
+
+/**
+ * Benchmark sorting 1M split words: qsort with string_compare against the
+ * prefix-cached multikey sort
+ */
+void benchmark_array_sort() {
+    const size_t count = 1 << 20;
+    string** words = malloc(count * sizeof(string*));
+    string** order = malloc(count * sizeof(string*));
+    uint32_t seed = 1;
+    for (size_t i = 0; i < count; i++) {
+        char word[32];
+        int length = snprintf(word, sizeof(word), "user/%u/item", (seed = seed * 1103515245 + 12345) >> 8);
+        words[i] = string_new_n(word, (size_t)length);
+    }
+    
+    memcpy(order, words, count * sizeof(string*));
+    long long start = get_time_ns();
+    qsort(order, count, sizeof(string*), compare_for_qsort);
+    print_benchmark_result("Sort 1M qsort", get_time_ns() - start, count);
+    
+    memcpy(order, words, count * sizeof(string*));
+    start = get_time_ns();
+    string_array_sort(order, count);
+    print_benchmark_result("Sort 1M multikey", get_time_ns() - start, count);
+    
+    memcpy(order, words, count * sizeof(string*));
+    start = get_time_ns();
+    string_array_sort_parallel(order, count, 0);
+    print_benchmark_result("Sort 1M parallel", get_time_ns() - start, count);
+    
+    for (size_t i = 0; i < count; i++) string_free(words[i]);
+    free(order);
+    free(words);
+}
+
+/**
+ * Benchmark numeric appends and parsing against snprintf and strtod
+ */
+void benchmark_numbers() {
+    const size_t count = 1 << 16;
+    const size_t iterations = 1000000;
+    int64_t* ints = malloc(count * sizeof(int64_t));
+    double* doubles = malloc(count * sizeof(double));
+    uint64_t seed = 88172645463325252ull;
+    for (size_t i = 0; i < count; i++) {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        ints[i] = (int64_t)(seed >> (seed % 48));
+        doubles[i] = (double)(seed >> 11) / (double)(1ull << (seed % 40));
+    }
+    string* line = string_with_capacity(64);
+    char buffer[64];
+    uint64_t acc = 0;
+    
+    long long start = get_time_ns();
+    for (size_t i = 0; i < iterations; i++) {
+        string_clear(line);
+        acc += string_append_int(line, ints[i & (count - 1)]);
+    }
+    print_benchmark_result("Append int", get_time_ns() - start, iterations);
+    
+    start = get_time_ns();
+    for (size_t i = 0; i < iterations; i++) {
+        string_clear(line);
+        int length = snprintf(buffer, sizeof(buffer), "%lld", (long long)ints[i & (count - 1)]);
+        acc += string_append_n(line, buffer, (size_t)length);
+    }
+    print_benchmark_result("snprintf int", get_time_ns() - start, iterations);
+    
+    start = get_time_ns();
+    for (size_t i = 0; i < iterations; i++) {
+        string_clear(line);
+        acc += string_append_double(line, doubles[i & (count - 1)]);
+    }
+    print_benchmark_result("Append double", get_time_ns() - start, iterations);
+    
+    start = get_time_ns();
+    for (size_t i = 0; i < iterations; i++) {
+        string_clear(line);
+        int length = snprintf(buffer, sizeof(buffer), "%.17g", doubles[i & (count - 1)]);
+        acc += string_append_n(line, buffer, (size_t)length);
+    }
+    print_benchmark_result("snprintf %.17g", get_time_ns() - start, iterations);
+    
+    // Parse the shortest forms back
+    string** texts = malloc(count * sizeof(string*));
+    for (size_t i = 0; i < count; i++) {
+        texts[i] = string_new("");
+        if (!string_append_double(texts[i], doubles[i])) break;
+    }
+    double sum = 0;
+    start = get_time_ns();
+    for (size_t i = 0; i < iterations; i++) {
+        double value = 0;
+        acc += string_to_double(texts[i & (count - 1)], &value);
+        sum += value;
+    }
+    print_benchmark_result("Parse double", get_time_ns() - start, iterations);
+    
+    start = get_time_ns();
+    for (size_t i = 0; i < iterations; i++) sum += strtod(string_cstr(texts[i & (count - 1)]), NULL);
+    print_benchmark_result("strtod", get_time_ns() - start, iterations);
+    
+    for (size_t i = 0; i < count; i++) {
+        string_clear(texts[i]);
+        if (!string_append_int(texts[i], ints[i])) break;
+    }
+    start = get_time_ns();
+    for (size_t i = 0; i < iterations; i++) {
+        int64_t value = 0;
+        acc += string_to_int64(texts[i & (count - 1)], &value);
+        acc += (uint64_t)value;
+    }
+    print_benchmark_result("Parse int64", get_time_ns() - start, iterations);
+    
+    start = get_time_ns();
+    for (size_t i = 0; i < iterations; i++) acc += (uint64_t)strtoll(string_cstr(texts[i & (count - 1)]), NULL, 10);
+    print_benchmark_result("strtoll", get_time_ns() - start, iterations);
+    
+    volatile uint64_t sink = acc + (uint64_t)sum;
+    (void)sink;
+    for (size_t i = 0; i < count; i++) string_free(texts[i]);
+    free(texts);
+    string_free(line);
+    free(doubles);
+    free(ints);
+}
+
+/**
+ * Benchmark string manipulation operations
+ */
+void benchmark_manipulations() {
+    const size_t iterations = 10000;
+    long long start = get_time_ns();
+    
+    for (size_t i = 0; i < iterations; i++) {
+        string* str = string_new("  hello, World! This is a TEST string.  ");
+        string_trim(str);
+        string_to_upper(str);
+        string_to_lower(str);
+        if (!string_replace(str, "test", "benchmark")) {
+            printf("Error: replace failed at iteration %zu\n", i);
+        }
+        string_free(str);
+    }
+    
+    long long end = get_time_ns();
+    print_benchmark_result("Manipulations", end - start, iterations);
+}
+
+/**
+ * Benchmark string split and join operations
+ */
+void benchmark_split_join() {
+    const size_t iterations = 10000;
+    long long start = get_time_ns();
+    
+    for (size_t i = 0; i < iterations; i++) {
+        string* str = string_new("one,two,three,four,five,six,seven");
+        size_t count = 0;
+        string** parts = string_split(str, ",", &count);
+        
+        string* joined = string_join(parts, count, "-");
+        
+        string_free(str);
+        string_free(joined);
+        for (size_t j = 0; j < count; j++) {
+            string_free(parts[j]);
+        }
+        free(parts);
+    }
+    
+    long long end = get_time_ns();
+    print_benchmark_result("Split/Join", end - start, iterations);
+}
+
+/**
+ * Benchmark a large population of short strings, where the header size
+ * decides how many strings fit in each cache line
+ */
+void benchmark_many_small() {
+    const size_t count = 1000000;
+    const size_t passes = 10;
+    string** strs = malloc(count * sizeof(string*));
+    char buf[32];
+    
+    for (size_t i = 0; i < count; i++) {
+        snprintf(buf, sizeof(buf), "key-%zu", i);
+        strs[i] = string_new(buf);
+    }
+    
+    long long start = get_time_ns();
+    size_t total = 0;
+    for (size_t p = 0; p < passes; p++) {
+        for (size_t i = 0; i < count; i++) {
+            total += string_length(strs[i]) + (unsigned char)string_char_at(strs[i], 0);
+        }
+    }
+    long long end = get_time_ns();
+    volatile size_t sink = total;
+    (void)sink;
+    
+    for (size_t i = 0; i < count; i++) {
+        string_free(strs[i]);
+    }
+    free(strs);
+    print_benchmark_result("Many Small (scan)", end - start, count * passes);
+}
+
+/**
+ * Benchmark split and join with pieces allocated from an arena
+ */
+void benchmark_arena_split_join() {
+    const size_t iterations = 10000;
+    string_arena* arena = string_arena_new(0);
+    long long start = get_time_ns();
+    
+    for (size_t i = 0; i < iterations; i++) {
+        string* str = string_new_in(arena, "one,two,three,four,five,six,seven");
+        size_t count = 0;
+        string** parts = string_split_in(arena, str, ",", &count);
+        
+        string* joined = string_join(parts, count, "-");
+        string_free(joined);
+        string_arena_reset(arena);
+    }
+    
+    long long end = get_time_ns();
+    string_arena_free(arena);
+    print_benchmark_result("Arena Split/Join", end - start, iterations);
+}
+
+/**
+ * Run all workload benchmarks
+ */
+void run_benchmarks() {
+    printf("\n=== WORKLOAD BENCHMARKS ===\n");
+    printf("sizeof(string) = %zu bytes\n", sizeof(string));
+    printf("%-20s | %10s | %12s | %8s\n", "Operation", "Time (ms)", "Ops/sec", "Iterations");
+    printf("---------------------------------------------------------------\n");
+    
+    benchmark_create_free();
+    benchmark_init_destroy();
+    benchmark_append();
+    benchmark_append_large();
+    benchmark_find();
+    benchmark_find_long();
+    benchmark_searcher();
+    benchmark_replace_many();
+    benchmark_replace_expand();
+    benchmark_manipulations();
+    benchmark_split_join();
+    benchmark_join_write();
+    benchmark_escape();
+    benchmark_arena_split_join();
+    benchmark_tokenizer();
+    benchmark_string_array();
+    benchmark_hash();
+    benchmark_numbers();
+    benchmark_pool();
+    benchmark_rope();
+    benchmark_file_loading();
+    benchmark_array_sort();
+    benchmark_many_small();
+}
+
+int main(int argc, char** argv) {
+    printf("C23 String Library Benchmarks\n");
+    printf("=============================\n");
+    printf("Dispatched SIMD level: %s\n", string_simd_level_name(string_simd_get_level()));
+    
+    // A filter narrows the run to matching per-size rows
+    const char* filter = argc > 1 ? argv[1] : NULL;
+    run_kernel_matrix(filter);
+    if (!filter) run_benchmarks();
+    
+    printf("\nAll benchmarks completed.\n");
+    return 0;
+}
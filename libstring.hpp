@@ -0,0 +1,294 @@
+/**
+ * @file libstring.hpp
+ * @brief Header-only C++17 wrapper for string_lib.h
+ *
+ * libstring::string owns one ::string by value, so it is the same 24 bytes
+ * and short values need no allocation. It is move-only: a move copies the
+ * struct and leaves the source empty, stealing a heap buffer or carrying
+ * the inline bytes along, and never allocates. Copies are explicit through
+ * clone(). Allocation failures throw std::bad_alloc and lengths past
+ * STRING_MAX_LENGTH throw std::length_error.
+ */
+#ifndef LIBSTRING_HPP
+#define LIBSTRING_HPP
+
+#include "string_lib.h"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace libstring {
+
+class string;
+
+namespace detail {
+
+// The tag byte layout documented on ::string: the last byte holds
+// SSO_SIZE - length for inline strings and has its high bit set for heap
+// ones. Reading it here keeps the hot accessors out of the shared library.
+inline constexpr unsigned char tag_heap = 0x80;
+
+inline unsigned char tag(const ::string& str) noexcept {
+    return reinterpret_cast<const unsigned char*>(&str)[sizeof(::string) - 1];
+}
+
+inline bool is_small(const ::string& str) noexcept {
+    return !(tag(str) & tag_heap);
+}
+
+// Throw for a failed call that sets errno the way the C API documents
+[[noreturn]] inline void throw_error() {
+    if (errno == EOVERFLOW) throw std::length_error("libstring: length limit exceeded");
+    throw std::bad_alloc();
+}
+
+inline void check(bool ok) {
+    if (!ok) throw_error();
+}
+
+inline ::string_view to_c(std::string_view sv) noexcept {
+    return ::string_view{ sv.data(), sv.size() };
+}
+
+// Types other than string itself that read as a view: std::string_view,
+// std::string, C strings and literals. Taking them through a template keeps
+// the implicit conversions from making mixed comparisons ambiguous.
+template <class T>
+using if_view_like = std::enable_if_t<std::is_convertible_v<const T&, std::string_view> &&
+                                      !std::is_same_v<T, string>, int>;
+
+}  // namespace detail
+
+/**
+ * @brief Move-only owning string backed by a ::string stored by value
+ */
+class string {
+public:
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    /**
+     * @brief Empty string; inline, so neither this nor destroying it calls the library
+     */
+    string() noexcept {
+        reset();
+    }
+
+    string(std::string_view sv) {
+        reset();
+        detail::check(string_set_n(&str_, sv.data(), sv.size()));
+    }
+
+    string(const char* cstr) : string(std::string_view(cstr ? cstr : "")) {}
+
+    // Anything else that converts to std::string_view, such as std::string
+    template <class T, detail::if_view_like<T> = 0,
+              std::enable_if_t<!std::is_convertible_v<const T&, const char*>, int> = 0>
+    string(const T& value) : string(std::string_view(value)) {}
+
+    string(const string&) = delete;
+    string& operator=(const string&) = delete;
+
+    string(string&& other) noexcept : str_(other.str_) {
+        other.reset();
+    }
+
+    string& operator=(string&& other) noexcept {
+        if (this != &other) {
+            destroy();
+            str_ = other.str_;
+            other.reset();
+        }
+        return *this;
+    }
+
+    template <class T, detail::if_view_like<T> = 0>
+    string& operator=(const T& value) {
+        std::string_view sv(value);
+        detail::check(string_set_n(&str_, sv.data(), sv.size()));
+        return *this;
+    }
+
+    ~string() {
+        destroy();
+    }
+
+    /**
+     * @brief Explicit deep copy
+     */
+    [[nodiscard]] string clone() const {
+        return string(view());
+    }
+
+    // Inline accessors
+    [[nodiscard]] std::size_t length() const noexcept {
+        return detail::is_small(str_) ? static_cast<std::size_t>(SSO_SIZE - detail::tag(str_))
+                                      : str_.heap.length;
+    }
+    [[nodiscard]] std::size_t size() const noexcept { return length(); }
+    [[nodiscard]] bool empty() const noexcept { return length() == 0; }
+
+    [[nodiscard]] const char* cstr() const noexcept {
+        return detail::is_small(str_) ? str_.stack.data : str_.heap.data;
+    }
+    [[nodiscard]] const char* c_str() const noexcept { return cstr(); }
+    [[nodiscard]] const char* data() const noexcept { return cstr(); }
+
+    /**
+     * @brief Byte at index, or '\0' past the end like string_char_at
+     */
+    [[nodiscard]] char char_at(std::size_t index) const noexcept {
+        return index < length() ? cstr()[index] : '\0';
+    }
+
+    /**
+     * @brief Unchecked byte access
+     */
+    [[nodiscard]] char operator[](std::size_t index) const noexcept {
+        return cstr()[index];
+    }
+
+    [[nodiscard]] std::string_view view() const noexcept {
+        return std::string_view(cstr(), length());
+    }
+    operator std::string_view() const noexcept { return view(); }
+
+    [[nodiscard]] std::size_t capacity() const noexcept { return string_capacity(&str_); }
+
+    /**
+     * @brief Hash, cached on heap strings; the same value libstring::hash gives a view of the bytes
+     */
+    [[nodiscard]] std::uint64_t hash() const noexcept { return string_hash(&str_); }
+
+    // Modifiers
+    string& append(std::string_view sv) {
+        detail::check(string_append_n(&str_, sv.data(), sv.size()));
+        return *this;
+    }
+    string& append(char c) {
+        detail::check(string_append_char(&str_, c));
+        return *this;
+    }
+    string& append_int(std::int64_t value) {
+        detail::check(string_append_int(&str_, value));
+        return *this;
+    }
+    string& append_double(double value) {
+        detail::check(string_append_double(&str_, value));
+        return *this;
+    }
+    string& operator+=(std::string_view sv) { return append(sv); }
+    string& operator+=(char c) { return append(c); }
+    void push_back(char c) { append(c); }
+
+    void clear() noexcept { string_clear(&str_); }
+    void reserve(std::size_t length) { detail::check(string_reserve(&str_, length)); }
+    void shrink_to_fit() noexcept { string_shrink_to_fit(&str_); }
+    void to_upper() noexcept { string_to_upper(&str_); }
+    void to_lower() noexcept { string_to_lower(&str_); }
+
+    /**
+     * @brief Offset of the first occurrence of needle, or npos
+     */
+    [[nodiscard]] std::size_t find(std::string_view needle) const noexcept {
+        std::ptrdiff_t found = string_find_view(&str_, detail::to_c(needle));
+        return found < 0 ? npos : static_cast<std::size_t>(found);
+    }
+
+    /**
+     * @brief The wrapped struct, for calling the C API directly
+     */
+    [[nodiscard]] ::string* get() noexcept { return &str_; }
+    [[nodiscard]] const ::string* get() const noexcept { return &str_; }
+
+    friend bool operator==(const string& a, const string& b) noexcept {
+        return string_equals(&a.str_, &b.str_);
+    }
+    friend bool operator!=(const string& a, const string& b) noexcept { return !(a == b); }
+
+private:
+    // Same bytes as STRING_INIT, which is not valid C++
+    void reset() noexcept {
+        std::memset(static_cast<void*>(&str_), 0, sizeof(str_));
+        str_.stack.data[SSO_SIZE] = SSO_SIZE;
+    }
+
+    void destroy() noexcept {
+        if (!detail::is_small(str_)) string_destroy(&str_);
+    }
+
+    ::string str_;
+};
+
+static_assert(sizeof(string) == sizeof(::string), "libstring::string must embed ::string exactly");
+
+// Mixed comparisons go through views, whose byte order is string_compare's
+template <class T, detail::if_view_like<T> = 0>
+bool operator==(const string& a, const T& b) noexcept { return a.view() == std::string_view(b); }
+template <class T, detail::if_view_like<T> = 0>
+bool operator==(const T& a, const string& b) noexcept { return std::string_view(a) == b.view(); }
+template <class T, detail::if_view_like<T> = 0>
+bool operator!=(const string& a, const T& b) noexcept { return !(a == b); }
+template <class T, detail::if_view_like<T> = 0>
+bool operator!=(const T& a, const string& b) noexcept { return !(a == b); }
+
+inline bool operator<(const string& a, const string& b) noexcept { return a.view() < b.view(); }
+template <class T, detail::if_view_like<T> = 0>
+bool operator<(const string& a, const T& b) noexcept { return a.view() < std::string_view(b); }
+template <class T, detail::if_view_like<T> = 0>
+bool operator<(const T& a, const string& b) noexcept { return std::string_view(a) < b.view(); }
+inline bool operator>(const string& a, const string& b) noexcept { return b < a; }
+inline bool operator<=(const string& a, const string& b) noexcept { return !(b < a); }
+inline bool operator>=(const string& a, const string& b) noexcept { return !(a < b); }
+
+/**
+ * @brief Transparent hash: strings and views of the same bytes hash alike
+ */
+struct hash {
+    using is_transparent = void;
+
+    std::size_t operator()(const string& str) const noexcept {
+        return static_cast<std::size_t>(str.hash());
+    }
+    template <class T, detail::if_view_like<T> = 0>
+    std::size_t operator()(const T& value) const noexcept {
+        return static_cast<std::size_t>(string_view_hash(detail::to_c(std::string_view(value))));
+    }
+};
+
+/**
+ * @brief Transparent equality between strings, views and C strings
+ */
+struct equal_to {
+    using is_transparent = void;
+
+    bool operator()(const string& a, const string& b) const noexcept { return a == b; }
+    template <class A, class B>
+    bool operator()(const A& a, const B& b) const noexcept {
+        return std::string_view(a) == std::string_view(b);
+    }
+};
+
+}  // namespace libstring
+
+// The defaults for unordered containers, so that with C++20 heterogeneous
+// lookup an unordered_map<libstring::string, V> takes views and C strings
+// without building a temporary key
+namespace std {
+
+template <>
+struct hash<libstring::string> : libstring::hash {};
+
+template <>
+struct equal_to<libstring::string> : libstring::equal_to {};
+
+}  // namespace std
+
+#endif /* LIBSTRING_HPP */
@@ -1,746 +1,7433 @@
-#define _GNU_SOURCE  // For memmem
 #define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE  // MAP_ANONYMOUS and madvise for string_from_file
 /**
  * @file string_lib.c
  * @brief Optimized C23 string library implementation with SSO
  */
 #include "string_lib.h"
 #include <string.h>
-#include <ctype.h>
 #include <errno.h>
+#include <float.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#define STRING_HAVE_MMAP 1
+#endif
 
 // Initial capacity for new strings
 #define INITIAL_CAPACITY 16
 // Use cache line size for optimal memory alignment
 #define CACHE_LINE_SIZE 64
+// Default arena block size when the caller passes 0
+#define ARENA_DEFAULT_BLOCK_SIZE (64 * 1024)
+// Arena buffers below a cache line are only aligned to this
+#define ARENA_SMALL_ALIGN 16
+
+// Both representations share the last byte of the struct. A small string
+// stores SSO_SIZE - length there, so a full 23-character string reuses it as
+// its null terminator. Heap strings set STRING_TAG_HEAP plus their flags; on
+// 64-bit targets this byte overlaps the top byte of heap.capacity.
+#define STRING_TAG(str) (((const unsigned char*)(str))[sizeof(string) - 1])
+#define STRING_TAG_HEAP  0x80   // Data lives in heap.data
+#define STRING_TAG_ARENA 0x40   // Header and heap data belong to a string_arena
+#define STRING_TAG_HASHED 0x20  // The last 8 bytes of the heap buffer hold the hash
+#define STRING_TAG_INTERNED 0x10 // Canonical string owned by a string_pool
+#define STRING_TAG_MAPPED 0x08  // heap.data is a private file mapping of heap.capacity bytes
+#define STRING_TAG_SHARED 0x04  // Reference-counted buffer, see shared_trailer
+#define STRING_TAG_ASCII 0x02   // Contents were validated as pure ASCII
+
+// The byte below the tag holds the allocator_table index of a heap string's
+// buffer, so it is always returned to the allocator that produced it
+#define STRING_ALLOCATOR(str) (((const unsigned char*)(str))[sizeof(string) - 2])
+
+#if SIZE_MAX > UINT32_MAX && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define CAPACITY_SHIFT 16       // The tag and allocator are the low bytes of heap.capacity
+#else
+#define CAPACITY_SHIFT 0
+#endif
+
+#if SIZE_MAX > UINT32_MAX
+#define CAPACITY_MAX (SIZE_MAX >> 16)
+#else
+#define CAPACITY_MAX SIZE_MAX   // heap.capacity ends before the allocator and tag bytes
+#endif
+
+static_assert(sizeof(string) == SSO_SIZE + 1, "string must fit in its inline buffer");
 
 // Helper macros for safer access
-#define STRING_DATA(str) ((str)->is_small ? (str)->stack.data : (str)->heap.data)
-#define STRING_CAPACITY(str) ((str)->is_small ? SSO_SIZE : (str)->heap.capacity)
+#define STRING_IS_SMALL(str) (!(STRING_TAG(str) & STRING_TAG_HEAP))
+#define STRING_IN_ARENA(str) ((STRING_TAG(str) & STRING_TAG_ARENA) != 0)
+#define STRING_LENGTH(str) (STRING_IS_SMALL(str) ? (size_t)(SSO_SIZE - STRING_TAG(str)) : (str)->heap.length)
+#define STRING_DATA(str) (STRING_IS_SMALL(str) ? (str)->stack.data : (str)->heap.data)
+// Usable bytes including the null terminator
+#define STRING_CAPACITY(str) (STRING_IS_SMALL(str) ? (size_t)SSO_SIZE + 1 : heap_capacity(str))
 
-// Convert from heap to stack storage if possible
-static inline void try_shrink_to_small(string* str) {
-    if (!str || str->is_small || str->length > SSO_SIZE) return;
-    
-    char* old_data = str->heap.data;
-    memcpy(str->stack.data, old_data, str->length + 1);
-    free(old_data);
-    str->is_small = 1;
+// Instrumentation counters, kept per thread in STRING_STATS builds and
+// compiled out otherwise
+#ifdef STRING_STATS
+static _Thread_local string_stats thread_stats;
+#define STAT_ADD(field, n) (thread_stats.field += (n))
+#else
+#define STAT_ADD(field, n) ((void)0)
+#endif
+
+static inline void set_tag(string* str, unsigned char tag) {
+    ((unsigned char*)str)[sizeof(string) - 1] = tag;
 }
 
-// Convert from stack to heap storage when needed
-static inline bool convert_to_heap(string* str, size_t needed_capacity) {
-    if (!str) return false;
-    if (!str->is_small) return true;  // Already on heap
-    
-    // Round up to multiple of CACHE_LINE_SIZE for better memory alignment
-    size_t new_capacity = (needed_capacity + CACHE_LINE_SIZE - 1) & ~(CACHE_LINE_SIZE - 1);
-    
-    // Allocate new heap storage
-    char* new_data = aligned_alloc(CACHE_LINE_SIZE, new_capacity);
-    if (!new_data) {
-        errno = ENOMEM;
-        return false;
+static inline void set_allocator(string* str, unsigned char allocator) {
+    ((unsigned char*)str)[sizeof(string) - 2] = allocator;
+}
+
+static inline size_t heap_capacity(const string* str) {
+    return (str->heap.capacity >> CAPACITY_SHIFT) & CAPACITY_MAX;
+}
+
+// Store a heap capacity without disturbing the tag and allocator bytes it
+// may overlap; the cached hash lives at the end of the buffer, so it has to go
+static inline void set_heap_capacity(string* str, size_t capacity) {
+    unsigned char tag = STRING_TAG(str) & ~STRING_TAG_HASHED;
+    unsigned char allocator = STRING_ALLOCATOR(str);
+    str->heap.capacity = capacity << CAPACITY_SHIFT;
+    set_allocator(str, allocator);
+    set_tag(str, tag);
+}
+
+// Switch str to the heap representation, with a buffer from allocator
+static inline void set_heap(string* str, char* data, size_t length, size_t capacity,
+                            unsigned char flags, unsigned char allocator) {
+    str->heap.data = data;
+    str->heap.length = length;
+    set_tag(str, STRING_TAG_HEAP | flags);
+    set_allocator(str, allocator);
+    set_heap_capacity(str, capacity);
+}
+
+static inline void init_small(string* str) {
+    str->stack.data[0] = '\0';
+    set_tag(str, SSO_SIZE);
+}
+
+// Flags describing the contents, which every change to the bytes drops
+#define STRING_TAG_CONTENT (STRING_TAG_HASHED | STRING_TAG_ASCII)
+
+// Store a new length and its null terminator. Every mutation ends here, so
+// this is also where a cached hash and the ASCII flag are dropped.
+static inline void set_length(string* str, size_t length) {
+    if (STRING_IS_SMALL(str)) {
+        // At length == SSO_SIZE the terminator is the tag byte itself
+        str->stack.data[length] = '\0';
+        set_tag(str, (unsigned char)(SSO_SIZE - length));
+    } else {
+        str->heap.data[length] = '\0';
+        str->heap.length = length;
+        set_tag(str, STRING_TAG(str) & ~STRING_TAG_CONTENT);
     }
-    
-    // Copy from stack to heap
-    memcpy(new_data, str->stack.data, str->length + 1);
-    str->heap.data = new_data;
-    str->heap.capacity = new_capacity;
-    str->is_small = 0;
-    return true;
 }
 
-static inline bool ensure_capacity(string* str, size_t needed_capacity) {
-    if (!str) return false;
+// Drop a cached hash and the ASCII flag after changing bytes in place
+static inline void invalidate_hash(string* str) {
+    if (!STRING_IS_SMALL(str)) set_tag(str, STRING_TAG(str) & ~STRING_TAG_CONTENT);
+}
+
+// Round up to multiple of CACHE_LINE_SIZE for better memory alignment
+static inline size_t round_to_cache_line(size_t size) {
+    return (size + CACHE_LINE_SIZE - 1) & ~(size_t)(CACHE_LINE_SIZE - 1);
+}
+
+// Allocators. Buffers record the index of their allocator in this table,
+// which only ever grows, so a buffer can be released through the right one
+// from any thread; entry 0 is the C library.
+#define ALLOCATOR_MAX 256
+
+// Rounds up to a multiple of align, as aligned_alloc requires
+static void* default_allocate(void* context, size_t size, size_t align) {
+    (void)context;
+    if (align <= _Alignof(max_align_t)) return malloc(size);
+    return aligned_alloc(align, (size + align - 1) & ~(align - 1));
+}
+
+// realloc only promises max_align_t, so a block it moves to a less aligned
+// address is moved once more. Should that copy fail, the misaligned block is
+// kept: the kernels never need alignment, it only saves split cache lines.
+static void* default_reallocate(void* context, void* ptr, size_t old_size, size_t new_size, size_t align) {
+    (void)old_size;
+    void* moved = realloc(ptr, new_size);
+    if (!moved || ((uintptr_t)moved & (align - 1)) == 0) return moved;
     
-    // Check if capacity is already sufficient
-    if (STRING_CAPACITY(str) >= needed_capacity) return true;
+    void* aligned = default_allocate(context, new_size, align);
+    if (!aligned) return moved;
+    memcpy(aligned, moved, new_size);
+    free(moved);
+    return aligned;
+}
+
+static void default_deallocate(void* context, void* ptr, size_t size) {
+    (void)context;
+    (void)size;
+    free(ptr);
+}
+
+static const string_allocator default_allocator = {
+    default_allocate, default_reallocate, default_deallocate, NULL
+};
+
+static const string_allocator* allocator_table[ALLOCATOR_MAX] = { &default_allocator };
+static size_t allocator_count = 1;
+static pthread_mutex_t allocator_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static _Atomic unsigned char global_allocator;
+static _Thread_local int thread_allocator = -1;     // Index, or -1 to follow global_allocator
+
+// Allocator for new buffers on the calling thread
+static inline unsigned char current_allocator(void) {
+    if (thread_allocator >= 0) return (unsigned char)thread_allocator;
+    return atomic_load_explicit(&global_allocator, memory_order_acquire);
+}
+
+static inline void* allocator_alloc(unsigned char allocator, size_t size, size_t align) {
+    if (allocator == 0) return default_allocate(NULL, size, align);
+    const string_allocator* a = allocator_table[allocator];
+    return a->allocate(a->context, size, align);
+}
+
+// Allocators without reallocate get allocate, copy and deallocate
+static inline void* allocator_realloc(unsigned char allocator, void* ptr, size_t used,
+                                      size_t old_size, size_t new_size, size_t align) {
+    if (allocator == 0) return default_reallocate(NULL, ptr, old_size, new_size, align);
+    const string_allocator* a = allocator_table[allocator];
+    if (a->reallocate) return a->reallocate(a->context, ptr, old_size, new_size, align);
     
-    // Need to switch from stack to heap?
-    if (str->is_small) {
-        return convert_to_heap(str, needed_capacity);
+    void* moved = a->allocate(a->context, new_size, align);
+    if (!moved) return NULL;
+    memcpy(moved, ptr, used < new_size ? used : new_size);
+    a->deallocate(a->context, ptr, old_size);
+    return moved;
+}
+
+static inline void allocator_free(unsigned char allocator, void* ptr, size_t size) {
+    if (allocator == 0) {
+        free(ptr);
+        return;
     }
-    
-    // Already on heap, just resize
-    size_t new_capacity = str->heap.capacity;
-    while (new_capacity < needed_capacity) {
-        if (__builtin_mul_overflow(new_capacity, 2, &new_capacity)) {
-            new_capacity = needed_capacity;
-        }
+    const string_allocator* a = allocator_table[allocator];
+    a->deallocate(a->context, ptr, size);
+}
+
+// Table index for an allocator, adding it on first use
+static int allocator_index(const string_allocator* allocator) {
+    if (!allocator) return 0;
+    if (!allocator->allocate || !allocator->deallocate) {
+        errno = EINVAL;
+        return -1;
     }
     
-    // Round up to multiple of CACHE_LINE_SIZE for better memory alignment
-    new_capacity = (new_capacity + CACHE_LINE_SIZE - 1) & ~(CACHE_LINE_SIZE - 1);
-    
-    char* new_data = realloc(str->heap.data, new_capacity);
-    if (!new_data) {
-        errno = ENOMEM;
-        return false;
+    pthread_mutex_lock(&allocator_lock);
+    int index = -1;
+    for (size_t i = 0; i < allocator_count; i++) {
+        if (allocator_table[i] == allocator) index = (int)i;
+    }
+    if (index < 0 && allocator_count < ALLOCATOR_MAX) {
+        index = (int)allocator_count;
+        allocator_table[allocator_count++] = allocator;
     }
+    pthread_mutex_unlock(&allocator_lock);
     
-    str->heap.data = new_data;
-    str->heap.capacity = new_capacity;
+    if (index < 0) errno = ENOSPC;
+    return index;
+}
+
+bool string_set_allocator(const string_allocator* allocator) {
+    int index = allocator_index(allocator);
+    if (index < 0) return false;
+    atomic_store_explicit(&global_allocator, (unsigned char)index, memory_order_release);
     return true;
 }
 
-string* string_new(const char* initial_value) {
-    string* str = malloc(sizeof(string));
-    if (!str) return NULL;
-    
-    // Initialize as small string
-    str->is_small = 1;
-    str->length = 0;
-    str->stack.data[0] = '\0';
-    
-    if (initial_value) {
-        if (!string_set(str, initial_value)) {
-            string_free(str);
-            return NULL;
-        }
+bool string_set_thread_allocator(const string_allocator* allocator) {
+    if (!allocator) {
+        thread_allocator = -1;
+        return true;
     }
-    
-    return str;
+    int index = allocator_index(allocator);
+    if (index < 0) return false;
+    thread_allocator = index;
+    return true;
 }
 
-string* string_with_capacity(size_t capacity) {
-    string* str = malloc(sizeof(string));
-    if (!str) return NULL;
-    
-    if (capacity <= SSO_SIZE) {
-        // Initialize as small string
-        str->is_small = 1;
-        str->length = 0;
-        str->stack.data[0] = '\0';
-    } else {
-        // Initialize as heap string
-        size_t actual_capacity = (capacity + CACHE_LINE_SIZE - 1) & ~(CACHE_LINE_SIZE - 1);
-        str->heap.data = aligned_alloc(CACHE_LINE_SIZE, actual_capacity);
-        
-        if (!str->heap.data) {
-            free(str);
-            errno = ENOMEM;
-            return NULL;
+// Per-thread cache of C library buffers, one freelist per cache-line
+// multiple up to BUFFER_CACHE_MAX bytes plus one for string headers, so
+// strings of similar sizes that come and go skip aligned_alloc, which unlike
+// malloc has no fast path of its own. Blocks are linked through their first
+// bytes and may be released by any thread, since they all end up in free();
+// custom allocators keep their own size classes.
+#define BUFFER_CACHE_CLASSES 64
+#define BUFFER_CACHE_MAX (BUFFER_CACHE_CLASSES * CACHE_LINE_SIZE)
+#define BUFFER_CACHE_DEPTH 16       // Most buffers kept per size class
+#define BUFFER_CACHE_CLASS_BYTES 8192   // Larger classes keep fewer buffers
+#define HEADER_CACHE_DEPTH 64
+
+typedef struct cached_block {
+    struct cached_block* next;
+} cached_block;
+
+typedef struct {
+    cached_block* buffers[BUFFER_CACHE_CLASSES];
+    unsigned char counts[BUFFER_CACHE_CLASSES];
+    cached_block* headers;
+    unsigned char header_count;
+    bool registered;                // cache_key will release the cache at thread exit
+} buffer_cache;
+
+static _Thread_local buffer_cache thread_cache;
+static pthread_key_t cache_key;
+static pthread_once_t cache_key_once = PTHREAD_ONCE_INIT;
+static bool cache_key_valid;
+
+static void cache_flush(buffer_cache* cache) {
+    for (size_t i = 0; i < BUFFER_CACHE_CLASSES; i++) {
+        while (cache->buffers[i]) {
+            cached_block* next = cache->buffers[i]->next;
+            free(cache->buffers[i]);
+            cache->buffers[i] = next;
+            STAT_ADD(frees, 1);
         }
-        
-        str->is_small = 0;
-        str->length = 0;
-        str->heap.capacity = actual_capacity;
-        str->heap.data[0] = '\0';
+        cache->counts[i] = 0;
     }
-    
-    return str;
+    while (cache->headers) {
+        cached_block* next = cache->headers->next;
+        free(cache->headers);
+        cache->headers = next;
+        STAT_ADD(frees, 1);
+    }
+    cache->header_count = 0;
 }
 
-void string_free(string* str) {
-    if (!str) return;
-    if (!str->is_small) {
-        free(str->heap.data);
-    }
-    free(str);
+static void cache_thread_exit(void* cache) {
+    cache_flush(cache);
+    ((buffer_cache*)cache)->registered = false;
 }
 
-// Optimized core functions
-size_t string_length(const string* str) {
-    return str ? str->length : 0;
+static void cache_key_create(void) {
+    cache_key_valid = pthread_key_create(&cache_key, cache_thread_exit) == 0;
 }
 
-size_t string_capacity(const string* str) {
-    return str ? STRING_CAPACITY(str) : 0;
+// Arrange for the cache to be released when the thread exits; nothing is
+// cached on a thread where that is impossible
+static bool cache_register(void) {
+    if (thread_cache.registered) return true;
+    pthread_once(&cache_key_once, cache_key_create);
+    thread_cache.registered = cache_key_valid && pthread_setspecific(cache_key, &thread_cache) == 0;
+    return thread_cache.registered;
 }
 
-const char* string_cstr(const string* str) {
-    return str ? STRING_DATA(str) : NULL;
+void string_buffer_cache_release(void) {
+    cache_flush(&thread_cache);
 }
 
-bool string_is_empty(const string* str) {
-    return !str || str->length == 0;
+static inline bool cache_holds(unsigned char allocator, size_t capacity) {
+    return allocator == 0 && capacity != 0 && capacity <= BUFFER_CACHE_MAX &&
+           capacity % CACHE_LINE_SIZE == 0;
 }
 
-bool string_append(string* str, const string* other) {
-    if (!str || !other) return false;
-    return string_append_cstr(str, STRING_DATA(other));
+static inline void* cache_take(size_t capacity) {
+    size_t index = capacity / CACHE_LINE_SIZE - 1;
+    cached_block* block = thread_cache.buffers[index];
+    if (!block) return NULL;
+    thread_cache.buffers[index] = block->next;
+    thread_cache.counts[index]--;
+    STAT_ADD(cache_hits, 1);
+    return block;
 }
 
-bool string_append_cstr(string* str, const char* cstr) {
-    if (!str || !cstr) return false;
-    
-    size_t cstr_len = strlen(cstr);
-    if (cstr_len == 0) return true;  // Early return for empty strings
-    
-    if (!ensure_capacity(str, str->length + cstr_len + 1)) {
-        return false;
-    }
-    
-    memcpy(STRING_DATA(str) + str->length, cstr, cstr_len + 1);
-    str->length += cstr_len;
+static inline bool cache_put(void* ptr, size_t capacity) {
+    size_t index = capacity / CACHE_LINE_SIZE - 1;
+    size_t depth = BUFFER_CACHE_CLASS_BYTES / capacity;
+    if (depth > BUFFER_CACHE_DEPTH) depth = BUFFER_CACHE_DEPTH;
+    if (thread_cache.counts[index] >= depth || !cache_register()) return false;
+    cached_block* block = ptr;
+    block->next = thread_cache.buffers[index];
+    thread_cache.buffers[index] = block;
+    thread_cache.counts[index]++;
+    STAT_ADD(cache_returns, 1);
     return true;
 }
 
-bool string_append_char(string* str, char c) {
-    if (!str) return false;
-    
-    if (!ensure_capacity(str, str->length + 2)) {
-        return false;
+// Heap buffer of capacity bytes, from the cache when its allocator is the C library
+static inline char* heap_buffer_alloc(unsigned char allocator, size_t capacity) {
+    if (cache_holds(allocator, capacity)) {
+        char* data = cache_take(capacity);
+        if (data) return data;
     }
-    
-    STRING_DATA(str)[str->length] = c;
-    STRING_DATA(str)[++str->length] = '\0';
-    return true;
+    char* data = allocator_alloc(allocator, capacity, CACHE_LINE_SIZE);
+    STAT_ADD(allocations, data ? 1 : 0);
+    STAT_ADD(bytes_allocated, data ? capacity : 0);
+    return data;
 }
 
-bool string_set(string* str, const char* cstr) {
-    if (!str || !cstr) return false;
-    
-    size_t cstr_len = strlen(cstr);
-    if (!ensure_capacity(str, cstr_len + 1)) {
-        return false;
+static inline void heap_buffer_free(unsigned char allocator, void* data, size_t capacity) {
+    if (cache_holds(allocator, capacity) && cache_put(data, capacity)) return;
+    allocator_free(allocator, data, capacity);
+    STAT_ADD(frees, 1);
+}
+
+// Headers of heap-allocated strings come from the global allocator, since
+// a small string has no spare byte to remember another one
+static inline string* header_alloc(void) {
+    unsigned char allocator = atomic_load_explicit(&global_allocator, memory_order_acquire);
+    if (allocator == 0 && thread_cache.headers) {
+        cached_block* block = thread_cache.headers;
+        thread_cache.headers = block->next;
+        thread_cache.header_count--;
+        STAT_ADD(cache_hits, 1);
+        return (string*)block;
     }
     
-    memcpy(STRING_DATA(str), cstr, cstr_len + 1);
-    str->length = cstr_len;
-    return true;
+    string* str = allocator_alloc(allocator, sizeof(string), _Alignof(string));
+    if (!str) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    STAT_ADD(allocations, 1);
+    STAT_ADD(bytes_allocated, sizeof(string));
+    return str;
 }
 
-void string_clear(string* str) {
-    if (!str) return;
-    STRING_DATA(str)[0] = '\0';
-    str->length = 0;
+static inline void header_free(string* str) {
+    unsigned char allocator = atomic_load_explicit(&global_allocator, memory_order_acquire);
+    if (allocator == 0 && thread_cache.header_count < HEADER_CACHE_DEPTH && cache_register()) {
+        cached_block* block = (cached_block*)str;
+        block->next = thread_cache.headers;
+        thread_cache.headers = block;
+        thread_cache.header_count++;
+        STAT_ADD(cache_returns, 1);
+        return;
+    }
+    allocator_free(allocator, str, sizeof(string));
+    STAT_ADD(frees, 1);
 }
 
-#ifdef __SSE4_2__
-#include <nmmintrin.h>
-// SSE4.2 optimized string compare
-int string_compare(const string* str1, const string* str2) {
-    if (!str1 && !str2) return 0;
-    if (!str1) return -1;
-    if (!str2) return 1;
-    
-    // For very short strings, use standard memcmp to avoid overhead
-    if (str1->length < 16 || str2->length < 16) {
-        size_t min_len = (str1->length < str2->length) ? str1->length : str2->length;
-        int result = memcmp(STRING_DATA(str1), STRING_DATA(str2), min_len);
-        return result != 0 ? result : (str1->length - str2->length);
+// Arena block; the usable bytes start at the next cache line after the header
+typedef struct arena_block {
+    struct arena_block* next;
+    size_t size;                // Usable bytes in this block
+    size_t used;                // Bytes handed out so far
+} arena_block;
+
+#define ARENA_BLOCK_HEADER round_to_cache_line(sizeof(arena_block))
+
+struct string_arena {
+    arena_block* head;          // Block currently being bumped into
+    arena_block* spare;         // Standard-size blocks kept across resets
+    size_t block_size;          // Usable size of a standard block
+    unsigned char allocator;    // Source of the blocks and the arena itself
+};
+
+// Strings created in an arena carry a back pointer so they can grow there
+typedef struct {
+    string_arena* arena;
+    string str;
+} arena_string;
+
+static inline char* arena_block_data(arena_block* block) {
+    return (char*)block + ARENA_BLOCK_HEADER;
+}
+
+static inline string_arena* arena_of(const string* str) {
+    return ((const arena_string*)((const char*)str - offsetof(arena_string, str)))->arena;
+}
+
+// Interned strings are arena strings that also record their pool, so
+// string_equals can tell whether two of them were deduplicated together
+typedef struct {
+    const string_pool* pool;
+    arena_string owned;
+} pooled_string;
+
+#define STRING_IS_INTERNED(str) \
+    ((STRING_TAG(str) & (STRING_TAG_HEAP | STRING_TAG_INTERNED)) == (STRING_TAG_HEAP | STRING_TAG_INTERNED))
+
+static inline const string_pool* pool_of(const string* str) {
+    return ((const pooled_string*)((const char*)str - offsetof(pooled_string, owned.str)))->pool;
+}
+
+// Shared buffers end with a trailer holding their reference count. A shared
+// string may view a suffix of its buffer, so its capacity is the distance
+// from heap.data to the end of the buffer rather than the buffer's size.
+typedef struct {
+    _Atomic size_t refs;
+    size_t capacity;            // Size of the whole buffer
+} shared_trailer;
+
+#define STRING_IS_SHARED(str) \
+    ((STRING_TAG(str) & (STRING_TAG_HEAP | STRING_TAG_SHARED)) == (STRING_TAG_HEAP | STRING_TAG_SHARED))
+
+static inline shared_trailer* shared_trailer_of(const string* str) {
+    return (shared_trailer*)(str->heap.data + heap_capacity(str) - sizeof(shared_trailer));
+}
+
+static inline char* shared_block(const shared_trailer* trailer) {
+    return (char*)(trailer + 1) - trailer->capacity;
+}
+
+// Drop one reference; the last one frees the buffer
+static inline void shared_release(const string* str) {
+    shared_trailer* trailer = shared_trailer_of(str);
+    if (atomic_fetch_sub_explicit(&trailer->refs, 1, memory_order_acq_rel) == 1) {
+        heap_buffer_free(STRING_ALLOCATOR(str), shared_block(trailer), trailer->capacity);
     }
-    
-    size_t len = (str1->length < str2->length) ? str1->length : str2->length;
-    size_t i = 0;
-    
-    // Process 16 bytes at a time using SSE4.2
-    while (i + 16 <= len) {
-        __m128i xmm1 = _mm_loadu_si128((__m128i*)(STRING_DATA(str1) + i));
-        __m128i xmm2 = _mm_loadu_si128((__m128i*)(STRING_DATA(str2) + i));
-        
-        int result = _mm_cmpestri(
-            xmm1, 16,
-            xmm2, 16,
-            _SIDD_CMP_EQUAL_EACH | _SIDD_NEGATIVE_POLARITY | _SIDD_LEAST_SIGNIFICANT
-        );
-        
-        if (result != 16) {
-            // Found a differing character
-            return (unsigned char)STRING_DATA(str1)[i + result] - (unsigned char)STRING_DATA(str2)[i + result];
-        }
-        
-        i += 16;
+}
+
+static arena_block* arena_block_new(const string_arena* arena, size_t size) {
+    size_t total;
+    if (__builtin_add_overflow(ARENA_BLOCK_HEADER, round_to_cache_line(size), &total)) {
+        errno = ENOMEM;
+        return NULL;
     }
     
-    // Handle remaining bytes
-    if (i < len) {
-        int result = memcmp(STRING_DATA(str1) + i, STRING_DATA(str2) + i, len - i);
-        return result != 0 ? result : (str1->length - str2->length);
+    arena_block* block = allocator_alloc(arena->allocator, total, CACHE_LINE_SIZE);
+    if (!block) {
+        errno = ENOMEM;
+        return NULL;
     }
     
-    // Strings are equal up to the minimum length, so the shorter one is less
-    return str1->length - str2->length;
+    block->next = NULL;
+    block->size = total - ARENA_BLOCK_HEADER;
+    block->used = 0;
+    return block;
 }
 
-// SSE4.2 optimized string equality check
-bool string_equals(const string* str1, const string* str2) {
-    if (str1 == str2) return true;
-    if (!str1 || !str2) return false;
-    if (str1->length != str2->length) return false;
+// Bump-allocate size bytes aligned to align (a power of two)
+static void* arena_alloc(string_arena* arena, size_t size, size_t align) {
+    arena_block* block = arena->head;
     
-    // For very short strings, use standard memcmp to avoid overhead
-    if (str1->length < 16) {
-        return memcmp(STRING_DATA(str1), STRING_DATA(str2), str1->length) == 0;
+    if (block) {
+        size_t offset = (block->used + align - 1) & ~(align - 1);
+        if (offset <= block->size && size <= block->size - offset) {
+            block->used = offset + size;
+            return arena_block_data(block) + offset;
+        }
     }
     
-    size_t i = 0;
-    size_t len = str1->length;
-    
-    // Process 16 bytes at a time using SSE4.2
-    while (i + 16 <= len) {
-        __m128i xmm1 = _mm_loadu_si128((__m128i*)(STRING_DATA(str1) + i));
-        __m128i xmm2 = _mm_loadu_si128((__m128i*)(STRING_DATA(str2) + i));
-        
-        int diff = _mm_cmpestri(
-            xmm1, 16,
-            xmm2, 16,
-            _SIDD_CMP_EQUAL_EACH | _SIDD_NEGATIVE_POLARITY | _SIDD_LEAST_SIGNIFICANT
-        );
+    // Oversized requests get a dedicated block behind the current one so the
+    // remaining space in the current block is not wasted
+    if (size > arena->block_size / 4) {
+        arena_block* big = arena_block_new(arena, size);
+        if (!big) return NULL;
         
-        if (diff != 16) {
-            return false;  // Found a difference
+        big->used = size;
+        if (block) {
+            big->next = block->next;
+            block->next = big;
+        } else {
+            arena->head = big;
         }
-        
-        i += 16;
+        return arena_block_data(big);
     }
     
-    // Handle remaining bytes
-    return memcmp(STRING_DATA(str1) + i, STRING_DATA(str2) + i, len - i) == 0;
+    // Start a fresh standard block, reusing one retained by a reset if possible
+    arena_block* fresh = arena->spare;
+    if (fresh) {
+        arena->spare = fresh->next;
+        fresh->used = 0;
+    } else {
+        fresh = arena_block_new(arena, arena->block_size);
+        if (!fresh) return NULL;
+    }
+    
+    fresh->next = block;
+    arena->head = fresh;
+    fresh->used = size;
+    return arena_block_data(fresh);
 }
 
-// SSE4.2 optimized string find
-ptrdiff_t string_find_cstr(const string* str, const char* substr) {
-    if (!str || !substr) return -1;
-    
-    size_t substr_len = strlen(substr);
-    if (substr_len == 0) return 0;
-    if (substr_len > str->length) return -1;
+// Grow the most recent allocation in place when it ends at the bump pointer
+static bool arena_try_extend(string_arena* arena, char* ptr, size_t old_size, size_t new_size) {
+    arena_block* block = arena->head;
+    if (!block || ptr + old_size != arena_block_data(block) + block->used) return false;
     
-    // For very short needles or haystacks, use standard memmem
-    if (substr_len < 8 || str->length < 16) {
-        char* found = memmem(STRING_DATA(str), str->length, substr, substr_len);
-        return found ? (found - STRING_DATA(str)) : -1;
-    }
+    size_t start = (size_t)(ptr - arena_block_data(block));
+    if (new_size > block->size - start) return false;
     
-    // For longer needles, use SSE4.2 string search
-    const int mode = _SIDD_CMP_EQUAL_ORDERED | _SIDD_UBYTE_OPS | _SIDD_LEAST_SIGNIFICANT;
-    __m128i needle;
+    block->used = start + new_size;
+    return true;
+}
+
+string_arena* string_arena_new(size_t block_size) {
+    return string_arena_new_with_allocator(block_size, NULL);
+}
+
+string_arena* string_arena_new_with_allocator(size_t block_size, const string_allocator* allocator) {
+    int index = allocator ? allocator_index(allocator) : current_allocator();
+    if (index < 0) return NULL;
     
-    // Load up to 16 bytes of the needle
-    if (substr_len >= 16) {
-        needle = _mm_loadu_si128((__m128i*)substr);
-    } else {
-        char temp[16] = {0};
-        memcpy(temp, substr, substr_len);
-        needle = _mm_loadu_si128((__m128i*)temp);
+    string_arena* arena = allocator_alloc((unsigned char)index, sizeof(string_arena), _Alignof(string_arena));
+    if (!arena) {
+        errno = ENOMEM;
+        return NULL;
     }
     
-    size_t i = 0;
-    while (i <= str->length - substr_len) {
-        size_t remaining = str->length - i;
-        if (remaining < 16) {
-            // Fall back to standard search for the last few bytes
-            char* found = memmem(STRING_DATA(str) + i, remaining, substr, substr_len);
-            return found ? (found - STRING_DATA(str)) : -1;
-        }
-        
-        __m128i haystack = _mm_loadu_si128((__m128i*)(STRING_DATA(str) + i));
-        int index = _mm_cmpestri(needle, substr_len, haystack, 16, mode);
-        
-        if (index < 16) {
-            // Potential match - verify it's complete
-            if (i + index + substr_len <= str->length &&
-                memcmp(STRING_DATA(str) + i + index, substr, substr_len) == 0) {
-                return i + index;
-            }
-            // Move forward to check after this partial match
-            i += index + 1;
+    arena->head = NULL;
+    arena->spare = NULL;
+    arena->block_size = round_to_cache_line(block_size ? block_size : ARENA_DEFAULT_BLOCK_SIZE);
+    arena->allocator = (unsigned char)index;
+    return arena;
+}
+
+void string_arena_reset(string_arena* arena) {
+    if (!arena) return;
+    
+    arena_block* block = arena->head;
+    while (block) {
+        arena_block* next = block->next;
+        if (block->size == arena->block_size) {
+            block->next = arena->spare;
+            arena->spare = block;
         } else {
-            // No match in this 16-byte segment
-            i += 16 - substr_len + 1;
+            allocator_free(arena->allocator, block, ARENA_BLOCK_HEADER + block->size);
         }
+        block = next;
     }
-    
-    return -1;
+    arena->head = NULL;
 }
 
-// SSE4.2 optimized string to uppercase
-void string_to_upper(string* str) {
-    if (!str || !str->length) return;
-    
-    const size_t len = str->length;
-    char* data = STRING_DATA(str);
+void string_arena_free(string_arena* arena) {
+    if (!arena) return;
     
-    // For very short strings, use standard implementation
-    if (len < 16) {
-        for (size_t i = 0; i < len; i++) {
-            data[i] = toupper((unsigned char)data[i]);
-        }
-        return;
+    string_arena_reset(arena);
+    while (arena->spare) {
+        arena_block* next = arena->spare->next;
+        allocator_free(arena->allocator, arena->spare, ARENA_BLOCK_HEADER + arena->spare->size);
+        arena->spare = next;
     }
+    allocator_free(arena->allocator, arena, sizeof(string_arena));
+}
+
+size_t string_arena_used(const string_arena* arena) {
+    if (!arena) return 0;
     
-    // Use SIMD to process 16 bytes at a time
+    size_t used = 0;
+    for (const arena_block* block = arena->head; block; block = block->next) {
+        used += block->used;
+    }
+    return used;
+}
+
+// Heap capacity for a request; arena strings use smaller steps below a cache line
+static inline size_t round_capacity(const string* str, size_t needed) {
+    if (STRING_IN_ARENA(str) && needed < CACHE_LINE_SIZE) {
+        return (needed + ARENA_SMALL_ALIGN - 1) & ~(size_t)(ARENA_SMALL_ALIGN - 1);
+    }
+    return round_to_cache_line(needed);
+}
+
+// Allocate a cache-line aligned heap buffer for str from the calling
+// thread's allocator, whose index is stored in allocator for set_heap
+static inline char* buffer_alloc(const string* str, size_t capacity, unsigned char* allocator) {
+    char* data;
+    if (STRING_IN_ARENA(str)) {
+        *allocator = 0;
+        data = arena_alloc(arena_of(str), capacity,
+                           capacity < CACHE_LINE_SIZE ? ARENA_SMALL_ALIGN : CACHE_LINE_SIZE);
+    } else {
+        *allocator = current_allocator();
+        data = heap_buffer_alloc(*allocator, capacity);
+    }
+    if (!data) errno = ENOMEM;
+    return data;
+}
+
+// Release a heap buffer; arena buffers are reclaimed by string_arena_reset.
+// str must still describe the buffer, since a mapping is unmapped by size.
+static inline void buffer_free(const string* str, char* data) {
+    if (STRING_IS_SHARED(str)) {
+        shared_release(str);
+        return;
+    }
+#ifdef STRING_HAVE_MMAP
+    if (STRING_TAG(str) & STRING_TAG_MAPPED) {
+        munmap(data, heap_capacity(str));
+        STAT_ADD(frees, 1);
+        return;
+    }
+#endif
+    if (!STRING_IN_ARENA(str)) {
+        heap_buffer_free(STRING_ALLOCATOR(str), data, heap_capacity(str));
+    }
+}
+
+// Resize a heap buffer, preserving the first used bytes
+static inline char* buffer_realloc(string* str, char* data, size_t used,
+                                   size_t old_capacity, size_t new_capacity) {
+#ifdef STRING_HAVE_MMAP
+    if (STRING_TAG(str) & STRING_TAG_MAPPED) {
+        // A mapping cannot grow in place, so the string moves to the heap
+        unsigned char allocator = current_allocator();
+        char* new_data = allocator_alloc(allocator, new_capacity, CACHE_LINE_SIZE);
+        if (!new_data) {
+            errno = ENOMEM;
+            return NULL;
+        }
+        memcpy(new_data, data, used < new_capacity ? used : new_capacity);
+        munmap(data, old_capacity);
+        set_tag(str, STRING_TAG(str) & ~STRING_TAG_MAPPED);
+        set_allocator(str, allocator);
+        STAT_ADD(bytes_allocated, new_capacity);
+        return new_data;
+    }
+#endif
+    if (!STRING_IN_ARENA(str)) {
+        // Between cached sizes a swap of blocks beats realloc, which would
+        // copy anyway to keep the alignment
+        unsigned char allocator = STRING_ALLOCATOR(str);
+        if (cache_holds(allocator, old_capacity) && cache_holds(allocator, new_capacity)) {
+            char* cached = cache_take(new_capacity);
+            if (cached) {
+                memcpy(cached, data, used < new_capacity ? used : new_capacity);
+                heap_buffer_free(allocator, data, old_capacity);
+                return cached;
+            }
+        }
+        char* new_data = allocator_realloc(allocator, data, used,
+                                           old_capacity, new_capacity, CACHE_LINE_SIZE);
+        if (!new_data) errno = ENOMEM;
+        STAT_ADD(bytes_allocated, new_data ? new_capacity : 0);
+        return new_data;
+    }
+    
+    string_arena* arena = arena_of(str);
+    if (arena_try_extend(arena, data, old_capacity, new_capacity)) return data;
+    
+    char* new_data = arena_alloc(arena, new_capacity,
+                                 new_capacity < CACHE_LINE_SIZE ? ARENA_SMALL_ALIGN : CACHE_LINE_SIZE);
+    if (!new_data) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    memcpy(new_data, data, used);
+    return new_data;
+}
+
+// Convert from heap to stack storage if possible; arena strings stay on the heap
+static inline void try_shrink_to_small(string* str) {
+    if (!str || STRING_IS_SMALL(str) || STRING_IN_ARENA(str)) return;
+    
+    size_t length = str->heap.length;
+    if (length > SSO_SIZE) return;
+    
+    // Copying into the inline buffer overwrites the header describing the
+    // heap buffer, so keep that description for buffer_free
+    string heap = *str;
+    memcpy(str->stack.data, heap.heap.data, length);
+    buffer_free(&heap, heap.heap.data);
+    set_tag(str, 0);
+    set_length(str, length);
+    STAT_ADD(shrinks, 1);
+}
+
+// Convert from stack to heap storage when needed
+static inline bool convert_to_heap(string* str, size_t needed_capacity) {
+    if (!str) return false;
+    if (!STRING_IS_SMALL(str)) return true;  // Already on heap
+    
+    size_t new_capacity = round_to_cache_line(needed_capacity);
+    if (new_capacity > CAPACITY_MAX || new_capacity < needed_capacity) {
+        errno = EOVERFLOW;
+        return false;
+    }
+    
+    // Allocate new heap storage
+    unsigned char allocator;
+    char* new_data = buffer_alloc(str, new_capacity, &allocator);
+    if (!new_data) return false;
+    STAT_ADD(heap_promotions, 1);
+    
+    // Copy from stack to heap
+    size_t length = STRING_LENGTH(str);
+    memcpy(new_data, str->stack.data, length);
+    new_data[length] = '\0';
+    set_heap(str, new_data, length, new_capacity, 0, allocator);
+    return true;
+}
+
+// Give a shared string a private buffer of at least capacity bytes holding
+// length bytes of its view from offset, and drop its reference. The last
+// owner keeps the buffer when it is large enough and just moves the bytes.
+static bool detach(string* str, size_t offset, size_t length, size_t capacity) {
+    shared_trailer* trailer = shared_trailer_of(str);
+    char* block = shared_block(trailer);
+    const char* bytes = str->heap.data + offset;
+    if (capacity < length + 1) capacity = length + 1;
+    
+    if (capacity <= trailer->capacity &&
+        atomic_load_explicit(&trailer->refs, memory_order_acquire) == 1) {
+        size_t block_capacity = trailer->capacity;
+        memmove(block, bytes, length);
+        set_heap(str, block, length, block_capacity, 0, STRING_ALLOCATOR(str));
+        set_length(str, length);
+        return true;
+    }
+    
+    size_t new_capacity = round_to_cache_line(capacity);
+    if (new_capacity > CAPACITY_MAX || new_capacity < capacity) {
+        errno = EOVERFLOW;
+        return false;
+    }
+    unsigned char allocator;
+    char* new_data = buffer_alloc(str, new_capacity, &allocator);
+    if (!new_data) return false;
+    
+    memcpy(new_data, bytes, length);
+    shared_release(str);
+    set_heap(str, new_data, length, new_capacity, 0, allocator);
+    set_length(str, length);
+    return true;
+}
+
+// Make sure str owns its buffer before writing to it in place
+static inline bool unshare(string* str) {
+    return !STRING_IS_SHARED(str) || detach(str, 0, str->heap.length, 0);
+}
+
+static inline bool ensure_capacity(string* str, size_t needed_capacity) {
+    if (!str) return false;
+    
+    // Any write to a shared buffer needs a private copy first
+    if (STRING_IS_SHARED(str)) return detach(str, 0, str->heap.length, needed_capacity);
+    
+    // Check if capacity is already sufficient
+    if (STRING_CAPACITY(str) >= needed_capacity) return true;
+    
+    // Need to switch from stack to heap?
+    if (STRING_IS_SMALL(str)) {
+        return convert_to_heap(str, needed_capacity);
+    }
+    
+    // Already on heap, just resize
+    size_t old_capacity = heap_capacity(str);
+    size_t new_capacity = old_capacity;
+    while (new_capacity < needed_capacity) {
+        if (__builtin_mul_overflow(new_capacity, 2, &new_capacity) || new_capacity > CAPACITY_MAX) {
+            new_capacity = needed_capacity;
+        }
+    }
+    
+    new_capacity = round_capacity(str, new_capacity);
+    if (new_capacity > CAPACITY_MAX || new_capacity < needed_capacity) {
+        errno = EOVERFLOW;
+        return false;
+    }
+    
+    char* new_data = buffer_realloc(str, str->heap.data, str->heap.length + 1,
+                                    old_capacity, new_capacity);
+    if (!new_data) return false;
+    STAT_ADD(growth_reallocs, 1);
+    
+    str->heap.data = new_data;
+    set_heap_capacity(str, new_capacity);
+    return true;
+}
+
+// Allocate an empty string header, from the arena when one is given. Arena
+// strings always use the heap representation so the tag can mark them, and
+// get a buffer of at least capacity bytes right behind the header.
+static string* header_new(string_arena* arena, size_t capacity) {
+    string* str;
+    
+    if (arena) {
+        arena_string* owned = arena_alloc(arena, sizeof(arena_string), _Alignof(arena_string));
+        if (!owned) {
+            errno = ENOMEM;
+            return NULL;
+        }
+        owned->arena = arena;
+        str = &owned->str;
+        
+        set_heap(str, NULL, 0, 0, STRING_TAG_ARENA, 0);
+        size_t actual_capacity = round_capacity(str, capacity ? capacity : 1);
+        if (actual_capacity > CAPACITY_MAX || actual_capacity < capacity) {
+            errno = EOVERFLOW;
+            return NULL;
+        }
+        
+        unsigned char allocator;
+        char* data = buffer_alloc(str, actual_capacity, &allocator);
+        if (!data) return NULL;
+        
+        data[0] = '\0';
+        str->heap.data = data;
+        set_heap_capacity(str, actual_capacity);
+        return str;
+    }
+    
+    str = header_alloc();
+    if (!str) return NULL;
+    
+    // Initialize as small string
+    init_small(str);
+    return str;
+}
+
+static string* with_capacity_in(string_arena* arena, size_t capacity) {
+    string* str = header_new(arena, capacity);
+    if (!str) return NULL;
+    
+    // Arena headers already come with a large enough buffer
+    if (arena) return str;
+    
+    if (capacity > STRING_CAPACITY(str)) {
+        // Initialize as heap string
+        size_t actual_capacity = round_to_cache_line(capacity);
+        if (actual_capacity > CAPACITY_MAX || actual_capacity < capacity) {
+            header_free(str);
+            errno = EOVERFLOW;
+            return NULL;
+        }
+        
+        unsigned char allocator;
+        char* data = buffer_alloc(str, actual_capacity, &allocator);
+        if (!data) {
+            header_free(str);
+            return NULL;
+        }
+        
+        data[0] = '\0';
+        set_heap(str, data, 0, actual_capacity, 0, allocator);
+    }
+    
+    return str;
+}
+
+static string* new_in(string_arena* arena, const char* data, size_t length) {
+    if (length == SIZE_MAX) {
+        errno = EOVERFLOW;
+        return NULL;
+    }
+    string* str = header_new(arena, length + 1);
+    if (!str) return NULL;
+    
+    if (length && !string_set_n(str, data, length)) {
+        string_free(str);
+        return NULL;
+    }
+    
+    return str;
+}
+
+string* string_new(const char* initial_value) {
+    return new_in(NULL, initial_value, initial_value ? strlen(initial_value) : 0);
+}
+
+string* string_new_n(const char* data, size_t length) {
+    if (!data && length) return NULL;
+    return new_in(NULL, data, length);
+}
+
+string* string_with_capacity(size_t capacity) {
+    return with_capacity_in(NULL, capacity);
+}
+
+string* string_new_in(string_arena* arena, const char* initial_value) {
+    if (!arena) return NULL;
+    return new_in(arena, initial_value, initial_value ? strlen(initial_value) : 0);
+}
+
+string* string_with_capacity_in(string_arena* arena, size_t capacity) {
+    if (!arena) return NULL;
+    return with_capacity_in(arena, capacity);
+}
+
+bool string_init(string* str, const char* initial_value) {
+    if (!str) return false;
+    
+    init_small(str);
+    return !initial_value || string_set(str, initial_value);
+}
+
+bool string_init_with_capacity(string* str, size_t capacity) {
+    if (!str) return false;
+    
+    init_small(str);
+    return ensure_capacity(str, capacity);
+}
+
+void string_destroy(string* str) {
+    if (!str || STRING_IN_ARENA(str)) return;
+    if (!STRING_IS_SMALL(str)) {
+        buffer_free(str, str->heap.data);
+    }
+    init_small(str);
+}
+
+void string_free(string* str) {
+    if (!str || STRING_IN_ARENA(str)) return;
+    string_destroy(str);
+    header_free(str);
+}
+
+// Switch a heap string to the shared representation with one reference.
+// The trailer needs room past the terminator, and a mapping cannot be freed
+// like a heap block, so both of those move to a new buffer first.
+static bool make_shared(string* str) {
+    size_t length = str->heap.length;
+    size_t capacity = heap_capacity(str);
+    
+    if (capacity - length - 1 < sizeof(shared_trailer) || (STRING_TAG(str) & STRING_TAG_MAPPED)) {
+        size_t new_capacity = round_to_cache_line(length + 1 + sizeof(shared_trailer));
+        if (new_capacity > CAPACITY_MAX || new_capacity < length) {
+            errno = EOVERFLOW;
+            return false;
+        }
+        char* data = buffer_realloc(str, str->heap.data, length + 1, capacity, new_capacity);
+        if (!data) return false;
+        str->heap.data = data;
+        capacity = new_capacity;
+    }
+    
+    set_heap(str, str->heap.data, length, capacity, STRING_TAG_SHARED, STRING_ALLOCATOR(str));
+    shared_trailer* trailer = shared_trailer_of(str);
+    trailer->capacity = capacity;
+    atomic_init(&trailer->refs, 1);
+    return true;
+}
+
+// New header for another reference to a shared string's buffer
+static string* share_handle(const string* str) {
+    string* copy = header_alloc();
+    if (!copy) return NULL;
+    
+    atomic_fetch_add_explicit(&shared_trailer_of(str)->refs, 1, memory_order_relaxed);
+    *copy = *str;
+    return copy;
+}
+
+string* string_share(string* str) {
+    if (!str) return NULL;
+    
+    // Small strings copy as fast as they share, and arena buffers, interned
+    // ones included, go away with their arena
+    if (STRING_IS_SMALL(str) || STRING_IN_ARENA(str)) {
+        return string_new_n(STRING_DATA(str), STRING_LENGTH(str));
+    }
+    if (!STRING_IS_SHARED(str) && !make_shared(str)) return NULL;
+    return share_handle(str);
+}
+
+string* string_clone(const string* str) {
+    if (!str) return NULL;
+    if (STRING_IS_SHARED(str)) return share_handle(str);
+    return string_new_n(STRING_DATA(str), STRING_LENGTH(str));
+}
+
+// Optimized core functions
+size_t string_length(const string* str) {
+    return str ? STRING_LENGTH(str) : 0;
+}
+
+size_t string_capacity(const string* str) {
+    if (!str) return 0;
+    if (STRING_IS_SHARED(str)) return str->heap.length;  // Any write copies
+    return STRING_IS_SMALL(str) ? SSO_SIZE : heap_capacity(str);
+}
+
+bool string_reserve(string* str, size_t length) {
+    if (!str) {
+        errno = EINVAL;
+        return false;
+    }
+    if (length > STRING_MAX_LENGTH) {
+        errno = EOVERFLOW;
+        return false;
+    }
+    return ensure_capacity(str, length + 1);
+}
+
+void string_shrink_to_fit(string* str) {
+    if (!str || STRING_IS_SMALL(str) || STRING_IN_ARENA(str) || STRING_IS_SHARED(str)) return;
+    if (STRING_TAG(str) & STRING_TAG_MAPPED) return;
+    
+    size_t length = str->heap.length;
+    if (length <= SSO_SIZE) {
+        try_shrink_to_small(str);
+        return;
+    }
+    
+    size_t old_capacity = heap_capacity(str);
+    size_t new_capacity = round_to_cache_line(length + 1);
+    if (new_capacity >= old_capacity) return;
+    
+    char* new_data = buffer_realloc(str, str->heap.data, length + 1, old_capacity, new_capacity);
+    if (!new_data) return;
+    str->heap.data = new_data;
+    set_heap_capacity(str, new_capacity);
+    STAT_ADD(shrinks, 1);
+}
+
+const char* string_cstr(const string* str) {
+    return str ? STRING_DATA(str) : NULL;
+}
+
+bool string_is_empty(const string* str) {
+    return !str || STRING_LENGTH(str) == 0;
+}
+
+// True if bytes points into the string's current buffer, in which case
+// growing the buffer would leave it dangling
+static inline bool aliases_string(const string* str, const char* bytes) {
+    uintptr_t data = (uintptr_t)STRING_DATA(str);
+    uintptr_t ptr = (uintptr_t)bytes;
+    return ptr >= data && ptr <= data + STRING_LENGTH(str);
+}
+
+// Append a byte range of known length; the source may alias str
+static bool append_bytes(string* str, const char* bytes, size_t len) {
+    if (len == 0) return true;  // Early return for empty strings
+    
+    size_t length = STRING_LENGTH(str);
+    size_t needed;
+    if (__builtin_add_overflow(length, len + 1, &needed)) {
+        errno = EOVERFLOW;
+        return false;
+    }
+    
+    bool aliased = aliases_string(str, bytes);
+    size_t offset = aliased ? (size_t)(bytes - STRING_DATA(str)) : 0;
+    
+    if (!ensure_capacity(str, needed)) {
+        return false;
+    }
+    
+    if (aliased) bytes = STRING_DATA(str) + offset;
+    memmove(STRING_DATA(str) + length, bytes, len);
+    set_length(str, length + len);
+    return true;
+}
+
+// Replace the content with a byte range of known length; the source may alias str
+static bool set_bytes(string* str, const char* bytes, size_t len) {
+    if (len == SIZE_MAX) {
+        errno = EOVERFLOW;
+        return false;
+    }
+    
+    // An aliased source is never longer than the string, so only a shared
+    // buffer gets replaced, and the copy keeps the source's offset
+    bool aliased = aliases_string(str, bytes);
+    size_t offset = aliased ? (size_t)(bytes - STRING_DATA(str)) : 0;
+    if ((!aliased || STRING_IS_SHARED(str)) && !ensure_capacity(str, len + 1)) {
+        return false;
+    }
+    
+    if (aliased) bytes = STRING_DATA(str) + offset;
+    memmove(STRING_DATA(str), bytes, len);
+    set_length(str, len);
+    return true;
+}
+
+bool string_append(string* str, const string* other) {
+    if (!str || !other) return false;
+    return append_bytes(str, STRING_DATA(other), STRING_LENGTH(other));
+}
+
+bool string_append_cstr(string* str, const char* cstr) {
+    if (!str || !cstr) return false;
+    return append_bytes(str, cstr, strlen(cstr));
+}
+
+bool string_append_char(string* str, char c) {
+    if (!str) return false;
+    
+    size_t length = STRING_LENGTH(str);
+    if (!ensure_capacity(str, length + 2)) {
+        return false;
+    }
+    
+    STRING_DATA(str)[length] = c;
+    set_length(str, length + 1);
+    return true;
+}
+
+bool string_set(string* str, const char* cstr) {
+    if (!str || !cstr) return false;
+    return set_bytes(str, cstr, strlen(cstr));
+}
+
+bool string_append_n(string* str, const char* data, size_t length) {
+    if (!str || (!data && length)) return false;
+    return append_bytes(str, data, length);
+}
+
+bool string_set_n(string* str, const char* data, size_t length) {
+    if (!str || (!data && length)) return false;
+    return set_bytes(str, data ? data : "", length);
+}
+
+void string_clear(string* str) {
+    if (!str) return;
+    if (STRING_IS_SHARED(str)) {
+        shared_release(str);
+        init_small(str);
+        return;
+    }
+    set_length(str, 0);
+}
+
+// ASCII-only case mapping shared by every kernel so that all dispatch levels
+// produce identical results regardless of the current locale
+static inline char ascii_to_upper(char c) {
+    return (c >= 'a' && c <= 'z') ? (char)(c - ('a' - 'A')) : c;
+}
+
+static inline char ascii_to_lower(char c) {
+    return (c >= 'A' && c <= 'Z') ? (char)(c + ('a' - 'A')) : c;
+}
+
+// Case-insensitive comparisons fold both sides to lowercase
+static inline unsigned char fold_byte(unsigned char c, bool fold) {
+    return fold ? (unsigned char)ascii_to_lower((char)c) : c;
+}
+
+static int icase_compare_bytes(const char* a, const char* b, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        unsigned char ca = (unsigned char)ascii_to_lower(a[i]);
+        unsigned char cb = (unsigned char)ascii_to_lower(b[i]);
+        if (ca != cb) return ca - cb;
+    }
+    return 0;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#define STRING_SIMD_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define STRING_SIMD_ARM 1
+#include <arm_neon.h>
+#endif
+
+// Compile a single function for an instruction set the rest of the
+// translation unit does not assume
+#define STRING_TARGET(isa) __attribute__((target(isa)))
+
+// Substring search shared by every dispatch level. The vector kernels only
+// filter candidate positions on the needle's first and last byte and verify
+// survivors with memcmp. Verification is charged against a budget linear in
+// the haystack length; once an input such as "aaa...ab" in "aaa...a" has used
+// it up, the search continues with Two-Way so the worst case stays O(n + m).
+
+// Crochemore-Perrin Two-Way preprocessing for one needle
+typedef struct {
+    size_t shift[256];          // One past the last index of each byte in the needle
+    size_t critical;            // Last index of the left half of the factorization
+    size_t period;              // Shift after the right half has matched
+    size_t memory;              // Left-half bytes known to match after a period shift
+} two_way_table;
+
+// Needle as seen by the find kernels
+typedef struct {
+    const char* data;
+    size_t length;                  // At least 1
+    const two_way_table* table;     // Precomputed by a searcher, or NULL
+} search_needle;
+
+// Needle byte i, folded to lowercase for case-insensitive tables
+#define TW_BYTE(n, i) fold_byte((n)[i], fold)
+
+// Critical factorization and last-byte shift table; needs 1 <= needle_len.
+// With fold the table describes the needle folded to lowercase.
+static void two_way_prepare(two_way_table* table, const char* needle, size_t needle_len, bool fold) {
+    const unsigned char* const n = (const unsigned char*)needle;
+    const size_t l = needle_len;
+    size_t ip, jp, k, p, ms, p0;
+    
+    memset(table->shift, 0, sizeof(table->shift));
+    for (size_t i = 0; i < l; i++) table->shift[TW_BYTE(n, i)] = i + 1;
+    
+    // Maximal suffix for <, then for >; the later critical position wins
+    ip = (size_t)-1; jp = 0; k = p = 1;
+    while (jp + k < l) {
+        if (TW_BYTE(n, ip + k) == TW_BYTE(n, jp + k)) {
+            if (k == p) {
+                jp += p;
+                k = 1;
+            } else {
+                k++;
+            }
+        } else if (TW_BYTE(n, ip + k) > TW_BYTE(n, jp + k)) {
+            jp += k;
+            k = 1;
+            p = jp - ip;
+        } else {
+            ip = jp++;
+            k = p = 1;
+        }
+    }
+    ms = ip;
+    p0 = p;
+    
+    ip = (size_t)-1; jp = 0; k = p = 1;
+    while (jp + k < l) {
+        if (TW_BYTE(n, ip + k) == TW_BYTE(n, jp + k)) {
+            if (k == p) {
+                jp += p;
+                k = 1;
+            } else {
+                k++;
+            }
+        } else if (TW_BYTE(n, ip + k) < TW_BYTE(n, jp + k)) {
+            jp += k;
+            k = 1;
+            p = jp - ip;
+        } else {
+            ip = jp++;
+            k = p = 1;
+        }
+    }
+    if (ip + 1 > ms + 1) {
+        ms = ip;
+    } else {
+        p = p0;
+    }
+    
+    // Periodic needles remember how much of the left half already matched
+    table->critical = ms;
+    bool periodic = fold ? icase_compare_bytes(needle, needle + p, ms + 1) == 0
+                         : memcmp(n, n + p, ms + 1) == 0;
+    if (!periodic) {
+        table->memory = 0;
+        table->period = (ms > l - ms - 1 ? ms : l - ms - 1) + 1;
+    } else {
+        table->memory = l - p;
+        table->period = p;
+    }
+}
+
+// Two-Way search in O(haystack_len + needle_len) with a prepared table,
+// folding the haystack as well if the table was prepared with fold
+static const char* two_way_search(const two_way_table* table,
+                                  const char* haystack, size_t haystack_len,
+                                  const char* needle, size_t needle_len, bool fold) {
+    const unsigned char* h = (const unsigned char*)haystack;
+    const unsigned char* const end = h + haystack_len;
+    const unsigned char* const n = (const unsigned char*)needle;
+    const size_t l = needle_len;
+    const size_t ms = table->critical;
+    size_t k, mem = 0;
+    
+    while ((size_t)(end - h) >= l) {
+        // Align the last occurrence of the byte under the needle's end
+        k = l - table->shift[TW_BYTE(h, l - 1)];
+        if (k) {
+            h += (k < mem) ? mem : k;
+            mem = 0;
+            continue;
+        }
+        
+        // Right half first, then left half
+        for (k = (ms + 1 > mem) ? ms + 1 : mem; k < l && TW_BYTE(n, k) == TW_BYTE(h, k); k++);
+        if (k < l) {
+            h += k - ms;
+            mem = 0;
+            continue;
+        }
+        for (k = ms + 1; k > mem && TW_BYTE(n, k - 1) == TW_BYTE(h, k - 1); k--);
+        if (k <= mem) return (const char*)h;
+        h += table->period;
+        mem = table->memory;
+    }
+    
+    return NULL;
+}
+
+// Resume with Two-Way at an offset once the filter has given up
+static const char* two_way_from(const char* haystack, size_t haystack_len,
+                                const search_needle* pattern, size_t start) {
+    if (start > haystack_len - pattern->length) return NULL;
+    
+    two_way_table local;
+    const two_way_table* table = pattern->table;
+    if (!table) {
+        two_way_prepare(&local, pattern->data, pattern->length, false);
+        table = &local;
+    }
+    return two_way_search(table, haystack + start, haystack_len - start,
+                          pattern->data, pattern->length, false);
+}
+
+// Case-insensitive Two-Way from an offset; searcher tables are exact, so
+// the folded table is always built here
+static const char* icase_two_way_from(const char* haystack, size_t haystack_len,
+                                      const search_needle* pattern, size_t start) {
+    if (start > haystack_len - pattern->length) return NULL;
+    
+    two_way_table table;
+    two_way_prepare(&table, pattern->data, pattern->length, true);
+    return two_way_search(&table, haystack + start, haystack_len - start,
+                          pattern->data, pattern->length, true);
+}
+
+// Needle bytes the filter may spend verifying candidates before switching
+static inline size_t search_budget(size_t haystack_len) {
+    return haystack_len < (SIZE_MAX - 4096) / 2 ? 2 * haystack_len + 4096 : SIZE_MAX;
+}
+
+// Charge one failed verification; false once the budget is exhausted
+static inline bool search_charge(size_t* budget, size_t needle_len) {
+    if (*budget < needle_len) return false;
+    *budget -= needle_len;
+    return true;
+}
+
+// Scalar first/last byte filter from start; memchr does the scanning and
+// the needle must be at least 2 bytes. Vector kernels finish their tail here.
+static const char* filter_find_from(const char* haystack, size_t haystack_len,
+                                    const search_needle* pattern,
+                                    size_t start, size_t budget) {
+    const char* const needle = pattern->data;
+    const size_t needle_len = pattern->length;
+    const char last = needle[needle_len - 1];
+    const size_t last_start = haystack_len - needle_len;
+    size_t pos = start;
+    
+    while (pos <= last_start) {
+        const char* hit = memchr(haystack + pos, needle[0], last_start - pos + 1);
+        if (!hit) return NULL;
+        pos = (size_t)(hit - haystack);
+        
+        if (haystack[pos + needle_len - 1] == last) {
+            if (memcmp(haystack + pos + 1, needle + 1, needle_len - 2) == 0) {
+                return haystack + pos;
+            }
+            if (!search_charge(&budget, needle_len)) {
+                return two_way_from(haystack, haystack_len, pattern, pos + 1);
+            }
+        }
+        pos++;
+    }
+    
+    return NULL;
+}
+
+// Case-insensitive filter_find_from: the first and last bytes are matched
+// folded, and needles of one byte are accepted here too
+static const char* icase_filter_find_from(const char* haystack, size_t haystack_len,
+                                          const search_needle* pattern,
+                                          size_t start, size_t budget) {
+    const char* const needle = pattern->data;
+    const size_t needle_len = pattern->length;
+    const char first = ascii_to_lower(needle[0]);
+    const char last = ascii_to_lower(needle[needle_len - 1]);
+    
+    for (size_t pos = start; pos <= haystack_len - needle_len; pos++) {
+        if (ascii_to_lower(haystack[pos]) != first ||
+            ascii_to_lower(haystack[pos + needle_len - 1]) != last) continue;
+        if (needle_len <= 2 || icase_compare_bytes(haystack + pos + 1, needle + 1, needle_len - 2) == 0) {
+            return haystack + pos;
+        }
+        if (!search_charge(&budget, needle_len)) {
+            return icase_two_way_from(haystack, haystack_len, pattern, pos + 1);
+        }
+    }
+    
+    return NULL;
+}
+
+// Byte membership set. The row tables let vector kernels test 16 or more
+// bytes at once with a nibble shuffle: the low nibble picks a row of bits
+// and the high nibble picks the bit within it.
+typedef string_byte_set byte_set;
+
+static void byte_set_add(byte_set* set, unsigned char c) {
+    set->bits[c >> 6] |= (uint64_t)1 << (c & 63);
+    if (c < 128) {
+        set->low_rows[c & 15] |= (uint8_t)(1u << (c >> 4));
+    } else {
+        set->high_rows[c & 15] |= (uint8_t)(1u << ((c >> 4) - 8));
+    }
+}
+
+static inline bool byte_set_contains(const byte_set* set, unsigned char c) {
+    return (set->bits[c >> 6] >> (c & 63)) & 1;
+}
+
+/**
+ * @brief Table of SIMD kernels selected once at load time
+ *
+ * Every kernel works on raw byte ranges; the public wrappers take care of
+ * NULL checks, SSO access and length handling.
+ */
+typedef struct {
+    string_simd_level level;
+    int (*compare)(const char* a, const char* b, size_t len);
+    bool (*equals)(const char* a, const char* b, size_t len);
+    const char* (*find)(const char* haystack, size_t haystack_len,
+                        const search_needle* pattern);
+    const char* (*find_any)(const char* data, size_t len, const byte_set* set);
+    // Lengths of the leading and trailing runs of set members
+    size_t (*span)(const char* data, size_t len, const byte_set* set);
+    size_t (*rspan)(const char* data, size_t len, const byte_set* set);
+    void (*to_upper)(char* data, size_t len);
+    void (*to_lower)(char* data, size_t len);
+    // ASCII case-insensitive variants of compare, equals and find
+    int (*compare_icase)(const char* a, const char* b, size_t len);
+    bool (*equals_icase)(const char* a, const char* b, size_t len);
+    const char* (*find_icase)(const char* haystack, size_t haystack_len,
+                              const search_needle* pattern);
+    int (*utf8_check)(const char* data, size_t len);
+    size_t (*utf8_count)(const char* data, size_t len);
+} string_kernels;
+
+// Results of utf8_check
+#define UTF8_INVALID 0
+#define UTF8_VALID 1
+#define UTF8_ASCII 3            // Valid, and every byte is below 0x80
+
+// Portable scalar kernels, always available
+static int scalar_compare(const char* a, const char* b, size_t len) {
+    return memcmp(a, b, len);
+}
+
+static bool scalar_equals(const char* a, const char* b, size_t len) {
+    return memcmp(a, b, len) == 0;
+}
+
+static const char* scalar_find(const char* haystack, size_t haystack_len,
+                               const search_needle* pattern) {
+    const char* const needle = pattern->data;
+    const size_t needle_len = pattern->length;
+    if (needle_len == 1) return memchr(haystack, needle[0], haystack_len);
+    return filter_find_from(haystack, haystack_len, pattern, 0, search_budget(haystack_len));
+}
+
+static const char* scalar_find_any(const char* data, size_t len, const byte_set* set) {
+    for (size_t i = 0; i < len; i++) {
+        if (byte_set_contains(set, (unsigned char)data[i])) return data + i;
+    }
+    return NULL;
+}
+
+static size_t scalar_span(const char* data, size_t len, const byte_set* set) {
+    size_t i = 0;
+    while (i < len && byte_set_contains(set, (unsigned char)data[i])) i++;
+    return i;
+}
+
+static size_t scalar_rspan(const char* data, size_t len, const byte_set* set) {
+    size_t end = len;
+    while (end > 0 && byte_set_contains(set, (unsigned char)data[end - 1])) end--;
+    return len - end;
+}
+
+static void scalar_to_upper(char* data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        data[i] = ascii_to_upper(data[i]);
+    }
+}
+
+static void scalar_to_lower(char* data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        data[i] = ascii_to_lower(data[i]);
+    }
+}
+
+static int scalar_compare_icase(const char* a, const char* b, size_t len) {
+    return icase_compare_bytes(a, b, len);
+}
+
+static bool scalar_equals_icase(const char* a, const char* b, size_t len) {
+    return icase_compare_bytes(a, b, len) == 0;
+}
+
+static const char* scalar_find_icase(const char* haystack, size_t haystack_len,
+                                     const search_needle* pattern) {
+    return icase_filter_find_from(haystack, haystack_len, pattern, 0, search_budget(haystack_len));
+}
+
+static int scalar_utf8_check(const char* data, size_t len) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    bool ascii = true;
+    size_t i = 0;
+    
+    while (i < len) {
+        // Skip ASCII eight bytes at a time
+        uint64_t word;
+        if (len - i >= 8 && (memcpy(&word, bytes + i, 8), !(word & 0x8080808080808080ull))) {
+            i += 8;
+            continue;
+        }
+        
+        unsigned char lead = bytes[i];
+        if (lead < 0x80) {
+            i++;
+            continue;
+        }
+        ascii = false;
+        
+        // Continuation count and the range of the second byte, which rules
+        // out overlong forms, surrogates and code points past U+10FFFF
+        size_t continuations;
+        unsigned char low = 0x80, high = 0xBF;
+        if (lead >= 0xC2 && lead <= 0xDF) {
+            continuations = 1;
+        } else if (lead >= 0xE0 && lead <= 0xEF) {
+            continuations = 2;
+            if (lead == 0xE0) low = 0xA0;
+            if (lead == 0xED) high = 0x9F;
+        } else if (lead >= 0xF0 && lead <= 0xF4) {
+            continuations = 3;
+            if (lead == 0xF0) low = 0x90;
+            if (lead == 0xF4) high = 0x8F;
+        } else {
+            return UTF8_INVALID;
+        }
+        
+        if (len - i - 1 < continuations) return UTF8_INVALID;
+        if (bytes[i + 1] < low || bytes[i + 1] > high) return UTF8_INVALID;
+        for (size_t k = 2; k <= continuations; k++) {
+            if ((bytes[i + k] & 0xC0) != 0x80) return UTF8_INVALID;
+        }
+        i += continuations + 1;
+    }
+    
+    return ascii ? UTF8_ASCII : UTF8_VALID;
+}
+
+// Every byte but a continuation byte (10xxxxxx) starts a code point
+static size_t scalar_utf8_count(const char* data, size_t len) {
+    size_t count = 0;
+    for (size_t i = 0; i < len; i++) count += (signed char)data[i] > -65;
+    return count;
+}
+
+static const string_kernels scalar_kernels = {
+    STRING_SIMD_SCALAR,
+    scalar_compare, scalar_equals, scalar_find, scalar_find_any,
+    scalar_span, scalar_rspan,
+    scalar_to_upper, scalar_to_lower,
+    scalar_compare_icase, scalar_equals_icase, scalar_find_icase,
+    scalar_utf8_check, scalar_utf8_count
+};
+
+// Vector UTF-8 validation after Keiser and Lemire, "Validating UTF-8 In Less
+// Than One Instruction Per Byte". Three 16-entry lookups on the high and low
+// nibble of each byte and the high nibble of the byte before it flag every
+// invalid two-byte pair; the third and fourth bytes of a sequence are
+// checked against saturating subtractions of the bytes two and three back.
+#define UTF8_TOO_SHORT (1 << 0)     // Lead or ASCII followed by a lead or ASCII, where a continuation is due
+#define UTF8_TOO_LONG (1 << 1)      // ASCII followed by a continuation
+#define UTF8_OVERLONG_3 (1 << 2)    // E0 followed by 80..9F
+#define UTF8_TOO_LARGE (1 << 3)     // F4 followed by 90..BF, or F5..FF
+#define UTF8_SURROGATE (1 << 4)     // ED followed by A0..BF
+#define UTF8_OVERLONG_2 (1 << 5)    // C0 or C1
+#define UTF8_TOO_LARGE_1000 (1 << 6)
+#define UTF8_OVERLONG_4 (1 << 6)    // F0 followed by 80..8F
+#define UTF8_TWO_CONTS (1 << 7)     // Continuation after continuation, unless a 3 or 4 byte lead allows it
+#define UTF8_CARRY (UTF8_TOO_SHORT | UTF8_TOO_LONG | UTF8_TWO_CONTS)
+
+[[maybe_unused]] static const uint8_t utf8_byte_1_high[16] = {
+    UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+    UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+    UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS,
+    UTF8_TOO_SHORT | UTF8_OVERLONG_2,
+    UTF8_TOO_SHORT,
+    UTF8_TOO_SHORT | UTF8_OVERLONG_3 | UTF8_SURROGATE,
+    UTF8_TOO_SHORT | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4
+};
+
+[[maybe_unused]] static const uint8_t utf8_byte_1_low[16] = {
+    UTF8_CARRY | UTF8_OVERLONG_3 | UTF8_OVERLONG_2 | UTF8_OVERLONG_4,
+    UTF8_CARRY | UTF8_OVERLONG_2,
+    UTF8_CARRY,
+    UTF8_CARRY,
+    UTF8_CARRY | UTF8_TOO_LARGE,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_SURROGATE,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000
+};
+
+[[maybe_unused]] static const uint8_t utf8_byte_2_high[16] = {
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4,
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE,
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE,
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE,
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT
+};
+
+// A block ending in a lead byte whose sequence does not fit before the end
+// of the block has its error carried into the next: bytes above these
+// limits in the last three positions are incomplete. Narrower vectors load
+// the tail of the table.
+[[maybe_unused]] static const uint8_t utf8_incomplete_max[64] = {
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 0xF0 - 1, 0xE0 - 1, 0xC0 - 1
+};
+
+#ifdef STRING_SIMD_X86
+// SSE4.2 optimized string compare
+STRING_TARGET("sse4.2")
+static int sse42_compare(const char* a, const char* b, size_t len) {
+    // For very short strings, use standard memcmp to avoid overhead
+    if (len < 16) return memcmp(a, b, len);
+    
+    size_t i = 0;
+    
+    // Process 16 bytes at a time using SSE4.2
+    while (i + 16 <= len) {
+        __m128i xmm1 = _mm_loadu_si128((const __m128i*)(a + i));
+        __m128i xmm2 = _mm_loadu_si128((const __m128i*)(b + i));
+        
+        int result = _mm_cmpestri(
+            xmm1, 16,
+            xmm2, 16,
+            _SIDD_CMP_EQUAL_EACH | _SIDD_NEGATIVE_POLARITY | _SIDD_LEAST_SIGNIFICANT
+        );
+        
+        if (result != 16) {
+            // Found a differing character
+            return (unsigned char)a[i + result] - (unsigned char)b[i + result];
+        }
+        
+        i += 16;
+    }
+    
+    // Handle remaining bytes
+    return memcmp(a + i, b + i, len - i);
+}
+
+// SSE4.2 optimized string equality check
+STRING_TARGET("sse4.2")
+static bool sse42_equals(const char* a, const char* b, size_t len) {
+    // For very short strings, use standard memcmp to avoid overhead
+    if (len < 16) return memcmp(a, b, len) == 0;
+    
+    size_t i = 0;
+    
+    // Process 16 bytes at a time using SSE4.2
+    while (i + 16 <= len) {
+        __m128i xmm1 = _mm_loadu_si128((const __m128i*)(a + i));
+        __m128i xmm2 = _mm_loadu_si128((const __m128i*)(b + i));
+        
+        int diff = _mm_cmpestri(
+            xmm1, 16,
+            xmm2, 16,
+            _SIDD_CMP_EQUAL_EACH | _SIDD_NEGATIVE_POLARITY | _SIDD_LEAST_SIGNIFICANT
+        );
+        
+        if (diff != 16) {
+            return false;  // Found a difference
+        }
+        
+        i += 16;
+    }
+    
+    // Handle remaining bytes
+    return memcmp(a + i, b + i, len - i) == 0;
+}
+
+// First/last byte filter over 16 candidate positions per iteration; plain
+// SSE2 compares avoid the latency of cmpestri and never rescan byte by byte
+STRING_TARGET("sse4.2")
+static const char* sse42_find(const char* haystack, size_t haystack_len,
+                              const search_needle* pattern) {
+    const char* const needle = pattern->data;
+    const size_t needle_len = pattern->length;
+    if (needle_len == 1) return memchr(haystack, needle[0], haystack_len);
+    
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[needle_len - 1]);
+    const size_t candidates = haystack_len - needle_len + 1;
+    size_t budget = search_budget(haystack_len);
+    size_t i = 0;
+    
+    for (; i + 16 <= candidates; i += 16) {
+        __m128i head = _mm_loadu_si128((const __m128i*)(haystack + i));
+        __m128i tail = _mm_loadu_si128((const __m128i*)(haystack + i + needle_len - 1));
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(head, first), _mm_cmpeq_epi8(tail, last)));
+        
+        while (mask) {
+            size_t pos = i + (size_t)__builtin_ctz(mask);
+            if (memcmp(haystack + pos + 1, needle + 1, needle_len - 2) == 0) {
+                return haystack + pos;
+            }
+            if (!search_charge(&budget, needle_len)) {
+                return two_way_from(haystack, haystack_len, pattern, pos + 1);
+            }
+            mask &= mask - 1;
+        }
+    }
+    
+    return filter_find_from(haystack, haystack_len, pattern, i, budget);
+}
+
+// Nibble-shuffle membership test: one mask bit per member byte of chunk
+STRING_TARGET("sse4.2")
+static inline uint32_t sse42_members(__m128i chunk, __m128i low_rows, __m128i high_rows) {
+    const __m128i row_bits = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128,
+                                           1, 2, 4, 8, 16, 32, 64, -128);
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    __m128i lo = _mm_and_si128(chunk, nibble);
+    __m128i hi = _mm_and_si128(_mm_srli_epi16(chunk, 4), nibble);
+    // The top bit of each byte selects the high half of the set
+    __m128i rows = _mm_blendv_epi8(_mm_shuffle_epi8(low_rows, lo),
+                                   _mm_shuffle_epi8(high_rows, lo), chunk);
+    __m128i bit = _mm_shuffle_epi8(row_bits, hi);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(rows, bit), bit));
+}
+
+// Membership test over 16 bytes per iteration
+STRING_TARGET("sse4.2")
+static const char* sse42_find_any(const char* data, size_t len, const byte_set* set) {
+    const __m128i low_rows = _mm_loadu_si128((const __m128i*)set->low_rows);
+    const __m128i high_rows = _mm_loadu_si128((const __m128i*)set->high_rows);
+    size_t i = 0;
+    
+    for (; i + 16 <= len; i += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)(data + i));
+        uint32_t mask = sse42_members(chunk, low_rows, high_rows);
+        
+        if (mask) return data + i + __builtin_ctz(mask);
+    }
+    
+    return scalar_find_any(data + i, len - i, set);
+}
+
+STRING_TARGET("sse4.2")
+static size_t sse42_span(const char* data, size_t len, const byte_set* set) {
+    const __m128i low_rows = _mm_loadu_si128((const __m128i*)set->low_rows);
+    const __m128i high_rows = _mm_loadu_si128((const __m128i*)set->high_rows);
+    size_t i = 0;
+    
+    for (; i + 16 <= len; i += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)(data + i));
+        uint32_t outside = sse42_members(chunk, low_rows, high_rows) ^ 0xFFFF;
+        
+        if (outside) return i + (size_t)__builtin_ctz(outside);
+    }
+    
+    return i + scalar_span(data + i, len - i, set);
+}
+
+// Blocks from the end; the bytes left over at the front are done in scalar
+STRING_TARGET("sse4.2")
+static size_t sse42_rspan(const char* data, size_t len, const byte_set* set) {
+    const __m128i low_rows = _mm_loadu_si128((const __m128i*)set->low_rows);
+    const __m128i high_rows = _mm_loadu_si128((const __m128i*)set->high_rows);
+    size_t end = len;
+    
+    for (; end >= 16; end -= 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)(data + end - 16));
+        uint32_t outside = sse42_members(chunk, low_rows, high_rows) ^ 0xFFFF;
+        
+        if (outside) return len - (end - 16 + (size_t)(31 - __builtin_clz(outside))) - 1;
+    }
+    
+    return len - end + scalar_rspan(data, end, set);
+}
+
+// SSE4.2 optimized string to uppercase
+STRING_TARGET("sse4.2")
+static void sse42_to_upper(char* data, size_t len) {
+    size_t i = 0;
+    __m128i lower_a = _mm_set1_epi8('a');
+    __m128i lower_z = _mm_set1_epi8('z');
+    __m128i to_upper = _mm_set1_epi8('A' - 'a');
+    
+    // Use SIMD to process 16 bytes at a time
+    for (; i + 16 <= len; i += 16) {
+        __m128i chars = _mm_loadu_si128((__m128i*)(data + i));
+        
+        // Check which chars are in range 'a'..'z'
+        __m128i is_lower = _mm_and_si128(
+            _mm_cmpgt_epi8(chars, _mm_sub_epi8(lower_a, _mm_set1_epi8(1))),
+            _mm_cmpgt_epi8(_mm_add_epi8(lower_z, _mm_set1_epi8(1)), chars)
+        );
+        
+        // Convert to uppercase if in range
+        __m128i adjustment = _mm_and_si128(is_lower, to_upper);
+        __m128i result = _mm_add_epi8(chars, adjustment);
+        
+        _mm_storeu_si128((__m128i*)(data + i), result);
+    }
+    
+    // Process remaining characters
+    scalar_to_upper(data + i, len - i);
+}
+
+// SSE4.2 optimized string to lowercase
+STRING_TARGET("sse4.2")
+static void sse42_to_lower(char* data, size_t len) {
+    size_t i = 0;
+    __m128i upper_a = _mm_set1_epi8('A');
+    __m128i upper_z = _mm_set1_epi8('Z');
+    __m128i to_lower = _mm_set1_epi8('a' - 'A');
+    
+    // Use SIMD to process 16 bytes at a time
+    for (; i + 16 <= len; i += 16) {
+        __m128i chars = _mm_loadu_si128((__m128i*)(data + i));
+        
+        // Check which chars are in range 'A'..'Z'
+        __m128i is_upper = _mm_and_si128(
+            _mm_cmpgt_epi8(chars, _mm_sub_epi8(upper_a, _mm_set1_epi8(1))),
+            _mm_cmpgt_epi8(_mm_add_epi8(upper_z, _mm_set1_epi8(1)), chars)
+        );
+        
+        // Convert to lowercase if in range
+        __m128i adjustment = _mm_and_si128(is_upper, to_lower);
+        __m128i result = _mm_add_epi8(chars, adjustment);
+        
+        _mm_storeu_si128((__m128i*)(data + i), result);
+    }
+    
+    // Process remaining characters
+    scalar_to_lower(data + i, len - i);
+}
+
+// Fold 'A'..'Z' to lowercase with the range mask used by sse42_to_lower
+STRING_TARGET("sse4.2")
+static inline __m128i sse42_fold(__m128i chars) {
+    __m128i is_upper = _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8('A' - 1)),
+                                     _mm_cmpgt_epi8(_mm_set1_epi8('Z' + 1), chars));
+    return _mm_add_epi8(chars, _mm_and_si128(is_upper, _mm_set1_epi8('a' - 'A')));
+}
+
+STRING_TARGET("sse4.2")
+static int sse42_compare_icase(const char* a, const char* b, size_t len) {
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i va = sse42_fold(_mm_loadu_si128((const __m128i*)(a + i)));
+        __m128i vb = sse42_fold(_mm_loadu_si128((const __m128i*)(b + i)));
+        uint32_t diff = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) ^ 0xFFFF;
+        
+        if (diff) {
+            size_t pos = i + (size_t)__builtin_ctz(diff);
+            return (unsigned char)ascii_to_lower(a[pos]) - (unsigned char)ascii_to_lower(b[pos]);
+        }
+    }
+    
+    return icase_compare_bytes(a + i, b + i, len - i);
+}
+
+STRING_TARGET("sse4.2")
+static bool sse42_equals_icase(const char* a, const char* b, size_t len) {
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i va = sse42_fold(_mm_loadu_si128((const __m128i*)(a + i)));
+        __m128i vb = sse42_fold(_mm_loadu_si128((const __m128i*)(b + i)));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) != 0xFFFF) return false;
+    }
+    
+    return icase_compare_bytes(a + i, b + i, len - i) == 0;
+}
+
+// sse42_find with both filter bytes and the haystack folded
+STRING_TARGET("sse4.2")
+static const char* sse42_find_icase(const char* haystack, size_t haystack_len,
+                                    const search_needle* pattern) {
+    const char* const needle = pattern->data;
+    const size_t needle_len = pattern->length;
+    const __m128i first = _mm_set1_epi8(ascii_to_lower(needle[0]));
+    const __m128i last = _mm_set1_epi8(ascii_to_lower(needle[needle_len - 1]));
+    const size_t candidates = haystack_len - needle_len + 1;
+    size_t budget = search_budget(haystack_len);
+    size_t i = 0;
+    
+    for (; i + 16 <= candidates; i += 16) {
+        __m128i head = sse42_fold(_mm_loadu_si128((const __m128i*)(haystack + i)));
+        __m128i tail = sse42_fold(_mm_loadu_si128((const __m128i*)(haystack + i + needle_len - 1)));
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(head, first), _mm_cmpeq_epi8(tail, last)));
+        
+        while (mask) {
+            size_t pos = i + (size_t)__builtin_ctz(mask);
+            if (needle_len <= 2 || sse42_equals_icase(haystack + pos + 1, needle + 1, needle_len - 2)) {
+                return haystack + pos;
+            }
+            if (!search_charge(&budget, needle_len)) {
+                return icase_two_way_from(haystack, haystack_len, pattern, pos + 1);
+            }
+            mask &= mask - 1;
+        }
+    }
+    
+    return icase_filter_find_from(haystack, haystack_len, pattern, i, budget);
+}
+
+// Error bits for input given the 16 bytes before it
+STRING_TARGET("sse4.2")
+static inline __m128i sse42_utf8_block(__m128i input, __m128i prev_input) {
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    __m128i prev1 = _mm_alignr_epi8(input, prev_input, 15);
+    __m128i byte_1_high = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)utf8_byte_1_high),
+                                           _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble));
+    __m128i byte_1_low = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)utf8_byte_1_low),
+                                          _mm_and_si128(prev1, nibble));
+    __m128i byte_2_high = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)utf8_byte_2_high),
+                                           _mm_and_si128(_mm_srli_epi16(input, 4), nibble));
+    __m128i special = _mm_and_si128(_mm_and_si128(byte_1_high, byte_1_low), byte_2_high);
+    
+    __m128i third = _mm_subs_epu8(_mm_alignr_epi8(input, prev_input, 14), _mm_set1_epi8(0xE0 - 0x80));
+    __m128i fourth = _mm_subs_epu8(_mm_alignr_epi8(input, prev_input, 13), _mm_set1_epi8(0xF0 - 0x80));
+    __m128i must23 = _mm_and_si128(_mm_or_si128(third, fourth), _mm_set1_epi8((char)0x80));
+    return _mm_xor_si128(must23, special);
+}
+
+STRING_TARGET("sse4.2")
+static int sse42_utf8_check(const char* data, size_t len) {
+    const __m128i incomplete_max = _mm_loadu_si128((const __m128i*)(utf8_incomplete_max + 48));
+    __m128i error = _mm_setzero_si128();
+    __m128i prev_input = _mm_setzero_si128();
+    __m128i prev_incomplete = _mm_setzero_si128();
+    bool ascii = true;
+    
+    for (size_t i = 0; i < len; i += 16) {
+        // The tail is padded with nulls, which are ASCII
+        __m128i input;
+        if (len - i >= 16) {
+            input = _mm_loadu_si128((const __m128i*)(data + i));
+        } else {
+            char tail[16] = {0};
+            memcpy(tail, data + i, len - i);
+            input = _mm_loadu_si128((const __m128i*)tail);
+        }
+        
+        if (!_mm_movemask_epi8(input)) {
+            error = _mm_or_si128(error, prev_incomplete);
+        } else {
+            ascii = false;
+            error = _mm_or_si128(error, sse42_utf8_block(input, prev_input));
+            prev_incomplete = _mm_subs_epu8(input, incomplete_max);
+        }
+        if (!_mm_testz_si128(error, error)) return UTF8_INVALID;
+        prev_input = input;
+    }
+    
+    error = _mm_or_si128(error, prev_incomplete);
+    if (!_mm_testz_si128(error, error)) return UTF8_INVALID;
+    return ascii ? UTF8_ASCII : UTF8_VALID;
+}
+
+STRING_TARGET("sse4.2")
+static size_t sse42_utf8_count(const char* data, size_t len) {
+    const __m128i last_continuation = _mm_set1_epi8(-65);
+    size_t count = 0;
+    size_t i = 0;
+    
+    for (; i + 16 <= len; i += 16) {
+        __m128i chars = _mm_loadu_si128((const __m128i*)(data + i));
+        unsigned leads = (unsigned)_mm_movemask_epi8(_mm_cmpgt_epi8(chars, last_continuation));
+        count += (size_t)__builtin_popcount(leads);
+    }
+    
+    return count + scalar_utf8_count(data + i, len - i);
+}
+
+static const string_kernels sse42_kernels = {
+    STRING_SIMD_SSE42,
+    sse42_compare, sse42_equals, sse42_find, sse42_find_any,
+    sse42_span, sse42_rspan,
+    sse42_to_upper, sse42_to_lower,
+    sse42_compare_icase, sse42_equals_icase, sse42_find_icase,
+    sse42_utf8_check, sse42_utf8_count
+};
+
+// AVX2 kernels, 32 bytes per iteration
+STRING_TARGET("avx2")
+static int avx2_compare(const char* a, const char* b, size_t len) {
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i va = _mm256_loadu_si256((const __m256i*)(a + i));
+        __m256i vb = _mm256_loadu_si256((const __m256i*)(b + i));
+        uint32_t diff = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(va, vb));
+        
+        if (diff) {
+            size_t pos = i + (size_t)__builtin_ctz(diff);
+            return (unsigned char)a[pos] - (unsigned char)b[pos];
+        }
+    }
+    
+    return memcmp(a + i, b + i, len - i);
+}
+
+STRING_TARGET("avx2")
+static bool avx2_equals(const char* a, const char* b, size_t len) {
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i va = _mm256_loadu_si256((const __m256i*)(a + i));
+        __m256i vb = _mm256_loadu_si256((const __m256i*)(b + i));
+        if ((uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(va, vb)) != UINT32_MAX) {
+            return false;
+        }
+    }
+    
+    return memcmp(a + i, b + i, len - i) == 0;
+}
+
+// First/last byte filter over 32 candidate positions per iteration
+STRING_TARGET("avx2")
+static const char* avx2_find(const char* haystack, size_t haystack_len,
+                             const search_needle* pattern) {
+    const char* const needle = pattern->data;
+    const size_t needle_len = pattern->length;
+    if (needle_len == 1) return memchr(haystack, needle[0], haystack_len);
+    
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[needle_len - 1]);
+    const size_t candidates = haystack_len - needle_len + 1;
+    size_t budget = search_budget(haystack_len);
+    size_t i = 0;
+    
+    for (; i + 32 <= candidates; i += 32) {
+        __m256i head = _mm256_loadu_si256((const __m256i*)(haystack + i));
+        __m256i tail = _mm256_loadu_si256((const __m256i*)(haystack + i + needle_len - 1));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(head, first), _mm256_cmpeq_epi8(tail, last)));
+        
+        while (mask) {
+            size_t pos = i + (size_t)__builtin_ctz(mask);
+            if (memcmp(haystack + pos + 1, needle + 1, needle_len - 2) == 0) {
+                return haystack + pos;
+            }
+            if (!search_charge(&budget, needle_len)) {
+                return two_way_from(haystack, haystack_len, pattern, pos + 1);
+            }
+            mask &= mask - 1;
+        }
+    }
+    
+    return filter_find_from(haystack, haystack_len, pattern, i, budget);
+}
+
+// sse42_members over 32 bytes
+STRING_TARGET("avx2")
+static inline uint32_t avx2_members(__m256i chunk, __m256i low_rows, __m256i high_rows) {
+    const __m256i row_bits = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128,
+                                              1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    __m256i lo = _mm256_and_si256(chunk, nibble);
+    __m256i hi = _mm256_and_si256(_mm256_srli_epi16(chunk, 4), nibble);
+    __m256i rows = _mm256_blendv_epi8(_mm256_shuffle_epi8(low_rows, lo),
+                                      _mm256_shuffle_epi8(high_rows, lo), chunk);
+    __m256i bit = _mm256_shuffle_epi8(row_bits, hi);
+    return (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(rows, bit), bit));
+}
+
+STRING_TARGET("avx2")
+static const char* avx2_find_any(const char* data, size_t len, const byte_set* set) {
+    const __m256i low_rows = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)set->low_rows));
+    const __m256i high_rows = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)set->high_rows));
+    size_t i = 0;
+    
+    for (; i + 32 <= len; i += 32) {
+        __m256i chunk = _mm256_loadu_si256((const __m256i*)(data + i));
+        uint32_t mask = avx2_members(chunk, low_rows, high_rows);
+        
+        if (mask) return data + i + __builtin_ctz(mask);
+    }
+    
+    return scalar_find_any(data + i, len - i, set);
+}
+
+STRING_TARGET("avx2")
+static size_t avx2_span(const char* data, size_t len, const byte_set* set) {
+    const __m256i low_rows = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)set->low_rows));
+    const __m256i high_rows = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)set->high_rows));
+    size_t i = 0;
+    
+    for (; i + 32 <= len; i += 32) {
+        __m256i chunk = _mm256_loadu_si256((const __m256i*)(data + i));
+        uint32_t outside = ~avx2_members(chunk, low_rows, high_rows);
+        
+        if (outside) return i + (size_t)__builtin_ctz(outside);
+    }
+    
+    return i + scalar_span(data + i, len - i, set);
+}
+
+STRING_TARGET("avx2")
+static size_t avx2_rspan(const char* data, size_t len, const byte_set* set) {
+    const __m256i low_rows = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)set->low_rows));
+    const __m256i high_rows = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)set->high_rows));
+    size_t end = len;
+    
+    for (; end >= 32; end -= 32) {
+        __m256i chunk = _mm256_loadu_si256((const __m256i*)(data + end - 32));
+        uint32_t outside = ~avx2_members(chunk, low_rows, high_rows);
+        
+        if (outside) return len - (end - 32 + (size_t)(31 - __builtin_clz(outside))) - 1;
+    }
+    
+    return len - end + scalar_rspan(data, end, set);
+}
+
+STRING_TARGET("avx2")
+static void avx2_to_upper(char* data, size_t len) {
+    const __m256i before_a = _mm256_set1_epi8('a' - 1);
+    const __m256i after_z = _mm256_set1_epi8('z' + 1);
+    const __m256i case_bit = _mm256_set1_epi8('a' - 'A');
+    size_t i = 0;
+    
+    for (; i + 32 <= len; i += 32) {
+        __m256i chars = _mm256_loadu_si256((const __m256i*)(data + i));
+        __m256i is_lower = _mm256_and_si256(_mm256_cmpgt_epi8(chars, before_a),
+                                            _mm256_cmpgt_epi8(after_z, chars));
+        chars = _mm256_sub_epi8(chars, _mm256_and_si256(is_lower, case_bit));
+        _mm256_storeu_si256((__m256i*)(data + i), chars);
+    }
+    
+    scalar_to_upper(data + i, len - i);
+}
+
+STRING_TARGET("avx2")
+static void avx2_to_lower(char* data, size_t len) {
+    const __m256i before_a = _mm256_set1_epi8('A' - 1);
+    const __m256i after_z = _mm256_set1_epi8('Z' + 1);
+    const __m256i case_bit = _mm256_set1_epi8('a' - 'A');
+    size_t i = 0;
+    
+    for (; i + 32 <= len; i += 32) {
+        __m256i chars = _mm256_loadu_si256((const __m256i*)(data + i));
+        __m256i is_upper = _mm256_and_si256(_mm256_cmpgt_epi8(chars, before_a),
+                                            _mm256_cmpgt_epi8(after_z, chars));
+        chars = _mm256_add_epi8(chars, _mm256_and_si256(is_upper, case_bit));
+        _mm256_storeu_si256((__m256i*)(data + i), chars);
+    }
+    
+    scalar_to_lower(data + i, len - i);
+}
+
+STRING_TARGET("avx2")
+static inline __m256i avx2_fold(__m256i chars) {
+    __m256i is_upper = _mm256_and_si256(_mm256_cmpgt_epi8(chars, _mm256_set1_epi8('A' - 1)),
+                                        _mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1), chars));
+    return _mm256_add_epi8(chars, _mm256_and_si256(is_upper, _mm256_set1_epi8('a' - 'A')));
+}
+
+STRING_TARGET("avx2")
+static int avx2_compare_icase(const char* a, const char* b, size_t len) {
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i va = avx2_fold(_mm256_loadu_si256((const __m256i*)(a + i)));
+        __m256i vb = avx2_fold(_mm256_loadu_si256((const __m256i*)(b + i)));
+        uint32_t diff = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(va, vb));
+        
+        if (diff) {
+            size_t pos = i + (size_t)__builtin_ctz(diff);
+            return (unsigned char)ascii_to_lower(a[pos]) - (unsigned char)ascii_to_lower(b[pos]);
+        }
+    }
+    
+    return icase_compare_bytes(a + i, b + i, len - i);
+}
+
+STRING_TARGET("avx2")
+static bool avx2_equals_icase(const char* a, const char* b, size_t len) {
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i va = avx2_fold(_mm256_loadu_si256((const __m256i*)(a + i)));
+        __m256i vb = avx2_fold(_mm256_loadu_si256((const __m256i*)(b + i)));
+        if ((uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(va, vb)) != UINT32_MAX) {
+            return false;
+        }
+    }
+    
+    return icase_compare_bytes(a + i, b + i, len - i) == 0;
+}
+
+STRING_TARGET("avx2")
+static const char* avx2_find_icase(const char* haystack, size_t haystack_len,
+                                   const search_needle* pattern) {
+    const char* const needle = pattern->data;
+    const size_t needle_len = pattern->length;
+    const __m256i first = _mm256_set1_epi8(ascii_to_lower(needle[0]));
+    const __m256i last = _mm256_set1_epi8(ascii_to_lower(needle[needle_len - 1]));
+    const size_t candidates = haystack_len - needle_len + 1;
+    size_t budget = search_budget(haystack_len);
+    size_t i = 0;
+    
+    for (; i + 32 <= candidates; i += 32) {
+        __m256i head = avx2_fold(_mm256_loadu_si256((const __m256i*)(haystack + i)));
+        __m256i tail = avx2_fold(_mm256_loadu_si256((const __m256i*)(haystack + i + needle_len - 1)));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(head, first), _mm256_cmpeq_epi8(tail, last)));
+        
+        while (mask) {
+            size_t pos = i + (size_t)__builtin_ctz(mask);
+            if (needle_len <= 2 || avx2_equals_icase(haystack + pos + 1, needle + 1, needle_len - 2)) {
+                return haystack + pos;
+            }
+            if (!search_charge(&budget, needle_len)) {
+                return icase_two_way_from(haystack, haystack_len, pattern, pos + 1);
+            }
+            mask &= mask - 1;
+        }
+    }
+    
+    return icase_filter_find_from(haystack, haystack_len, pattern, i, budget);
+}
+
+// Bytes n back from each byte of input, reaching into prev_input; alignr
+// works per 128-bit lane, so the lane below each one is lined up first
+#define AVX2_PREV(input, prev_input, n) \
+    _mm256_alignr_epi8((input), _mm256_permute2x128_si256((prev_input), (input), 0x21), 16 - (n))
+
+STRING_TARGET("avx2")
+static inline __m256i avx2_utf8_block(__m256i input, __m256i prev_input) {
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    __m256i prev1 = AVX2_PREV(input, prev_input, 1);
+    __m256i byte_1_high = _mm256_shuffle_epi8(
+        _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)utf8_byte_1_high)),
+        _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble));
+    __m256i byte_1_low = _mm256_shuffle_epi8(
+        _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)utf8_byte_1_low)),
+        _mm256_and_si256(prev1, nibble));
+    __m256i byte_2_high = _mm256_shuffle_epi8(
+        _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)utf8_byte_2_high)),
+        _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble));
+    __m256i special = _mm256_and_si256(_mm256_and_si256(byte_1_high, byte_1_low), byte_2_high);
+    
+    __m256i third = _mm256_subs_epu8(AVX2_PREV(input, prev_input, 2), _mm256_set1_epi8(0xE0 - 0x80));
+    __m256i fourth = _mm256_subs_epu8(AVX2_PREV(input, prev_input, 3), _mm256_set1_epi8(0xF0 - 0x80));
+    __m256i must23 = _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8((char)0x80));
+    return _mm256_xor_si256(must23, special);
+}
+
+STRING_TARGET("avx2")
+static int avx2_utf8_check(const char* data, size_t len) {
+    const __m256i incomplete_max = _mm256_loadu_si256((const __m256i*)(utf8_incomplete_max + 32));
+    __m256i error = _mm256_setzero_si256();
+    __m256i prev_input = _mm256_setzero_si256();
+    __m256i prev_incomplete = _mm256_setzero_si256();
+    bool ascii = true;
+    
+    for (size_t i = 0; i < len; i += 32) {
+        __m256i input;
+        if (len - i >= 32) {
+            input = _mm256_loadu_si256((const __m256i*)(data + i));
+        } else {
+            char tail[32] = {0};
+            memcpy(tail, data + i, len - i);
+            input = _mm256_loadu_si256((const __m256i*)tail);
+        }
+        
+        if (!_mm256_movemask_epi8(input)) {
+            error = _mm256_or_si256(error, prev_incomplete);
+        } else {
+            ascii = false;
+            error = _mm256_or_si256(error, avx2_utf8_block(input, prev_input));
+            prev_incomplete = _mm256_subs_epu8(input, incomplete_max);
+        }
+        if (!_mm256_testz_si256(error, error)) return UTF8_INVALID;
+        prev_input = input;
+    }
+    
+    error = _mm256_or_si256(error, prev_incomplete);
+    if (!_mm256_testz_si256(error, error)) return UTF8_INVALID;
+    return ascii ? UTF8_ASCII : UTF8_VALID;
+}
+
+STRING_TARGET("avx2")
+static size_t avx2_utf8_count(const char* data, size_t len) {
+    const __m256i last_continuation = _mm256_set1_epi8(-65);
+    size_t count = 0;
+    size_t i = 0;
+    
+    for (; i + 32 <= len; i += 32) {
+        __m256i chars = _mm256_loadu_si256((const __m256i*)(data + i));
+        unsigned leads = (unsigned)_mm256_movemask_epi8(_mm256_cmpgt_epi8(chars, last_continuation));
+        count += (size_t)__builtin_popcount(leads);
+    }
+    
+    return count + scalar_utf8_count(data + i, len - i);
+}
+
+static const string_kernels avx2_kernels = {
+    STRING_SIMD_AVX2,
+    avx2_compare, avx2_equals, avx2_find, avx2_find_any,
+    avx2_span, avx2_rspan,
+    avx2_to_upper, avx2_to_lower,
+    avx2_compare_icase, avx2_equals_icase, avx2_find_icase,
+    avx2_utf8_check, avx2_utf8_count
+};
+
+// AVX-512BW kernels, 64 bytes per iteration; masked loads handle the tail
+// without reading past the end of the buffer
+#define AVX512_TARGET STRING_TARGET("avx512f,avx512bw")
+
+AVX512_TARGET
+static inline __mmask64 avx512_tail_mask(size_t remaining) {
+    return remaining >= 64 ? ~(__mmask64)0 : (((__mmask64)1 << remaining) - 1);
+}
+
+AVX512_TARGET
+static int avx512_compare(const char* a, const char* b, size_t len) {
+    for (size_t i = 0; i < len; i += 64) {
+        __mmask64 valid = avx512_tail_mask(len - i);
+        __m512i va = _mm512_maskz_loadu_epi8(valid, a + i);
+        __m512i vb = _mm512_maskz_loadu_epi8(valid, b + i);
+        __mmask64 diff = _mm512_cmpneq_epi8_mask(va, vb);
+        
+        if (diff) {
+            size_t pos = i + (size_t)__builtin_ctzll(diff);
+            return (unsigned char)a[pos] - (unsigned char)b[pos];
+        }
+    }
+    
+    return 0;
+}
+
+AVX512_TARGET
+static bool avx512_equals(const char* a, const char* b, size_t len) {
+    for (size_t i = 0; i < len; i += 64) {
+        __mmask64 valid = avx512_tail_mask(len - i);
+        __m512i va = _mm512_maskz_loadu_epi8(valid, a + i);
+        __m512i vb = _mm512_maskz_loadu_epi8(valid, b + i);
+        if (_mm512_cmpneq_epi8_mask(va, vb)) return false;
+    }
+    
+    return true;
+}
+
+// First/last byte filter over 64 candidate positions per iteration; both
+// loads are masked to the remaining candidates so no scalar tail is needed
+AVX512_TARGET
+static const char* avx512_find(const char* haystack, size_t haystack_len,
+                               const search_needle* pattern) {
+    const char* const needle = pattern->data;
+    const size_t needle_len = pattern->length;
+    if (needle_len == 1) return memchr(haystack, needle[0], haystack_len);
+    
+    const __m512i first = _mm512_set1_epi8(needle[0]);
+    const __m512i last = _mm512_set1_epi8(needle[needle_len - 1]);
+    const size_t candidates = haystack_len - needle_len + 1;
+    size_t budget = search_budget(haystack_len);
+    
+    for (size_t i = 0; i < candidates; i += 64) {
+        __mmask64 valid = avx512_tail_mask(candidates - i);
+        __m512i head = _mm512_maskz_loadu_epi8(valid, haystack + i);
+        __m512i tail = _mm512_maskz_loadu_epi8(valid, haystack + i + needle_len - 1);
+        __mmask64 mask = _mm512_mask_cmpeq_epi8_mask(
+            _mm512_mask_cmpeq_epi8_mask(valid, head, first), tail, last);
+        
+        while (mask) {
+            size_t pos = i + (size_t)__builtin_ctzll(mask);
+            if (memcmp(haystack + pos + 1, needle + 1, needle_len - 2) == 0) {
+                return haystack + pos;
+            }
+            if (!search_charge(&budget, needle_len)) {
+                return two_way_from(haystack, haystack_len, pattern, pos + 1);
+            }
+            mask &= mask - 1;
+        }
+    }
+    
+    return NULL;
+}
+
+// sse42_members over 64 bytes, limited to the valid ones
+AVX512_TARGET
+static inline __mmask64 avx512_members(__mmask64 valid, __m512i chunk, __m512i low_rows, __m512i high_rows) {
+    const __m512i row_bits = _mm512_broadcast_i32x4(_mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128,
+                                                                  1, 2, 4, 8, 16, 32, 64, -128));
+    const __m512i nibble = _mm512_set1_epi8(0x0F);
+    __m512i lo = _mm512_and_si512(chunk, nibble);
+    __m512i hi = _mm512_and_si512(_mm512_srli_epi16(chunk, 4), nibble);
+    __m512i rows = _mm512_mask_blend_epi8(_mm512_movepi8_mask(chunk),
+                                          _mm512_shuffle_epi8(low_rows, lo),
+                                          _mm512_shuffle_epi8(high_rows, lo));
+    return _mm512_mask_test_epi8_mask(valid, rows, _mm512_shuffle_epi8(row_bits, hi));
+}
+
+AVX512_TARGET
+static const char* avx512_find_any(const char* data, size_t len, const byte_set* set) {
+    const __m512i low_rows = _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i*)set->low_rows));
+    const __m512i high_rows = _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i*)set->high_rows));
+    
+    for (size_t i = 0; i < len; i += 64) {
+        __mmask64 valid = avx512_tail_mask(len - i);
+        __m512i chunk = _mm512_maskz_loadu_epi8(valid, data + i);
+        __mmask64 mask = avx512_members(valid, chunk, low_rows, high_rows);
+        
+        if (mask) return data + i + __builtin_ctzll(mask);
+    }
+    
+    return NULL;
+}
+
+AVX512_TARGET
+static size_t avx512_span(const char* data, size_t len, const byte_set* set) {
+    const __m512i low_rows = _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i*)set->low_rows));
+    const __m512i high_rows = _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i*)set->high_rows));
+    
+    for (size_t i = 0; i < len; i += 64) {
+        __mmask64 valid = avx512_tail_mask(len - i);
+        __m512i chunk = _mm512_maskz_loadu_epi8(valid, data + i);
+        __mmask64 outside = valid & ~avx512_members(valid, chunk, low_rows, high_rows);
+        
+        if (outside) return i + (size_t)__builtin_ctzll(outside);
+    }
+    
+    return len;
+}
+
+// Blocks from the end; the first one may be short and is masked
+AVX512_TARGET
+static size_t avx512_rspan(const char* data, size_t len, const byte_set* set) {
+    const __m512i low_rows = _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i*)set->low_rows));
+    const __m512i high_rows = _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i*)set->high_rows));
+    
+    for (size_t end = len; end > 0; ) {
+        size_t start = end >= 64 ? end - 64 : 0;
+        __mmask64 valid = avx512_tail_mask(end - start);
+        __m512i chunk = _mm512_maskz_loadu_epi8(valid, data + start);
+        __mmask64 outside = valid & ~avx512_members(valid, chunk, low_rows, high_rows);
+        
+        if (outside) return len - (start + (size_t)(63 - __builtin_clzll(outside))) - 1;
+        end = start;
+    }
+    
+    return len;
+}
+
+AVX512_TARGET
+static void avx512_to_upper(char* data, size_t len) {
+    const __m512i lower_a = _mm512_set1_epi8('a');
+    const __m512i letters = _mm512_set1_epi8(26);
+    const __m512i case_bit = _mm512_set1_epi8('a' - 'A');
+    
+    for (size_t i = 0; i < len; i += 64) {
+        __mmask64 valid = avx512_tail_mask(len - i);
+        __m512i chars = _mm512_maskz_loadu_epi8(valid, data + i);
+        __mmask64 is_lower = _mm512_mask_cmplt_epu8_mask(
+            valid, _mm512_sub_epi8(chars, lower_a), letters);
+        chars = _mm512_mask_sub_epi8(chars, is_lower, chars, case_bit);
+        _mm512_mask_storeu_epi8(data + i, valid, chars);
+    }
+}
+
+AVX512_TARGET
+static void avx512_to_lower(char* data, size_t len) {
+    const __m512i upper_a = _mm512_set1_epi8('A');
+    const __m512i letters = _mm512_set1_epi8(26);
+    const __m512i case_bit = _mm512_set1_epi8('a' - 'A');
+    
+    for (size_t i = 0; i < len; i += 64) {
+        __mmask64 valid = avx512_tail_mask(len - i);
+        __m512i chars = _mm512_maskz_loadu_epi8(valid, data + i);
+        __mmask64 is_upper = _mm512_mask_cmplt_epu8_mask(
+            valid, _mm512_sub_epi8(chars, upper_a), letters);
+        chars = _mm512_mask_add_epi8(chars, is_upper, chars, case_bit);
+        _mm512_mask_storeu_epi8(data + i, valid, chars);
+    }
+}
+
+AVX512_TARGET
+static inline __m512i avx512_fold(__m512i chars) {
+    __mmask64 is_upper = _mm512_cmplt_epu8_mask(_mm512_sub_epi8(chars, _mm512_set1_epi8('A')),
+                                                _mm512_set1_epi8(26));
+    return _mm512_mask_add_epi8(chars, is_upper, chars, _mm512_set1_epi8('a' - 'A'));
+}
+
+AVX512_TARGET
+static int avx512_compare_icase(const char* a, const char* b, size_t len) {
+    for (size_t i = 0; i < len; i += 64) {
+        __mmask64 valid = avx512_tail_mask(len - i);
+        __m512i va = avx512_fold(_mm512_maskz_loadu_epi8(valid, a + i));
+        __m512i vb = avx512_fold(_mm512_maskz_loadu_epi8(valid, b + i));
+        __mmask64 diff = _mm512_cmpneq_epi8_mask(va, vb);
+        
+        if (diff) {
+            size_t pos = i + (size_t)__builtin_ctzll(diff);
+            return (unsigned char)ascii_to_lower(a[pos]) - (unsigned char)ascii_to_lower(b[pos]);
+        }
+    }
+    
+    return 0;
+}
+
+AVX512_TARGET
+static bool avx512_equals_icase(const char* a, const char* b, size_t len) {
+    for (size_t i = 0; i < len; i += 64) {
+        __mmask64 valid = avx512_tail_mask(len - i);
+        __m512i va = avx512_fold(_mm512_maskz_loadu_epi8(valid, a + i));
+        __m512i vb = avx512_fold(_mm512_maskz_loadu_epi8(valid, b + i));
+        if (_mm512_cmpneq_epi8_mask(va, vb)) return false;
+    }
+    
+    return true;
+}
+
+AVX512_TARGET
+static const char* avx512_find_icase(const char* haystack, size_t haystack_len,
+                                     const search_needle* pattern) {
+    const char* const needle = pattern->data;
+    const size_t needle_len = pattern->length;
+    const __m512i first = _mm512_set1_epi8(ascii_to_lower(needle[0]));
+    const __m512i last = _mm512_set1_epi8(ascii_to_lower(needle[needle_len - 1]));
+    const size_t candidates = haystack_len - needle_len + 1;
+    size_t budget = search_budget(haystack_len);
+    
+    for (size_t i = 0; i < candidates; i += 64) {
+        __mmask64 valid = avx512_tail_mask(candidates - i);
+        __m512i head = avx512_fold(_mm512_maskz_loadu_epi8(valid, haystack + i));
+        __m512i tail = avx512_fold(_mm512_maskz_loadu_epi8(valid, haystack + i + needle_len - 1));
+        __mmask64 mask = _mm512_mask_cmpeq_epi8_mask(
+            _mm512_mask_cmpeq_epi8_mask(valid, head, first), tail, last);
+        
+        while (mask) {
+            size_t pos = i + (size_t)__builtin_ctzll(mask);
+            if (needle_len <= 2 || avx512_equals_icase(haystack + pos + 1, needle + 1, needle_len - 2)) {
+                return haystack + pos;
+            }
+            if (!search_charge(&budget, needle_len)) {
+                return icase_two_way_from(haystack, haystack_len, pattern, pos + 1);
+            }
+            mask &= mask - 1;
+        }
+    }
+    
+    return NULL;
+}
+
+// Same idea as AVX2_PREV: line up the 128-bit lane below each one, the
+// lowest taking the top lane of prev_input
+#define AVX512_PREV(input, lanes_below, n) _mm512_alignr_epi8((input), (lanes_below), 16 - (n))
+
+AVX512_TARGET
+static inline __m512i avx512_utf8_block(__m512i input, __m512i prev_input) {
+    const __m512i nibble = _mm512_set1_epi8(0x0F);
+    __m512i lanes_below = _mm512_alignr_epi64(input, prev_input, 6);
+    __m512i prev1 = AVX512_PREV(input, lanes_below, 1);
+    __m512i byte_1_high = _mm512_shuffle_epi8(
+        _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i*)utf8_byte_1_high)),
+        _mm512_and_si512(_mm512_srli_epi16(prev1, 4), nibble));
+    __m512i byte_1_low = _mm512_shuffle_epi8(
+        _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i*)utf8_byte_1_low)),
+        _mm512_and_si512(prev1, nibble));
+    __m512i byte_2_high = _mm512_shuffle_epi8(
+        _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i*)utf8_byte_2_high)),
+        _mm512_and_si512(_mm512_srli_epi16(input, 4), nibble));
+    __m512i special = _mm512_and_si512(_mm512_and_si512(byte_1_high, byte_1_low), byte_2_high);
+    
+    __m512i third = _mm512_subs_epu8(AVX512_PREV(input, lanes_below, 2), _mm512_set1_epi8(0xE0 - 0x80));
+    __m512i fourth = _mm512_subs_epu8(AVX512_PREV(input, lanes_below, 3), _mm512_set1_epi8(0xF0 - 0x80));
+    __m512i must23 = _mm512_and_si512(_mm512_or_si512(third, fourth), _mm512_set1_epi8((char)0x80));
+    return _mm512_xor_si512(must23, special);
+}
+
+AVX512_TARGET
+static int avx512_utf8_check(const char* data, size_t len) {
+    const __m512i incomplete_max = _mm512_loadu_si512(utf8_incomplete_max);
+    __m512i error = _mm512_setzero_si512();
+    __m512i prev_input = _mm512_setzero_si512();
+    __m512i prev_incomplete = _mm512_setzero_si512();
+    bool ascii = true;
+    
+    for (size_t i = 0; i < len; i += 64) {
+        // Masked loads zero the bytes past the end, which reads as ASCII
+        __m512i input = _mm512_maskz_loadu_epi8(avx512_tail_mask(len - i), data + i);
+        
+        if (!_mm512_movepi8_mask(input)) {
+            error = _mm512_or_si512(error, prev_incomplete);
+        } else {
+            ascii = false;
+            error = _mm512_or_si512(error, avx512_utf8_block(input, prev_input));
+            prev_incomplete = _mm512_subs_epu8(input, incomplete_max);
+        }
+        if (_mm512_test_epi8_mask(error, error)) return UTF8_INVALID;
+        prev_input = input;
+    }
+    
+    error = _mm512_or_si512(error, prev_incomplete);
+    if (_mm512_test_epi8_mask(error, error)) return UTF8_INVALID;
+    return ascii ? UTF8_ASCII : UTF8_VALID;
+}
+
+AVX512_TARGET
+static size_t avx512_utf8_count(const char* data, size_t len) {
+    const __m512i last_continuation = _mm512_set1_epi8(-65);
+    size_t count = 0;
+    
+    for (size_t i = 0; i < len; i += 64) {
+        __mmask64 valid = avx512_tail_mask(len - i);
+        __m512i chars = _mm512_maskz_loadu_epi8(valid, data + i);
+        count += (size_t)__builtin_popcountll(_mm512_mask_cmpgt_epi8_mask(valid, chars, last_continuation));
+    }
+    
+    return count;
+}
+
+static const string_kernels avx512_kernels = {
+    STRING_SIMD_AVX512,
+    avx512_compare, avx512_equals, avx512_find, avx512_find_any,
+    avx512_span, avx512_rspan,
+    avx512_to_upper, avx512_to_lower,
+    avx512_compare_icase, avx512_equals_icase, avx512_find_icase,
+    avx512_utf8_check, avx512_utf8_count
+};
+#endif /* STRING_SIMD_X86 */
+
+#ifdef STRING_SIMD_ARM
+// NEON has no movemask; narrowing shift packs a 16-byte compare result
+// into 64 bits with 4 bits per byte
+static inline uint64_t neon_nibble_mask(uint8x16_t v) {
+    return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(v), 4)), 0);
+}
+
+static int neon_compare(const char* a, const char* b, size_t len) {
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        uint8x16_t eq = vceqq_u8(vld1q_u8((const uint8_t*)a + i),
+                                 vld1q_u8((const uint8_t*)b + i));
+        if (vminvq_u8(eq) != 0xFF) {
+            uint64_t diff = ~neon_nibble_mask(eq);
+            size_t pos = i + ((size_t)__builtin_ctzll(diff) >> 2);
+            return (unsigned char)a[pos] - (unsigned char)b[pos];
+        }
+    }
+    
+    return memcmp(a + i, b + i, len - i);
+}
+
+static bool neon_equals(const char* a, const char* b, size_t len) {
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        uint8x16_t eq = vceqq_u8(vld1q_u8((const uint8_t*)a + i),
+                                 vld1q_u8((const uint8_t*)b + i));
+        if (vminvq_u8(eq) != 0xFF) return false;
+    }
+    
+    return memcmp(a + i, b + i, len - i) == 0;
+}
+
+// First/last byte filter over 16 candidate positions per iteration
+static const char* neon_find(const char* haystack, size_t haystack_len,
+                             const search_needle* pattern) {
+    const char* const needle = pattern->data;
+    const size_t needle_len = pattern->length;
+    if (needle_len == 1) return memchr(haystack, needle[0], haystack_len);
+    
+    const uint8x16_t first = vdupq_n_u8((uint8_t)needle[0]);
+    const uint8x16_t last = vdupq_n_u8((uint8_t)needle[needle_len - 1]);
+    const size_t candidates = haystack_len - needle_len + 1;
+    size_t budget = search_budget(haystack_len);
+    size_t i = 0;
+    
+    for (; i + 16 <= candidates; i += 16) {
+        uint8x16_t head = vceqq_u8(vld1q_u8((const uint8_t*)haystack + i), first);
+        uint8x16_t tail = vceqq_u8(vld1q_u8((const uint8_t*)haystack + i + needle_len - 1), last);
+        uint64_t mask = neon_nibble_mask(vandq_u8(head, tail)) & 0x8888888888888888ULL;
+        
+        while (mask) {
+            size_t pos = i + ((size_t)__builtin_ctzll(mask) >> 2);
+            if (memcmp(haystack + pos + 1, needle + 1, needle_len - 2) == 0) {
+                return haystack + pos;
+            }
+            if (!search_charge(&budget, needle_len)) {
+                return two_way_from(haystack, haystack_len, pattern, pos + 1);
+            }
+            mask &= mask - 1;
+        }
+    }
+    
+    return filter_find_from(haystack, haystack_len, pattern, i, budget);
+}
+
+// Four mask bits per member byte of chunk, as from neon_nibble_mask
+static inline uint64_t neon_members(uint8x16_t chunk, uint8x16_t low_rows, uint8x16_t high_rows) {
+    static const uint8_t row_bit_table[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+    const uint8x16_t row_bits = vld1q_u8(row_bit_table);
+    uint8x16_t lo = vandq_u8(chunk, vdupq_n_u8(0x0F));
+    uint8x16_t rows = vbslq_u8(vcgeq_u8(chunk, vdupq_n_u8(0x80)),
+                               vqtbl1q_u8(high_rows, lo), vqtbl1q_u8(low_rows, lo));
+    uint8x16_t hit = vtstq_u8(rows, vqtbl1q_u8(row_bits, vshrq_n_u8(chunk, 4)));
+    return neon_nibble_mask(hit);
+}
+
+static const char* neon_find_any(const char* data, size_t len, const byte_set* set) {
+    const uint8x16_t low_rows = vld1q_u8(set->low_rows);
+    const uint8x16_t high_rows = vld1q_u8(set->high_rows);
+    size_t i = 0;
+    
+    for (; i + 16 <= len; i += 16) {
+        uint64_t mask = neon_members(vld1q_u8((const uint8_t*)data + i), low_rows, high_rows);
+        
+        if (mask) return data + i + ((size_t)__builtin_ctzll(mask) >> 2);
+    }
+    
+    return scalar_find_any(data + i, len - i, set);
+}
+
+static size_t neon_span(const char* data, size_t len, const byte_set* set) {
+    const uint8x16_t low_rows = vld1q_u8(set->low_rows);
+    const uint8x16_t high_rows = vld1q_u8(set->high_rows);
+    size_t i = 0;
+    
+    for (; i + 16 <= len; i += 16) {
+        uint64_t outside = ~neon_members(vld1q_u8((const uint8_t*)data + i), low_rows, high_rows);
+        
+        if (outside) return i + ((size_t)__builtin_ctzll(outside) >> 2);
+    }
+    
+    return i + scalar_span(data + i, len - i, set);
+}
+
+static size_t neon_rspan(const char* data, size_t len, const byte_set* set) {
+    const uint8x16_t low_rows = vld1q_u8(set->low_rows);
+    const uint8x16_t high_rows = vld1q_u8(set->high_rows);
+    size_t end = len;
+    
+    for (; end >= 16; end -= 16) {
+        uint64_t outside = ~neon_members(vld1q_u8((const uint8_t*)data + end - 16), low_rows, high_rows);
+        
+        if (outside) return len - (end - 16 + ((size_t)(63 - __builtin_clzll(outside)) >> 2)) - 1;
+    }
+    
+    return len - end + scalar_rspan(data, end, set);
+}
+
+static void neon_to_upper(char* data, size_t len) {
+    const uint8x16_t lower_a = vdupq_n_u8('a');
+    const uint8x16_t letters = vdupq_n_u8(26);
+    const uint8x16_t case_bit = vdupq_n_u8('a' - 'A');
+    size_t i = 0;
+    
+    for (; i + 16 <= len; i += 16) {
+        uint8x16_t chars = vld1q_u8((const uint8_t*)data + i);
+        uint8x16_t is_lower = vcltq_u8(vsubq_u8(chars, lower_a), letters);
+        vst1q_u8((uint8_t*)data + i, vsubq_u8(chars, vandq_u8(is_lower, case_bit)));
+    }
+    
+    scalar_to_upper(data + i, len - i);
+}
+
+static void neon_to_lower(char* data, size_t len) {
+    const uint8x16_t upper_a = vdupq_n_u8('A');
+    const uint8x16_t letters = vdupq_n_u8(26);
+    const uint8x16_t case_bit = vdupq_n_u8('a' - 'A');
+    size_t i = 0;
+    
+    for (; i + 16 <= len; i += 16) {
+        uint8x16_t chars = vld1q_u8((const uint8_t*)data + i);
+        uint8x16_t is_upper = vcltq_u8(vsubq_u8(chars, upper_a), letters);
+        vst1q_u8((uint8_t*)data + i, vaddq_u8(chars, vandq_u8(is_upper, case_bit)));
+    }
+    
+    scalar_to_lower(data + i, len - i);
+}
+
+static inline uint8x16_t neon_fold(uint8x16_t chars) {
+    uint8x16_t is_upper = vcltq_u8(vsubq_u8(chars, vdupq_n_u8('A')), vdupq_n_u8(26));
+    return vaddq_u8(chars, vandq_u8(is_upper, vdupq_n_u8('a' - 'A')));
+}
+
+static int neon_compare_icase(const char* a, const char* b, size_t len) {
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        uint8x16_t eq = vceqq_u8(neon_fold(vld1q_u8((const uint8_t*)a + i)),
+                                 neon_fold(vld1q_u8((const uint8_t*)b + i)));
+        if (vminvq_u8(eq) != 0xFF) {
+            uint64_t diff = ~neon_nibble_mask(eq);
+            size_t pos = i + ((size_t)__builtin_ctzll(diff) >> 2);
+            return (unsigned char)ascii_to_lower(a[pos]) - (unsigned char)ascii_to_lower(b[pos]);
+        }
+    }
+    
+    return icase_compare_bytes(a + i, b + i, len - i);
+}
+
+static bool neon_equals_icase(const char* a, const char* b, size_t len) {
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        uint8x16_t eq = vceqq_u8(neon_fold(vld1q_u8((const uint8_t*)a + i)),
+                                 neon_fold(vld1q_u8((const uint8_t*)b + i)));
+        if (vminvq_u8(eq) != 0xFF) return false;
+    }
+    
+    return icase_compare_bytes(a + i, b + i, len - i) == 0;
+}
+
+static const char* neon_find_icase(const char* haystack, size_t haystack_len,
+                                   const search_needle* pattern) {
+    const char* const needle = pattern->data;
+    const size_t needle_len = pattern->length;
+    const uint8x16_t first = vdupq_n_u8((uint8_t)ascii_to_lower(needle[0]));
+    const uint8x16_t last = vdupq_n_u8((uint8_t)ascii_to_lower(needle[needle_len - 1]));
+    const size_t candidates = haystack_len - needle_len + 1;
+    size_t budget = search_budget(haystack_len);
+    size_t i = 0;
+    
+    for (; i + 16 <= candidates; i += 16) {
+        uint8x16_t head = vceqq_u8(neon_fold(vld1q_u8((const uint8_t*)haystack + i)), first);
+        uint8x16_t tail = vceqq_u8(neon_fold(vld1q_u8((const uint8_t*)haystack + i + needle_len - 1)), last);
+        uint64_t mask = neon_nibble_mask(vandq_u8(head, tail)) & 0x8888888888888888ULL;
+        
+        while (mask) {
+            size_t pos = i + ((size_t)__builtin_ctzll(mask) >> 2);
+            if (needle_len <= 2 || neon_equals_icase(haystack + pos + 1, needle + 1, needle_len - 2)) {
+                return haystack + pos;
+            }
+            if (!search_charge(&budget, needle_len)) {
+                return icase_two_way_from(haystack, haystack_len, pattern, pos + 1);
+            }
+            mask &= mask - 1;
+        }
+    }
+    
+    return icase_filter_find_from(haystack, haystack_len, pattern, i, budget);
+}
+
+static inline uint8x16_t neon_utf8_block(uint8x16_t input, uint8x16_t prev_input) {
+    const uint8x16_t nibble = vdupq_n_u8(0x0F);
+    uint8x16_t prev1 = vextq_u8(prev_input, input, 15);
+    uint8x16_t byte_1_high = vqtbl1q_u8(vld1q_u8(utf8_byte_1_high), vshrq_n_u8(prev1, 4));
+    uint8x16_t byte_1_low = vqtbl1q_u8(vld1q_u8(utf8_byte_1_low), vandq_u8(prev1, nibble));
+    uint8x16_t byte_2_high = vqtbl1q_u8(vld1q_u8(utf8_byte_2_high), vshrq_n_u8(input, 4));
+    uint8x16_t special = vandq_u8(vandq_u8(byte_1_high, byte_1_low), byte_2_high);
+    
+    uint8x16_t third = vqsubq_u8(vextq_u8(prev_input, input, 14), vdupq_n_u8(0xE0 - 0x80));
+    uint8x16_t fourth = vqsubq_u8(vextq_u8(prev_input, input, 13), vdupq_n_u8(0xF0 - 0x80));
+    uint8x16_t must23 = vandq_u8(vorrq_u8(third, fourth), vdupq_n_u8(0x80));
+    return veorq_u8(must23, special);
+}
+
+static int neon_utf8_check(const char* data, size_t len) {
+    const uint8x16_t incomplete_max = vld1q_u8(utf8_incomplete_max + 48);
+    uint8x16_t error = vdupq_n_u8(0);
+    uint8x16_t prev_input = vdupq_n_u8(0);
+    uint8x16_t prev_incomplete = vdupq_n_u8(0);
+    bool ascii = true;
+    
+    for (size_t i = 0; i < len; i += 16) {
+        uint8x16_t input;
+        if (len - i >= 16) {
+            input = vld1q_u8((const uint8_t*)data + i);
+        } else {
+            uint8_t tail[16] = {0};
+            memcpy(tail, data + i, len - i);
+            input = vld1q_u8(tail);
+        }
+        
+        if (vmaxvq_u8(input) < 0x80) {
+            error = vorrq_u8(error, prev_incomplete);
+        } else {
+            ascii = false;
+            error = vorrq_u8(error, neon_utf8_block(input, prev_input));
+            prev_incomplete = vqsubq_u8(input, incomplete_max);
+        }
+        if (vmaxvq_u8(error)) return UTF8_INVALID;
+        prev_input = input;
+    }
+    
+    if (vmaxvq_u8(vorrq_u8(error, prev_incomplete))) return UTF8_INVALID;
+    return ascii ? UTF8_ASCII : UTF8_VALID;
+}
+
+static size_t neon_utf8_count(const char* data, size_t len) {
+    const int8x16_t last_continuation = vdupq_n_s8(-65);
+    size_t count = 0;
+    size_t i = 0;
+    
+    for (; i + 16 <= len; i += 16) {
+        uint8x16_t leads = vcgtq_s8(vld1q_s8((const int8_t*)data + i), last_continuation);
+        count += vaddvq_u8(vshrq_n_u8(leads, 7));
+    }
+    
+    return count + scalar_utf8_count(data + i, len - i);
+}
+
+static const string_kernels neon_kernels = {
+    STRING_SIMD_NEON,
+    neon_compare, neon_equals, neon_find, neon_find_any,
+    neon_span, neon_rspan,
+    neon_to_upper, neon_to_lower,
+    neon_compare_icase, neon_equals_icase, neon_find_icase,
+    neon_utf8_check, neon_utf8_count
+};
+#endif /* STRING_SIMD_ARM */
+
+// Kernel table for a level, or NULL if this build or CPU cannot run it
+static const string_kernels* kernels_for_level(string_simd_level level) {
+    switch (level) {
+    case STRING_SIMD_SCALAR:
+        return &scalar_kernels;
+#ifdef STRING_SIMD_X86
+    case STRING_SIMD_SSE42:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("sse4.2") ? &sse42_kernels : NULL;
+    case STRING_SIMD_AVX2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") ? &avx2_kernels : NULL;
+    case STRING_SIMD_AVX512:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx512f") &&
+               __builtin_cpu_supports("avx512bw") ? &avx512_kernels : NULL;
+#endif
+#ifdef STRING_SIMD_ARM
+    case STRING_SIMD_NEON:
+        return &neon_kernels;
+#endif
+    default:
+        return NULL;
+    }
+}
+
+static const string_kernels* detect_kernels(void) {
+    static const string_simd_level preference[] = {
+        STRING_SIMD_AVX512, STRING_SIMD_AVX2, STRING_SIMD_SSE42, STRING_SIMD_NEON
+    };
+    
+    for (size_t i = 0; i < sizeof(preference) / sizeof(preference[0]); i++) {
+        const string_kernels* kernels = kernels_for_level(preference[i]);
+        if (kernels) return kernels;
+    }
+    return &scalar_kernels;
+}
+
+static _Atomic(const string_kernels*) active_kernels_ptr = NULL;
+
+// Pick the widest kernels once when the library is loaded
+__attribute__((constructor))
+static void string_simd_init(void) {
+    atomic_store_explicit(&active_kernels_ptr, detect_kernels(), memory_order_relaxed);
+}
+
+static inline const string_kernels* active_kernels(void) {
+    const string_kernels* kernels = atomic_load_explicit(&active_kernels_ptr, memory_order_relaxed);
+    if (__builtin_expect(!kernels, 0)) {
+        // Called from another constructor before ours ran
+        string_simd_init();
+        kernels = atomic_load_explicit(&active_kernels_ptr, memory_order_relaxed);
+    }
+    return kernels;
+}
+
+// Count a kernel call as SIMD when it is long enough for one full vector of
+// the active level; shorter calls only run the scalar tails
+static inline void stat_kernel_call([[maybe_unused]] const string_kernels* kernels,
+                                    [[maybe_unused]] size_t len) {
+#ifdef STRING_STATS
+    static const size_t vector_bytes[] = {
+        [STRING_SIMD_SCALAR] = SIZE_MAX, [STRING_SIMD_SSE42] = 16, [STRING_SIMD_AVX2] = 32,
+        [STRING_SIMD_AVX512] = 64, [STRING_SIMD_NEON] = 16
+    };
+    if (len >= vector_bytes[kernels->level]) {
+        thread_stats.simd_calls++;
+    } else {
+        thread_stats.scalar_calls++;
+    }
+#endif
+}
+
+// Kernels for one call over len bytes
+static inline const string_kernels* kernels_for(size_t len) {
+    const string_kernels* kernels = active_kernels();
+    stat_kernel_call(kernels, len);
+    return kernels;
+}
+
+string_simd_level string_simd_get_level(void) {
+    return active_kernels()->level;
+}
+
+bool string_simd_set_level(string_simd_level level) {
+    const string_kernels* kernels = kernels_for_level(level);
+    if (!kernels) return false;
+    atomic_store_explicit(&active_kernels_ptr, kernels, memory_order_relaxed);
+    return true;
+}
+
+bool string_simd_level_supported(string_simd_level level) {
+    return kernels_for_level(level) != NULL;
+}
+
+const char* string_simd_level_name(string_simd_level level) {
+    switch (level) {
+    case STRING_SIMD_SCALAR: return "scalar";
+    case STRING_SIMD_SSE42:  return "sse4.2";
+    case STRING_SIMD_AVX2:   return "avx2";
+    case STRING_SIMD_AVX512: return "avx512";
+    case STRING_SIMD_NEON:   return "neon";
+    default:                 return "unknown";
+    }
+}
+
+// 64-bit wyhash-style hash: 48 bytes per round in three independent
+// multiply-mix lanes, with overlapping loads for the tail so short keys take
+// no loop at all. Reads are little-endian so hashes match across targets.
+static const uint64_t hash_secret[4] = {
+    0xa0761d6478bd642full, 0xe7037ed1a0b428dbull, 0x8ebc6af09c88c6e3ull, 0x589965cc75374cc3ull
+};
+
+// Full 64x64 -> 128 bit product, folded to 64 bits
+static inline uint64_t hash_mix(uint64_t a, uint64_t b) {
+#ifdef __SIZEOF_INT128__
+    __extension__ unsigned __int128 product = (unsigned __int128)a * b;
+    return (uint64_t)product ^ (uint64_t)(product >> 64);
+#else
+    uint64_t a_lo = (uint32_t)a, a_hi = a >> 32, b_lo = (uint32_t)b, b_hi = b >> 32;
+    uint64_t lo_lo = a_lo * b_lo, hi_lo = a_hi * b_lo, lo_hi = a_lo * b_hi, hi_hi = a_hi * b_hi;
+    uint64_t cross = (lo_lo >> 32) + (uint32_t)hi_lo + lo_hi;
+    uint64_t hi = hi_hi + (hi_lo >> 32) + (cross >> 32);
+    return ((cross << 32) | (uint32_t)lo_lo) ^ hi;
+#endif
+}
+
+static inline uint64_t hash_read8(const unsigned char* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    return v;
+}
+
+static inline uint64_t hash_read4(const unsigned char* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap32(v);
+#endif
+    return v;
+}
+
+static uint64_t hash_bytes(const char* data, size_t len) {
+    const unsigned char* p = (const unsigned char*)data;
+    uint64_t seed = hash_secret[0];
+    uint64_t a, b;
+    
+    if (len <= 16) {
+        if (len >= 4) {
+            size_t mid = (len >> 3) << 2;
+            a = (hash_read4(p) << 32) | hash_read4(p + mid);
+            b = (hash_read4(p + len - 4) << 32) | hash_read4(p + len - 4 - mid);
+        } else if (len > 0) {
+            a = ((uint64_t)p[0] << 16) | ((uint64_t)p[len >> 1] << 8) | p[len - 1];
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = len;
+        if (i > 48) {
+            uint64_t lane1 = seed, lane2 = seed;
+            do {
+                seed = hash_mix(hash_read8(p) ^ hash_secret[1], hash_read8(p + 8) ^ seed);
+                lane1 = hash_mix(hash_read8(p + 16) ^ hash_secret[2], hash_read8(p + 24) ^ lane1);
+                lane2 = hash_mix(hash_read8(p + 32) ^ hash_secret[3], hash_read8(p + 40) ^ lane2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= lane1 ^ lane2;
+        }
+        while (i > 16) {
+            seed = hash_mix(hash_read8(p) ^ hash_secret[1], hash_read8(p + 8) ^ seed);
+            p += 16;
+            i -= 16;
+        }
+        a = hash_read8(p + i - 16);
+        b = hash_read8(p + i - 8);
+    }
+    
+    return hash_mix(hash_secret[1] ^ len, hash_mix(a ^ hash_secret[1], b ^ seed));
+}
+
+// The cache sits in the last 8 bytes of a heap buffer and is only used while
+// they lie past the null terminator. Shared buffers are read from several
+// threads and keep their trailer there, so they are never cached into.
+static inline bool hash_slot_free(const string* str) {
+    return !STRING_IS_SMALL(str) && !STRING_IS_SHARED(str) &&
+           str->heap.length + 1 + sizeof(uint64_t) <= heap_capacity(str);
+}
+
+static inline bool cached_hash(const string* str, uint64_t* hash) {
+    if (STRING_IS_SMALL(str) || !(STRING_TAG(str) & STRING_TAG_HASHED)) return false;
+    memcpy(hash, str->heap.data + heap_capacity(str) - sizeof(uint64_t), sizeof(uint64_t));
+    return true;
+}
+
+uint64_t string_hash(const string* str) {
+    if (!str) return hash_bytes("", 0);
+    
+    uint64_t hash;
+    if (cached_hash(str, &hash)) return hash;
+    
+    hash = hash_bytes(STRING_DATA(str), STRING_LENGTH(str));
+    
+    // Small strings rehash in a couple of multiplies and have nowhere to
+    // keep it. The cache is not part of the value, so storing it through a
+    // const string is fine.
+    if (hash_slot_free(str)) {
+        string* cache = (string*)str;
+        memcpy(cache->heap.data + heap_capacity(cache) - sizeof(uint64_t), &hash, sizeof(uint64_t));
+        set_tag(cache, STRING_TAG(cache) | STRING_TAG_HASHED);
+    }
+    return hash;
+}
+
+uint64_t string_view_hash(string_view sv) {
+    return hash_bytes(sv.data ? sv.data : "", sv.data ? sv.length : 0);
+}
+
+int string_compare(const string* str1, const string* str2) {
+    if (!str1 && !str2) return 0;
+    if (!str1) return -1;
+    if (!str2) return 1;
+    
+    size_t len1 = STRING_LENGTH(str1);
+    size_t len2 = STRING_LENGTH(str2);
+    size_t len = (len1 < len2) ? len1 : len2;
+    int result = kernels_for(len)->compare(STRING_DATA(str1), STRING_DATA(str2), len);
+    if (result != 0) return result;
+    
+    // Strings are equal up to the minimum length, so the shorter one is less
+    return (len1 > len2) - (len1 < len2);
+}
+
+bool string_equals(const string* str1, const string* str2) {
+    if (str1 == str2) return true;
+    if (!str1 || !str2) return false;
+    size_t len = STRING_LENGTH(str1);
+    if (len != STRING_LENGTH(str2)) return false;
+    
+    // Distinct strings from one pool never hold the same value
+    if (STRING_IS_INTERNED(str1) && STRING_IS_INTERNED(str2) && pool_of(str1) == pool_of(str2)) return false;
+    
+    // Keys that have been hashed before differ in their hash almost always
+    uint64_t hash1, hash2;
+    if (cached_hash(str1, &hash1) && cached_hash(str2, &hash2) && hash1 != hash2) return false;
+    return kernels_for(len)->equals(STRING_DATA(str1), STRING_DATA(str2), len);
+}
+
+int string_compare_icase(const string* str1, const string* str2) {
+    if (!str1 && !str2) return 0;
+    if (!str1) return -1;
+    if (!str2) return 1;
+    
+    size_t len1 = STRING_LENGTH(str1);
+    size_t len2 = STRING_LENGTH(str2);
+    size_t len = (len1 < len2) ? len1 : len2;
+    int result = kernels_for(len)->compare_icase(STRING_DATA(str1), STRING_DATA(str2), len);
+    if (result != 0) return result;
+    
+    return (len1 > len2) - (len1 < len2);
+}
+
+bool string_equals_icase(const string* str1, const string* str2) {
+    if (str1 == str2) return true;
+    if (!str1 || !str2) return false;
+    size_t len = STRING_LENGTH(str1);
+    if (len != STRING_LENGTH(str2)) return false;
+    return kernels_for(len)->equals_icase(STRING_DATA(str1), STRING_DATA(str2), len);
+}
+
+// Offset of the first match of a non-empty needle, or -1
+static ptrdiff_t find_pattern(const char* haystack, size_t haystack_len,
+                              const search_needle* pattern) {
+    if (pattern->length > haystack_len) return -1;
+    
+    const char* found = kernels_for(haystack_len)->find(haystack, haystack_len, pattern);
+    return found ? (found - haystack) : -1;
+}
+
+// Shared search entry point for strings, C strings and views
+static ptrdiff_t find_bytes(const char* haystack, size_t haystack_len,
+                           const char* needle, size_t needle_len) {
+    if (needle_len == 0) return 0;
+    
+    const search_needle pattern = { needle, needle_len, NULL };
+    return find_pattern(haystack, haystack_len, &pattern);
+}
+
+ptrdiff_t string_find(const string* str, const string* substr) {
+    if (!str || !substr) return -1;
+    return find_bytes(STRING_DATA(str), STRING_LENGTH(str), STRING_DATA(substr), STRING_LENGTH(substr));
+}
+
+ptrdiff_t string_find_cstr(const string* str, const char* substr) {
+    if (!str || !substr) return -1;
+    return find_bytes(STRING_DATA(str), STRING_LENGTH(str), substr, strlen(substr));
+}
+
+void string_to_upper(string* str) {
+    if (!str || !STRING_LENGTH(str) || !unshare(str)) return;
+    kernels_for(STRING_LENGTH(str))->to_upper(STRING_DATA(str), STRING_LENGTH(str));
+    invalidate_hash(str);
+}
+
+void string_to_lower(string* str) {
+    if (!str || !STRING_LENGTH(str) || !unshare(str)) return;
+    kernels_for(STRING_LENGTH(str))->to_lower(STRING_DATA(str), STRING_LENGTH(str));
+    invalidate_hash(str);
+}
+
+// The C locale's isspace set: space, \t, \n, \v, \f and \r, laid out as
+// string_byte_set_from would build it
+static const byte_set whitespace_set = {
+    .bits = { (1ull << ' ') | (1ull << '\t') | (1ull << '\n') | (1ull << '\v') | (1ull << '\f') | (1ull << '\r') },
+    .low_rows = { [' ' & 15] = 1 << (' ' >> 4), ['\t'] = 1, ['\n'] = 1, ['\v'] = 1, ['\f'] = 1, ['\r'] = 1 },
+};
+
+void string_trim_set(string* str, const string_byte_set* set, unsigned flags) {
+    if (!str || !set || !STRING_LENGTH(str)) return;
+    
+    char* data = STRING_DATA(str);
+    size_t length = STRING_LENGTH(str);
+    const string_kernels* kernels = kernels_for(length);
+    size_t lead = (flags & STRING_TRIM_LEFT) ? kernels->span(data, length, set) : 0;
+    size_t trail = (flags & STRING_TRIM_RIGHT) ? kernels->rspan(data + lead, length - lead, set) : 0;
+    size_t new_length = length - lead - trail;
+    char* start = data + lead;
+    
+    // A shared string copies out just the trimmed bytes, if anything changed
+    if (STRING_IS_SHARED(str)) {
+        if (new_length == length) return;
+        if (!detach(str, lead, new_length, 0)) return;
+        start = STRING_DATA(str);
+    }
+    
+    bool keep_buffer = (flags & STRING_TRIM_KEEP_BUFFER) != 0;
+    if (keep_buffer && new_length == length) return;
+    
+    // Check if we can convert to small string after trimming
+    if (!keep_buffer && !STRING_IS_SMALL(str) && !STRING_IN_ARENA(str) && new_length <= SSO_SIZE) {
+        // Convert to small string; the trimmed bytes live in the heap buffer,
+        // so they can be copied straight over the header
+        string heap = *str;
+        memcpy(str->stack.data, start, new_length);
+        set_tag(str, 0);
+        
+        // Free heap data
+        buffer_free(&heap, heap.heap.data);
+        STAT_ADD(shrinks, 1);
+    } else if (start > STRING_DATA(str)) {
+        // Move the data in place
+        memmove(STRING_DATA(str), start, new_length);
+    }
+    
+    set_length(str, new_length);
+    
+    // Try to shrink memory usage
+    if (!keep_buffer && !STRING_IS_SMALL(str) && !STRING_IN_ARENA(str) && heap_capacity(str) > new_length * 2 && 
+        new_length > SSO_SIZE && new_length < 1024) {
+        
+        // Shrink the buffer to avoid wasting memory
+        size_t new_capacity = round_to_cache_line(new_length * 2);
+        char* new_data = buffer_realloc(str, str->heap.data, new_length + 1,
+                                        heap_capacity(str), new_capacity);
+        
+        if (new_data) {
+            str->heap.data = new_data;
+            set_heap_capacity(str, new_capacity);
+            STAT_ADD(shrinks, 1);
+        }
+    }
+}
+
+// Add an optimized trim function that automatically switches to small string
+// optimization when possible
+void string_trim(string* str) {
+    string_trim_set(str, &whitespace_set, STRING_TRIM_BOTH);
+}
+
+void string_trim_left(string* str) {
+    string_trim_set(str, &whitespace_set, STRING_TRIM_LEFT);
+}
+
+void string_trim_right(string* str) {
+    string_trim_set(str, &whitespace_set, STRING_TRIM_RIGHT);
+}
+
+string* string_substr(const string* str, size_t start, size_t length) {
+    size_t str_len = string_length(str);
+    if (!str || start >= str_len) return NULL;
+    
+    length = (length > str_len - start) ? (str_len - start) : length;
+    
+    // A long suffix of a shared buffer is already null-terminated, so it
+    // can be shared as well
+    if (STRING_IS_SHARED(str) && start + length == str_len && length > SSO_SIZE) {
+        string* result = share_handle(str);
+        if (!result) return NULL;
+        result->heap.data += start;
+        result->heap.length = length;
+        set_heap_capacity(result, heap_capacity(str) - start);
+        return result;
+    }
+    
+    string* result = string_with_capacity(length + 1);
+    if (!result) return NULL;
+    
+    memcpy(STRING_DATA(result), STRING_DATA(str) + start, length);
+    set_length(result, length);
+    return result;
+}
+
+static string** split_pattern(string_arena* arena, const string* str,
+                              const search_needle* delim, size_t* count) {
+    if (!str || !count || !STRING_LENGTH(str) || !delim->length) {
+        if (count) *count = 0;
+        return NULL;
+    }
+    
+    const char* data = STRING_DATA(str);
+    size_t str_len = STRING_LENGTH(str);
+    size_t delim_len = delim->length;
+    
+    // Count splits
+    size_t num_splits = 1;
+    for (size_t pos = 0; pos <= str_len; ) {
+        ptrdiff_t found = find_pattern(data + pos, str_len - pos, delim);
+        if (found < 0) break;
+        num_splits++;
+        pos += (size_t)found + delim_len;
+    }
+    
+    string** result = arena
+        ? arena_alloc(arena, num_splits * sizeof(string*), _Alignof(string*))
+        : calloc(num_splits, sizeof(string*));
+    if (!result) {
+        if (count) *count = 0;
+        return NULL;
+    }
+    
+    // Split string
+    // Every piece is produced, including an empty one after a trailing delimiter
+    const char* start = data;
+    
+    for (size_t i = 0; i < num_splits; i++) {
+        ptrdiff_t found = (i + 1 < num_splits)
+            ? find_pattern(start, str_len - (size_t)(start - data), delim) : -1;
+        const char* end = (found >= 0) ? start + found : data + str_len;
+        
+        size_t part_len = end - start;
+        result[i] = with_capacity_in(arena, part_len + 1);
+        if (!result[i]) {
+            if (!arena) {
+                for (size_t j = 0; j < i; j++) string_free(result[j]);
+                free(result);
+            }
+            if (count) *count = 0;
+            return NULL;
+        }
+        
+        memcpy(STRING_DATA(result[i]), start, part_len);
+        set_length(result[i], part_len);
+        
+        start = end + delim_len;
+    }
+    
+    *count = num_splits;
+    return result;
+}
+
+static string** split_in(string_arena* arena, const string* str, const char* delim, size_t* count) {
+    if (!delim) {
+        if (count) *count = 0;
+        return NULL;
+    }
+    
+    const search_needle pattern = { delim, strlen(delim), NULL };
+    return split_pattern(arena, str, &pattern, count);
+}
+
+string** string_split(const string* str, const char* delim, size_t* count) {
+    return split_in(NULL, str, delim, count);
+}
+
+string** string_split_in(string_arena* arena, const string* str, const char* delim, size_t* count) {
+    if (!arena) {
+        if (count) *count = 0;
+        return NULL;
+    }
+    return split_in(arena, str, delim, count);
+}
+
+string* string_join(string** strs, size_t count, const char* delim) {
+    if (!strs || !count || !delim) return NULL;
+    
+    size_t delim_len = strlen(delim);
+    size_t total_len = 0;
+    
+    for (size_t i = 0; i < count; i++) {
+        if (strs[i]) {
+            if (__builtin_add_overflow(total_len, STRING_LENGTH(strs[i]), &total_len)) {
+                errno = EOVERFLOW;
+                return NULL;
+            }
+            if (i < count - 1 && __builtin_add_overflow(total_len, delim_len, &total_len)) {
+                errno = EOVERFLOW;
+                return NULL;
+            }
+        }
+    }
+    
+    if (total_len == SIZE_MAX) {
+        errno = EOVERFLOW;
+        return NULL;
+    }
+    string* result = string_with_capacity(total_len + 1);
+    if (!result) return NULL;
+    
+    // The buffer is sized exactly, so the pieces are copied straight in
+    char* out = STRING_DATA(result);
+    for (size_t i = 0; i < count; i++) {
+        if (strs[i]) {
+            size_t len = STRING_LENGTH(strs[i]);
+            memcpy(out, STRING_DATA(strs[i]), len);
+            out += len;
+            if (i < count - 1) {
+                memcpy(out, delim, delim_len);
+                out += delim_len;
+            }
+        }
+    }
+    set_length(result, total_len);
+    
+    return result;
+}
+
+#ifdef STRING_HAVE_IOVEC
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+// Entries string_join_write_fd gathers on the stack per writev
+#define JOIN_WRITE_BATCH 1024
+
+static inline void set_iovec(struct iovec* iov, const char* data, size_t length) {
+    iov->iov_base = (void*)data;    // writev only reads through it
+    iov->iov_len = length;
+}
+
+size_t string_to_iovec(string** strs, size_t count, struct iovec* iov, size_t iov_count) {
+    if (!strs) return 0;
+    
+    size_t needed = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (!strs[i] || !STRING_LENGTH(strs[i])) continue;
+        if (needed < iov_count) set_iovec(&iov[needed], STRING_DATA(strs[i]), STRING_LENGTH(strs[i]));
+        needed++;
+    }
+    return needed;
+}
+
+// Fill entries for the join from piece *next on, stopping before the array
+// is full; returns the entries used and leaves *next at the first piece
+// left over. A piece and the delimiter after it are added together, as
+// string_join does, so a batch never ends between the two.
+static size_t join_iovec_from(string** strs, size_t count, const char* delim, size_t delim_len,
+                              struct iovec* iov, size_t iov_count, size_t* next) {
+    size_t used = 0;
+    size_t i = *next;
+    for (; i < count; i++) {
+        if (!strs[i]) continue;
+        size_t length = STRING_LENGTH(strs[i]);
+        bool with_delim = i < count - 1 && delim_len;
+        size_t entries = (length != 0) + with_delim;
+        if (iov_count - used < entries) break;
+        
+        if (length) set_iovec(&iov[used++], STRING_DATA(strs[i]), length);
+        if (with_delim) set_iovec(&iov[used++], delim, delim_len);
+    }
+    *next = i;
+    return used;
+}
+
+size_t string_join_iovec(string** strs, size_t count, const char* delim,
+                         struct iovec* iov, size_t iov_count) {
+    if (!strs || !count || !delim) return 0;
+    
+    size_t delim_len = strlen(delim);
+    size_t needed = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (strs[i]) needed += (STRING_LENGTH(strs[i]) != 0) + (i < count - 1 && delim_len);
+    }
+    
+    size_t next = 0;
+    if (iov_count) (void)join_iovec_from(strs, count, delim, delim_len, iov, iov_count, &next);
+    return needed;
+}
+
+bool string_writev_fd(int fd, struct iovec* iov, size_t iov_count) {
+    if (!iov && iov_count) {
+        errno = EINVAL;
+        return false;
+    }
+    
+    while (iov_count) {
+        // Skip entries already written, then hand the kernel a batch
+        if (iov->iov_len == 0) {
+            iov++;
+            iov_count--;
+            continue;
+        }
+        int batch = iov_count < IOV_MAX ? (int)iov_count : IOV_MAX;
+        ssize_t written = writev(fd, iov, batch);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        if (written == 0) {
+            errno = EIO;
+            return false;
+        }
+        
+        size_t left = (size_t)written;
+        while (left && left >= iov->iov_len) {
+            left -= iov->iov_len;
+            iov++;
+            iov_count--;
+        }
+        if (left) {
+            iov->iov_base = (char*)iov->iov_base + left;
+            iov->iov_len -= left;
+        }
+    }
+    return true;
+}
+
+bool string_write_fd(int fd, const string* str) {
+    if (!str) {
+        errno = EINVAL;
+        return false;
+    }
+    struct iovec iov;
+    set_iovec(&iov, STRING_DATA(str), STRING_LENGTH(str));
+    return string_writev_fd(fd, &iov, 1);
+}
+
+bool string_join_write_fd(int fd, string** strs, size_t count, const char* delim) {
+    if (!strs || !delim) {
+        errno = EINVAL;
+        return false;
+    }
+    
+    size_t delim_len = strlen(delim);
+    struct iovec batch[JOIN_WRITE_BATCH];
+    size_t next = 0;
+    while (next < count) {
+        size_t used = join_iovec_from(strs, count, delim, delim_len, batch, JOIN_WRITE_BATCH, &next);
+        if (!string_writev_fd(fd, batch, used)) return false;
+    }
+    return true;
+}
+#endif
+
+// Match offsets found by the counting scan are kept so the rewrite never
+// searches again; this many fit on the stack before spilling to the heap
+#define REPLACE_STACK_MATCHES 64
+
+static bool replace_pattern(string* str, const search_needle* old, const char* new_str) {
+    if (!str || !new_str || !STRING_LENGTH(str)) return false;
+    
+    size_t length = STRING_LENGTH(str);
+    
+    size_t old_len = old->length;
+    if (!old_len) return true;
+    
+    size_t new_len = strlen(new_str);
+    size_t stack_matches[REPLACE_STACK_MATCHES];
+    size_t* matches = stack_matches;
+    size_t max_matches = REPLACE_STACK_MATCHES;
+    size_t count = 0;
+    
+    // Record every non-overlapping occurrence in one scan
+    for (size_t pos = 0; pos <= length; ) {
+        ptrdiff_t found = find_pattern(STRING_DATA(str) + pos, length - pos, old);
+        if (found < 0) break;
+        
+        if (count == max_matches) {
+            size_t* grown = (matches == stack_matches)
+                ? malloc(2 * max_matches * sizeof(size_t))
+                : realloc(matches, 2 * max_matches * sizeof(size_t));
+            if (!grown) {
+                if (matches != stack_matches) free(matches);
+                return false;
+            }
+            if (matches == stack_matches) memcpy(grown, stack_matches, sizeof(stack_matches));
+            matches = grown;
+            max_matches *= 2;
+        }
+        
+        matches[count++] = pos + (size_t)found;
+        pos += (size_t)found + old_len;
+    }
+    
+    if (!count) return true;
+    
+    // The rewrite moves bytes in place, so a replacement taken from str
+    // itself has to be copied out first
+    char* replacement_copy = NULL;
+    if (new_len && aliases_string(str, new_str)) {
+        replacement_copy = malloc(new_len);
+        if (!replacement_copy) {
+            if (matches != stack_matches) free(matches);
+            return false;
+        }
+        memcpy(replacement_copy, new_str, new_len);
+        new_str = replacement_copy;
+    }
+    
+    bool ok = true;
+    if (new_len <= old_len && !unshare(str)) {
+        ok = false;
+    } else if (new_len <= old_len) {
+        // Shrinking or same size: one forward pass, the write position never
+        // overtakes the read position
+        char* data = STRING_DATA(str);
+        size_t read_pos = 0, write_pos = 0;
+        
+        for (size_t i = 0; i < count; i++) {
+            size_t prefix_len = matches[i] - read_pos;
+            if (write_pos != read_pos) memmove(data + write_pos, data + read_pos, prefix_len);
+            write_pos += prefix_len;
+            memcpy(data + write_pos, new_str, new_len);
+            write_pos += new_len;
+            read_pos = matches[i] + old_len;
+        }
+        memmove(data + write_pos, data + read_pos, length - read_pos);
+        set_length(str, write_pos + length - read_pos);
+        
+        // Try to shrink to small string if possible
+        try_shrink_to_small(str);
+    } else {
+        // Growing: size the buffer once, then fill it back to front so no
+        // byte is overwritten before it has been moved
+        size_t new_total_len;
+        if (__builtin_mul_overflow(count, new_len - old_len, &new_total_len) ||
+            __builtin_add_overflow(length, new_total_len, &new_total_len)) {
+            errno = EOVERFLOW;
+            ok = false;
+        } else if ((ok = ensure_capacity(str, new_total_len + 1))) {
+            char* data = STRING_DATA(str);
+            size_t read_pos = length, write_pos = new_total_len;
+            
+            for (size_t i = count; i-- > 0; ) {
+                size_t suffix_len = read_pos - (matches[i] + old_len);
+                write_pos -= suffix_len;
+                memmove(data + write_pos, data + matches[i] + old_len, suffix_len);
+                write_pos -= new_len;
+                memcpy(data + write_pos, new_str, new_len);
+                read_pos = matches[i];
+            }
+            set_length(str, new_total_len);
+        }
+    }
+    
+    free(replacement_copy);
+    if (matches != stack_matches) free(matches);
+    return ok;
+}
+
+bool string_replace(string* str, const char* old_str, const char* new_str) {
+    if (!old_str) return false;
+    
+    const search_needle pattern = { old_str, strlen(old_str), NULL };
+    return replace_pattern(str, &pattern, new_str);
+}
+
+char string_char_at(const string* str, size_t index) {
+    if (!str || index >= STRING_LENGTH(str)) return '\0';
+    return STRING_DATA(str)[index];
+}
+
+// String views
+string_view string_view_from_cstr(const char* cstr) {
+    return (string_view){ cstr ? cstr : "", cstr ? strlen(cstr) : 0 };
+}
+
+string_view string_as_view(const string* str) {
+    return str ? (string_view){ STRING_DATA(str), STRING_LENGTH(str) } : (string_view){ "", 0 };
+}
+
+string_view string_view_substr(string_view sv, size_t start, size_t length) {
+    if (start >= sv.length) return (string_view){ sv.data + sv.length, 0 };
+    
+    length = (length > sv.length - start) ? (sv.length - start) : length;
+    return (string_view){ sv.data + start, length };
+}
+
+ptrdiff_t string_view_find(string_view sv, string_view needle) {
+    return find_bytes(sv.data, sv.length, needle.data, needle.length);
+}
+
+bool string_view_equals(string_view a, string_view b) {
+    if (a.length != b.length) return false;
+    if (a.data == b.data) return true;
+    return kernels_for(a.length)->equals(a.data, b.data, a.length);
+}
+
+int string_view_compare(string_view a, string_view b) {
+    size_t len = (a.length < b.length) ? a.length : b.length;
+    int result = kernels_for(len)->compare(a.data, b.data, len);
+    if (result != 0) return result;
+    return (a.length > b.length) - (a.length < b.length);
+}
+
+size_t string_view_split(string_view sv, string_view delim,
+                         string_view* parts, size_t max_parts) {
+    if (!delim.length) return 0;
+    
+    size_t count = 0;
+    size_t start = 0;
+    
+    for (;;) {
+        ptrdiff_t found = find_bytes(sv.data + start, sv.length - start, delim.data, delim.length);
+        size_t end = found < 0 ? sv.length : start + (size_t)found;
+        
+        if (parts && count < max_parts) {
+            parts[count] = (string_view){ sv.data + start, end - start };
+        }
+        count++;
+        
+        if (found < 0) break;
+        start = end + delim.length;
+    }
+    
+    return count;
+}
+
+string* string_new_view(string_view sv) {
+    return string_new_n(sv.data, sv.length);
+}
+
+bool string_set_view(string* str, string_view sv) {
+    return string_set_n(str, sv.data, sv.length);
+}
+
+bool string_append_view(string* str, string_view sv) {
+    return string_append_n(str, sv.data, sv.length);
+}
+
+ptrdiff_t string_find_view(const string* str, string_view needle) {
+    if (!str || (!needle.data && needle.length)) return -1;
+    return find_bytes(STRING_DATA(str), STRING_LENGTH(str), needle.data, needle.length);
+}
+
+ptrdiff_t string_find_icase(const string* str, string_view needle) {
+    if (!str || (!needle.data && needle.length)) return -1;
+    if (needle.length == 0) return 0;
+    
+    size_t len = STRING_LENGTH(str);
+    if (needle.length > len) return -1;
+    
+    const search_needle pattern = { needle.data, needle.length, NULL };
+    const char* haystack = STRING_DATA(str);
+    const char* found = kernels_for(len)->find_icase(haystack, len, &pattern);
+    return found ? (found - haystack) : -1;
+}
+
+struct string_searcher {
+    search_needle pattern;      // Points at bytes and table below
+    two_way_table table;        // Precomputed for needles of two bytes or more
+    char bytes[];               // Owned copy of the needle, null-terminated
+};
+
+string_searcher* string_searcher_new(const char* needle) {
+    if (!needle) return NULL;
+    return string_searcher_new_view((string_view){ needle, strlen(needle) });
+}
+
+string_searcher* string_searcher_new_view(string_view needle) {
+    if (!needle.data && needle.length) return NULL;
+    if (needle.length > STRING_MAX_LENGTH) {
+        errno = EOVERFLOW;
+        return NULL;
+    }
+    
+    string_searcher* searcher = malloc(sizeof(string_searcher) + needle.length + 1);
+    if (!searcher) return NULL;
+    
+    if (needle.length) memcpy(searcher->bytes, needle.data, needle.length);
+    searcher->bytes[needle.length] = '\0';
+    searcher->pattern = (search_needle){ searcher->bytes, needle.length, &searcher->table };
+    
+    // Single bytes go straight to memchr and never reach Two-Way
+    if (needle.length > 1) two_way_prepare(&searcher->table, searcher->bytes, needle.length, false);
+    return searcher;
+}
+
+void string_searcher_free(string_searcher* searcher) {
+    free(searcher);
+}
+
+string_view string_searcher_needle(const string_searcher* searcher) {
+    if (!searcher) return (string_view){ "", 0 };
+    return (string_view){ searcher->bytes, searcher->pattern.length };
+}
+
+ptrdiff_t string_searcher_find(const string_searcher* searcher, string_view haystack) {
+    if (!searcher) return -1;
+    if (!searcher->pattern.length) return 0;
+    if (!haystack.data) return -1;
+    return find_pattern(haystack.data, haystack.length, &searcher->pattern);
+}
+
+size_t string_searcher_find_all(const string_searcher* searcher, string_view haystack,
+                                size_t* positions, size_t max_positions) {
+    if (!searcher || !searcher->pattern.length || !haystack.data) return 0;
+    
+    size_t matches = 0;
+    for (size_t pos = 0; pos <= haystack.length; ) {
+        ptrdiff_t found = find_pattern(haystack.data + pos, haystack.length - pos, &searcher->pattern);
+        if (found < 0) break;
+        
+        pos += (size_t)found;
+        if (positions && matches < max_positions) positions[matches] = pos;
+        matches++;
+        pos += searcher->pattern.length;
+    }
+    
+    return matches;
+}
+
+string** string_split_with(const string* str, const string_searcher* delim, size_t* count) {
+    if (!delim) {
+        if (count) *count = 0;
+        return NULL;
+    }
+    return split_pattern(NULL, str, &delim->pattern, count);
+}
+
+bool string_replace_with(string* str, const string_searcher* old, const char* new_str) {
+    if (!old) return false;
+    return replace_pattern(str, &old->pattern, new_str);
+}
+
+// Multi-pattern matching: an Aho-Corasick automaton with the failure links
+// folded into a dense transition table over byte classes. Bytes that occur
+// in no pattern share class 0, so the table stays small for typical sets.
+#define MATCHER_NO_PATTERN UINT32_MAX
+// Distinct first bytes up to which skipping ahead with find_any pays off
+#define MATCHER_PREFILTER_MAX 16
+
+// Each table row holds one transition per class followed by the state's
+// output and depth; transitions store the offset of the target row so a
+// step is a single dependent load
+#define MATCHER_OUTPUT(classes) (classes)
+#define MATCHER_DEPTH(classes) ((classes) + 1)
+
+struct string_matcher {
+    uint32_t* table;            // Rows of classes + 2 entries; the root row is first
+    size_t* lengths;            // Length of each pattern
+    size_t count;               // Number of patterns
+    size_t classes;             // Number of byte classes
+    uint16_t class_of[256];     // Byte class of every byte value
+    bool prefilter;             // Skip to candidates with find_any from the root
+    byte_set first_bytes;       // First byte of every pattern
+};
+
+string_matcher* string_matcher_new(const char* const* patterns, size_t count) {
+    if (!patterns || !count) {
+        errno = EINVAL;
+        return NULL;
+    }
+    
+    string_view* views = malloc(count * sizeof(string_view));
+    if (!views) return NULL;
+    
+    for (size_t i = 0; i < count; i++) views[i] = string_view_from_cstr(patterns[i]);
+    string_matcher* matcher = string_matcher_new_views(views, count);
+    free(views);
+    return matcher;
+}
+
+string_matcher* string_matcher_new_views(const string_view* patterns, size_t count) {
+    if (!patterns || !count) {
+        errno = EINVAL;
+        return NULL;
+    }
+    
+    // Every pattern byte can add at most one trie state
+    size_t max_states = 1;
+    for (size_t i = 0; i < count; i++) {
+        if (!patterns[i].data || !patterns[i].length) {
+            errno = EINVAL;
+            return NULL;
+        }
+        if (__builtin_add_overflow(max_states, patterns[i].length, &max_states) ||
+            max_states >= MATCHER_NO_PATTERN || count >= MATCHER_NO_PATTERN) {
+            errno = EOVERFLOW;
+            return NULL;
+        }
+    }
+    
+    string_matcher* matcher = calloc(1, sizeof(string_matcher));
+    if (!matcher) return NULL;
+    
+    matcher->classes = 1;
+    for (size_t i = 0; i < count; i++) {
+        for (size_t j = 0; j < patterns[i].length; j++) {
+            unsigned char c = (unsigned char)patterns[i].data[j];
+            if (!matcher->class_of[c]) matcher->class_of[c] = (uint16_t)matcher->classes++;
+        }
+    }
+    
+    // Row offsets must fit the 32-bit transitions
+    const size_t classes = matcher->classes;
+    const size_t stride = classes + 2;
+    size_t table_size;
+    if (__builtin_mul_overflow(max_states, stride, &table_size) || table_size > UINT32_MAX) {
+        free(matcher);
+        errno = EOVERFLOW;
+        return NULL;
+    }
+    
+    matcher->count = count;
+    matcher->table = calloc(table_size, sizeof(uint32_t));
+    matcher->lengths = malloc(count * sizeof(size_t));
+    uint32_t* fail = malloc(max_states * sizeof(uint32_t));
+    uint32_t* queue = malloc(max_states * sizeof(uint32_t));
+    if (!matcher->table || !matcher->lengths || !fail || !queue) {
+        free(fail);
+        free(queue);
+        string_matcher_free(matcher);
+        return NULL;
+    }
+    
+    // Trie of all patterns, addressed by state number while building;
+    // duplicates report the first index
+    uint32_t* const table = matcher->table;
+    size_t states = 1;
+    size_t first_byte_count = 0;
+    table[MATCHER_OUTPUT(classes)] = MATCHER_NO_PATTERN;
+    
+    for (size_t i = 0; i < count; i++) {
+        uint32_t state = 0;
+        for (size_t j = 0; j < patterns[i].length; j++) {
+            uint32_t* edge = &table[state * stride + matcher->class_of[(unsigned char)patterns[i].data[j]]];
+            if (!*edge) {
+                *edge = (uint32_t)states;
+                table[states * stride + MATCHER_OUTPUT(classes)] = MATCHER_NO_PATTERN;
+                table[states * stride + MATCHER_DEPTH(classes)] = table[state * stride + MATCHER_DEPTH(classes)] + 1;
+                states++;
+            }
+            state = *edge;
+        }
+        uint32_t* output = &table[state * stride + MATCHER_OUTPUT(classes)];
+        if (*output == MATCHER_NO_PATTERN) *output = (uint32_t)i;
+        matcher->lengths[i] = patterns[i].length;
+        
+        unsigned char first = (unsigned char)patterns[i].data[0];
+        if (!byte_set_contains(&matcher->first_bytes, first)) {
+            byte_set_add(&matcher->first_bytes, first);
+            first_byte_count++;
+        }
+    }
+    matcher->prefilter = first_byte_count <= MATCHER_PREFILTER_MAX;
+    
+    // Breadth-first pass: a missing edge takes the failure state's edge, and
+    // each state inherits the output of its failure state unless it ends a
+    // pattern itself (which is then the longest suffix match)
+    size_t head = 0, tail = 0;
+    for (size_t c = 0; c < classes; c++) {
+        if (table[c]) {
+            fail[table[c]] = 0;
+            queue[tail++] = table[c];
+        }
+    }
+    while (head < tail) {
+        uint32_t* row = &table[queue[head] * stride];
+        const uint32_t* fail_row = &table[fail[queue[head]] * stride];
+        head++;
+        if (row[MATCHER_OUTPUT(classes)] == MATCHER_NO_PATTERN) {
+            row[MATCHER_OUTPUT(classes)] = fail_row[MATCHER_OUTPUT(classes)];
+        }
+        
+        for (size_t c = 0; c < classes; c++) {
+            if (row[c]) {
+                fail[row[c]] = fail_row[c];
+                queue[tail++] = row[c];
+            } else {
+                row[c] = fail_row[c];
+            }
+        }
+    }
+    free(fail);
+    free(queue);
+    
+    // Switch from state numbers to row offsets
+    for (size_t state = 0; state < states; state++) {
+        for (size_t c = 0; c < classes; c++) table[state * stride + c] *= (uint32_t)stride;
+    }
+    
+    // Give back the slack reserved for prefixes shared between patterns
+    uint32_t* trimmed = realloc(matcher->table, states * stride * sizeof(uint32_t));
+    if (trimmed) matcher->table = trimmed;
+    return matcher;
+}
+
+void string_matcher_free(string_matcher* matcher) {
+    if (!matcher) return;
+    free(matcher->table);
+    free(matcher->lengths);
+    free(matcher);
+}
+
+size_t string_matcher_count(const string_matcher* matcher) {
+    return matcher ? matcher->count : 0;
+}
+
+// Leftmost-longest match starting at or after from. The automaton reports
+// matches by their end, so the best candidate is held until the current
+// state's prefix starts past it; no later match can then start earlier or
+// at the same position.
+static bool matcher_next(const string_matcher* matcher, const char* data, size_t len,
+                         size_t from, string_match* match) {
+    const string_kernels* kernels = active_kernels();
+    const uint32_t* const table = matcher->table;
+    const size_t classes = matcher->classes;
+    uint32_t state = 0;
+    bool found = false;
+    
+    for (size_t i = from; i < len; ) {
+        if (!state && !found && matcher->prefilter) {
+            stat_kernel_call(kernels, len - i);
+            const char* hit = kernels->find_any(data + i, len - i, &matcher->first_bytes);
+            if (!hit) break;
+            i = (size_t)(hit - data);
+        }
+        
+        state = table[state + matcher->class_of[(unsigned char)data[i]]];
+        const uint32_t* row = &table[state];
+        i++;
+        
+        uint32_t pattern = row[MATCHER_OUTPUT(classes)];
+        if (pattern != MATCHER_NO_PATTERN) {
+            size_t length = matcher->lengths[pattern];
+            size_t start = i - length;
+            if (!found || start < match->offset ||
+                (start == match->offset && length > match->length)) {
+                *match = (string_match){ start, length, pattern };
+                found = true;
+            }
+        }
+        
+        if (found && i - row[MATCHER_DEPTH(classes)] > match->offset) break;
+    }
+    
+    return found;
+}
+
+bool string_matcher_find(const string_matcher* matcher, string_view haystack, string_match* match) {
+    if (!matcher || !match || !haystack.data) return false;
+    return matcher_next(matcher, haystack.data, haystack.length, 0, match);
+}
+
+size_t string_matcher_find_all(const string_matcher* matcher, string_view haystack,
+                               string_match* matches, size_t max_matches) {
+    if (!matcher || !haystack.data) return 0;
+    
+    size_t found = 0;
+    string_match match;
+    for (size_t pos = 0; matcher_next(matcher, haystack.data, haystack.length, pos, &match); ) {
+        if (matches && found < max_matches) matches[found] = match;
+        found++;
+        pos = match.offset + match.length;
+    }
+    
+    return found;
+}
+
+bool string_replace_many(string* str, const string_matcher* matcher, const char* const* replacements) {
+    if (!str || !matcher || !replacements) return false;
+    
+    const char* data = STRING_DATA(str);
+    size_t length = STRING_LENGTH(str);
+    string_match match;
+    
+    // Nothing to rewrite: leave the buffer untouched
+    if (!matcher_next(matcher, data, length, 0, &match)) return true;
+    
+    size_t* replacement_lengths = malloc(matcher->count * sizeof(size_t));
+    if (!replacement_lengths) return false;
+    for (size_t i = 0; i < matcher->count; i++) {
+        replacement_lengths[i] = replacements[i] ? strlen(replacements[i]) : 0;
+    }
+    
+    // One output pass into a fresh buffer, so replacements may alias str
+    string out;
+    bool ok = string_init_with_capacity(&out, length + 1);
+    size_t pos = 0;
+    do {
+        ok = ok && append_bytes(&out, data + pos, match.offset - pos) &&
+             append_bytes(&out, replacements[match.pattern], replacement_lengths[match.pattern]);
+        pos = match.offset + match.length;
+    } while (ok && matcher_next(matcher, data, length, pos, &match));
+    ok = ok && append_bytes(&out, data + pos, length - pos);
+    free(replacement_lengths);
+    
+    if (!ok) {
+        string_destroy(&out);
+        return false;
+    }
+    
+    // Arena strings must keep their arena buffer; others take over the new one
+    if (STRING_IN_ARENA(str)) {
+        ok = set_bytes(str, STRING_DATA(&out), STRING_LENGTH(&out));
+        string_destroy(&out);
+        return ok;
+    }
+    string_destroy(str);
+    *str = out;
+    try_shrink_to_small(str);
+    return true;
+}
+
+string_byte_set string_byte_set_from(string_view chars) {
+    string_byte_set set = {0};
+    for (size_t i = 0; chars.data && i < chars.length; i++) {
+        byte_set_add(&set, (unsigned char)chars.data[i]);
+    }
+    return set;
+}
+
+bool string_byte_set_contains(const string_byte_set* set, char c) {
+    return set && byte_set_contains(set, (unsigned char)c);
+}
+
+ptrdiff_t string_view_find_any(string_view sv, const string_byte_set* set) {
+    if (!set || !sv.data || !sv.length) return -1;
+    
+    const char* hit = kernels_for(sv.length)->find_any(sv.data, sv.length, set);
+    return hit ? (hit - sv.data) : -1;
+}
+
+// Shared by the init functions; a NULL view is treated as empty
+static void tokenizer_reset(string_tokenizer* tok, string_view input) {
+    *tok = (string_tokenizer){0};
+    tok->input = input.data ? input : (string_view){ "", 0 };
+}
+
+void string_tokenizer_init(string_tokenizer* tok, string_view input, string_view delim) {
+    if (!tok) return;
+    tokenizer_reset(tok, input);
+    if (delim.data) tok->delim = delim;
+}
+
+void string_tokenizer_init_with(string_tokenizer* tok, string_view input, const string_searcher* delim) {
+    if (!tok) return;
+    tokenizer_reset(tok, input);
+    if (delim && delim->pattern.length) tok->searcher = delim;
+}
+
+void string_tokenizer_init_any(string_tokenizer* tok, string_view input, string_view chars) {
+    if (!tok) return;
+    tokenizer_reset(tok, input);
+    tok->set = string_byte_set_from(chars);
+    tok->any = chars.data && chars.length;
+}
+
+bool string_tokenizer_next(string_tokenizer* tok, string_view* token) {
+    if (!tok || tok->finished) return false;
+    
+    const char* start = tok->input.data + tok->position;
+    size_t remaining = tok->input.length - tok->position;
+    ptrdiff_t found = -1;
+    size_t delim_len = 0;
+    
+    if (tok->any) {
+        const char* hit = remaining ? kernels_for(remaining)->find_any(start, remaining, &tok->set) : NULL;
+        found = hit ? (hit - start) : -1;
+        delim_len = 1;
+    } else if (tok->searcher) {
+        found = find_pattern(start, remaining, &tok->searcher->pattern);
+        delim_len = tok->searcher->pattern.length;
+    } else if (tok->delim.length) {
+        const search_needle pattern = { tok->delim.data, tok->delim.length, NULL };
+        found = find_pattern(start, remaining, &pattern);
+        delim_len = tok->delim.length;
+    }
+    
+    if (found < 0) {
+        if (token) *token = (string_view){ start, remaining };
+        tok->finished = true;
+    } else {
+        if (token) *token = (string_view){ start, (size_t)found };
+        tok->position += (size_t)found + delim_len;
+    }
+    return true;
+}
+
+// Interning pool. The hash picks a shard from its top bits and a slot from
+// its low bits. Each shard is an open-addressed table of (hash, string)
+// slots that only ever gains entries, so readers probe it without a lock:
+// a slot's string pointer is published with release order after its hash.
+// Inserts take the shard's mutex and allocate from the shard's own arena.
+// Growing publishes a new table and keeps the old one alive until the pool
+// is freed, because readers may still be probing it; a reader that misses
+// an entry inserted meanwhile retries under the lock.
+
+#define POOL_SHARD_BITS 6
+#define POOL_SHARDS (1u << POOL_SHARD_BITS)
+#define POOL_INITIAL_SLOTS 64
+#define POOL_ARENA_BLOCK_SIZE (16 * 1024)
+
+typedef struct {
+    _Atomic uint64_t hash;
+    _Atomic(const string*) str;
+} pool_slot;
+
+typedef struct pool_table {
+    struct pool_table* retired;     // Smaller table this one replaced
+    size_t mask;                    // Slot count - 1
+    pool_slot slots[];
+} pool_table;
+
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) _Atomic(pool_table*) table;
+    pthread_mutex_t lock;           // Held by inserts into this shard
+    _Atomic size_t count;           // Strings in this shard
+    string_arena* arena;            // Interned headers and bytes
+} pool_shard;
+
+struct string_pool {
+    pool_shard shards[POOL_SHARDS];
+};
+
+static pool_table* pool_table_new(size_t slots) {
+    pool_table* table = calloc(1, sizeof(pool_table) + slots * sizeof(pool_slot));
+    if (!table) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    table->mask = slots - 1;
+    return table;
+}
+
+static const string* pool_probe(const pool_table* table, const char* data, size_t len, uint64_t hash) {
+    for (size_t i = (size_t)hash & table->mask;; i = (i + 1) & table->mask) {
+        const string* str = atomic_load_explicit(&table->slots[i].str, memory_order_acquire);
+        if (!str) return NULL;
+        if (atomic_load_explicit(&table->slots[i].hash, memory_order_relaxed) == hash &&
+            str->heap.length == len && memcmp(str->heap.data, data, len) == 0) {
+            return str;
+        }
+    }
+}
+
+static void pool_place(pool_table* table, const string* str, uint64_t hash) {
+    size_t i = (size_t)hash & table->mask;
+    while (atomic_load_explicit(&table->slots[i].str, memory_order_relaxed)) i = (i + 1) & table->mask;
+    atomic_store_explicit(&table->slots[i].hash, hash, memory_order_relaxed);
+    atomic_store_explicit(&table->slots[i].str, str, memory_order_release);
+}
+
+// Copy a value into the shard's arena as an immutable heap string with its
+// hash already cached
+static const string* pool_string_new(const string_pool* pool, pool_shard* shard,
+                                     const char* data, size_t len, uint64_t hash) {
+    pooled_string* pooled = arena_alloc(shard->arena, sizeof(pooled_string), _Alignof(pooled_string));
+    if (!pooled) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    pooled->pool = pool;
+    pooled->owned.arena = shard->arena;
+    string* str = &pooled->owned.str;
+    
+    size_t needed;
+    if (__builtin_add_overflow(len, 1 + sizeof(uint64_t), &needed)) {
+        errno = EOVERFLOW;
+        return NULL;
+    }
+    set_heap(str, NULL, 0, 0, STRING_TAG_ARENA | STRING_TAG_INTERNED, 0);
+    size_t capacity = round_capacity(str, needed);
+    if (capacity > CAPACITY_MAX || capacity < needed) {
+        errno = EOVERFLOW;
+        return NULL;
+    }
+    
+    unsigned char allocator;
+    char* bytes = buffer_alloc(str, capacity, &allocator);
+    if (!bytes) return NULL;
+    memcpy(bytes, data, len);
+    bytes[len] = '\0';
+    str->heap.data = bytes;
+    str->heap.length = len;
+    set_heap_capacity(str, capacity);
+    
+    memcpy(bytes + capacity - sizeof(uint64_t), &hash, sizeof(uint64_t));
+    set_tag(str, STRING_TAG(str) | STRING_TAG_HASHED);
+    return str;
+}
+
+// Insert a value known to be missing; the caller holds the shard lock
+static const string* pool_insert(const string_pool* pool, pool_shard* shard,
+                                 const char* data, size_t len, uint64_t hash) {
+    pool_table* table = atomic_load_explicit(&shard->table, memory_order_relaxed);
+    size_t count = atomic_load_explicit(&shard->count, memory_order_relaxed);
+    
+    // Keep the load at or below one half so probes stay short
+    if (2 * (count + 1) > table->mask + 1) {
+        pool_table* grown = pool_table_new(2 * (table->mask + 1));
+        if (!grown) return NULL;
+        for (size_t i = 0; i <= table->mask; i++) {
+            const string* str = atomic_load_explicit(&table->slots[i].str, memory_order_relaxed);
+            if (str) pool_place(grown, str, atomic_load_explicit(&table->slots[i].hash, memory_order_relaxed));
+        }
+        grown->retired = table;
+        atomic_store_explicit(&shard->table, grown, memory_order_release);
+        table = grown;
+    }
+    
+    const string* str = pool_string_new(pool, shard, data, len, hash);
+    if (!str) return NULL;
+    pool_place(table, str, hash);
+    atomic_store_explicit(&shard->count, count + 1, memory_order_relaxed);
+    return str;
+}
+
+static inline const pool_shard* pool_shard_of(const string_pool* pool, uint64_t hash) {
+    return &pool->shards[hash >> (64 - POOL_SHARD_BITS)];
+}
+
+string_pool* string_pool_new(void) {
+    string_pool* pool = aligned_alloc(CACHE_LINE_SIZE, round_to_cache_line(sizeof(string_pool)));
+    if (!pool) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    
+    for (size_t i = 0; i < POOL_SHARDS; i++) {
+        pool_shard* shard = &pool->shards[i];
+        pool_table* table = pool_table_new(POOL_INITIAL_SLOTS);
+        string_arena* arena = table ? string_arena_new(POOL_ARENA_BLOCK_SIZE) : NULL;
+        if (!arena || pthread_mutex_init(&shard->lock, NULL) != 0) {
+            free(table);
+            string_arena_free(arena);
+            while (i-- > 0) {
+                pthread_mutex_destroy(&pool->shards[i].lock);
+                free(atomic_load(&pool->shards[i].table));
+                string_arena_free(pool->shards[i].arena);
+            }
+            free(pool);
+            errno = ENOMEM;
+            return NULL;
+        }
+        atomic_init(&shard->table, table);
+        atomic_init(&shard->count, 0);
+        shard->arena = arena;
+    }
+    return pool;
+}
+
+void string_pool_free(string_pool* pool) {
+    if (!pool) return;
+    
+    for (size_t i = 0; i < POOL_SHARDS; i++) {
+        pool_shard* shard = &pool->shards[i];
+        pool_table* table = atomic_load(&shard->table);
+        while (table) {
+            pool_table* retired = table->retired;
+            free(table);
+            table = retired;
+        }
+        pthread_mutex_destroy(&shard->lock);
+        string_arena_free(shard->arena);
+    }
+    free(pool);
+}
+
+const string* string_pool_find(const string_pool* pool, string_view sv) {
+    if (!pool) return NULL;
+    const char* data = sv.data ? sv.data : "";
+    size_t len = sv.data ? sv.length : 0;
+    
+    uint64_t hash = hash_bytes(data, len);
+    const pool_shard* shard = pool_shard_of(pool, hash);
+    return pool_probe(atomic_load_explicit(&shard->table, memory_order_acquire), data, len, hash);
+}
+
+const string* string_pool_intern_view(string_pool* pool, string_view sv) {
+    if (!pool) return NULL;
+    const char* data = sv.data ? sv.data : "";
+    size_t len = sv.data ? sv.length : 0;
+    
+    uint64_t hash = hash_bytes(data, len);
+    pool_shard* shard = (pool_shard*)pool_shard_of(pool, hash);
+    const string* str = pool_probe(atomic_load_explicit(&shard->table, memory_order_acquire), data, len, hash);
+    if (str) return str;
+    
+    // Another thread may have inserted the value since the lock-free probe
+    pthread_mutex_lock(&shard->lock);
+    str = pool_probe(atomic_load_explicit(&shard->table, memory_order_relaxed), data, len, hash);
+    if (!str) str = pool_insert(pool, shard, data, len, hash);
+    pthread_mutex_unlock(&shard->lock);
+    return str;
+}
+
+const string* string_pool_intern(string_pool* pool, const char* cstr) {
+    if (!cstr) return NULL;
+    return string_pool_intern_view(pool, string_view_from_cstr(cstr));
+}
+
+size_t string_pool_count(const string_pool* pool) {
+    if (!pool) return 0;
+    
+    size_t count = 0;
+    for (size_t i = 0; i < POOL_SHARDS; i++) {
+        count += atomic_load_explicit(&pool->shards[i].count, memory_order_relaxed);
+    }
+    return count;
+}
+
+// Ropes. A rope is a height-balanced (AVL) binary tree whose leaves hold the
+// bytes, either in a string of their own or as a slice of another leaf's
+// string. Nodes are reference counted and never change once shared, so
+// substrings and both halves of a split reuse whole subtrees and an edit
+// only builds the O(log n) nodes on its path. The one exception is appending
+// to a rope that owns its whole right spine, which grows the last leaf in
+// place.
+
+#define ROPE_LEAF_MAX 4096      // Small appends and joins merge leaves up to this size
+
+typedef struct rope_node rope_node;
+struct rope_node {
+    _Atomic size_t refs;
+    size_t length;              // Bytes in this subtree
+    unsigned height;            // 1 for leaves
+    union {
+        struct {
+            rope_node* left;
+            rope_node* right;
+        } branch;
+        struct {
+            rope_node* base;    // Leaf whose text this slice shares, or NULL
+            size_t offset;      // Start of the slice in base's text
+            string text;        // Own bytes when base is NULL
+        } leaf;
+    };
+};
+
+struct string_rope {
+    rope_node* root;            // NULL for an empty rope
+};
+
+static inline unsigned rope_height(const rope_node* node) {
+    return node ? node->height : 0;
+}
+
+static inline const char* rope_leaf_data(const rope_node* leaf) {
+    return leaf->leaf.base ? STRING_DATA(&leaf->leaf.base->leaf.text) + leaf->leaf.offset
+                           : STRING_DATA(&leaf->leaf.text);
+}
+
+static inline rope_node* rope_retain(rope_node* node) {
+    if (node) atomic_fetch_add_explicit(&node->refs, 1, memory_order_relaxed);
+    return node;
+}
+
+static void rope_release(rope_node* node) {
+    while (node && atomic_fetch_sub_explicit(&node->refs, 1, memory_order_acq_rel) == 1) {
+        rope_node* next;
+        if (node->height == 1) {
+            next = node->leaf.base;
+            if (!next) string_destroy(&node->leaf.text);
+        } else {
+            rope_release(node->branch.left);
+            next = node->branch.right;
+        }
+        free(node);
+        node = next;
+    }
+}
+
+static rope_node* rope_node_alloc(size_t length, unsigned height) {
+    rope_node* node = malloc(sizeof(rope_node));
+    if (!node) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    atomic_init(&node->refs, 1);
+    node->length = length;
+    node->height = height;
+    return node;
+}
+
+static rope_node* rope_leaf_new(const char* data, size_t len) {
+    rope_node* leaf = rope_node_alloc(len, 1);
+    if (!leaf) return NULL;
+    
+    leaf->leaf.base = NULL;
+    leaf->leaf.offset = 0;
+    init_small(&leaf->leaf.text);
+    if (!append_bytes(&leaf->leaf.text, data, len)) {
+        free(leaf);
+        return NULL;
+    }
+    return leaf;
+}
+
+// Leaf for part of another leaf; short pieces are copied rather than pinning
+// a large buffer
+static rope_node* rope_slice(rope_node* leaf, size_t offset, size_t len) {
+    if (len <= SSO_SIZE) return rope_leaf_new(rope_leaf_data(leaf) + offset, len);
+    
+    rope_node* slice = rope_node_alloc(len, 1);
+    if (!slice) return NULL;
+    
+    slice->leaf.base = rope_retain(leaf->leaf.base ? leaf->leaf.base : leaf);
+    slice->leaf.offset = (leaf->leaf.base ? leaf->leaf.offset : 0) + offset;
+    init_small(&slice->leaf.text);
+    return slice;
+}
+
+// The builders below borrow their arguments and return a new reference, or
+// NULL with the inputs untouched when an allocation fails
+static rope_node* rope_branch(rope_node* left, rope_node* right) {
+    unsigned height = rope_height(left) > rope_height(right) ? rope_height(left) : rope_height(right);
+    rope_node* node = rope_node_alloc(left->length + right->length, height + 1);
+    if (!node) return NULL;
+    
+    node->branch.left = rope_retain(left);
+    node->branch.right = rope_retain(right);
+    return node;
+}
+
+static rope_node* rope_branch4(rope_node* a, rope_node* b, rope_node* c, rope_node* d) {
+    rope_node* left = rope_branch(a, b);
+    rope_node* right = left ? rope_branch(c, d) : NULL;
+    rope_node* node = right ? rope_branch(left, right) : NULL;
+    rope_release(left);
+    rope_release(right);
+    return node;
+}
+
+static rope_node* rope_branch3(rope_node* a, rope_node* b, rope_node* c, bool nest_left) {
+    rope_node* inner = nest_left ? rope_branch(a, b) : rope_branch(b, c);
+    rope_node* node = inner ? (nest_left ? rope_branch(inner, c) : rope_branch(a, inner)) : NULL;
+    rope_release(inner);
+    return node;
+}
+
+// Branch over two subtrees whose heights differ by at most two, rotating
+// once or twice to restore the AVL invariant
+static rope_node* rope_balance(rope_node* left, rope_node* right) {
+    if (rope_height(left) > rope_height(right) + 1) {
+        rope_node* outer = left->branch.left;
+        rope_node* inner = left->branch.right;
+        if (rope_height(outer) >= rope_height(inner)) return rope_branch3(outer, inner, right, false);
+        return rope_branch4(outer, inner->branch.left, inner->branch.right, right);
+    }
+    if (rope_height(right) > rope_height(left) + 1) {
+        rope_node* inner = right->branch.left;
+        rope_node* outer = right->branch.right;
+        if (rope_height(outer) >= rope_height(inner)) return rope_branch3(left, inner, outer, true);
+        return rope_branch4(left, inner->branch.left, inner->branch.right, outer);
+    }
+    return rope_branch(left, right);
+}
+
+// Concatenate two trees in O(|height difference|) by descending the taller
+// one's inner spine
+static rope_node* rope_join(rope_node* left, rope_node* right) {
+    if (!left) return rope_retain(right);
+    if (!right) return rope_retain(left);
+    
+    if (left->height == 1 && right->height == 1 && left->length + right->length <= ROPE_LEAF_MAX) {
+        rope_node* leaf = rope_leaf_new(rope_leaf_data(left), left->length);
+        if (!leaf) return NULL;
+        if (!append_bytes(&leaf->leaf.text, rope_leaf_data(right), right->length)) {
+            rope_release(leaf);
+            return NULL;
+        }
+        leaf->length += right->length;
+        return leaf;
+    }
+    
+    if (left->height > right->height + 1) {
+        rope_node* joined = rope_join(left->branch.right, right);
+        if (!joined) return NULL;
+        rope_node* node = rope_balance(left->branch.left, joined);
+        rope_release(joined);
+        return node;
+    }
+    if (right->height > left->height + 1) {
+        rope_node* joined = rope_join(left, right->branch.left);
+        if (!joined) return NULL;
+        rope_node* node = rope_balance(joined, right->branch.right);
+        rope_release(joined);
+        return node;
+    }
+    return rope_branch(left, right);
+}
+
+// Split a tree into the first pos bytes and the rest
+static bool rope_split(rope_node* node, size_t pos, rope_node** left, rope_node** right) {
+    *left = *right = NULL;
+    if (!node) return true;
+    if (pos == 0) {
+        *right = rope_retain(node);
+        return true;
+    }
+    if (pos >= node->length) {
+        *left = rope_retain(node);
+        return true;
+    }
+    
+    if (node->height == 1) {
+        *left = rope_slice(node, 0, pos);
+        *right = *left ? rope_slice(node, pos, node->length - pos) : NULL;
+        if (!*right) {
+            rope_release(*left);
+            *left = NULL;
+            return false;
+        }
+        return true;
+    }
+    
+    rope_node* first;
+    rope_node* second;
+    size_t left_len = node->branch.left->length;
+    if (pos < left_len) {
+        if (!rope_split(node->branch.left, pos, &first, &second)) return false;
+        *right = rope_join(second, node->branch.right);
+        rope_release(second);
+        if (!*right) {
+            rope_release(first);
+            return false;
+        }
+        *left = first;
+    } else {
+        if (!rope_split(node->branch.right, pos - left_len, &first, &second)) return false;
+        *left = rope_join(node->branch.left, first);
+        rope_release(first);
+        if (!*left) {
+            rope_release(second);
+            return false;
+        }
+        *right = second;
+    }
+    return true;
+}
+
+// Grow the last leaf in place when the rope owns every node on the way to it
+static bool rope_append_in_place(rope_node* root, string_view sv) {
+    rope_node* node = root;
+    while (node->height > 1 && atomic_load_explicit(&node->refs, memory_order_acquire) == 1) {
+        node = node->branch.right;
+    }
+    if (node->height > 1 || atomic_load_explicit(&node->refs, memory_order_acquire) != 1 ||
+        node->leaf.base || node->length + sv.length > ROPE_LEAF_MAX) {
+        return false;
+    }
+    if (!append_bytes(&node->leaf.text, sv.data, sv.length)) return false;
+    
+    for (node = root; node->height > 1; node = node->branch.right) node->length += sv.length;
+    node->length += sv.length;
+    return true;
+}
+
+// Install a freshly built root, or report the failure that produced none
+static bool rope_set_root(string_rope* rope, rope_node* root) {
+    if (!root) return false;
+    rope_release(rope->root);
+    rope->root = root;
+    return true;
+}
+
+static void rope_copy(const rope_node* node, char* dest) {
+    while (node->height > 1) {
+        rope_copy(node->branch.left, dest);
+        dest += node->branch.left->length;
+        node = node->branch.right;
+    }
+    memcpy(dest, rope_leaf_data(node), node->length);
+}
+
+string_rope* string_rope_new(void) {
+    string_rope* rope = malloc(sizeof(string_rope));
+    if (!rope) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    rope->root = NULL;
+    return rope;
+}
+
+void string_rope_free(string_rope* rope) {
+    if (!rope) return;
+    rope_release(rope->root);
+    free(rope);
+}
+
+size_t string_rope_length(const string_rope* rope) {
+    return rope && rope->root ? rope->root->length : 0;
+}
+
+bool string_rope_append(string_rope* rope, string_view sv) {
+    if (!rope || (!sv.data && sv.length)) return false;
+    if (!sv.length) return true;
+    if (rope->root && rope_append_in_place(rope->root, sv)) return true;
+    
+    rope_node* leaf = rope_leaf_new(sv.data, sv.length);
+    if (!leaf) return false;
+    
+    // A rope that is being appended to will likely fill this leaf next, so
+    // size it for that up front instead of doubling through every size
+    if (rope->root && sv.length < ROPE_LEAF_MAX / 2 &&
+        !ensure_capacity(&leaf->leaf.text, ROPE_LEAF_MAX + 1)) {
+        rope_release(leaf);
+        return false;
+    }
+    
+    rope_node* root = rope_join(rope->root, leaf);
+    rope_release(leaf);
+    return rope_set_root(rope, root);
+}
+
+bool string_rope_append_string(string_rope* rope, string* str) {
+    if (!rope || !str) return false;
+    
+    // Short strings merge into the last leaf and arena buffers cannot
+    // outlive their arena, so both are copied
+    size_t length = STRING_LENGTH(str);
+    if (length <= ROPE_LEAF_MAX || STRING_IN_ARENA(str)) {
+        if (!string_rope_append(rope, string_as_view(str))) return false;
+        string_clear(str);
+        return true;
+    }
+    
+    rope_node* leaf = rope_node_alloc(length, 1);
+    if (!leaf) return false;
+    leaf->leaf.base = NULL;
+    leaf->leaf.offset = 0;
+    leaf->leaf.text = *str;
+    
+    rope_node* root = rope_join(rope->root, leaf);
+    if (!root) {
+        free(leaf);
+        return false;
+    }
+    init_small(str);
+    rope_release(leaf);
+    return rope_set_root(rope, root);
+}
+
+bool string_rope_insert(string_rope* rope, size_t pos, string_view sv) {
+    if (!rope || (!sv.data && sv.length)) return false;
+    if (pos > string_rope_length(rope)) {
+        errno = EINVAL;
+        return false;
+    }
+    if (!sv.length) return true;
+    if (pos == string_rope_length(rope)) return string_rope_append(rope, sv);
+    
+    rope_node* leaf = rope_leaf_new(sv.data, sv.length);
+    if (!leaf) return false;
+    
+    rope_node* before;
+    rope_node* after;
+    rope_node* root = NULL;
+    if (rope_split(rope->root, pos, &before, &after)) {
+        rope_node* head = rope_join(before, leaf);
+        root = head ? rope_join(head, after) : NULL;
+        rope_release(head);
+        rope_release(before);
+        rope_release(after);
+    }
+    rope_release(leaf);
+    return rope_set_root(rope, root);
+}
+
+bool string_rope_erase(string_rope* rope, size_t pos, size_t length) {
+    if (!rope) return false;
+    size_t total = string_rope_length(rope);
+    if (pos > total) {
+        errno = EINVAL;
+        return false;
+    }
+    length = (length > total - pos) ? (total - pos) : length;
+    if (!length) return true;
+    if (length == total) {
+        rope_release(rope->root);
+        rope->root = NULL;
+        return true;
+    }
+    
+    rope_node* before;
+    rope_node* rest;
+    if (!rope_split(rope->root, pos, &before, &rest)) return false;
+    
+    rope_node* removed;
+    rope_node* after;
+    rope_node* root = NULL;
+    if (rope_split(rest, length, &removed, &after)) {
+        root = rope_join(before, after);
+        rope_release(removed);
+        rope_release(after);
+    }
+    rope_release(rest);
+    rope_release(before);
+    return rope_set_root(rope, root);
+}
+
+string_rope* string_rope_substr(const string_rope* rope, size_t start, size_t length) {
+    if (!rope) return NULL;
+    string_rope* result = string_rope_new();
+    if (!result) return NULL;
+    
+    size_t total = string_rope_length(rope);
+    if (start >= total) return result;
+    length = (length > total - start) ? (total - start) : length;
+    
+    rope_node* before;
+    rope_node* rest;
+    if (!rope_split(rope->root, start, &before, &rest)) {
+        string_rope_free(result);
+        return NULL;
+    }
+    rope_node* after;
+    bool ok = rope_split(rest, length, &result->root, &after);
+    rope_release(before);
+    rope_release(rest);
+    rope_release(after);
+    if (!ok) {
+        string_rope_free(result);
+        return NULL;
+    }
+    return result;
+}
+
+char string_rope_char_at(const string_rope* rope, size_t index) {
+    if (!rope || index >= string_rope_length(rope)) return '\0';
+    
+    const rope_node* node = rope->root;
+    while (node->height > 1) {
+        if (index < node->branch.left->length) {
+            node = node->branch.left;
+        } else {
+            index -= node->branch.left->length;
+            node = node->branch.right;
+        }
+    }
+    return rope_leaf_data(node)[index];
+}
+
+const string* string_rope_flatten(string_rope* rope) {
+    if (!rope) return NULL;
+    
+    rope_node* root = rope->root;
+    if (root && root->height == 1 && !root->leaf.base) return &root->leaf.text;
+    
+    size_t length = string_rope_length(rope);
+    rope_node* flat = rope_node_alloc(length, 1);
+    if (!flat) return NULL;
+    flat->leaf.base = NULL;
+    flat->leaf.offset = 0;
+    init_small(&flat->leaf.text);
+    if (length == SIZE_MAX || !ensure_capacity(&flat->leaf.text, length + 1)) {
+        if (length == SIZE_MAX) errno = EOVERFLOW;
+        free(flat);
+        return NULL;
+    }
+    
+    if (root) rope_copy(root, STRING_DATA(&flat->leaf.text));
+    set_length(&flat->leaf.text, length);
+    rope_set_root(rope, flat);
+    return &flat->leaf.text;
+}
+
+void string_rope_iter_init(string_rope_iter* iter, const string_rope* rope) {
+    if (!iter) return;
+    iter->rope = rope;
+    iter->offset = 0;
+}
+
+bool string_rope_iter_next(string_rope_iter* iter, string_view* chunk) {
+    if (!iter || iter->offset >= string_rope_length(iter->rope)) return false;
+    
+    // Descend to the leaf holding the next byte
+    const rope_node* node = iter->rope->root;
+    size_t pos = iter->offset;
+    while (node->height > 1) {
+        if (pos < node->branch.left->length) {
+            node = node->branch.left;
+        } else {
+            pos -= node->branch.left->length;
+            node = node->branch.right;
+        }
+    }
+    
+    string_view piece = { rope_leaf_data(node) + pos, node->length - pos };
+    iter->offset += piece.length;
+    if (chunk) *chunk = piece;
+    return true;
+}
+
+// File loading. The copying mode reads straight into the string's buffer,
+// so the bytes are copied once; the mapping mode copies nothing up front.
+
+#ifndef O_CLOEXEC
+#define O_CLOEXEC 0
+#endif
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+// Read block for files whose size is not known in advance
+#define FILE_READ_CHUNK (64 * 1024)
+
+static string* read_file(int fd, size_t size_hint) {
+    string* str = string_with_capacity(size_hint + 1);
+    if (!str) return NULL;
+    
+#if defined(POSIX_FADV_SEQUENTIAL) && !defined(_WIN32)
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    size_t length = 0;
+    for (;;) {
+        // Keep room for at least one more byte so EOF at the hinted size
+        // is seen without growing the buffer
+        size_t room = STRING_CAPACITY(str) - length - 1;
+        if (room == 0) {
+            if (!ensure_capacity(str, STRING_CAPACITY(str) + FILE_READ_CHUNK)) break;
+            room = STRING_CAPACITY(str) - length - 1;
+        }
+        
+        ssize_t got = read(fd, STRING_DATA(str) + length, room);
+        if (got < 0 && errno == EINTR) continue;
+        if (got < 0) break;
+        if (got == 0) {
+            set_length(str, length);
+            return str;
+        }
+        length += (size_t)got;
+    }
+    
+    int saved = errno;
+    string_free(str);
+    errno = saved;
+    return NULL;
+}
+
+#ifdef STRING_HAVE_MMAP
+static string* map_file(int fd, size_t size) {
+    long page = sysconf(_SC_PAGESIZE);
+    size_t page_size = page > 0 ? (size_t)page : 4096;
+    if (size > CAPACITY_MAX - page_size) {
+        errno = EOVERFLOW;
+        return NULL;
+    }
+    size_t capacity = (size + page_size) & ~(page_size - 1);
+    
+    string* str = header_alloc();
+    if (!str) return NULL;
+    
+    // Reserve zero pages for the whole range and map the file over the
+    // front, so a terminator follows even a file that ends on a page
+    // boundary. Private writable pages stay shared with the page cache until
+    // the string is modified.
+    char* base = mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        header_free(str);
+        return NULL;
+    }
+    if (mmap(base, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        int saved = errno;
+        munmap(base, capacity);
+        header_free(str);
+        errno = saved;
+        return NULL;
+    }
+    madvise(base, size, MADV_SEQUENTIAL);
+    
+    set_heap(str, base, size, capacity, STRING_TAG_MAPPED, 0);
+    return str;
+}
+#endif
+
+string* string_from_file(const char* path, string_file_mode mode) {
+    if (!path) {
+        errno = EINVAL;
+        return NULL;
+    }
+    
+    int fd = open(path, O_RDONLY | O_CLOEXEC | O_BINARY);
+    if (fd < 0) return NULL;
+    
+    struct stat st;
+    string* str = NULL;
+    if (fstat(fd, &st) == 0) {
+        // Pipes and pseudo-files report no useful size and cannot be mapped
+        bool sized = S_ISREG(st.st_mode) && st.st_size > 0;
+        if (sized && (uintmax_t)st.st_size >= CAPACITY_MAX) {
+            errno = EOVERFLOW;
+        } else {
+#ifdef STRING_HAVE_MMAP
+            if (mode == STRING_FILE_MAP && sized) {
+                str = map_file(fd, (size_t)st.st_size);
+            } else
+#endif
+            {
+                (void)mode;
+                str = read_file(fd, sized ? (size_t)st.st_size : 0);
+            }
+        }
+    }
+    
+    int saved = errno;
+    close(fd);
+    errno = saved;
+    return str;
+}
+
+void string_line_iter_init(string_line_iter* iter, string_view input) {
+    if (!iter) return;
+    iter->input = input.data ? input : (string_view){ "", 0 };
+    iter->position = 0;
+}
+
+bool string_line_iter_next(string_line_iter* iter, string_view* line) {
+    if (!iter || iter->position >= iter->input.length) return false;
+    
+    // memchr is the vectorized single-byte scan on every libc we target,
+    // the same one single-byte find uses
+    const char* start = iter->input.data + iter->position;
+    size_t remaining = iter->input.length - iter->position;
+    const char* newline = memchr(start, '\n', remaining);
+    size_t length = newline ? (size_t)(newline - start) : remaining;
+    iter->position += newline ? length + 1 : length;
+    
+    if (length && start[length - 1] == '\r') length--;
+    if (line) *line = (string_view){ start, length };
+    return true;
+}
+
+// UTF-8. Heap strings remember that they passed validation as pure ASCII,
+// which makes later validation free and code points equal to bytes.
+static inline bool known_ascii(const string* str) {
+    return (STRING_TAG(str) & (STRING_TAG_HEAP | STRING_TAG_ASCII)) == (STRING_TAG_HEAP | STRING_TAG_ASCII);
+}
+
+bool string_view_utf8_validate(string_view sv) {
+    if (!sv.data) return false;
+    return kernels_for(sv.length)->utf8_check(sv.data, sv.length) != UTF8_INVALID;
+}
+
+bool string_utf8_validate(const string* str) {
+    if (!str) return false;
+    if (known_ascii(str)) return true;
+    
+    size_t len = STRING_LENGTH(str);
+    int result = kernels_for(len)->utf8_check(STRING_DATA(str), len);
+    // The flag describes the contents rather than the value, so caching it
+    // through a const pointer is no more visible than the cached hash
+    if (result == UTF8_ASCII && !STRING_IS_SMALL(str)) {
+        set_tag((string*)str, STRING_TAG(str) | STRING_TAG_ASCII);
+    }
+    return result != UTF8_INVALID;
+}
+
+size_t string_view_utf8_length(string_view sv) {
+    if (!sv.data) return 0;
+    return kernels_for(sv.length)->utf8_count(sv.data, sv.length);
+}
+
+size_t string_utf8_length(const string* str) {
+    if (!str) return 0;
+    if (known_ascii(str)) return str->heap.length;
+    
+    size_t len = STRING_LENGTH(str);
+    return kernels_for(len)->utf8_count(STRING_DATA(str), len);
+}
+
+// Byte offset of the code point index code points into data, or len if
+// there are no more. Whole 64-byte blocks are skipped with the count
+// kernel, the rest is walked to the next lead byte.
+static size_t utf8_advance(const string_kernels* kernels, const char* data, size_t len, size_t index) {
+    size_t pos = 0;
+    while (len - pos >= 64) {
+        size_t count = kernels->utf8_count(data + pos, 64);
+        if (count > index) break;
+        index -= count;
+        pos += 64;
+    }
+    
+    for (; pos < len; pos++) {
+        if ((signed char)data[pos] > -65 && index-- == 0) return pos;
+    }
+    return len;
+}
+
+string* string_utf8_substr(const string* str, size_t start, size_t length) {
+    if (!str) return NULL;
+    if (known_ascii(str)) return string_substr(str, start, length);
+    
+    const char* data = STRING_DATA(str);
+    size_t len = STRING_LENGTH(str);
+    const string_kernels* kernels = kernels_for(len);
+    
+    size_t first = utf8_advance(kernels, data, len, start);
+    if (first >= len) return NULL;
+    size_t last = first + utf8_advance(kernels, data + first, len - first, length);
+    
+    return string_substr(str, first, last - first);
+}
+
+// Numeric formatting and parsing, independent of the locale. Integers are
+// written backwards two digits at a time into space reserved once. Doubles
+// are printed with Schubfach (the shortest digits that read back, the
+// closest of those on ties) and parsed with Clinger's fast path, then
+// Eisel-Lemire, then exact decimal arithmetic for the rare inputs neither
+// settles. Both algorithms use one table of powers of ten.
+
+static const char digit_pairs[201] =
+    "00010203040506070809" "10111213141516171819" "20212223242526272829" "30313233343536373839"
+    "40414243444546474849" "50515253545556575859" "60616263646566676869" "70717273747576777879"
+    "80818283848586878889" "90919293949596979899";
+
+static const uint64_t pow10_u64[20] = {
+    1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull, 100000000ull,
+    1000000000ull, 10000000000ull, 100000000000ull, 1000000000000ull, 10000000000000ull,
+    100000000000000ull, 1000000000000000ull, 10000000000000000ull, 100000000000000000ull,
+    1000000000000000000ull, 10000000000000000000ull
+};
+
+// Number of decimal digits in v, at least 1
+static inline unsigned decimal_digits(uint64_t v) {
+    unsigned bits = 64 - (unsigned)__builtin_clzll(v | 1);
+    unsigned digits = (bits * 1233) >> 12;      // floor(bits * log10(2))
+    digits += v >= pow10_u64[digits];
+    return digits ? digits : 1;
+}
+
+// Write the digits of v so that they end just before end
+static inline void write_decimal(char* end, uint64_t v) {
+    while (v >= 100) {
+        size_t pair = (size_t)(v % 100) * 2;
+        v /= 100;
+        end -= 2;
+        memcpy(end, digit_pairs + pair, 2);
+    }
+    if (v >= 10) {
+        memcpy(end - 2, digit_pairs + v * 2, 2);
+    } else {
+        end[-1] = (char)('0' + v);
+    }
+}
+
+// Grow str for count more bytes and return where they go
+static char* append_space(string* str, size_t count) {
+    size_t length = STRING_LENGTH(str);
+    size_t needed;
+    if (__builtin_add_overflow(length, count + 1, &needed)) {
+        errno = EOVERFLOW;
+        return NULL;
+    }
+    if (!ensure_capacity(str, needed)) return NULL;
+    return STRING_DATA(str) + length;
+}
+
+static bool append_decimal(string* str, uint64_t magnitude, bool negative) {
+    size_t count = decimal_digits(magnitude) + negative;
+    char* out = append_space(str, count);
+    if (!out) return false;
+    
+    out[0] = '-';
+    write_decimal(out + count, magnitude);
+    set_length(str, STRING_LENGTH(str) + count);
+    return true;
+}
+
+bool string_append_uint(string* str, uint64_t value) {
+    if (!str) return false;
+    return append_decimal(str, value, false);
+}
+
+bool string_append_int(string* str, int64_t value) {
+    if (!str) return false;
+    return append_decimal(str, value < 0 ? 0 - (uint64_t)value : (uint64_t)value, value < 0);
+}
+
+// 128-bit truncations of 10^q scaled into [2^127, 2^128), as { high, low },
+// for q from POW10_MIN to POW10_MAX
+#define POW10_MIN (-342)
+#define POW10_MAX 324
+
+static const uint64_t pow10_128[POW10_MAX - POW10_MIN + 1][2] = {
+    { 0xeef453d6923bd65aull, 0x113faa2906a13b3full }, { 0x9558b4661b6565f8ull, 0x4ac7ca59a424c507ull },
+    { 0xbaaee17fa23ebf76ull, 0x5d79bcf00d2df649ull }, { 0xe95a99df8ace6f53ull, 0xf4d82c2c107973dcull },
+    { 0x91d8a02bb6c10594ull, 0x79071b9b8a4be869ull }, { 0xb64ec836a47146f9ull, 0x9748e2826cdee284ull },
+    { 0xe3e27a444d8d98b7ull, 0xfd1b1b2308169b25ull }, { 0x8e6d8c6ab0787f72ull, 0xfe30f0f5e50e20f7ull },
+    { 0xb208ef855c969f4full, 0xbdbd2d335e51a935ull }, { 0xde8b2b66b3bc4723ull, 0xad2c788035e61382ull },
+    { 0x8b16fb203055ac76ull, 0x4c3bcb5021afcc31ull }, { 0xaddcb9e83c6b1793ull, 0xdf4abe242a1bbf3dull },
+    { 0xd953e8624b85dd78ull, 0xd71d6dad34a2af0dull }, { 0x87d4713d6f33aa6bull, 0x8672648c40e5ad68ull },
+    { 0xa9c98d8ccb009506ull, 0x680efdaf511f18c2ull }, { 0xd43bf0effdc0ba48ull, 0x0212bd1b2566def2ull },
+    { 0x84a57695fe98746dull, 0x014bb630f7604b57ull }, { 0xa5ced43b7e3e9188ull, 0x419ea3bd35385e2dull },
+    { 0xcf42894a5dce35eaull, 0x52064cac828675b9ull }, { 0x818995ce7aa0e1b2ull, 0x7343efebd1940993ull },
+    { 0xa1ebfb4219491a1full, 0x1014ebe6c5f90bf8ull }, { 0xca66fa129f9b60a6ull, 0xd41a26e077774ef6ull },
+    { 0xfd00b897478238d0ull, 0x8920b098955522b4ull }, { 0x9e20735e8cb16382ull, 0x55b46e5f5d5535b0ull },
+    { 0xc5a890362fddbc62ull, 0xeb2189f734aa831dull }, { 0xf712b443bbd52b7bull, 0xa5e9ec7501d523e4ull },
+    { 0x9a6bb0aa55653b2dull, 0x47b233c92125366eull }, { 0xc1069cd4eabe89f8ull, 0x999ec0bb696e840aull },
+    { 0xf148440a256e2c76ull, 0xc00670ea43ca250dull }, { 0x96cd2a865764dbcaull, 0x380406926a5e5728ull },
+    { 0xbc807527ed3e12bcull, 0xc605083704f5ecf2ull }, { 0xeba09271e88d976bull, 0xf7864a44c633682eull },
+    { 0x93445b8731587ea3ull, 0x7ab3ee6afbe0211dull }, { 0xb8157268fdae9e4cull, 0x5960ea05bad82964ull },
+    { 0xe61acf033d1a45dfull, 0x6fb92487298e33bdull }, { 0x8fd0c16206306babull, 0xa5d3b6d479f8e056ull },
+    { 0xb3c4f1ba87bc8696ull, 0x8f48a4899877186cull }, { 0xe0b62e2929aba83cull, 0x331acdabfe94de87ull },
+    { 0x8c71dcd9ba0b4925ull, 0x9ff0c08b7f1d0b14ull }, { 0xaf8e5410288e1b6full, 0x07ecf0ae5ee44dd9ull },
+    { 0xdb71e91432b1a24aull, 0xc9e82cd9f69d6150ull }, { 0x892731ac9faf056eull, 0xbe311c083a225cd2ull },
+    { 0xab70fe17c79ac6caull, 0x6dbd630a48aaf406ull }, { 0xd64d3d9db981787dull, 0x092cbbccdad5b108ull },
+    { 0x85f0468293f0eb4eull, 0x25bbf56008c58ea5ull }, { 0xa76c582338ed2621ull, 0xaf2af2b80af6f24eull },
+    { 0xd1476e2c07286faaull, 0x1af5af660db4aee1ull }, { 0x82cca4db847945caull, 0x50d98d9fc890ed4dull },
+    { 0xa37fce126597973cull, 0xe50ff107bab528a0ull }, { 0xcc5fc196fefd7d0cull, 0x1e53ed49a96272c8ull },
+    { 0xff77b1fcbebcdc4full, 0x25e8e89c13bb0f7aull }, { 0x9faacf3df73609b1ull, 0x77b191618c54e9acull },
+    { 0xc795830d75038c1dull, 0xd59df5b9ef6a2417ull }, { 0xf97ae3d0d2446f25ull, 0x4b0573286b44ad1dull },
+    { 0x9becce62836ac577ull, 0x4ee367f9430aec32ull }, { 0xc2e801fb244576d5ull, 0x229c41f793cda73full },
+    { 0xf3a20279ed56d48aull, 0x6b43527578c1110full }, { 0x9845418c345644d6ull, 0x830a13896b78aaa9ull },
+    { 0xbe5691ef416bd60cull, 0x23cc986bc656d553ull }, { 0xedec366b11c6cb8full, 0x2cbfbe86b7ec8aa8ull },
+    { 0x94b3a202eb1c3f39ull, 0x7bf7d71432f3d6a9ull }, { 0xb9e08a83a5e34f07ull, 0xdaf5ccd93fb0cc53ull },
+    { 0xe858ad248f5c22c9ull, 0xd1b3400f8f9cff68ull }, { 0x91376c36d99995beull, 0x23100809b9c21fa1ull },
+    { 0xb58547448ffffb2dull, 0xabd40a0c2832a78aull }, { 0xe2e69915b3fff9f9ull, 0x16c90c8f323f516cull },
+    { 0x8dd01fad907ffc3bull, 0xae3da7d97f6792e3ull }, { 0xb1442798f49ffb4aull, 0x99cd11cfdf41779cull },
+    { 0xdd95317f31c7fa1dull, 0x40405643d711d583ull }, { 0x8a7d3eef7f1cfc52ull, 0x482835ea666b2572ull },
+    { 0xad1c8eab5ee43b66ull, 0xda3243650005eecfull }, { 0xd863b256369d4a40ull, 0x90bed43e40076a82ull },
+    { 0x873e4f75e2224e68ull, 0x5a7744a6e804a291ull }, { 0xa90de3535aaae202ull, 0x711515d0a205cb36ull },
+    { 0xd3515c2831559a83ull, 0x0d5a5b44ca873e03ull }, { 0x8412d9991ed58091ull, 0xe858790afe9486c2ull },
+    { 0xa5178fff668ae0b6ull, 0x626e974dbe39a872ull }, { 0xce5d73ff402d98e3ull, 0xfb0a3d212dc8128full },
+    { 0x80fa687f881c7f8eull, 0x7ce66634bc9d0b99ull }, { 0xa139029f6a239f72ull, 0x1c1fffc1ebc44e80ull },
+    { 0xc987434744ac874eull, 0xa327ffb266b56220ull }, { 0xfbe9141915d7a922ull, 0x4bf1ff9f0062baa8ull },
+    { 0x9d71ac8fada6c9b5ull, 0x6f773fc3603db4a9ull }, { 0xc4ce17b399107c22ull, 0xcb550fb4384d21d3ull },
+    { 0xf6019da07f549b2bull, 0x7e2a53a146606a48ull }, { 0x99c102844f94e0fbull, 0x2eda7444cbfc426dull },
+    { 0xc0314325637a1939ull, 0xfa911155fefb5308ull }, { 0xf03d93eebc589f88ull, 0x793555ab7eba27caull },
+    { 0x96267c7535b763b5ull, 0x4bc1558b2f3458deull }, { 0xbbb01b9283253ca2ull, 0x9eb1aaedfb016f16ull },
+    { 0xea9c227723ee8bcbull, 0x465e15a979c1cadcull }, { 0x92a1958a7675175full, 0x0bfacd89ec191ec9ull },
+    { 0xb749faed14125d36ull, 0xcef980ec671f667bull }, { 0xe51c79a85916f484ull, 0x82b7e12780e7401aull },
+    { 0x8f31cc0937ae58d2ull, 0xd1b2ecb8b0908810ull }, { 0xb2fe3f0b8599ef07ull, 0x861fa7e6dcb4aa15ull },
+    { 0xdfbdcece67006ac9ull, 0x67a791e093e1d49aull }, { 0x8bd6a141006042bdull, 0xe0c8bb2c5c6d24e0ull },
+    { 0xaecc49914078536dull, 0x58fae9f773886e18ull }, { 0xda7f5bf590966848ull, 0xaf39a475506a899eull },
+    { 0x888f99797a5e012dull, 0x6d8406c952429603ull }, { 0xaab37fd7d8f58178ull, 0xc8e5087ba6d33b83ull },
+    { 0xd5605fcdcf32e1d6ull, 0xfb1e4a9a90880a64ull }, { 0x855c3be0a17fcd26ull, 0x5cf2eea09a55067full },
+    { 0xa6b34ad8c9dfc06full, 0xf42faa48c0ea481eull }, { 0xd0601d8efc57b08bull, 0xf13b94daf124da26ull },
+    { 0x823c12795db6ce57ull, 0x76c53d08d6b70858ull }, { 0xa2cb1717b52481edull, 0x54768c4b0c64ca6eull },
+    { 0xcb7ddcdda26da268ull, 0xa9942f5dcf7dfd09ull }, { 0xfe5d54150b090b02ull, 0xd3f93b35435d7c4cull },
+    { 0x9efa548d26e5a6e1ull, 0xc47bc5014a1a6dafull }, { 0xc6b8e9b0709f109aull, 0x359ab6419ca1091bull },
+    { 0xf867241c8cc6d4c0ull, 0xc30163d203c94b62ull }, { 0x9b407691d7fc44f8ull, 0x79e0de63425dcf1dull },
+    { 0xc21094364dfb5636ull, 0x985915fc12f542e4ull }, { 0xf294b943e17a2bc4ull, 0x3e6f5b7b17b2939dull },
+    { 0x979cf3ca6cec5b5aull, 0xa705992ceecf9c42ull }, { 0xbd8430bd08277231ull, 0x50c6ff782a838353ull },
+    { 0xece53cec4a314ebdull, 0xa4f8bf5635246428ull }, { 0x940f4613ae5ed136ull, 0x871b7795e136be99ull },
+    { 0xb913179899f68584ull, 0x28e2557b59846e3full }, { 0xe757dd7ec07426e5ull, 0x331aeada2fe589cfull },
+    { 0x9096ea6f3848984full, 0x3ff0d2c85def7621ull }, { 0xb4bca50b065abe63ull, 0x0fed077a756b53a9ull },
+    { 0xe1ebce4dc7f16dfbull, 0xd3e8495912c62894ull }, { 0x8d3360f09cf6e4bdull, 0x64712dd7abbbd95cull },
+    { 0xb080392cc4349decull, 0xbd8d794d96aacfb3ull }, { 0xdca04777f541c567ull, 0xecf0d7a0fc5583a0ull },
+    { 0x89e42caaf9491b60ull, 0xf41686c49db57244ull }, { 0xac5d37d5b79b6239ull, 0x311c2875c522ced5ull },
+    { 0xd77485cb25823ac7ull, 0x7d633293366b828bull }, { 0x86a8d39ef77164bcull, 0xae5dff9c02033197ull },
+    { 0xa8530886b54dbdebull, 0xd9f57f830283fdfcull }, { 0xd267caa862a12d66ull, 0xd072df63c324fd7bull },
+    { 0x8380dea93da4bc60ull, 0x4247cb9e59f71e6dull }, { 0xa46116538d0deb78ull, 0x52d9be85f074e608ull },
+    { 0xcd795be870516656ull, 0x67902e276c921f8bull }, { 0x806bd9714632dff6ull, 0x00ba1cd8a3db53b6ull },
+    { 0xa086cfcd97bf97f3ull, 0x80e8a40eccd228a4ull }, { 0xc8a883c0fdaf7df0ull, 0x6122cd128006b2cdull },
+    { 0xfad2a4b13d1b5d6cull, 0x796b805720085f81ull }, { 0x9cc3a6eec6311a63ull, 0xcbe3303674053bb0ull },
+    { 0xc3f490aa77bd60fcull, 0xbedbfc4411068a9cull }, { 0xf4f1b4d515acb93bull, 0xee92fb5515482d44ull },
+    { 0x991711052d8bf3c5ull, 0x751bdd152d4d1c4aull }, { 0xbf5cd54678eef0b6ull, 0xd262d45a78a0635dull },
+    { 0xef340a98172aace4ull, 0x86fb897116c87c34ull }, { 0x9580869f0e7aac0eull, 0xd45d35e6ae3d4da0ull },
+    { 0xbae0a846d2195712ull, 0x8974836059cca109ull }, { 0xe998d258869facd7ull, 0x2bd1a438703fc94bull },
+    { 0x91ff83775423cc06ull, 0x7b6306a34627ddcfull }, { 0xb67f6455292cbf08ull, 0x1a3bc84c17b1d542ull },
+    { 0xe41f3d6a7377eecaull, 0x20caba5f1d9e4a93ull }, { 0x8e938662882af53eull, 0x547eb47b7282ee9cull },
+    { 0xb23867fb2a35b28dull, 0xe99e619a4f23aa43ull }, { 0xdec681f9f4c31f31ull, 0x6405fa00e2ec94d4ull },
+    { 0x8b3c113c38f9f37eull, 0xde83bc408dd3dd04ull }, { 0xae0b158b4738705eull, 0x9624ab50b148d445ull },
+    { 0xd98ddaee19068c76ull, 0x3badd624dd9b0957ull }, { 0x87f8a8d4cfa417c9ull, 0xe54ca5d70a80e5d6ull },
+    { 0xa9f6d30a038d1dbcull, 0x5e9fcf4ccd211f4cull }, { 0xd47487cc8470652bull, 0x7647c3200069671full },
+    { 0x84c8d4dfd2c63f3bull, 0x29ecd9f40041e073ull }, { 0xa5fb0a17c777cf09ull, 0xf468107100525890ull },
+    { 0xcf79cc9db955c2ccull, 0x7182148d4066eeb4ull }, { 0x81ac1fe293d599bfull, 0xc6f14cd848405530ull },
+    { 0xa21727db38cb002full, 0xb8ada00e5a506a7cull }, { 0xca9cf1d206fdc03bull, 0xa6d90811f0e4851cull },
+    { 0xfd442e4688bd304aull, 0x908f4a166d1da663ull }, { 0x9e4a9cec15763e2eull, 0x9a598e4e043287feull },
+    { 0xc5dd44271ad3cdbaull, 0x40eff1e1853f29fdull }, { 0xf7549530e188c128ull, 0xd12bee59e68ef47cull },
+    { 0x9a94dd3e8cf578b9ull, 0x82bb74f8301958ceull }, { 0xc13a148e3032d6e7ull, 0xe36a52363c1faf01ull },
+    { 0xf18899b1bc3f8ca1ull, 0xdc44e6c3cb279ac1ull }, { 0x96f5600f15a7b7e5ull, 0x29ab103a5ef8c0b9ull },
+    { 0xbcb2b812db11a5deull, 0x7415d448f6b6f0e7ull }, { 0xebdf661791d60f56ull, 0x111b495b3464ad21ull },
+    { 0x936b9fcebb25c995ull, 0xcab10dd900beec34ull }, { 0xb84687c269ef3bfbull, 0x3d5d514f40eea742ull },
+    { 0xe65829b3046b0afaull, 0x0cb4a5a3112a5112ull }, { 0x8ff71a0fe2c2e6dcull, 0x47f0e785eaba72abull },
+    { 0xb3f4e093db73a093ull, 0x59ed216765690f56ull }, { 0xe0f218b8d25088b8ull, 0x306869c13ec3532cull },
+    { 0x8c974f7383725573ull, 0x1e414218c73a13fbull }, { 0xafbd2350644eeacfull, 0xe5d1929ef90898faull },
+    { 0xdbac6c247d62a583ull, 0xdf45f746b74abf39ull }, { 0x894bc396ce5da772ull, 0x6b8bba8c328eb783ull },
+    { 0xab9eb47c81f5114full, 0x066ea92f3f326564ull }, { 0xd686619ba27255a2ull, 0xc80a537b0efefebdull },
+    { 0x8613fd0145877585ull, 0xbd06742ce95f5f36ull }, { 0xa798fc4196e952e7ull, 0x2c48113823b73704ull },
+    { 0xd17f3b51fca3a7a0ull, 0xf75a15862ca504c5ull }, { 0x82ef85133de648c4ull, 0x9a984d73dbe722fbull },
+    { 0xa3ab66580d5fdaf5ull, 0xc13e60d0d2e0ebbaull }, { 0xcc963fee10b7d1b3ull, 0x318df905079926a8ull },
+    { 0xffbbcfe994e5c61full, 0xfdf17746497f7052ull }, { 0x9fd561f1fd0f9bd3ull, 0xfeb6ea8bedefa633ull },
+    { 0xc7caba6e7c5382c8ull, 0xfe64a52ee96b8fc0ull }, { 0xf9bd690a1b68637bull, 0x3dfdce7aa3c673b0ull },
+    { 0x9c1661a651213e2dull, 0x06bea10ca65c084eull }, { 0xc31bfa0fe5698db8ull, 0x486e494fcff30a62ull },
+    { 0xf3e2f893dec3f126ull, 0x5a89dba3c3efccfaull }, { 0x986ddb5c6b3a76b7ull, 0xf89629465a75e01cull },
+    { 0xbe89523386091465ull, 0xf6bbb397f1135823ull }, { 0xee2ba6c0678b597full, 0x746aa07ded582e2cull },
+    { 0x94db483840b717efull, 0xa8c2a44eb4571cdcull }, { 0xba121a4650e4ddebull, 0x92f34d62616ce413ull },
+    { 0xe896a0d7e51e1566ull, 0x77b020baf9c81d17ull }, { 0x915e2486ef32cd60ull, 0x0ace1474dc1d122eull },
+    { 0xb5b5ada8aaff80b8ull, 0x0d819992132456baull }, { 0xe3231912d5bf60e6ull, 0x10e1fff697ed6c69ull },
+    { 0x8df5efabc5979c8full, 0xca8d3ffa1ef463c1ull }, { 0xb1736b96b6fd83b3ull, 0xbd308ff8a6b17cb2ull },
+    { 0xddd0467c64bce4a0ull, 0xac7cb3f6d05ddbdeull }, { 0x8aa22c0dbef60ee4ull, 0x6bcdf07a423aa96bull },
+    { 0xad4ab7112eb3929dull, 0x86c16c98d2c953c6ull }, { 0xd89d64d57a607744ull, 0xe871c7bf077ba8b7ull },
+    { 0x87625f056c7c4a8bull, 0x11471cd764ad4972ull }, { 0xa93af6c6c79b5d2dull, 0xd598e40d3dd89bcfull },
+    { 0xd389b47879823479ull, 0x4aff1d108d4ec2c3ull }, { 0x843610cb4bf160cbull, 0xcedf722a585139baull },
+    { 0xa54394fe1eedb8feull, 0xc2974eb4ee658828ull }, { 0xce947a3da6a9273eull, 0x733d226229feea32ull },
+    { 0x811ccc668829b887ull, 0x0806357d5a3f525full }, { 0xa163ff802a3426a8ull, 0xca07c2dcb0cf26f7ull },
+    { 0xc9bcff6034c13052ull, 0xfc89b393dd02f0b5ull }, { 0xfc2c3f3841f17c67ull, 0xbbac2078d443ace2ull },
+    { 0x9d9ba7832936edc0ull, 0xd54b944b84aa4c0dull }, { 0xc5029163f384a931ull, 0x0a9e795e65d4df11ull },
+    { 0xf64335bcf065d37dull, 0x4d4617b5ff4a16d5ull }, { 0x99ea0196163fa42eull, 0x504bced1bf8e4e45ull },
+    { 0xc06481fb9bcf8d39ull, 0xe45ec2862f71e1d6ull }, { 0xf07da27a82c37088ull, 0x5d767327bb4e5a4cull },
+    { 0x964e858c91ba2655ull, 0x3a6a07f8d510f86full }, { 0xbbe226efb628afeaull, 0x890489f70a55368bull },
+    { 0xeadab0aba3b2dbe5ull, 0x2b45ac74ccea842eull }, { 0x92c8ae6b464fc96full, 0x3b0b8bc90012929dull },
+    { 0xb77ada0617e3bbcbull, 0x09ce6ebb40173744ull }, { 0xe55990879ddcaabdull, 0xcc420a6a101d0515ull },
+    { 0x8f57fa54c2a9eab6ull, 0x9fa946824a12232dull }, { 0xb32df8e9f3546564ull, 0x47939822dc96abf9ull },
+    { 0xdff9772470297ebdull, 0x59787e2b93bc56f7ull }, { 0x8bfbea76c619ef36ull, 0x57eb4edb3c55b65aull },
+    { 0xaefae51477a06b03ull, 0xede622920b6b23f1ull }, { 0xdab99e59958885c4ull, 0xe95fab368e45ecedull },
+    { 0x88b402f7fd75539bull, 0x11dbcb0218ebb414ull }, { 0xaae103b5fcd2a881ull, 0xd652bdc29f26a119ull },
+    { 0xd59944a37c0752a2ull, 0x4be76d3346f0495full }, { 0x857fcae62d8493a5ull, 0x6f70a4400c562ddbull },
+    { 0xa6dfbd9fb8e5b88eull, 0xcb4ccd500f6bb952ull }, { 0xd097ad07a71f26b2ull, 0x7e2000a41346a7a7ull },
+    { 0x825ecc24c873782full, 0x8ed400668c0c28c8ull }, { 0xa2f67f2dfa90563bull, 0x728900802f0f32faull },
+    { 0xcbb41ef979346bcaull, 0x4f2b40a03ad2ffb9ull }, { 0xfea126b7d78186bcull, 0xe2f610c84987bfa8ull },
+    { 0x9f24b832e6b0f436ull, 0x0dd9ca7d2df4d7c9ull }, { 0xc6ede63fa05d3143ull, 0x91503d1c79720dbbull },
+    { 0xf8a95fcf88747d94ull, 0x75a44c6397ce912aull }, { 0x9b69dbe1b548ce7cull, 0xc986afbe3ee11abaull },
+    { 0xc24452da229b021bull, 0xfbe85badce996168ull }, { 0xf2d56790ab41c2a2ull, 0xfae27299423fb9c3ull },
+    { 0x97c560ba6b0919a5ull, 0xdccd879fc967d41aull }, { 0xbdb6b8e905cb600full, 0x5400e987bbc1c920ull },
+    { 0xed246723473e3813ull, 0x290123e9aab23b68ull }, { 0x9436c0760c86e30bull, 0xf9a0b6720aaf6521ull },
+    { 0xb94470938fa89bceull, 0xf808e40e8d5b3e69ull }, { 0xe7958cb87392c2c2ull, 0xb60b1d1230b20e04ull },
+    { 0x90bd77f3483bb9b9ull, 0xb1c6f22b5e6f48c2ull }, { 0xb4ecd5f01a4aa828ull, 0x1e38aeb6360b1af3ull },
+    { 0xe2280b6c20dd5232ull, 0x25c6da63c38de1b0ull }, { 0x8d590723948a535full, 0x579c487e5a38ad0eull },
+    { 0xb0af48ec79ace837ull, 0x2d835a9df0c6d851ull }, { 0xdcdb1b2798182244ull, 0xf8e431456cf88e65ull },
+    { 0x8a08f0f8bf0f156bull, 0x1b8e9ecb641b58ffull }, { 0xac8b2d36eed2dac5ull, 0xe272467e3d222f3full },
+    { 0xd7adf884aa879177ull, 0x5b0ed81dcc6abb0full }, { 0x86ccbb52ea94baeaull, 0x98e947129fc2b4e9ull },
+    { 0xa87fea27a539e9a5ull, 0x3f2398d747b36224ull }, { 0xd29fe4b18e88640eull, 0x8eec7f0d19a03aadull },
+    { 0x83a3eeeef9153e89ull, 0x1953cf68300424acull }, { 0xa48ceaaab75a8e2bull, 0x5fa8c3423c052dd7ull },
+    { 0xcdb02555653131b6ull, 0x3792f412cb06794dull }, { 0x808e17555f3ebf11ull, 0xe2bbd88bbee40bd0ull },
+    { 0xa0b19d2ab70e6ed6ull, 0x5b6aceaeae9d0ec4ull }, { 0xc8de047564d20a8bull, 0xf245825a5a445275ull },
+    { 0xfb158592be068d2eull, 0xeed6e2f0f0d56712ull }, { 0x9ced737bb6c4183dull, 0x55464dd69685606bull },
+    { 0xc428d05aa4751e4cull, 0xaa97e14c3c26b886ull }, { 0xf53304714d9265dfull, 0xd53dd99f4b3066a8ull },
+    { 0x993fe2c6d07b7fabull, 0xe546a8038efe4029ull }, { 0xbf8fdb78849a5f96ull, 0xde98520472bdd033ull },
+    { 0xef73d256a5c0f77cull, 0x963e66858f6d4440ull }, { 0x95a8637627989aadull, 0xdde7001379a44aa8ull },
+    { 0xbb127c53b17ec159ull, 0x5560c018580d5d52ull }, { 0xe9d71b689dde71afull, 0xaab8f01e6e10b4a6ull },
+    { 0x9226712162ab070dull, 0xcab3961304ca70e8ull }, { 0xb6b00d69bb55c8d1ull, 0x3d607b97c5fd0d22ull },
+    { 0xe45c10c42a2b3b05ull, 0x8cb89a7db77c506aull }, { 0x8eb98a7a9a5b04e3ull, 0x77f3608e92adb242ull },
+    { 0xb267ed1940f1c61cull, 0x55f038b237591ed3ull }, { 0xdf01e85f912e37a3ull, 0x6b6c46dec52f6688ull },
+    { 0x8b61313bbabce2c6ull, 0x2323ac4b3b3da015ull }, { 0xae397d8aa96c1b77ull, 0xabec975e0a0d081aull },
+    { 0xd9c7dced53c72255ull, 0x96e7bd358c904a21ull }, { 0x881cea14545c7575ull, 0x7e50d64177da2e54ull },
+    { 0xaa242499697392d2ull, 0xdde50bd1d5d0b9e9ull }, { 0xd4ad2dbfc3d07787ull, 0x955e4ec64b44e864ull },
+    { 0x84ec3c97da624ab4ull, 0xbd5af13bef0b113eull }, { 0xa6274bbdd0fadd61ull, 0xecb1ad8aeacdd58eull },
+    { 0xcfb11ead453994baull, 0x67de18eda5814af2ull }, { 0x81ceb32c4b43fcf4ull, 0x80eacf948770ced7ull },
+    { 0xa2425ff75e14fc31ull, 0xa1258379a94d028dull }, { 0xcad2f7f5359a3b3eull, 0x096ee45813a04330ull },
+    { 0xfd87b5f28300ca0dull, 0x8bca9d6e188853fcull }, { 0x9e74d1b791e07e48ull, 0x775ea264cf55347dull },
+    { 0xc612062576589ddaull, 0x95364afe032a819dull }, { 0xf79687aed3eec551ull, 0x3a83ddbd83f52204ull },
+    { 0x9abe14cd44753b52ull, 0xc4926a9672793542ull }, { 0xc16d9a0095928a27ull, 0x75b7053c0f178293ull },
+    { 0xf1c90080baf72cb1ull, 0x5324c68b12dd6338ull }, { 0x971da05074da7beeull, 0xd3f6fc16ebca5e03ull },
+    { 0xbce5086492111aeaull, 0x88f4bb1ca6bcf584ull }, { 0xec1e4a7db69561a5ull, 0x2b31e9e3d06c32e5ull },
+    { 0x9392ee8e921d5d07ull, 0x3aff322e62439fcfull }, { 0xb877aa3236a4b449ull, 0x09befeb9fad487c2ull },
+    { 0xe69594bec44de15bull, 0x4c2ebe687989a9b3ull }, { 0x901d7cf73ab0acd9ull, 0x0f9d37014bf60a10ull },
+    { 0xb424dc35095cd80full, 0x538484c19ef38c94ull }, { 0xe12e13424bb40e13ull, 0x2865a5f206b06fb9ull },
+    { 0x8cbccc096f5088cbull, 0xf93f87b7442e45d3ull }, { 0xafebff0bcb24aafeull, 0xf78f69a51539d748ull },
+    { 0xdbe6fecebdedd5beull, 0xb573440e5a884d1bull }, { 0x89705f4136b4a597ull, 0x31680a88f8953030ull },
+    { 0xabcc77118461cefcull, 0xfdc20d2b36ba7c3dull }, { 0xd6bf94d5e57a42bcull, 0x3d32907604691b4cull },
+    { 0x8637bd05af6c69b5ull, 0xa63f9a49c2c1b10full }, { 0xa7c5ac471b478423ull, 0x0fcf80dc33721d53ull },
+    { 0xd1b71758e219652bull, 0xd3c36113404ea4a8ull }, { 0x83126e978d4fdf3bull, 0x645a1cac083126e9ull },
+    { 0xa3d70a3d70a3d70aull, 0x3d70a3d70a3d70a3ull }, { 0xccccccccccccccccull, 0xccccccccccccccccull },
+    { 0x8000000000000000ull, 0x0000000000000000ull }, { 0xa000000000000000ull, 0x0000000000000000ull },
+    { 0xc800000000000000ull, 0x0000000000000000ull }, { 0xfa00000000000000ull, 0x0000000000000000ull },
+    { 0x9c40000000000000ull, 0x0000000000000000ull }, { 0xc350000000000000ull, 0x0000000000000000ull },
+    { 0xf424000000000000ull, 0x0000000000000000ull }, { 0x9896800000000000ull, 0x0000000000000000ull },
+    { 0xbebc200000000000ull, 0x0000000000000000ull }, { 0xee6b280000000000ull, 0x0000000000000000ull },
+    { 0x9502f90000000000ull, 0x0000000000000000ull }, { 0xba43b74000000000ull, 0x0000000000000000ull },
+    { 0xe8d4a51000000000ull, 0x0000000000000000ull }, { 0x9184e72a00000000ull, 0x0000000000000000ull },
+    { 0xb5e620f480000000ull, 0x0000000000000000ull }, { 0xe35fa931a0000000ull, 0x0000000000000000ull },
+    { 0x8e1bc9bf04000000ull, 0x0000000000000000ull }, { 0xb1a2bc2ec5000000ull, 0x0000000000000000ull },
+    { 0xde0b6b3a76400000ull, 0x0000000000000000ull }, { 0x8ac7230489e80000ull, 0x0000000000000000ull },
+    { 0xad78ebc5ac620000ull, 0x0000000000000000ull }, { 0xd8d726b7177a8000ull, 0x0000000000000000ull },
+    { 0x878678326eac9000ull, 0x0000000000000000ull }, { 0xa968163f0a57b400ull, 0x0000000000000000ull },
+    { 0xd3c21bcecceda100ull, 0x0000000000000000ull }, { 0x84595161401484a0ull, 0x0000000000000000ull },
+    { 0xa56fa5b99019a5c8ull, 0x0000000000000000ull }, { 0xcecb8f27f4200f3aull, 0x0000000000000000ull },
+    { 0x813f3978f8940984ull, 0x4000000000000000ull }, { 0xa18f07d736b90be5ull, 0x5000000000000000ull },
+    { 0xc9f2c9cd04674edeull, 0xa400000000000000ull }, { 0xfc6f7c4045812296ull, 0x4d00000000000000ull },
+    { 0x9dc5ada82b70b59dull, 0xf020000000000000ull }, { 0xc5371912364ce305ull, 0x6c28000000000000ull },
+    { 0xf684df56c3e01bc6ull, 0xc732000000000000ull }, { 0x9a130b963a6c115cull, 0x3c7f400000000000ull },
+    { 0xc097ce7bc90715b3ull, 0x4b9f100000000000ull }, { 0xf0bdc21abb48db20ull, 0x1e86d40000000000ull },
+    { 0x96769950b50d88f4ull, 0x1314448000000000ull }, { 0xbc143fa4e250eb31ull, 0x17d955a000000000ull },
+    { 0xeb194f8e1ae525fdull, 0x5dcfab0800000000ull }, { 0x92efd1b8d0cf37beull, 0x5aa1cae500000000ull },
+    { 0xb7abc627050305adull, 0xf14a3d9e40000000ull }, { 0xe596b7b0c643c719ull, 0x6d9ccd05d0000000ull },
+    { 0x8f7e32ce7bea5c6full, 0xe4820023a2000000ull }, { 0xb35dbf821ae4f38bull, 0xdda2802c8a800000ull },
+    { 0xe0352f62a19e306eull, 0xd50b2037ad200000ull }, { 0x8c213d9da502de45ull, 0x4526f422cc340000ull },
+    { 0xaf298d050e4395d6ull, 0x9670b12b7f410000ull }, { 0xdaf3f04651d47b4cull, 0x3c0cdd765f114000ull },
+    { 0x88d8762bf324cd0full, 0xa5880a69fb6ac800ull }, { 0xab0e93b6efee0053ull, 0x8eea0d047a457a00ull },
+    { 0xd5d238a4abe98068ull, 0x72a4904598d6d880ull }, { 0x85a36366eb71f041ull, 0x47a6da2b7f864750ull },
+    { 0xa70c3c40a64e6c51ull, 0x999090b65f67d924ull }, { 0xd0cf4b50cfe20765ull, 0xfff4b4e3f741cf6dull },
+    { 0x82818f1281ed449full, 0xbff8f10e7a8921a4ull }, { 0xa321f2d7226895c7ull, 0xaff72d52192b6a0dull },
+    { 0xcbea6f8ceb02bb39ull, 0x9bf4f8a69f764490ull }, { 0xfee50b7025c36a08ull, 0x02f236d04753d5b4ull },
+    { 0x9f4f2726179a2245ull, 0x01d762422c946590ull }, { 0xc722f0ef9d80aad6ull, 0x424d3ad2b7b97ef5ull },
+    { 0xf8ebad2b84e0d58bull, 0xd2e0898765a7deb2ull }, { 0x9b934c3b330c8577ull, 0x63cc55f49f88eb2full },
+    { 0xc2781f49ffcfa6d5ull, 0x3cbf6b71c76b25fbull }, { 0xf316271c7fc3908aull, 0x8bef464e3945ef7aull },
+    { 0x97edd871cfda3a56ull, 0x97758bf0e3cbb5acull }, { 0xbde94e8e43d0c8ecull, 0x3d52eeed1cbea317ull },
+    { 0xed63a231d4c4fb27ull, 0x4ca7aaa863ee4bddull }, { 0x945e455f24fb1cf8ull, 0x8fe8caa93e74ef6aull },
+    { 0xb975d6b6ee39e436ull, 0xb3e2fd538e122b44ull }, { 0xe7d34c64a9c85d44ull, 0x60dbbca87196b616ull },
+    { 0x90e40fbeea1d3a4aull, 0xbc8955e946fe31cdull }, { 0xb51d13aea4a488ddull, 0x6babab6398bdbe41ull },
+    { 0xe264589a4dcdab14ull, 0xc696963c7eed2dd1ull }, { 0x8d7eb76070a08aecull, 0xfc1e1de5cf543ca2ull },
+    { 0xb0de65388cc8ada8ull, 0x3b25a55f43294bcbull }, { 0xdd15fe86affad912ull, 0x49ef0eb713f39ebeull },
+    { 0x8a2dbf142dfcc7abull, 0x6e3569326c784337ull }, { 0xacb92ed9397bf996ull, 0x49c2c37f07965404ull },
+    { 0xd7e77a8f87daf7fbull, 0xdc33745ec97be906ull }, { 0x86f0ac99b4e8dafdull, 0x69a028bb3ded71a3ull },
+    { 0xa8acd7c0222311bcull, 0xc40832ea0d68ce0cull }, { 0xd2d80db02aabd62bull, 0xf50a3fa490c30190ull },
+    { 0x83c7088e1aab65dbull, 0x792667c6da79e0faull }, { 0xa4b8cab1a1563f52ull, 0x577001b891185938ull },
+    { 0xcde6fd5e09abcf26ull, 0xed4c0226b55e6f86ull }, { 0x80b05e5ac60b6178ull, 0x544f8158315b05b4ull },
+    { 0xa0dc75f1778e39d6ull, 0x696361ae3db1c721ull }, { 0xc913936dd571c84cull, 0x03bc3a19cd1e38e9ull },
+    { 0xfb5878494ace3a5full, 0x04ab48a04065c723ull }, { 0x9d174b2dcec0e47bull, 0x62eb0d64283f9c76ull },
+    { 0xc45d1df942711d9aull, 0x3ba5d0bd324f8394ull }, { 0xf5746577930d6500ull, 0xca8f44ec7ee36479ull },
+    { 0x9968bf6abbe85f20ull, 0x7e998b13cf4e1ecbull }, { 0xbfc2ef456ae276e8ull, 0x9e3fedd8c321a67eull },
+    { 0xefb3ab16c59b14a2ull, 0xc5cfe94ef3ea101eull }, { 0x95d04aee3b80ece5ull, 0xbba1f1d158724a12ull },
+    { 0xbb445da9ca61281full, 0x2a8a6e45ae8edc97ull }, { 0xea1575143cf97226ull, 0xf52d09d71a3293bdull },
+    { 0x924d692ca61be758ull, 0x593c2626705f9c56ull }, { 0xb6e0c377cfa2e12eull, 0x6f8b2fb00c77836cull },
+    { 0xe498f455c38b997aull, 0x0b6dfb9c0f956447ull }, { 0x8edf98b59a373fecull, 0x4724bd4189bd5eacull },
+    { 0xb2977ee300c50fe7ull, 0x58edec91ec2cb657ull }, { 0xdf3d5e9bc0f653e1ull, 0x2f2967b66737e3edull },
+    { 0x8b865b215899f46cull, 0xbd79e0d20082ee74ull }, { 0xae67f1e9aec07187ull, 0xecd8590680a3aa11ull },
+    { 0xda01ee641a708de9ull, 0xe80e6f4820cc9495ull }, { 0x884134fe908658b2ull, 0x3109058d147fdcddull },
+    { 0xaa51823e34a7eedeull, 0xbd4b46f0599fd415ull }, { 0xd4e5e2cdc1d1ea96ull, 0x6c9e18ac7007c91aull },
+    { 0x850fadc09923329eull, 0x03e2cf6bc604ddb0ull }, { 0xa6539930bf6bff45ull, 0x84db8346b786151cull },
+    { 0xcfe87f7cef46ff16ull, 0xe612641865679a63ull }, { 0x81f14fae158c5f6eull, 0x4fcb7e8f3f60c07eull },
+    { 0xa26da3999aef7749ull, 0xe3be5e330f38f09dull }, { 0xcb090c8001ab551cull, 0x5cadf5bfd3072cc5ull },
+    { 0xfdcb4fa002162a63ull, 0x73d9732fc7c8f7f6ull }, { 0x9e9f11c4014dda7eull, 0x2867e7fddcdd9afaull },
+    { 0xc646d63501a1511dull, 0xb281e1fd541501b8ull }, { 0xf7d88bc24209a565ull, 0x1f225a7ca91a4226ull },
+    { 0x9ae757596946075full, 0x3375788de9b06958ull }, { 0xc1a12d2fc3978937ull, 0x0052d6b1641c83aeull },
+    { 0xf209787bb47d6b84ull, 0xc0678c5dbd23a49aull }, { 0x9745eb4d50ce6332ull, 0xf840b7ba963646e0ull },
+    { 0xbd176620a501fbffull, 0xb650e5a93bc3d898ull }, { 0xec5d3fa8ce427affull, 0xa3e51f138ab4cebeull },
+    { 0x93ba47c980e98cdfull, 0xc66f336c36b10137ull }, { 0xb8a8d9bbe123f017ull, 0xb80b0047445d4184ull },
+    { 0xe6d3102ad96cec1dull, 0xa60dc059157491e5ull }, { 0x9043ea1ac7e41392ull, 0x87c89837ad68db2full },
+    { 0xb454e4a179dd1877ull, 0x29babe4598c311fbull }, { 0xe16a1dc9d8545e94ull, 0xf4296dd6fef3d67aull },
+    { 0x8ce2529e2734bb1dull, 0x1899e4a65f58660cull }, { 0xb01ae745b101e9e4ull, 0x5ec05dcff72e7f8full },
+    { 0xdc21a1171d42645dull, 0x76707543f4fa1f73ull }, { 0x899504ae72497ebaull, 0x6a06494a791c53a8ull },
+    { 0xabfa45da0edbde69ull, 0x0487db9d17636892ull }, { 0xd6f8d7509292d603ull, 0x45a9d2845d3c42b6ull },
+    { 0x865b86925b9bc5c2ull, 0x0b8a2392ba45a9b2ull }, { 0xa7f26836f282b732ull, 0x8e6cac7768d7141eull },
+    { 0xd1ef0244af2364ffull, 0x3207d795430cd926ull }, { 0x8335616aed761f1full, 0x7f44e6bd49e807b8ull },
+    { 0xa402b9c5a8d3a6e7ull, 0x5f16206c9c6209a6ull }, { 0xcd036837130890a1ull, 0x36dba887c37a8c0full },
+    { 0x802221226be55a64ull, 0xc2494954da2c9789ull }, { 0xa02aa96b06deb0fdull, 0xf2db9baa10b7bd6cull },
+    { 0xc83553c5c8965d3dull, 0x6f92829494e5acc7ull }, { 0xfa42a8b73abbf48cull, 0xcb772339ba1f17f9ull },
+    { 0x9c69a97284b578d7ull, 0xff2a760414536efbull }, { 0xc38413cf25e2d70dull, 0xfef5138519684abaull },
+    { 0xf46518c2ef5b8cd1ull, 0x7eb258665fc25d69ull }, { 0x98bf2f79d5993802ull, 0xef2f773ffbd97a61ull },
+    { 0xbeeefb584aff8603ull, 0xaafb550ffacfd8faull }, { 0xeeaaba2e5dbf6784ull, 0x95ba2a53f983cf38ull },
+    { 0x952ab45cfa97a0b2ull, 0xdd945a747bf26183ull }, { 0xba756174393d88dfull, 0x94f971119aeef9e4ull },
+    { 0xe912b9d1478ceb17ull, 0x7a37cd5601aab85dull }, { 0x91abb422ccb812eeull, 0xac62e055c10ab33aull },
+    { 0xb616a12b7fe617aaull, 0x577b986b314d6009ull }, { 0xe39c49765fdf9d94ull, 0xed5a7e85fda0b80bull },
+    { 0x8e41ade9fbebc27dull, 0x14588f13be847307ull }, { 0xb1d219647ae6b31cull, 0x596eb2d8ae258fc8ull },
+    { 0xde469fbd99a05fe3ull, 0x6fca5f8ed9aef3bbull }, { 0x8aec23d680043beeull, 0x25de7bb9480d5854ull },
+    { 0xada72ccc20054ae9ull, 0xaf561aa79a10ae6aull }, { 0xd910f7ff28069da4ull, 0x1b2ba1518094da04ull },
+    { 0x87aa9aff79042286ull, 0x90fb44d2f05d0842ull }, { 0xa99541bf57452b28ull, 0x353a1607ac744a53ull },
+    { 0xd3fa922f2d1675f2ull, 0x42889b8997915ce8ull }, { 0x847c9b5d7c2e09b7ull, 0x69956135febada11ull },
+    { 0xa59bc234db398c25ull, 0x43fab9837e699095ull }, { 0xcf02b2c21207ef2eull, 0x94f967e45e03f4bbull },
+    { 0x8161afb94b44f57dull, 0x1d1be0eebac278f5ull }, { 0xa1ba1ba79e1632dcull, 0x6462d92a69731732ull },
+    { 0xca28a291859bbf93ull, 0x7d7b8f7503cfdcfeull }, { 0xfcb2cb35e702af78ull, 0x5cda735244c3d43eull },
+    { 0x9defbf01b061adabull, 0x3a0888136afa64a7ull }, { 0xc56baec21c7a1916ull, 0x088aaa1845b8fdd0ull },
+    { 0xf6c69a72a3989f5bull, 0x8aad549e57273d45ull }, { 0x9a3c2087a63f6399ull, 0x36ac54e2f678864bull },
+    { 0xc0cb28a98fcf3c7full, 0x84576a1bb416a7ddull }, { 0xf0fdf2d3f3c30b9full, 0x656d44a2a11c51d5ull },
+    { 0x969eb7c47859e743ull, 0x9f644ae5a4b1b325ull }, { 0xbc4665b596706114ull, 0x873d5d9f0dde1feeull },
+    { 0xeb57ff22fc0c7959ull, 0xa90cb506d155a7eaull }, { 0x9316ff75dd87cbd8ull, 0x09a7f12442d588f2ull },
+    { 0xb7dcbf5354e9beceull, 0x0c11ed6d538aeb2full }, { 0xe5d3ef282a242e81ull, 0x8f1668c8a86da5faull },
+    { 0x8fa475791a569d10ull, 0xf96e017d694487bcull }, { 0xb38d92d760ec4455ull, 0x37c981dcc395a9acull },
+    { 0xe070f78d3927556aull, 0x85bbe253f47b1417ull }, { 0x8c469ab843b89562ull, 0x93956d7478ccec8eull },
+    { 0xaf58416654a6babbull, 0x387ac8d1970027b2ull }, { 0xdb2e51bfe9d0696aull, 0x06997b05fcc0319eull },
+    { 0x88fcf317f22241e2ull, 0x441fece3bdf81f03ull }, { 0xab3c2fddeeaad25aull, 0xd527e81cad7626c3ull },
+    { 0xd60b3bd56a5586f1ull, 0x8a71e223d8d3b074ull }, { 0x85c7056562757456ull, 0xf6872d5667844e49ull },
+    { 0xa738c6bebb12d16cull, 0xb428f8ac016561dbull }, { 0xd106f86e69d785c7ull, 0xe13336d701beba52ull },
+    { 0x82a45b450226b39cull, 0xecc0024661173473ull }, { 0xa34d721642b06084ull, 0x27f002d7f95d0190ull },
+    { 0xcc20ce9bd35c78a5ull, 0x31ec038df7b441f4ull }, { 0xff290242c83396ceull, 0x7e67047175a15271ull },
+    { 0x9f79a169bd203e41ull, 0x0f0062c6e984d386ull }, { 0xc75809c42c684dd1ull, 0x52c07b78a3e60868ull },
+    { 0xf92e0c3537826145ull, 0xa7709a56ccdf8a82ull }, { 0x9bbcc7a142b17ccbull, 0x88a66076400bb691ull },
+    { 0xc2abf989935ddbfeull, 0x6acff893d00ea435ull }, { 0xf356f7ebf83552feull, 0x0583f6b8c4124d43ull },
+    { 0x98165af37b2153deull, 0xc3727a337a8b704aull }, { 0xbe1bf1b059e9a8d6ull, 0x744f18c0592e4c5cull },
+    { 0xeda2ee1c7064130cull, 0x1162def06f79df73ull }, { 0x9485d4d1c63e8be7ull, 0x8addcb5645ac2ba8ull },
+    { 0xb9a74a0637ce2ee1ull, 0x6d953e2bd7173692ull }, { 0xe8111c87c5c1ba99ull, 0xc8fa8db6ccdd0437ull },
+    { 0x910ab1d4db9914a0ull, 0x1d9c9892400a22a2ull }, { 0xb54d5e4a127f59c8ull, 0x2503beb6d00cab4bull },
+    { 0xe2a0b5dc971f303aull, 0x2e44ae64840fd61dull }, { 0x8da471a9de737e24ull, 0x5ceaecfed289e5d2ull },
+    { 0xb10d8e1456105dadull, 0x7425a83e872c5f47ull }, { 0xdd50f1996b947518ull, 0xd12f124e28f77719ull },
+    { 0x8a5296ffe33cc92full, 0x82bd6b70d99aaa6full }, { 0xace73cbfdc0bfb7bull, 0x636cc64d1001550bull },
+    { 0xd8210befd30efa5aull, 0x3c47f7e05401aa4eull }, { 0x8714a775e3e95c78ull, 0x65acfaec34810a71ull },
+    { 0xa8d9d1535ce3b396ull, 0x7f1839a741a14d0dull }, { 0xd31045a8341ca07cull, 0x1ede48111209a050ull },
+    { 0x83ea2b892091e44dull, 0x934aed0aab460432ull }, { 0xa4e4b66b68b65d60ull, 0xf81da84d5617853full },
+    { 0xce1de40642e3f4b9ull, 0x36251260ab9d668eull }, { 0x80d2ae83e9ce78f3ull, 0xc1d72b7c6b426019ull },
+    { 0xa1075a24e4421730ull, 0xb24cf65b8612f81full }, { 0xc94930ae1d529cfcull, 0xdee033f26797b627ull },
+    { 0xfb9b7cd9a4a7443cull, 0x169840ef017da3b1ull }, { 0x9d412e0806e88aa5ull, 0x8e1f289560ee864eull },
+    { 0xc491798a08a2ad4eull, 0xf1a6f2bab92a27e2ull }, { 0xf5b5d7ec8acb58a2ull, 0xae10af696774b1dbull },
+    { 0x9991a6f3d6bf1765ull, 0xacca6da1e0a8ef29ull }, { 0xbff610b0cc6edd3full, 0x17fd090a58d32af3ull },
+    { 0xeff394dcff8a948eull, 0xddfc4b4cef07f5b0ull }, { 0x95f83d0a1fb69cd9ull, 0x4abdaf101564f98eull },
+    { 0xbb764c4ca7a4440full, 0x9d6d1ad41abe37f1ull }, { 0xea53df5fd18d5513ull, 0x84c86189216dc5edull },
+    { 0x92746b9be2f8552cull, 0x32fd3cf5b4e49bb4ull }, { 0xb7118682dbb66a77ull, 0x3fbc8c33221dc2a1ull },
+    { 0xe4d5e82392a40515ull, 0x0fabaf3feaa5334aull }, { 0x8f05b1163ba6832dull, 0x29cb4d87f2a7400eull },
+    { 0xb2c71d5bca9023f8ull, 0x743e20e9ef511012ull }, { 0xdf78e4b2bd342cf6ull, 0x914da9246b255416ull },
+    { 0x8bab8eefb6409c1aull, 0x1ad089b6c2f7548eull }, { 0xae9672aba3d0c320ull, 0xa184ac2473b529b1ull },
+    { 0xda3c0f568cc4f3e8ull, 0xc9e5d72d90a2741eull }, { 0x8865899617fb1871ull, 0x7e2fa67c7a658892ull },
+    { 0xaa7eebfb9df9de8dull, 0xddbb901b98feeab7ull }, { 0xd51ea6fa85785631ull, 0x552a74227f3ea565ull },
+    { 0x8533285c936b35deull, 0xd53a88958f87275full }, { 0xa67ff273b8460356ull, 0x8a892abaf368f137ull },
+    { 0xd01fef10a657842cull, 0x2d2b7569b0432d85ull }, { 0x8213f56a67f6b29bull, 0x9c3b29620e29fc73ull },
+    { 0xa298f2c501f45f42ull, 0x8349f3ba91b47b8full }, { 0xcb3f2f7642717713ull, 0x241c70a936219a73ull },
+    { 0xfe0efb53d30dd4d7ull, 0xed238cd383aa0110ull }, { 0x9ec95d1463e8a506ull, 0xf4363804324a40aaull },
+    { 0xc67bb4597ce2ce48ull, 0xb143c6053edcd0d5ull }, { 0xf81aa16fdc1b81daull, 0xdd94b7868e94050aull },
+    { 0x9b10a4e5e9913128ull, 0xca7cf2b4191c8326ull }, { 0xc1d4ce1f63f57d72ull, 0xfd1c2f611f63a3f0ull },
+    { 0xf24a01a73cf2dccfull, 0xbc633b39673c8cecull }, { 0x976e41088617ca01ull, 0xd5be0503e085d813ull },
+    { 0xbd49d14aa79dbc82ull, 0x4b2d8644d8a74e18ull }, { 0xec9c459d51852ba2ull, 0xddf8e7d60ed1219eull },
+    { 0x93e1ab8252f33b45ull, 0xcabb90e5c942b503ull }, { 0xb8da1662e7b00a17ull, 0x3d6a751f3b936243ull },
+    { 0xe7109bfba19c0c9dull, 0x0cc512670a783ad4ull }, { 0x906a617d450187e2ull, 0x27fb2b80668b24c5ull },
+    { 0xb484f9dc9641e9daull, 0xb1f9f660802dedf6ull }, { 0xe1a63853bbd26451ull, 0x5e7873f8a0396973ull },
+    { 0x8d07e33455637eb2ull, 0xdb0b487b6423e1e8ull }, { 0xb049dc016abc5e5full, 0x91ce1a9a3d2cda62ull },
+    { 0xdc5c5301c56b75f7ull, 0x7641a140cc7810fbull }, { 0x89b9b3e11b6329baull, 0xa9e904c87fcb0a9dull },
+    { 0xac2820d9623bf429ull, 0x546345fa9fbdcd44ull }, { 0xd732290fbacaf133ull, 0xa97c177947ad4095ull },
+    { 0x867f59a9d4bed6c0ull, 0x49ed8eabcccc485dull }, { 0xa81f301449ee8c70ull, 0x5c68f256bfff5a74ull },
+    { 0xd226fc195c6a2f8cull, 0x73832eec6fff3111ull }, { 0x83585d8fd9c25db7ull, 0xc831fd53c5ff7eabull },
+    { 0xa42e74f3d032f525ull, 0xba3e7ca8b77f5e55ull }, { 0xcd3a1230c43fb26full, 0x28ce1bd2e55f35ebull },
+    { 0x80444b5e7aa7cf85ull, 0x7980d163cf5b81b3ull }, { 0xa0555e361951c366ull, 0xd7e105bcc332621full },
+    { 0xc86ab5c39fa63440ull, 0x8dd9472bf3fefaa7ull }, { 0xfa856334878fc150ull, 0xb14f98f6f0feb951ull },
+    { 0x9c935e00d4b9d8d2ull, 0x6ed1bf9a569f33d3ull }, { 0xc3b8358109e84f07ull, 0x0a862f80ec4700c8ull },
+    { 0xf4a642e14c6262c8ull, 0xcd27bb612758c0faull }, { 0x98e7e9cccfbd7dbdull, 0x8038d51cb897789cull },
+    { 0xbf21e44003acdd2cull, 0xe0470a63e6bd56c3ull }, { 0xeeea5d5004981478ull, 0x1858ccfce06cac74ull },
+    { 0x95527a5202df0ccbull, 0x0f37801e0c43ebc8ull }, { 0xbaa718e68396cffdull, 0xd30560258f54e6baull },
+    { 0xe950df20247c83fdull, 0x47c6b82ef32a2069ull }, { 0x91d28b7416cdd27eull, 0x4cdc331d57fa5441ull },
+    { 0xb6472e511c81471dull, 0xe0133fe4adf8e952ull }, { 0xe3d8f9e563a198e5ull, 0x58180fddd97723a6ull },
+    { 0x8e679c2f5e44ff8full, 0x570f09eaa7ea7648ull }, { 0xb201833b35d63f73ull, 0x2cd2cc6551e513daull },
+    { 0xde81e40a034bcf4full, 0xf8077f7ea65e58d1ull }, { 0x8b112e86420f6191ull, 0xfb04afaf27faf782ull },
+    { 0xadd57a27d29339f6ull, 0x79c5db9af1f9b563ull }, { 0xd94ad8b1c7380874ull, 0x18375281ae7822bcull },
+    { 0x87cec76f1c830548ull, 0x8f2293910d0b15b5ull }, { 0xa9c2794ae3a3c69aull, 0xb2eb3875504ddb22ull },
+    { 0xd433179d9c8cb841ull, 0x5fa60692a46151ebull }, { 0x849feec281d7f328ull, 0xdbc7c41ba6bcd333ull },
+    { 0xa5c7ea73224deff3ull, 0x12b9b522906c0800ull }, { 0xcf39e50feae16befull, 0xd768226b34870a00ull },
+    { 0x81842f29f2cce375ull, 0xe6a1158300d46640ull }, { 0xa1e53af46f801c53ull, 0x60495ae3c1097fd0ull },
+    { 0xca5e89b18b602368ull, 0x385bb19cb14bdfc4ull }, { 0xfcf62c1dee382c42ull, 0x46729e03dd9ed7b5ull },
+    { 0x9e19db92b4e31ba9ull, 0x6c07a2c26a8346d1ull },
+};
+
+// Low half of a * b, with the high half stored in high
+static inline uint64_t multiply_128(uint64_t a, uint64_t b, uint64_t* high) {
+#ifdef __SIZEOF_INT128__
+    __extension__ unsigned __int128 product = (unsigned __int128)a * b;
+    *high = (uint64_t)(product >> 64);
+    return (uint64_t)product;
+#else
+    uint64_t a_lo = (uint32_t)a, a_hi = a >> 32, b_lo = (uint32_t)b, b_hi = b >> 32;
+    uint64_t lo_lo = a_lo * b_lo, hi_lo = a_hi * b_lo, lo_hi = a_lo * b_hi, hi_hi = a_hi * b_hi;
+    uint64_t cross = (lo_lo >> 32) + (uint32_t)hi_lo + lo_hi;
+    *high = hi_hi + (hi_lo >> 32) + (cross >> 32);
+    return (cross << 32) | (uint32_t)lo_lo;
+#endif
+}
+
+static inline uint64_t multiply_high(uint64_t a, uint64_t b) {
+    uint64_t high;
+    (void)multiply_128(a, b, &high);
+    return high;
+}
+
+// floor(e * log10(2)), floor(e * log10(3/4 * 2)) and floor(e * log2(10)) over
+// the exponents of doubles; the shifts of negative values are arithmetic
+static inline int floor_log10_pow2(int e) {
+    return (int)((int64_t)e * 661971961083 >> 41);
+}
+
+static inline int floor_log10_three_quarters_pow2(int e) {
+    return (int)(((int64_t)e * 661971961083 - 274743187321) >> 41);
+}
+
+static inline int floor_log2_pow10(int e) {
+    return (int)((int64_t)e * 913124641741 >> 38);
+}
+
+#define MASK_63 ((uint64_t)INT64_MAX)
+
+// Schubfach's rounding-odd product of the 126-bit 10^-k cut into
+// g1 * 2^63 + g0 with cp, keeping the bits Schubfach compares
+static inline uint64_t schubfach_round_odd(uint64_t g1, uint64_t g0, uint64_t cp) {
+    uint64_t x1 = multiply_high(g0, cp);
+    uint64_t y0 = g1 * cp;
+    uint64_t y1 = multiply_high(g1, cp);
+    uint64_t z = (y0 >> 1) + x1;
+    uint64_t vbp = y1 + (z >> 63);
+    return vbp | (((z & MASK_63) + MASK_63) >> 63);
+}
+
+// The value c * 2^q as the shortest digits * 10^exponent inside its
+// rounding interval, following Giulietti's Schubfach. A second length is
+// tried for two-digit results too, since nothing here wants at least two.
+static uint64_t schubfach(int q, uint64_t c, int* exponent) {
+    const int q_min = -1074;
+    const uint64_t c_min = 1ull << 52;
+    
+    uint64_t out = c & 1;
+    uint64_t cb = c << 2;
+    uint64_t cbr = cb + 2;
+    uint64_t cbl;
+    int k;
+    if (c != c_min || q == q_min) {
+        cbl = cb - 2;
+        k = floor_log10_pow2(q);
+    } else {
+        cbl = cb - 1;   // The interval below a power of two is half as wide
+        k = floor_log10_three_quarters_pow2(q);
+    }
+    int h = q + floor_log2_pow10(-k) + 2;
+    
+    // 10^-k to 126 bits, rounded up
+    const uint64_t* t = pow10_128[-k - POW10_MIN];
+    uint64_t g_hi = t[0] >> 2;
+    uint64_t g_lo = (t[0] << 62 | t[1] >> 2) + 1;
+    g_hi += g_lo == 0;
+    uint64_t g1 = g_hi << 1 | g_lo >> 63;
+    uint64_t g0 = g_lo & MASK_63;
+    
+    uint64_t vb = schubfach_round_odd(g1, g0, cb << h);
+    uint64_t vbl = schubfach_round_odd(g1, g0, cbl << h);
+    uint64_t vbr = schubfach_round_odd(g1, g0, cbr << h);
+    
+    uint64_t s = vb >> 2;
+    if (s >= 10) {
+        uint64_t sp10 = s / 10 * 10;
+        uint64_t tp10 = sp10 + 10;
+        bool upin = vbl + out <= sp10 << 2;
+        bool wpin = (tp10 << 2) + out <= vbr;
+        if (upin != wpin) {
+            *exponent = k;
+            return upin ? sp10 : tp10;
+        }
+    }
+    
+    uint64_t next = s + 1;
+    bool uin = vbl + out <= s << 2;
+    bool win = (next << 2) + out <= vbr;
+    *exponent = k;
+    if (uin != win) return uin ? s : next;
+    
+    // Both bounds in: pick the closer, ties to even
+    uint64_t mid = (s + next) << 1;
+    return vb < mid || (vb == mid && (s & 1) == 0) ? s : next;
+}
+
+// Shortest digits * 10^exponent of a finite, nonzero magnitude
+static uint64_t shortest_decimal(uint64_t bits, int* exponent) {
+    uint64_t fraction = bits & ((1ull << 52) - 1);
+    int biased = (int)(bits >> 52 & 0x7FF);
+    if (biased == 0) return schubfach(-1074, fraction, exponent);
+    
+    int shift = 1075 - biased;
+    uint64_t c = (1ull << 52) | fraction;
+    if (shift > 0 && shift < 53 && (c >> shift << shift) == c) {
+        *exponent = 0;      // Integers below 2^53 are exact
+        return c >> shift;
+    }
+    return schubfach(-shift, c, exponent);
+}
+
+// Longest output: a sign, 17 digits, "e-308" and a point
+#define DOUBLE_CHARS_MAX 32
+
+// Format like JavaScript's Number.prototype.toString: positional notation
+// for decimal exponents from -7 to 20, scientific ("1e+21", "2.5e-8") beyond
+static size_t format_double(char* out, double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    char* p = out;
+    if (bits >> 63) *p++ = '-';
+    bits &= ~(1ull << 63);
+    
+    if (bits >= 0x7FF0000000000000ull) {
+        if (bits > 0x7FF0000000000000ull) {
+            memcpy(out, "nan", 3);  // The sign of a NaN carries no meaning
+            return 3;
+        }
+        memcpy(p, "inf", 3);
+        return (size_t)(p - out) + 3;
+    }
+    if (bits == 0) {
+        *p = '0';
+        return (size_t)(p - out) + 1;
+    }
+    
+    int exponent;
+    uint64_t digits = shortest_decimal(bits, &exponent);
+    while (digits % 10 == 0) {
+        digits /= 10;
+        exponent++;
+    }
+    int count = (int)decimal_digits(digits);
+    int point = count + exponent;       // Digits before the decimal point
+    
+    if (point >= count && point <= 21) {
+        write_decimal(p + count, digits);
+        memset(p + count, '0', (size_t)(point - count));
+        p += point;
+    } else if (point > 0 && point <= 21) {
+        write_decimal(p + count + 1, digits);
+        memmove(p, p + 1, (size_t)point);
+        p[point] = '.';
+        p += count + 1;
+    } else if (point > -6 && point <= 0) {
+        p[0] = '0';
+        p[1] = '.';
+        memset(p + 2, '0', (size_t)-point);
+        p += 2 - point;
+        write_decimal(p + count, digits);
+        p += count;
+    } else {
+        write_decimal(p + count + 1, digits);
+        p[0] = p[1];
+        p[1] = '.';
+        p += count == 1 ? 1 : count + 1;
+        int scientific = point - 1;
+        *p++ = 'e';
+        *p++ = scientific < 0 ? '-' : '+';
+        unsigned magnitude = (unsigned)(scientific < 0 ? -scientific : scientific);
+        unsigned width = decimal_digits(magnitude);
+        write_decimal(p + width, magnitude);
+        p += width;
+    }
+    return (size_t)(p - out);
+}
+
+bool string_append_double(string* str, double value) {
+    if (!str) return false;
+    char buffer[DOUBLE_CHARS_MAX];
+    return append_bytes(str, buffer, format_double(buffer, value));
+}
+
+// Eight ASCII digits packed little-endian
+static inline bool is_eight_digits(uint64_t chunk) {
+    return ((chunk & 0xF0F0F0F0F0F0F0F0ull) |
+            (((chunk + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4)) == 0x3333333333333333ull;
+}
+
+static inline uint32_t parse_eight_digits(uint64_t chunk) {
+    chunk -= 0x3030303030303030ull;
+    chunk = chunk * 10 + (chunk >> 8);
+    chunk = (((chunk & 0x000000FF000000FFull) * (100 + (1000000ull << 32))) +
+             (((chunk >> 16) & 0x000000FF000000FFull) * (1 + (10000ull << 32)))) >> 32;
+    return (uint32_t)chunk;
+}
+
+// Decimal digits of [p, end) as an unsigned value; EINVAL for anything but
+// one or more digits, ERANGE if they do not fit
+static bool parse_unsigned(const char* p, const char* end, uint64_t* value) {
+    if (p == end) {
+        errno = EINVAL;
+        return false;
+    }
+    
+    uint64_t v = 0;
+    bool overflow = false;
+    while (end - p >= 8) {
+        uint64_t chunk = hash_read8((const unsigned char*)p);
+        if (!is_eight_digits(chunk)) break;
+        overflow |= __builtin_mul_overflow(v, 100000000, &v);
+        overflow |= __builtin_add_overflow(v, parse_eight_digits(chunk), &v);
+        p += 8;
+    }
+    for (; p < end; p++) {
+        unsigned digit = (unsigned)(unsigned char)*p - '0';
+        if (digit > 9) {
+            errno = EINVAL;
+            return false;
+        }
+        overflow |= __builtin_mul_overflow(v, 10, &v);
+        overflow |= __builtin_add_overflow(v, digit, &v);
+    }
+    if (overflow) {
+        errno = ERANGE;
+        return false;
+    }
+    *value = v;
+    return true;
+}
+
+bool string_view_to_uint64(string_view view, uint64_t* value) {
+    if (!value || (!view.data && view.length)) {
+        errno = EINVAL;
+        return false;
+    }
+    const char* p = view.data;
+    const char* end = p + view.length;
+    if (p != end && *p == '+') p++;
+    return parse_unsigned(p, end, value);
+}
+
+bool string_view_to_int64(string_view view, int64_t* value) {
+    if (!value || (!view.data && view.length)) {
+        errno = EINVAL;
+        return false;
+    }
+    const char* p = view.data;
+    const char* end = p + view.length;
+    bool negative = p != end && *p == '-';
+    if (p != end && (*p == '-' || *p == '+')) p++;
+    
+    uint64_t magnitude;
+    if (!parse_unsigned(p, end, &magnitude)) return false;
+    if (magnitude > (uint64_t)INT64_MAX + negative) {
+        errno = ERANGE;
+        return false;
+    }
+    *value = negative ? (int64_t)(0 - magnitude) : (int64_t)magnitude;
+    return true;
+}
+
+bool string_to_uint64(const string* str, uint64_t* value) {
+    if (!str) {
+        errno = EINVAL;
+        return false;
+    }
+    return string_view_to_uint64(string_as_view(str), value);
+}
+
+bool string_to_int64(const string* str, int64_t* value) {
+    if (!str) {
+        errno = EINVAL;
+        return false;
+    }
+    return string_view_to_int64(string_as_view(str), value);
+}
+
+// Exact decimal for the inputs the fast paths cannot settle: the digits are
+// scaled by powers of two until the value sits in [1/2, 1), then the
+// mantissa is read off with round-half-even, as in Go's strconv
+#define DECIMAL_DIGITS 800
+
+typedef struct {
+    unsigned char digits[DECIMAL_DIGITS];   // Values 0 to 9, most significant first
+    int count;
+    int point;          // Position of the decimal point relative to digits
+    bool truncated;     // Nonzero digits were dropped past DECIMAL_DIGITS
+} exact_decimal;
+
+static void exact_trim(exact_decimal* d) {
+    while (d->count > 0 && d->digits[d->count - 1] == 0) d->count--;
+    if (d->count == 0) d->point = 0;
+}
+
+// Multiply by 2^shift, shift at most 60
+static void exact_left_shift(exact_decimal* d, unsigned shift) {
+    unsigned char out[DECIMAL_DIGITS + 20];
+    int w = (int)sizeof(out);
+    uint64_t n = 0;
+    for (int r = d->count - 1; r >= 0; r--) {
+        n += (uint64_t)d->digits[r] << shift;
+        out[--w] = (unsigned char)(n % 10);
+        n /= 10;
+    }
+    while (n > 0) {
+        out[--w] = (unsigned char)(n % 10);
+        n /= 10;
+    }
+    
+    int produced = (int)sizeof(out) - w;
+    int kept = produced < DECIMAL_DIGITS ? produced : DECIMAL_DIGITS;
+    for (int i = kept; i < produced; i++) d->truncated |= out[w + i] != 0;
+    memcpy(d->digits, out + w, (size_t)kept);
+    d->point += produced - d->count;
+    d->count = kept;
+    exact_trim(d);
+}
+
+// Divide by 2^shift, shift at most 60
+static void exact_right_shift(exact_decimal* d, unsigned shift) {
+    int r = 0;
+    int w = 0;
+    uint64_t n = 0;
+    
+    // Pick up enough leading digits for the first quotient digit
+    for (; n >> shift == 0; r++) {
+        if (r >= d->count) {
+            if (n == 0) {
+                d->count = 0;
+                d->point = 0;
+                return;
+            }
+            while (n >> shift == 0) {
+                n *= 10;
+                r++;
+            }
+            break;
+        }
+        n = n * 10 + d->digits[r];
+    }
+    d->point -= r - 1;
+    
+    uint64_t mask = (1ull << shift) - 1;
+    for (; r < d->count; r++) {
+        d->digits[w++] = (unsigned char)(n >> shift);
+        n = (n & mask) * 10 + d->digits[r];
+    }
+    while (n > 0) {
+        unsigned char digit = (unsigned char)(n >> shift);
+        if (w < DECIMAL_DIGITS) {
+            d->digits[w++] = digit;
+        } else if (digit > 0) {
+            d->truncated = true;
+        }
+        n = (n & mask) * 10;
+    }
+    d->count = w;
+    exact_trim(d);
+}
+
+static void exact_shift(exact_decimal* d, int shift) {
+    if (d->count == 0) return;
+    for (; shift > 60; shift -= 60) exact_left_shift(d, 60);
+    for (; shift < -60; shift += 60) exact_right_shift(d, 60);
+    if (shift > 0) exact_left_shift(d, (unsigned)shift);
+    if (shift < 0) exact_right_shift(d, (unsigned)-shift);
+}
+
+// Integer part, rounded half to even; the caller keeps it below 2^54
+static uint64_t exact_rounded_integer(const exact_decimal* d) {
+    uint64_t n = 0;
+    int i = 0;
+    for (; i < d->point && i < d->count; i++) n = n * 10 + d->digits[i];
+    for (; i < d->point; i++) n *= 10;
+    
+    int next = d->point;
+    if (next >= 0 && next < d->count) {
+        bool halfway = d->digits[next] == 5 && next + 1 == d->count && !d->truncated;
+        if (halfway ? next > 0 && (d->digits[next - 1] & 1) : d->digits[next] >= 5) n++;
+    }
+    return n;
+}
+
+// Bits of the magnitude of d, which is trimmed; infinity on overflow
+static uint64_t exact_to_bits(exact_decimal* d) {
+    static const unsigned char steps[] = { 1, 3, 6, 9, 13, 16, 19, 23, 26 };
+    if (d->count == 0 || d->point < -330) return 0;
+    if (d->point > 310) return 0x7FF0000000000000ull;
+    
+    // Bring the value into [1/2, 1)
+    int exponent = 0;
+    while (d->point > 0) {
+        int step = d->point >= (int)sizeof(steps) ? 27 : steps[d->point];
+        exact_shift(d, -step);
+        exponent += step;
+    }
+    while (d->point < 0 || (d->point == 0 && d->digits[0] < 5)) {
+        int step = -d->point >= (int)sizeof(steps) ? 27 : steps[-d->point];
+        exact_shift(d, step);
+        exponent -= step;
+    }
+    exponent--;     // Now in [1, 2) times 2^exponent
+    
+    // Subnormals keep the minimum exponent and lose mantissa bits instead
+    if (exponent < -1022) {
+        exact_shift(d, exponent + 1022);
+        exponent = -1022;
+    }
+    if (exponent > 1023) return 0x7FF0000000000000ull;
+    
+    exact_shift(d, 53);
+    uint64_t mantissa = exact_rounded_integer(d);
+    if (mantissa == 2ull << 52) {
+        mantissa >>= 1;
+        if (++exponent > 1023) return 0x7FF0000000000000ull;
+    }
+    if ((mantissa & (1ull << 52)) == 0) return mantissa;    // Subnormal
+    return (uint64_t)(exponent + 1023) << 52 | (mantissa & ((1ull << 52) - 1));
+}
+
+// Eisel-Lemire: the correctly rounded bits of mantissa * 10^exponent from
+// one or two 64x128-bit products, or false when those cannot decide
+static bool eisel_lemire(uint64_t mantissa, int exponent, uint64_t* bits) {
+    if (exponent < POW10_MIN || exponent > 308) return false;
+    
+    int clz = __builtin_clzll(mantissa);
+    mantissa <<= clz;
+    uint64_t result_exponent = (uint64_t)(((217706 * (int64_t)exponent) >> 16) + 64 + 1023 - clz);
+    
+    const uint64_t* power = pow10_128[exponent - POW10_MIN];
+    uint64_t x_hi;
+    uint64_t x_lo = multiply_128(mantissa, power[0], &x_hi);
+    if ((x_hi & 0x1FF) == 0x1FF && x_lo + mantissa < mantissa) {
+        // The truncated power may be too low; widen with its low half
+        uint64_t y_hi;
+        uint64_t y_lo = multiply_128(mantissa, power[1], &y_hi);
+        uint64_t merged_hi = x_hi;
+        uint64_t merged_lo = x_lo + y_hi;
+        merged_hi += merged_lo < x_lo;
+        if ((merged_hi & 0x1FF) == 0x1FF && merged_lo + 1 == 0 && y_lo + mantissa < mantissa) return false;
+        x_hi = merged_hi;
+        x_lo = merged_lo;
+    }
+    
+    uint64_t msb = x_hi >> 63;
+    uint64_t result = x_hi >> (msb + 9);
+    result_exponent -= 1 ^ msb;
+    if (x_lo == 0 && (x_hi & 0x1FF) == 0 && (result & 3) == 1) return false;    // Halfway
+    
+    result += result & 1;
+    result >>= 1;
+    if (result >> 53) {
+        result >>= 1;
+        result_exponent++;
+    }
+    if (result_exponent - 1 >= 0x7FF - 1) return false;     // Subnormal or overflow
+    *bits = result_exponent << 52 | (result & ((1ull << 52) - 1));
+    return true;
+}
+
+// Doubles that are exact, for Clinger's fast path
+static const double pow10_double[23] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// Case-insensitive match of word at p
+static inline bool match_word(const char* p, const char* end, const char* word, size_t len) {
+    return (size_t)(end - p) == len && icase_compare_bytes(p, word, len) == 0;
+}
+
+bool string_view_to_double(string_view view, double* value) {
+    if (!value || (!view.data && view.length)) {
+        errno = EINVAL;
+        return false;
+    }
+    const char* p = view.data;
+    const char* end = p + view.length;
+    bool negative = p != end && *p == '-';
+    if (p != end && (*p == '-' || *p == '+')) p++;
+    uint64_t sign = (uint64_t)negative << 63;
+    uint64_t bits;
+    
+    if (match_word(p, end, "inf", 3) || match_word(p, end, "infinity", 8)) {
+        bits = sign | 0x7FF0000000000000ull;
+        memcpy(value, &bits, sizeof(bits));
+        return true;
+    }
+    if (match_word(p, end, "nan", 3)) {
+        bits = sign | 0x7FF8000000000000ull;
+        memcpy(value, &bits, sizeof(bits));
+        return true;
+    }
+    
+    // Up to 19 significant digits go into mantissa; the rest only need to
+    // be known as present
+    const char* digits_start = p;
+    uint64_t mantissa = 0;
+    int significant = 0;
+    int dropped = 0;            // Integer digits past the 19 kept
+    int fraction = 0;           // Fraction digits kept
+    bool truncated = false;
+    for (; p < end && (unsigned)(*p - '0') <= 9; p++) {
+        if (significant < 19) {
+            mantissa = mantissa * 10 + (unsigned)(*p - '0');
+            significant += mantissa != 0;
+        } else {
+            dropped++;
+            truncated |= *p != '0';
+        }
+    }
+    size_t integer_digits = (size_t)(p - digits_start);
+    size_t fraction_digits = 0;
+    const char* fraction_start = NULL;
+    if (p < end && *p == '.') {
+        fraction_start = ++p;
+        for (; p < end && (unsigned)(*p - '0') <= 9; p++) {
+            if (significant < 19) {
+                mantissa = mantissa * 10 + (unsigned)(*p - '0');
+                significant += mantissa != 0;
+                fraction++;
+            } else {
+                truncated |= *p != '0';
+            }
+        }
+        fraction_digits = (size_t)(p - fraction_start);
+    }
+    if (integer_digits + fraction_digits == 0) {
+        errno = EINVAL;
+        return false;
+    }
+    
+    int64_t exponent = 0;
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        bool exponent_negative = p != end && *p == '-';
+        if (p != end && (*p == '-' || *p == '+')) p++;
+        if (p == end) {
+            errno = EINVAL;
+            return false;
+        }
+        for (; p < end && (unsigned)(*p - '0') <= 9; p++) {
+            if (exponent < 100000) exponent = exponent * 10 + (*p - '0');
+        }
+        if (exponent_negative) exponent = -exponent;
+    }
+    if (p != end) {
+        errno = EINVAL;
+        return false;
+    }
+    
+    int decimal_exponent = (int)exponent + dropped - fraction;
+    if (mantissa == 0 && !truncated) {
+        bits = sign;
+        memcpy(value, &bits, sizeof(bits));
+        return true;
+    }
+    
+#if FLT_EVAL_METHOD == 0
+    // Both operands exact, so one correctly rounded operation is the answer
+    if (!truncated && mantissa <= (1ull << 53) && decimal_exponent >= -22 && decimal_exponent <= 22) {
+        double result = (double)mantissa;
+        result = decimal_exponent < 0 ? result / pow10_double[-decimal_exponent]
+                                      : result * pow10_double[decimal_exponent];
+        *value = negative ? -result : result;
+        return true;
+    }
+#endif
+    
+    // Dropped digits put the value between mantissa and mantissa + 1
+    if (mantissa != 0 && eisel_lemire(mantissa, decimal_exponent, &bits)) {
+        uint64_t upper;
+        if (!truncated || (mantissa + 1 != 0 && eisel_lemire(mantissa + 1, decimal_exponent, &upper) && upper == bits)) {
+            bits |= sign;
+            memcpy(value, &bits, sizeof(bits));
+            return true;
+        }
+    }
+    
+    // Exact decimal over every digit
+    exact_decimal d;
+    d.count = 0;
+    d.truncated = false;
+    int64_t point = 0;
+    bool in_fraction = false;
+    for (const char* q = digits_start; q < end && *q != 'e' && *q != 'E'; q++) {
+        if (*q == '.') {
+            in_fraction = true;
+        } else if (*q == '0' && d.count == 0) {
+            point -= in_fraction;       // Leading zeros only move the point
+        } else {
+            point += !in_fraction && point < 100000;
+            if (d.count < DECIMAL_DIGITS) {
+                d.digits[d.count++] = (unsigned char)(*q - '0');
+            } else {
+                d.truncated |= *q != '0';
+            }
+        }
+    }
+    point += exponent;
+    d.point = (int)(point < -100000 ? -100000 : point > 100000 ? 100000 : point);
+    exact_trim(&d);
+    
+    bits = exact_to_bits(&d);
+    if (bits == 0x7FF0000000000000ull) {
+        errno = ERANGE;
+        return false;
+    }
+    bits |= sign;
+    memcpy(value, &bits, sizeof(bits));
+    return true;
+}
+
+bool string_to_double(const string* str, double* value) {
+    if (!str) {
+        errno = EINVAL;
+        return false;
+    }
+    return string_view_to_double(string_as_view(str), value);
+}
+
+// Escaping and unescaping. Each encoder finds the bytes that need work with
+// the byte-set kernels, sizes the output in one counting pass and then
+// copies the clean runs between those bytes in bulk. Decoders never grow
+// their input, so they reserve its length once and locate escapes with
+// the same kernels.
+
+// '"', '\\' and every control byte below 0x20, as string_byte_set_from
+// would build it
+static const byte_set json_escape_set = {
+    .bits = { 0xFFFFFFFFull | (1ull << '"'), 1ull << ('\\' - 64) },
+    .low_rows = { 3, 3, 3 | 1 << ('"' >> 4), 3, 3, 3, 3, 3,
+                  3, 3, 3, 3, 3 | 1 << ('\\' >> 4), 3, 3, 3 },
+};
+
+// Bytes that force quoting in a CSV field
+static const byte_set csv_quote_set = {
+    .bits = { (1ull << ',') | (1ull << '"') | (1ull << '\n') | (1ull << '\r') },
+    .low_rows = { [',' & 15] = 1 << (',' >> 4), ['"' & 15] = 1 << ('"' >> 4), ['\n'] = 1, ['\r'] = 1 },
+};
+
+// RFC 3986 unreserved bytes, the only ones a URL encoder copies unchanged:
+// ALPHA, DIGIT, '-', '.', '_' and '~'
+static const byte_set url_unreserved_set = {
+    .bits = { 0x03FF600000000000ull, 0x47FFFFFE87FFFFFEull },
+    .low_rows = { 0xA8, 0xF8, 0xF8, 0xF8, 0xF8, 0xF8, 0xF8, 0xF8,
+                  0xF8, 0xF8, 0xF0, 0x50, 0x50, 0x54, 0xD4, 0x70 },
+};
+
+// Bytes a URL decoder has to look at, without and with STRING_URL_FORM
+static const byte_set url_percent_set = {
+    .bits = { 1ull << '%' },
+    .low_rows = { ['%' & 15] = 1 << ('%' >> 4) },
+};
+static const byte_set url_form_set = {
+    .bits = { (1ull << '%') | (1ull << '+') },
+    .low_rows = { ['%' & 15] = 1 << ('%' >> 4), ['+' & 15] = 1 << ('+' >> 4) },
+};
+
+static const char hex_lower[16] = "0123456789abcdef";
+static const char hex_upper[16] = "0123456789ABCDEF";
+
+// Value of a hex digit, or -1
+static inline int hex_value(unsigned char c) {
+    if ((unsigned)(c - '0') < 10) return c - '0';
+    c |= 0x20;
+    if ((unsigned)(c - 'a') < 6) return c - 'a' + 10;
+    return -1;
+}
+
+// Next member of set in [data, end), or end
+static inline const char* next_member(const char* data, const char* end, const byte_set* set) {
+    size_t len = (size_t)(end - data);
+    const char* hit = len ? kernels_for(len)->find_any(data, len, set) : NULL;
+    return hit ? hit : end;
+}
+
+// Re-point a source view after the buffer it aliases may have moved
+static inline const char* rebase_source(const string* str, const char* data,
+                                        bool aliased, size_t offset) {
+    return aliased ? STRING_DATA(str) + offset : data;
+}
+
+// Short escapes for the control bytes JSON names, 0 for the \u00XX forms
+static inline char json_short_escape(unsigned char c) {
+    switch (c) {
+        case '"': return '"';
+        case '\\': return '\\';
+        case '\b': return 'b';
+        case '\f': return 'f';
+        case '\n': return 'n';
+        case '\r': return 'r';
+        case '\t': return 't';
+        default: return 0;
+    }
+}
+
+bool string_append_json_escaped(string* str, string_view sv) {
+    if (!str || (!sv.data && sv.length)) return false;
+    
+    const char* end = sv.data + sv.length;
+    size_t extra = 0;
+    for (const char* p = next_member(sv.data, end, &json_escape_set); p < end;
+         p = next_member(p + 1, end, &json_escape_set)) {
+        extra += json_short_escape((unsigned char)*p) ? 1 : 5;
+    }
+    if (!extra) return append_bytes(str, sv.data, sv.length);
+    
+    size_t count;
+    if (__builtin_add_overflow(sv.length, extra, &count)) {
+        errno = EOVERFLOW;
+        return false;
+    }
+    bool aliased = aliases_string(str, sv.data);
+    size_t offset = aliased ? (size_t)(sv.data - STRING_DATA(str)) : 0;
+    char* out = append_space(str, count);
+    if (!out) return false;
+    
+    const char* src = rebase_source(str, sv.data, aliased, offset);
+    end = src + sv.length;
+    while (src < end) {
+        const char* p = next_member(src, end, &json_escape_set);
+        memcpy(out, src, (size_t)(p - src));
+        out += p - src;
+        if (p == end) break;
+        
+        unsigned char c = (unsigned char)*p;
+        char short_form = json_short_escape(c);
+        *out++ = '\\';
+        if (short_form) {
+            *out++ = short_form;
+        } else {
+            memcpy(out, "u00", 3);
+            out[3] = hex_lower[c >> 4];
+            out[4] = hex_lower[c & 15];
+            out += 5;
+        }
+        src = p + 1;
+    }
+    set_length(str, STRING_LENGTH(str) + count);
+    return true;
+}
+
+// Four hex digits of a \u escape, or -1
+static inline long json_code_unit(const char* p, const char* end) {
+    if (end - p < 4) return -1;
+    long unit = 0;
+    for (int i = 0; i < 4; i++) {
+        int digit = hex_value((unsigned char)p[i]);
+        if (digit < 0) return -1;
+        unit = unit << 4 | digit;
+    }
+    return unit;
+}
+
+// Write a code point as UTF-8 and return the bytes written
+static inline size_t write_utf8(char* out, uint32_t cp) {
+    if (cp < 0x80) {
+        out[0] = (char)cp;
+        return 1;
+    }
+    if (cp < 0x800) {
+        out[0] = (char)(0xC0 | cp >> 6);
+        out[1] = (char)(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        out[0] = (char)(0xE0 | cp >> 12);
+        out[1] = (char)(0x80 | (cp >> 6 & 0x3F));
+        out[2] = (char)(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    out[0] = (char)(0xF0 | cp >> 18);
+    out[1] = (char)(0x80 | (cp >> 12 & 0x3F));
+    out[2] = (char)(0x80 | (cp >> 6 & 0x3F));
+    out[3] = (char)(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+// Decode [src, end) into out, where p is the first backslash. Returns the
+// end of the output, or NULL at a malformed escape.
+static char* json_unescape_bytes(char* out, const char* src, const char* p, const char* end) {
+    for (;;) {
+        memcpy(out, src, (size_t)(p - src));
+        out += p - src;
+        if (p == end) return out;
+        if (end - p < 2) return NULL;
+        
+        char c = p[1];
+        src = p + 2;
+        switch (c) {
+            case '"': case '\\': case '/': *out++ = c; break;
+            case 'b': *out++ = '\b'; break;
+            case 'f': *out++ = '\f'; break;
+            case 'n': *out++ = '\n'; break;
+            case 'r': *out++ = '\r'; break;
+            case 't': *out++ = '\t'; break;
+            case 'u': {
+                long unit = json_code_unit(src, end);
+                if (unit < 0 || (unit >= 0xDC00 && unit <= 0xDFFF)) return NULL;
+                src += 4;
+                uint32_t cp = (uint32_t)unit;
+                // A high surrogate only counts as half of an escaped pair
+                if (unit >= 0xD800 && unit <= 0xDBFF) {
+                    long low = (end - src >= 2 && src[0] == '\\' && src[1] == 'u')
+                        ? json_code_unit(src + 2, end) : -1;
+                    if (low < 0xDC00 || low > 0xDFFF) return NULL;
+                    src += 6;
+                    cp = 0x10000 + ((uint32_t)(unit - 0xD800) << 10) + (uint32_t)(low - 0xDC00);
+                }
+                out += write_utf8(out, cp);
+                break;
+            }
+            default:
+                return NULL;
+        }
+        p = src < end ? memchr(src, '\\', (size_t)(end - src)) : NULL;
+        if (!p) p = end;
+    }
+}
+
+bool string_append_json_unescaped(string* str, string_view sv) {
+    if (!str || (!sv.data && sv.length)) return false;
+    
+    const char* first = sv.length ? memchr(sv.data, '\\', sv.length) : NULL;
+    if (!first) return append_bytes(str, sv.data, sv.length);
+    
+    size_t length = STRING_LENGTH(str);
+    bool aliased = aliases_string(str, sv.data);
+    size_t offset = aliased ? (size_t)(sv.data - STRING_DATA(str)) : 0;
+    // Every escape decodes to fewer bytes than it spans
+    char* out = append_space(str, sv.length);
+    if (!out) return false;
+    
+    const char* src = rebase_source(str, sv.data, aliased, offset);
+    char* stop = json_unescape_bytes(out, src, src + (first - sv.data), src + sv.length);
+    if (!stop) {
+        set_length(str, length);
+        errno = EINVAL;
+        return false;
+    }
+    set_length(str, (size_t)(stop - STRING_DATA(str)));
+    return true;
+}
+
+bool string_append_csv_quoted(string* str, string_view field) {
+    if (!str || (!field.data && field.length)) return false;
+    
+    const char* end = field.data + field.length;
+    if (next_member(field.data, end, &csv_quote_set) == end) {
+        return append_bytes(str, field.data, field.length);
+    }
+    
+    size_t count = field.length + 2;
+    for (const char* p = memchr(field.data, '"', field.length); p;
+         p = memchr(p + 1, '"', (size_t)(end - p - 1))) {
+        count++;
+    }
+    if (count < field.length) {
+        errno = EOVERFLOW;
+        return false;
+    }
+    bool aliased = aliases_string(str, field.data);
+    size_t offset = aliased ? (size_t)(field.data - STRING_DATA(str)) : 0;
+    char* out = append_space(str, count);
+    if (!out) return false;
+    
+    const char* src = rebase_source(str, field.data, aliased, offset);
+    end = src + field.length;
+    *out++ = '"';
+    while (src < end) {
+        const char* p = memchr(src, '"', (size_t)(end - src));
+        // Copy through the quote itself, then write its twin
+        const char* stop = p ? p + 1 : end;
+        memcpy(out, src, (size_t)(stop - src));
+        out += stop - src;
+        if (p) *out++ = '"';
+        src = stop;
+    }
+    *out = '"';
+    set_length(str, STRING_LENGTH(str) + count);
+    return true;
+}
+
+bool string_append_csv_unquoted(string* str, string_view field) {
+    if (!str || (!field.data && field.length)) return false;
+    if (!field.length || field.data[0] != '"') {
+        return append_bytes(str, field.data, field.length);
+    }
+    if (field.length < 2 || field.data[field.length - 1] != '"') {
+        errno = EINVAL;
+        return false;
+    }
+    
+    size_t length = STRING_LENGTH(str);
+    size_t inner = field.length - 2;
+    bool aliased = aliases_string(str, field.data);
+    size_t offset = aliased ? (size_t)(field.data - STRING_DATA(str)) : 0;
+    char* out = append_space(str, inner);
+    if (!out) return false;
+    
+    const char* src = rebase_source(str, field.data, aliased, offset) + 1;
+    const char* end = src + inner;
+    while (src < end) {
+        const char* p = memchr(src, '"', (size_t)(end - src));
+        if (!p) p = end;
+        memcpy(out, src, (size_t)(p - src));
+        out += p - src;
+        if (p == end) break;
+        // Inside the quotes a quote only appears doubled
+        if (end - p < 2 || p[1] != '"') {
+            set_length(str, length);
+            errno = EINVAL;
+            return false;
+        }
+        *out++ = '"';
+        src = p + 2;
+    }
+    set_length(str, (size_t)(out - STRING_DATA(str)));
+    return true;
+}
+
+// After each clean run the URL coders take this many bytes one at a time,
+// without branching on their class, before searching again. Text with a
+// reserved byte every few characters would otherwise pay a mispredicted
+// run end for each one.
+#define URL_BLOCK 16
+
+// Encoded size of one byte
+static inline size_t url_width(unsigned char c, bool form) {
+    return (byte_set_contains(&url_unreserved_set, c) || (form && c == ' ')) ? 1 : 3;
+}
+
+bool string_append_url_encoded(string* str, string_view sv, unsigned flags) {
+    if (!str || (!sv.data && sv.length)) return false;
+    if (!sv.length) return true;
+    
+    const string_kernels* kernels = kernels_for(sv.length);
+    bool form = flags & STRING_URL_FORM;
+    size_t extra = 0;
     size_t i = 0;
-    __m128i lower_a = _mm_set1_epi8('a');
-    __m128i lower_z = _mm_set1_epi8('z');
-    __m128i to_upper = _mm_set1_epi8('A' - 'a');
+    while (i < sv.length) {
+        i += kernels->span(sv.data + i, sv.length - i, &url_unreserved_set);
+        size_t stop = sv.length - i > URL_BLOCK ? i + URL_BLOCK : sv.length;
+        for (; i < stop; i++) extra += url_width((unsigned char)sv.data[i], form) - 1;
+    }
     
-    for (; i + 16 <= len; i += 16) {
-        __m128i chars = _mm_loadu_si128((__m128i*)(data + i));
+    // The block loop stores three bytes for every input byte, so it needs
+    // two bytes of slack past the terminator
+    size_t count, reserve;
+    if (__builtin_add_overflow(sv.length, extra, &count) ||
+        __builtin_add_overflow(count, 2, &reserve)) {
+        errno = EOVERFLOW;
+        return false;
+    }
+    bool aliased = aliases_string(str, sv.data);
+    size_t offset = aliased ? (size_t)(sv.data - STRING_DATA(str)) : 0;
+    char* out = append_space(str, reserve);
+    if (!out) return false;
+    
+    const char* src = rebase_source(str, sv.data, aliased, offset);
+    const char* end = src + sv.length;
+    while (src < end) {
+        size_t run = kernels->span(src, (size_t)(end - src), &url_unreserved_set);
+        memcpy(out, src, run);
+        out += run;
+        src += run;
+        const char* stop = end - src > URL_BLOCK ? src + URL_BLOCK : end;
+        for (; src < stop; src++) {
+            unsigned char c = (unsigned char)*src;
+            size_t width = url_width(c, form);
+            out[0] = width == 3 ? '%' : (c == ' ' ? '+' : (char)c);
+            out[1] = hex_upper[c >> 4];
+            out[2] = hex_upper[c & 15];
+            out += width;
+        }
+    }
+    set_length(str, STRING_LENGTH(str) + count);
+    return true;
+}
+
+// Decode [src, end) into out, which may be src itself. Returns the end of
+// the output, or NULL at a malformed percent escape.
+static char* url_decode_bytes(char* out, const char* src, const char* end, unsigned flags) {
+    bool form = flags & STRING_URL_FORM;
+    const byte_set* set = form ? &url_form_set : &url_percent_set;
+    while (src < end) {
+        const char* p = next_member(src, end, set);
+        if (out != src) memmove(out, src, (size_t)(p - src));
+        out += p - src;
+        src = p;
         
-        // Check which chars are in range 'a'..'z'
-        __m128i is_lower = _mm_and_si128(
-            _mm_cmpgt_epi8(chars, _mm_sub_epi8(lower_a, _mm_set1_epi8(1))),
-            _mm_cmpgt_epi8(_mm_add_epi8(lower_z, _mm_set1_epi8(1)), chars)
-        );
+        const char* stop = end - src > URL_BLOCK ? src + URL_BLOCK : end;
+        while (src < stop) {
+            char c = *src;
+            if (c != '%') {
+                *out++ = (form && c == '+') ? ' ' : c;
+                src++;
+                continue;
+            }
+            int high = end - src > 2 ? hex_value((unsigned char)src[1]) : -1;
+            int low = high >= 0 ? hex_value((unsigned char)src[2]) : -1;
+            if (low < 0) return NULL;
+            *out++ = (char)(high << 4 | low);
+            src += 3;
+        }
+    }
+    return out;
+}
+
+bool string_append_url_decoded(string* str, string_view sv, unsigned flags) {
+    if (!str || (!sv.data && sv.length)) return false;
+    if (!sv.length) return true;
+    
+    size_t length = STRING_LENGTH(str);
+    bool aliased = aliases_string(str, sv.data);
+    size_t offset = aliased ? (size_t)(sv.data - STRING_DATA(str)) : 0;
+    char* out = append_space(str, sv.length);
+    if (!out) return false;
+    
+    const char* src = rebase_source(str, sv.data, aliased, offset);
+    char* stop = url_decode_bytes(out, src, src + sv.length, flags);
+    if (!stop) {
+        set_length(str, length);
+        errno = EINVAL;
+        return false;
+    }
+    set_length(str, (size_t)(stop - STRING_DATA(str)));
+    return true;
+}
+
+bool string_url_decode(string* str, unsigned flags) {
+    if (!str) return false;
+    size_t length = STRING_LENGTH(str);
+    const byte_set* set = (flags & STRING_URL_FORM) ? &url_form_set : &url_percent_set;
+    const char* data = STRING_DATA(str);
+    const char* first = next_member(data, data + length, set);
+    if (first == data + length) return true;
+    
+    // Validate before touching the bytes so a failure leaves them intact;
+    // only a '%' can be malformed
+    const char* end = data + length;
+    for (const char* p = memchr(first, '%', (size_t)(end - first)); p;
+         p = memchr(p + 3, '%', (size_t)(end - p - 3))) {
+        if (end - p < 3 || hex_value((unsigned char)p[1]) < 0 || hex_value((unsigned char)p[2]) < 0) {
+            errno = EINVAL;
+            return false;
+        }
+    }
+    if (!unshare(str)) return false;
+    
+    char* buffer = STRING_DATA(str);
+    size_t prefix = (size_t)(first - data);
+    char* stop = url_decode_bytes(buffer + prefix, buffer + prefix, buffer + length, flags);
+    set_length(str, (size_t)(stop - buffer));
+    return true;
+}
+
+// Parallel bulk kernels. The buffer is cut into cache-sized chunks that
+// workers claim in order from a shared counter, so a slow core only delays
+// its current chunk and the earliest match is always searched first.
+#define PARALLEL_CHUNK_SIZE (256 * 1024)
+// Below this the threads cost more than they save, so callers run inline
+#define PARALLEL_MIN_SIZE (4 * PARALLEL_CHUNK_SIZE)
+#define PARALLEL_MAX_THREADS 64
+#define NO_MATCH SIZE_MAX
+
+// Greedy non-overlapping matches that start in one chunk
+typedef struct {
+    size_t count;
+    size_t first;               // Position of the first match, or NO_MATCH
+    size_t last_end;            // End of the last match; may lie in the next chunk
+} chunk_matches;
+
+typedef struct parallel_job {
+    void (*run)(struct parallel_job* job, size_t start, size_t end, size_t chunk);
+    char* data;
+    size_t length;
+    size_t chunks;
+    _Atomic size_t next_chunk;
+    void (*convert)(char* data, size_t len);   // Case conversion kernel
+    const search_needle* needle;
+    _Atomic size_t found;                      // Earliest match so far
+    chunk_matches* matches;                    // One entry per chunk for count
+} parallel_job;
+
+static void* parallel_worker(void* arg) {
+    parallel_job* job = arg;
+    for (;;) {
+        size_t chunk = atomic_fetch_add_explicit(&job->next_chunk, 1, memory_order_relaxed);
+        if (chunk >= job->chunks) return NULL;
         
-        // Convert to uppercase if in range
-        __m128i adjustment = _mm_and_si128(is_lower, to_upper);
-        __m128i result = _mm_add_epi8(chars, adjustment);
+        size_t start = chunk * PARALLEL_CHUNK_SIZE;
+        size_t end = job->length - start > PARALLEL_CHUNK_SIZE ? start + PARALLEL_CHUNK_SIZE : job->length;
+        job->run(job, start, end, chunk);
+    }
+}
+
+// Run worker on up to threads threads (0 for one per online CPU) and at most
+// tasks, the calling thread included. Threads that fail to start just leave
+// more work to the others.
+static void parallel_spawn(void* (*worker)(void*), void* arg, unsigned threads, size_t tasks) {
+    if (threads == 0) {
+#ifdef _SC_NPROCESSORS_ONLN
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = online > 0 ? (unsigned)online : 1;
+#else
+        threads = 1;
+#endif
+    }
+    if (threads > tasks) threads = (unsigned)tasks;
+    if (threads > PARALLEL_MAX_THREADS) threads = PARALLEL_MAX_THREADS;
+    
+    pthread_t workers[PARALLEL_MAX_THREADS];
+    unsigned started = 0;
+    while (started + 1 < threads && pthread_create(&workers[started], NULL, worker, arg) == 0) {
+        started++;
+    }
+    worker(arg);
+    for (unsigned i = 0; i < started; i++) pthread_join(workers[i], NULL);
+}
+
+static void parallel_run(parallel_job* job, unsigned threads) {
+    job->chunks = (job->length + PARALLEL_CHUNK_SIZE - 1) / PARALLEL_CHUNK_SIZE;
+    atomic_init(&job->next_chunk, 0);
+    parallel_spawn(parallel_worker, job, threads, job->chunks);
+}
+
+static void run_convert(parallel_job* job, size_t start, size_t end, [[maybe_unused]] size_t chunk) {
+    job->convert(job->data + start, end - start);
+}
+
+// First match starting in [from, end), reading at most needle length - 1
+// bytes past end
+static size_t next_match(const parallel_job* job, size_t from, size_t end) {
+    if (from >= end) return NO_MATCH;
+    
+    size_t limit = end + job->needle->length - 1;
+    if (limit > job->length) limit = job->length;
+    ptrdiff_t found = find_pattern(job->data + from, limit - from, job->needle);
+    return found < 0 ? NO_MATCH : from + (size_t)found;
+}
+
+static void run_find(parallel_job* job, size_t start, size_t end, [[maybe_unused]] size_t chunk) {
+    // Chunks are claimed in order, so a match already found before this one wins
+    if (atomic_load_explicit(&job->found, memory_order_relaxed) < start) return;
+    
+    size_t match = next_match(job, start, end);
+    size_t found = atomic_load_explicit(&job->found, memory_order_relaxed);
+    while (match < found &&
+           !atomic_compare_exchange_weak_explicit(&job->found, &found, match,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+static void run_count(parallel_job* job, size_t start, size_t end, size_t chunk) {
+    chunk_matches* result = &job->matches[chunk];
+    *result = (chunk_matches){ 0, NO_MATCH, start };
+    
+    for (size_t pos = next_match(job, start, end); pos != NO_MATCH;
+         pos = next_match(job, pos + job->needle->length, end)) {
+        if (!result->count) result->first = pos;
+        result->count++;
+        result->last_end = pos + job->needle->length;
+    }
+}
+
+// Chunks are counted from their own start, so a match running over a chunk
+// boundary can invalidate the next chunk's first match. Walk that chunk's
+// matches alongside the true ones until both land on the same position,
+// after which they agree; this only scans far for periodic text like "aaaa".
+static size_t count_merge(const parallel_job* job) {
+    size_t total = 0;
+    size_t valid_end = 0;       // End of the last match counted so far
+    
+    for (size_t chunk = 0; chunk < job->chunks; chunk++) {
+        const chunk_matches* result = &job->matches[chunk];
+        if (result->first >= valid_end) {
+            total += result->count;
+            if (result->count) valid_end = result->last_end;
+            continue;
+        }
         
-        _mm_storeu_si128((__m128i*)(data + i), result);
+        size_t end = chunk + 1 < job->chunks ? (chunk + 1) * PARALLEL_CHUNK_SIZE : job->length;
+        size_t count = result->count;
+        size_t own = result->first;
+        size_t actual = next_match(job, valid_end, end);
+        while (own != actual) {
+            if (own < actual) {
+                count--;
+                own = next_match(job, own + job->needle->length, end);
+            } else {
+                count++;
+                valid_end = actual + job->needle->length;
+                actual = next_match(job, valid_end, end);
+            }
+        }
+        total += count;
+        if (actual != NO_MATCH) valid_end = result->last_end;
+    }
+    return total;
+}
+
+static void convert_parallel(string* str, unsigned threads, bool upper) {
+    if (!str || !STRING_LENGTH(str) || !unshare(str)) return;
+    
+    const string_kernels* kernels = kernels_for(STRING_LENGTH(str));
+    if (STRING_LENGTH(str) < PARALLEL_MIN_SIZE || threads == 1) {
+        (upper ? kernels->to_upper : kernels->to_lower)(STRING_DATA(str), STRING_LENGTH(str));
+        invalidate_hash(str);
+        return;
+    }
+    
+    parallel_job job = {
+        .run = run_convert,
+        .data = STRING_DATA(str),
+        .length = STRING_LENGTH(str),
+        .convert = upper ? kernels->to_upper : kernels->to_lower,
+    };
+    parallel_run(&job, threads);
+    invalidate_hash(str);
+}
+
+void string_to_upper_parallel(string* str, unsigned threads) {
+    convert_parallel(str, threads, true);
+}
+
+void string_to_lower_parallel(string* str, unsigned threads) {
+    convert_parallel(str, threads, false);
+}
+
+// Shared by find and count: the needle is prepared once for every worker
+static void search_job_init(parallel_job* job, two_way_table* table, search_needle* pattern,
+                            const string* str, string_view needle) {
+    *pattern = (search_needle){ needle.data, needle.length, NULL };
+    if (needle.length > 1) {
+        two_way_prepare(table, needle.data, needle.length, false);
+        pattern->table = table;
+    }
+    *job = (parallel_job){
+        .data = (char*)STRING_DATA(str),
+        .length = STRING_LENGTH(str),
+        .needle = pattern,
+    };
+}
+
+ptrdiff_t string_find_parallel(const string* str, string_view needle, unsigned threads) {
+    if (!str || (!needle.data && needle.length)) return -1;
+    if (!needle.length) return 0;
+    if (STRING_LENGTH(str) < PARALLEL_MIN_SIZE || threads == 1) return string_find_view(str, needle);
+    
+    parallel_job job;
+    two_way_table table;
+    search_needle pattern;
+    search_job_init(&job, &table, &pattern, str, needle);
+    job.run = run_find;
+    atomic_init(&job.found, NO_MATCH);
+    parallel_run(&job, threads);
+    
+    size_t found = atomic_load_explicit(&job.found, memory_order_relaxed);
+    return found == NO_MATCH ? -1 : (ptrdiff_t)found;
+}
+
+size_t string_count(const string* str, string_view needle) {
+    if (!str || !needle.data || !needle.length) return 0;
+    
+    size_t count = 0;
+    const char* data = STRING_DATA(str);
+    size_t length = STRING_LENGTH(str);
+    for (size_t pos = 0; pos < length; ) {
+        ptrdiff_t found = find_bytes(data + pos, length - pos, needle.data, needle.length);
+        if (found < 0) break;
+        count++;
+        pos += (size_t)found + needle.length;
+    }
+    return count;
+}
+
+size_t string_count_parallel(const string* str, string_view needle, unsigned threads) {
+    if (!str || !needle.data || !needle.length) return 0;
+    if (STRING_LENGTH(str) < PARALLEL_MIN_SIZE || threads == 1) return string_count(str, needle);
+    
+    parallel_job job;
+    two_way_table table;
+    search_needle pattern;
+    search_job_init(&job, &table, &pattern, str, needle);
+    job.run = run_count;
+    job.matches = malloc(((job.length + PARALLEL_CHUNK_SIZE - 1) / PARALLEL_CHUNK_SIZE) * sizeof(chunk_matches));
+    if (!job.matches) return string_count(str, needle);
+    
+    parallel_run(&job, threads);
+    size_t count = count_merge(&job);
+    free(job.matches);
+    return count;
+}
+
+// Array sorting: a multikey quicksort over 8-byte digits. Each entry keeps
+// the digit at the current depth as a big-endian integer, so most
+// comparisons are one integer compare that never touches the string.
+#define SORT_INSERTION_MAX 16
+// From this many strings up, the parallel sort buckets the array on 16 bits
+// of the first digit and sorts the buckets concurrently
+#define SORT_PARALLEL_MIN (64 * 1024)
+#define SORT_BUCKETS 65536
+
+typedef struct {
+    uint64_t prefix;            // Bytes [depth, depth + 8) big-endian, zero padded
+    const char* data;           // Key bytes, copied out so the sort never
+    size_t length;              // dereferences the string header
+    string* str;                // Owning string, or NULL for string_array items
+} sort_entry;
+
+static inline uint64_t sort_digit(const char* bytes, size_t length, size_t depth) {
+    if (depth >= length) return 0;
+    
+    const unsigned char* data = (const unsigned char*)bytes + depth;
+    uint64_t digit = 0;
+    if (length - depth >= 8) {
+        memcpy(&digit, data, sizeof(digit));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        digit = __builtin_bswap64(digit);
+#endif
+    } else {
+        for (size_t i = 0; i < length - depth; i++) digit |= (uint64_t)data[i] << (56 - 8 * i);
     }
+    return digit;
+}
+
+static inline void sort_swap(sort_entry* a, sort_entry* b) {
+    sort_entry t = *a;
+    *a = *b;
+    *b = t;
+}
+
+// Full comparison of two entries whose strings agree on their first depth bytes
+static int sort_compare(const sort_entry* a, const sort_entry* b, size_t depth) {
+    if (a->prefix != b->prefix) return a->prefix < b->prefix ? -1 : 1;
     
-    // Process remaining characters
-    for (; i < len; i++) {
-        data[i] = toupper((unsigned char)data[i]);
+    // Equal digits: a string ending inside them is a prefix of the other
+    size_t len1 = a->length;
+    size_t len2 = b->length;
+    size_t next = depth + 8;
+    if (len1 > next && len2 > next) {
+        size_t len = (len1 < len2 ? len1 : len2) - next;
+        int result = memcmp(a->data + next, b->data + next, len);
+        if (result != 0) return result;
     }
+    return (len1 > len2) - (len1 < len2);
 }
 
-// SSE4.2 optimized string to lowercase
-void string_to_lower(string* str) {
-    if (!str || !str->length) return;
-    
-    const size_t len = str->length;
-    char* data = STRING_DATA(str);
+static inline uint64_t median3(uint64_t a, uint64_t b, uint64_t c) {
+    if (a < b) return b < c ? b : (a < c ? c : a);
+    return a < c ? a : (b < c ? c : b);
+}
+
+// Entries whose digit at depth is pivot: the strings that end within the
+// digit go first, ordered by length, and the rest get the next digit.
+// Returns how many ended.
+static size_t sort_equal_digits(sort_entry* entries, size_t n, size_t depth) {
+    size_t next = depth + 8;
+    size_t ended = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (entries[i].length <= next) sort_swap(&entries[ended++], &entries[i]);
+    }
     
-    // For very short strings, use standard implementation
-    if (len < 16) {
-        for (size_t i = 0; i < len; i++) {
-            data[i] = tolower((unsigned char)data[i]);
+    // Equal digits leave at most nine distinct lengths among those
+    size_t placed = 0;
+    for (size_t length = depth; length <= next && placed < ended; length++) {
+        for (size_t i = placed; i < ended; i++) {
+            if (entries[i].length == length) sort_swap(&entries[placed++], &entries[i]);
         }
-        return;
     }
     
-    // Use SIMD to process 16 bytes at a time
-    size_t i = 0;
-    __m128i upper_a = _mm_set1_epi8('A');
-    __m128i upper_z = _mm_set1_epi8('Z');
-    __m128i to_lower = _mm_set1_epi8('a' - 'A');
-    
-    for (; i + 16 <= len; i += 16) {
-        __m128i chars = _mm_loadu_si128((__m128i*)(data + i));
+    for (size_t i = ended; i < n; i++) {
+        entries[i].prefix = sort_digit(entries[i].data, entries[i].length, next);
+    }
+    return ended;
+}
+
+static void sort_range(sort_entry* entries, size_t n, size_t depth) {
+    while (n > SORT_INSERTION_MAX) {
+        uint64_t pivot = median3(entries[0].prefix, entries[n / 2].prefix, entries[n - 1].prefix);
         
-        // Check which chars are in range 'A'..'Z'
-        __m128i is_upper = _mm_and_si128(
-            _mm_cmpgt_epi8(chars, _mm_sub_epi8(upper_a, _mm_set1_epi8(1))),
-            _mm_cmpgt_epi8(_mm_add_epi8(upper_z, _mm_set1_epi8(1)), chars)
-        );
+        // Three-way partition: [0, lt) less, [lt, gt) equal, [gt, n) greater
+        size_t lt = 0, i = 0, gt = n;
+        while (i < gt) {
+            if (entries[i].prefix < pivot) {
+                sort_swap(&entries[lt++], &entries[i++]);
+            } else if (entries[i].prefix > pivot) {
+                sort_swap(&entries[i], &entries[--gt]);
+            } else {
+                i++;
+            }
+        }
         
-        // Convert to lowercase if in range
-        __m128i adjustment = _mm_and_si128(is_upper, to_lower);
-        __m128i result = _mm_add_epi8(chars, adjustment);
+        size_t ended = sort_equal_digits(entries + lt, gt - lt, depth);
         
-        _mm_storeu_si128((__m128i*)(data + i), result);
+        // Recurse into the two smaller parts and loop on the largest, which
+        // keeps the stack logarithmic
+        sort_entry* part[3] = { entries, entries + lt + ended, entries + gt };
+        size_t size[3] = { lt, gt - lt - ended, n - gt };
+        size_t level[3] = { depth, depth + 8, depth };
+        size_t largest = size[0] >= size[1] ? (size[0] >= size[2] ? 0 : 2) : (size[1] >= size[2] ? 1 : 2);
+        for (size_t k = 0; k < 3; k++) {
+            if (k != largest) sort_range(part[k], size[k], level[k]);
+        }
+        entries = part[largest];
+        n = size[largest];
+        depth = level[largest];
     }
     
-    // Process remaining characters
-    for (; i < len; i++) {
-        data[i] = tolower((unsigned char)data[i]);
+    for (size_t i = 1; i < n; i++) {
+        sort_entry entry = entries[i];
+        size_t j = i;
+        while (j > 0 && sort_compare(&entry, &entries[j - 1], depth) < 0) {
+            entries[j] = entries[j - 1];
+            j--;
+        }
+        entries[j] = entry;
     }
 }
-#else
-int string_compare(const string* str1, const string* str2) {
-    if (!str1 && !str2) return 0;
-    if (!str1) return -1;
-    if (!str2) return 1;
-    return memcmp(STRING_DATA(str1), STRING_DATA(str2), 
-                 (str1->length < str2->length) ? str1->length : str2->length);
+
+static int compare_string_ptrs(const void* a, const void* b) {
+    return string_compare(*(string* const*)a, *(string* const*)b);
 }
 
-bool string_equals(const string* str1, const string* str2) {
-    if (str1 == str2) return true;
-    if (!str1 || !str2) return false;
-    return str1->length == str2->length && 
-           memcmp(STRING_DATA(str1), STRING_DATA(str2), str1->length) == 0;
+// NULL entries sort first, as in string_compare; returns how many there were
+static size_t sort_nulls_first(string** strings, size_t count) {
+    size_t nulls = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (!strings[i]) {
+            strings[i] = strings[nulls];
+            strings[nulls++] = NULL;
+        }
+    }
+    return nulls;
 }
 
-ptrdiff_t string_find_cstr(const string* str, const char* substr) {
-    if (!str || !substr) return -1;
-    
-    char* found = memmem(STRING_DATA(str), str->length, substr, strlen(substr));
-    return found ? (found - STRING_DATA(str)) : -1;
+static sort_entry* sort_entries_new(string** strings, size_t count) {
+    sort_entry* entries = malloc(count * sizeof(sort_entry));
+    if (!entries) return NULL;
+    for (size_t i = 0; i < count; i++) {
+        const char* data = STRING_DATA(strings[i]);
+        size_t length = STRING_LENGTH(strings[i]);
+        entries[i] = (sort_entry){ sort_digit(data, length, 0), data, length, strings[i] };
+    }
+    return entries;
 }
 
-// Standard implementations for systems without SSE4.2
-void string_to_upper(string* str) {
-    if (!str || !str->length) return;
+void string_array_sort(string** strings, size_t count) {
+    if (!strings || count < 2) return;
     
-    char* data = STRING_DATA(str);
-    for (size_t i = 0; i < str->length; i++) {
-        data[i] = toupper((unsigned char)data[i]);
+    size_t nulls = sort_nulls_first(strings, count);
+    strings += nulls;
+    count -= nulls;
+    
+    sort_entry* entries = sort_entries_new(strings, count);
+    if (!entries) {
+        // Still sorted, just without the prefix cache
+        qsort(strings, count, sizeof(string*), compare_string_ptrs);
+        return;
     }
+    
+    sort_range(entries, count, 0);
+    for (size_t i = 0; i < count; i++) strings[i] = entries[i].str;
+    free(entries);
 }
 
-void string_to_lower(string* str) {
-    if (!str || !str->length) return;
-    
-    char* data = STRING_DATA(str);
-    for (size_t i = 0; i < str->length; i++) {
-        data[i] = tolower((unsigned char)data[i]);
+// Bucket from the 16 bits below the shared leading bits of every prefix
+static inline size_t sort_bucket(uint64_t prefix, unsigned shared) {
+    return (size_t)((prefix << shared) >> 48);
+}
+
+typedef struct {
+    sort_entry* entries;
+    const size_t* starts;       // Bucket b holds entries [starts[b], starts[b + 1])
+    _Atomic size_t next_bucket;
+} sort_job;
+
+static void* sort_worker(void* arg) {
+    sort_job* job = arg;
+    for (;;) {
+        size_t bucket = atomic_fetch_add_explicit(&job->next_bucket, 1, memory_order_relaxed);
+        if (bucket >= SORT_BUCKETS) return NULL;
+        
+        size_t start = job->starts[bucket];
+        sort_range(job->entries + start, job->starts[bucket + 1] - start, 0);
     }
 }
-#endif
 
-// Add an optimized trim function that automatically switches to small string
-// optimization when possible
-void string_trim(string* str) {
-    if (!str || !str->length) return;
+void string_array_sort_parallel(string** strings, size_t count, unsigned threads) {
+    if (!strings || count < 2) return;
     
-    char *start = STRING_DATA(str);
-    char *end = STRING_DATA(str) + str->length - 1;
+    size_t nulls = sort_nulls_first(strings, count);
+    if (count - nulls < SORT_PARALLEL_MIN || threads == 1) {
+        string_array_sort(strings + nulls, count - nulls);
+        return;
+    }
+    strings += nulls;
+    count -= nulls;
     
-    while (start <= end && isspace((unsigned char)*start)) start++;
-    while (end > start && isspace((unsigned char)*end)) end--;
+    sort_entry* buckets = malloc(count * sizeof(sort_entry));
+    size_t* starts = calloc(SORT_BUCKETS + 1, sizeof(size_t));
+    if (!buckets || !starts) {
+        free(buckets);
+        free(starts);
+        string_array_sort(strings, count);
+        return;
+    }
     
-    size_t new_length = end - start + 1;
+    // Keys such as paths or URLs often share a leading prefix, so bucket on
+    // the 16 bits just below the ones every first digit has in common
+    uint64_t low = UINT64_MAX, high = 0;
+    for (size_t i = 0; i < count; i++) {
+        uint64_t prefix = sort_digit(STRING_DATA(strings[i]), STRING_LENGTH(strings[i]), 0);
+        if (prefix < low) low = prefix;
+        if (prefix > high) high = prefix;
+    }
+    unsigned shared = low == high ? 48 : (unsigned)__builtin_clzll(low ^ high);
+    if (shared > 48) shared = 48;
     
-    // Check if we can convert to small string after trimming
-    if (!str->is_small && new_length <= SSO_SIZE) {
-        // Convert to small string
-        char* heap_data = str->heap.data;
-        char temp_buf[SSO_SIZE + 1];
-        
-        // Copy trimmed data to a temporary buffer
-        memcpy(temp_buf, start, new_length);
-        temp_buf[new_length] = '\0';
-        
-        // Convert to small string
-        str->is_small = 1;
-        memcpy(str->stack.data, temp_buf, new_length + 1);
-        
-        // Free heap data
-        free(heap_data);
-    } else if (start > STRING_DATA(str)) {
-        // Move the data in place
-        memmove(STRING_DATA(str), start, new_length);
+    // Counting sort on those bits, building each entry straight into its slot
+    for (size_t i = 0; i < count; i++) {
+        uint64_t prefix = sort_digit(STRING_DATA(strings[i]), STRING_LENGTH(strings[i]), 0);
+        starts[sort_bucket(prefix, shared) + 1]++;
+    }
+    for (size_t b = 0; b < SORT_BUCKETS; b++) starts[b + 1] += starts[b];
+    for (size_t i = 0; i < count; i++) {
+        const char* data = STRING_DATA(strings[i]);
+        size_t length = STRING_LENGTH(strings[i]);
+        uint64_t prefix = sort_digit(data, length, 0);
+        buckets[starts[sort_bucket(prefix, shared)]++] = (sort_entry){ prefix, data, length, strings[i] };
     }
+    // Each start was advanced to the next bucket's start; shift them back
+    memmove(starts + 1, starts, SORT_BUCKETS * sizeof(size_t));
+    starts[0] = 0;
     
-    STRING_DATA(str)[new_length] = '\0';
-    str->length = new_length;
+    sort_job job = { buckets, starts, 0 };
+    parallel_spawn(sort_worker, &job, threads, SORT_BUCKETS);
     
-    // Try to shrink memory usage
-    if (!str->is_small && str->heap.capacity > new_length * 2 && 
-        new_length > SSO_SIZE && new_length < 1024) {
-        
-        // Shrink the buffer to avoid wasting memory
-        size_t new_capacity = (new_length * 2 + CACHE_LINE_SIZE - 1) & ~(CACHE_LINE_SIZE - 1);
-        char* new_data = realloc(str->heap.data, new_capacity);
-        
-        if (new_data) {
-            str->heap.data = new_data;
-            str->heap.capacity = new_capacity;
+    for (size_t i = 0; i < count; i++) strings[i] = buckets[i].str;
+    free(starts);
+    free(buckets);
+}
+
+size_t string_array_unique(string** strings, size_t count) {
+    if (!strings || !count) return 0;
+    
+    size_t kept = 1;
+    for (size_t i = 1; i < count; i++) {
+        string* last = strings[kept - 1];
+        if (!string_equals(strings[i], last)) {
+            strings[kept++] = strings[i];
+        } else if (strings[i] != last) {
+            string_free(strings[i]);
         }
     }
+    return kept;
 }
 
-string* string_substr(const string* str, size_t start, size_t length) {
-    if (!str || start >= str->length) return NULL;
-    
-    length = (start + length > str->length) ? (str->length - start) : length;
-    string* result = string_with_capacity(length + 1);
-    if (!result) return NULL;
-    
-    memcpy(STRING_DATA(result), STRING_DATA(str) + start, length);
-    STRING_DATA(result)[length] = '\0';
-    result->length = length;
-    return result;
+// Contiguous string arrays. Items are appended to one byte block, each with
+// a null terminator, and located through a table of offsets and lengths;
+// sorting and deduplicating only rewrite the table.
+#define ARRAY_MIN_ITEMS 8
+#define ARRAY_MIN_BYTES 64
+
+typedef struct {
+    size_t offset;
+    size_t length;
+} array_item;
+
+struct string_array {
+    char* bytes;
+    size_t used;                // Bytes of the block in use
+    size_t bytes_capacity;
+    array_item* items;
+    size_t count;
+    size_t items_capacity;
+};
+
+// Grow a block to hold at least needed elements of size bytes, doubling
+static bool array_grow(void** block, size_t* capacity, size_t needed, size_t size, size_t minimum) {
+    if (needed <= *capacity) return true;
+    size_t grown = *capacity ? *capacity : minimum;
+    while (grown < needed) {
+        if (__builtin_mul_overflow(grown, 2, &grown)) {
+            grown = needed;
+            break;
+        }
+    }
+    size_t bytes;
+    if (__builtin_mul_overflow(grown, size, &bytes)) {
+        errno = EOVERFLOW;
+        return false;
+    }
+    void* moved = realloc(*block, bytes);
+    if (!moved) return false;
+    *block = moved;
+    *capacity = grown;
+    return true;
 }
 
-string** string_split(const string* str, const char* delim, size_t* count) {
-    if (!str || !delim || !count || !str->length) {
-        if (count) *count = 0;
-        return NULL;
+// Make room for items more entries holding bytes more bytes in all
+static bool array_reserve(string_array* array, size_t items, size_t bytes) {
+    size_t needed_items, needed_bytes;
+    if (__builtin_add_overflow(array->count, items, &needed_items) ||
+        __builtin_add_overflow(array->used, bytes, &needed_bytes)) {
+        errno = EOVERFLOW;
+        return false;
     }
-    
-    size_t delim_len = strlen(delim);
-    if (!delim_len) {
-        if (count) *count = 0;
-        return NULL;
+    return array_grow((void**)&array->items, &array->items_capacity, needed_items,
+                      sizeof(array_item), ARRAY_MIN_ITEMS) &&
+           array_grow((void**)&array->bytes, &array->bytes_capacity, needed_bytes,
+                      1, ARRAY_MIN_BYTES);
+}
+
+// Append one item; the caller has reserved the room
+static inline void array_add(string_array* array, const char* data, size_t length) {
+    char* out = array->bytes + array->used;
+    if (length) memcpy(out, data, length);
+    out[length] = '\0';
+    array->items[array->count++] = (array_item){ array->used, length };
+    array->used += length + 1;
+}
+
+static inline string_view array_view(const string_array* array, size_t index) {
+    return (string_view){ array->bytes + array->items[index].offset, array->items[index].length };
+}
+
+string_array* string_array_new(void) {
+    return calloc(1, sizeof(string_array));
+}
+
+void string_array_free(string_array* array) {
+    if (!array) return;
+    free(array->bytes);
+    free(array->items);
+    free(array);
+}
+
+void string_array_clear(string_array* array) {
+    if (!array) return;
+    array->used = 0;
+    array->count = 0;
+}
+
+size_t string_array_count(const string_array* array) {
+    return array ? array->count : 0;
+}
+
+string_view string_array_get(const string_array* array, size_t index) {
+    if (!array || index >= array->count) return (string_view){ "", 0 };
+    return array_view(array, index);
+}
+
+bool string_array_push(string_array* array, string_view sv) {
+    if (!array || (!sv.data && sv.length)) return false;
+    if (sv.length >= SIZE_MAX) {
+        errno = EOVERFLOW;
+        return false;
     }
     
-    // Count splits
-    size_t num_splits = 1;
-    const char* pos = STRING_DATA(str);
-    while ((pos = memmem(pos, str->length - (pos - STRING_DATA(str)), delim, delim_len))) {
-        num_splits++;
-        pos += delim_len;
-    }
+    // The view may point into the block, which can move
+    uintptr_t ptr = (uintptr_t)sv.data;
+    uintptr_t base = (uintptr_t)array->bytes;
+    bool aliased = array->bytes && ptr >= base && ptr < base + array->used;
+    size_t offset = aliased ? (size_t)(ptr - base) : 0;
+    if (!array_reserve(array, 1, sv.length + 1)) return false;
     
-    string** result = calloc(num_splits, sizeof(string*));
-    if (!result) {
-        if (count) *count = 0;
-        return NULL;
-    }
+    array_add(array, aliased ? array->bytes + offset : sv.data, sv.length);
+    return true;
+}
+
+bool string_split_into(string_array* array, const string* str, const char* delim) {
+    if (!array || !str || !delim) return false;
     
-    // Split string
-    const char* start = STRING_DATA(str);
-    size_t i = 0;
+    size_t str_len = STRING_LENGTH(str);
+    size_t delim_len = strlen(delim);
+    if (!str_len || !delim_len) return true;
     
-    while (start < STRING_DATA(str) + str->length) {
-        const char* end = memmem(start, str->length - (start - STRING_DATA(str)), delim, delim_len);
-        if (!end) end = STRING_DATA(str) + str->length;
-        
-        size_t part_len = end - start;
-        result[i] = string_with_capacity(part_len + 1);
-        if (!result[i]) {
-            for (size_t j = 0; j < i; j++) string_free(result[j]);
-            free(result);
-            if (count) *count = 0;
-            return NULL;
+    // n pieces take str_len - (n - 1) * delim_len bytes plus n terminators,
+    // never more than str_len + 1, so the block is sized once
+    if (!array_reserve(array, 1, str_len + 1)) return false;
+    
+    size_t count = array->count;
+    size_t used = array->used;
+    const search_needle pattern = { delim, delim_len, NULL };
+    const char* data = STRING_DATA(str);
+    for (size_t pos = 0; ; ) {
+        ptrdiff_t found = find_pattern(data + pos, str_len - pos, &pattern);
+        size_t piece = found >= 0 ? (size_t)found : str_len - pos;
+        if (!array_reserve(array, 1, 0)) {
+            array->count = count;
+            array->used = used;
+            return false;
         }
-        
-        memcpy(STRING_DATA(result[i]), start, part_len);
-        STRING_DATA(result[i])[part_len] = '\0';
-        result[i]->length = part_len;
-        
-        start = end + delim_len;
-        i++;
-        if (!end) break;
+        array_add(array, data + pos, piece);
+        if (found < 0) break;
+        pos += piece + delim_len;
     }
-    
-    *count = num_splits;
-    return result;
+    return true;
 }
 
-string* string_join(string** strs, size_t count, const char* delim) {
-    if (!strs || !count || !delim) return NULL;
+string* string_array_join(const string_array* array, const char* delim) {
+    if (!array || !delim) return NULL;
     
     size_t delim_len = strlen(delim);
     size_t total_len = 0;
-    
-    for (size_t i = 0; i < count; i++) {
-        if (strs[i]) {
-            if (__builtin_add_overflow(total_len, strs[i]->length, &total_len)) {
-                errno = EOVERFLOW;
-                return NULL;
-            }
-            if (i < count - 1 && __builtin_add_overflow(total_len, delim_len, &total_len)) {
-                errno = EOVERFLOW;
-                return NULL;
-            }
+    for (size_t i = 0; i < array->count; i++) {
+        if (__builtin_add_overflow(total_len, array->items[i].length, &total_len) ||
+            (i + 1 < array->count && __builtin_add_overflow(total_len, delim_len, &total_len))) {
+            errno = EOVERFLOW;
+            return NULL;
         }
     }
     
+    if (total_len == SIZE_MAX) {
+        errno = EOVERFLOW;
+        return NULL;
+    }
     string* result = string_with_capacity(total_len + 1);
     if (!result) return NULL;
     
-    for (size_t i = 0; i < count; i++) {
-        if (strs[i]) {
-            if (!string_append(result, strs[i])) {
-                string_free(result);
-                return NULL;
-            }
-            if (i < count - 1 && !string_append_cstr(result, delim)) {
-                string_free(result);
-                return NULL;
-            }
+    char* out = STRING_DATA(result);
+    for (size_t i = 0; i < array->count; i++) {
+        if (i) {
+            memcpy(out, delim, delim_len);
+            out += delim_len;
         }
+        memcpy(out, array->bytes + array->items[i].offset, array->items[i].length);
+        out += array->items[i].length;
     }
-    
+    set_length(result, total_len);
     return result;
 }
 
-bool string_replace(string* str, const char* old_str, const char* new_str) {
-    if (!str || !old_str || !new_str || !str->length) return false;
-    
-    size_t old_len = strlen(old_str);
-    if (!old_len) return true;
-    
-    size_t new_len = strlen(new_str);
-    const char* pos = STRING_DATA(str);
-    size_t count = 0;
+bool string_array_sort_items(string_array* array) {
+    if (!array || array->count < 2) return true;
     
-    // Count occurrences and check for overflow
-    while ((pos = memmem(pos, str->length - (pos - STRING_DATA(str)), old_str, old_len))) {
-        count++;
-        pos += old_len;
+    sort_entry* entries = malloc(array->count * sizeof(sort_entry));
+    if (!entries) return false;
+    for (size_t i = 0; i < array->count; i++) {
+        string_view item = array_view(array, i);
+        entries[i] = (sort_entry){ sort_digit(item.data, item.length, 0), item.data, item.length, NULL };
     }
     
-    if (!count) return true;
-    
-    // Optimize for the case when new_len <= old_len (in-place replacement)
-    if (new_len <= old_len) {
-        char* write_pos = STRING_DATA(str);
-        const char* read_pos = STRING_DATA(str);
-        const char* end = STRING_DATA(str) + str->length;
-        
-        while (read_pos < end) {
-            const char* match = memmem(read_pos, end - read_pos, old_str, old_len);
-            
-            if (!match) {
-                // No more matches, copy remaining data
-                size_t remaining = end - read_pos;
-                if (write_pos != read_pos) {
-                    memmove(write_pos, read_pos, remaining);
-                }
-                write_pos += remaining;
-                break;
-            }
-            
-            // Copy data before match
-            size_t prefix_len = match - read_pos;
-            if (prefix_len > 0) {
-                if (write_pos != read_pos) {
-                    memmove(write_pos, read_pos, prefix_len);
-                }
-                write_pos += prefix_len;
-            }
-            
-            // Insert replacement
-            memcpy(write_pos, new_str, new_len);
-            write_pos += new_len;
-            
-            // Move read pointer past the match
-            read_pos = match + old_len;
-        }
-        
-        // Null terminate and set new length
-        *write_pos = '\0';
-        str->length = write_pos - STRING_DATA(str);
-        
-        // Try to shrink to small string if possible
-        if (!str->is_small && str->length <= SSO_SIZE) {
-            try_shrink_to_small(str);
-        }
-        
-        return true;
+    sort_range(entries, array->count, 0);
+    for (size_t i = 0; i < array->count; i++) {
+        array->items[i] = (array_item){ (size_t)(entries[i].data - array->bytes), entries[i].length };
     }
+    free(entries);
+    return true;
+}
+
+size_t string_array_unique_items(string_array* array) {
+    if (!array || !array->count) return 0;
     
-    // Calculate new length with overflow checking
-    size_t new_total_len;
-    if (__builtin_mul_overflow(count, new_len, &new_total_len) ||
-        __builtin_add_overflow(str->length, new_total_len, &new_total_len) ||
-        __builtin_sub_overflow(new_total_len, count * old_len, &new_total_len)) {
-        errno = EOVERFLOW;
-        return false;
+    size_t kept = 1;
+    for (size_t i = 1; i < array->count; i++) {
+        string_view last = array_view(array, kept - 1);
+        string_view item = array_view(array, i);
+        if (item.length != last.length || memcmp(item.data, last.data, item.length) != 0) {
+            array->items[kept++] = array->items[i];
+        }
     }
+    array->count = kept;
+    return kept;
+}
+
+ptrdiff_t string_array_find(const string_array* array, string_view sv) {
+    if (!array || (!sv.data && sv.length)) return -1;
     
-    if (!ensure_capacity(str, new_total_len + 1)) return false;
-    
-    // Perform replacement from end to beginning
-    char* write_pos = STRING_DATA(str) + new_total_len;
-    const char* read_pos = STRING_DATA(str) + str->length;
-    const char* last_match = NULL;
-    
-    *write_pos = '\0';
-    while (read_pos > STRING_DATA(str)) {
-        const char* match = memmem(STRING_DATA(str), read_pos - STRING_DATA(str), old_str, old_len);
-        if (!match || match == last_match) break;
-        
-        size_t suffix_len = read_pos - (match + old_len);
-        write_pos -= suffix_len;
-        memcpy(write_pos, match + old_len, suffix_len);
-        
-        write_pos -= new_len;
-        memcpy(write_pos, new_str, new_len);
-        
-        read_pos = match;
-        last_match = match;
+    for (size_t i = 0; i < array->count; i++) {
+        if (array->items[i].length == sv.length &&
+            (!sv.length || memcmp(array->bytes + array->items[i].offset, sv.data, sv.length) == 0)) {
+            return (ptrdiff_t)i;
+        }
     }
+    return -1;
+}
+
+ptrdiff_t string_array_find_sorted(const string_array* array, string_view sv) {
+    if (!array || (!sv.data && sv.length)) return -1;
     
-    if (read_pos > STRING_DATA(str)) {
-        memmove(STRING_DATA(str), STRING_DATA(str), read_pos - STRING_DATA(str));
+    size_t low = 0, high = array->count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        string_view item = array_view(array, mid);
+        size_t len = item.length < sv.length ? item.length : sv.length;
+        int result = len ? memcmp(item.data, sv.data, len) : 0;
+        if (result == 0) result = (item.length > sv.length) - (item.length < sv.length);
+        if (result == 0) return (ptrdiff_t)mid;
+        if (result < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
     }
-    
-    str->length = new_total_len;
-    return true;
+    return -1;
 }
 
-char string_char_at(const string* str, size_t index) {
-    if (!str || index >= str->length) return '\0';
-    return STRING_DATA(str)[index];
-}
\ No newline at end of file
+string_stats string_stats_get(void) {
+#ifdef STRING_STATS
+    return thread_stats;
+#else
+    return (string_stats){ 0 };
+#endif
+}
+
+void string_stats_reset(void) {
+#ifdef STRING_STATS
+    thread_stats = (string_stats){ 0 };
+#endif
+}
+
+bool string_stats_enabled(void) {
+#ifdef STRING_STATS
+    return true;
+#else
+    return false;
+#endif
+}
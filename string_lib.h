@@ -10,32 +10,255 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#ifndef _WIN32
+#include <sys/uio.h>
+#define STRING_HAVE_IOVEC 1
+#endif
 
+#ifdef __cplusplus
+extern "C" {
+#else
 // Using C2X version check instead of C23
 static_assert(__STDC_VERSION__ >= 201710L, "C2X or later is required");
+#endif
 
 // Small string optimization
 #define SSO_SIZE 23  // 23 bytes + null terminator for small strings
 
 /**
  * @brief string structure definition with small string optimization
+ *
+ * The whole object is 24 bytes on 64-bit targets. The last byte is shared by
+ * both representations: small strings store SSO_SIZE - length there (so it
+ * doubles as the terminator of a full 23-byte string), heap strings store a
+ * flag byte with the high bit set, and the byte before it records the
+ * buffer's allocator; both overlap the top of capacity.
+ * Use the accessor functions rather than reading the fields directly.
  */
 typedef struct {
     union {
         struct {
             char* data;         // Pointer to string data
-            size_t capacity;    // Allocated capacity
+            size_t length;      // Current string length
+            size_t capacity;    // Allocated capacity (the top two bytes are reserved)
         } heap;
         struct {
-            char data[SSO_SIZE + 1]; // Inline buffer for small strings
+            char data[SSO_SIZE + 1]; // Inline buffer; the last byte encodes the length
         } stack;
     };
-    size_t length;              // Current string length (for both heap and stack)
-    uint8_t is_small:1;         // Flag for SSO - 1 if using stack storage
 } string;
 
+/**
+ * @brief Bump-pointer region that strings can be allocated from
+ *
+ * All strings created in an arena are released together by
+ * string_arena_reset or string_arena_free; string_free on them is a no-op.
+ * An arena is not thread-safe.
+ */
+typedef struct string_arena string_arena;
+
+/**
+ * @brief Memory source for string buffers, arena blocks and string headers
+ *
+ * alignment is a power of two; buffers ask for 64 so the SIMD kernels never
+ * split a cache line at the start of a string. reallocate may be NULL, in
+ * which case the library allocates, copies and deallocates. An allocator must
+ * stay valid until every buffer it produced has been freed.
+ */
+typedef struct {
+    void* (*allocate)(void* context, size_t size, size_t alignment);
+    void* (*reallocate)(void* context, void* ptr, size_t old_size, size_t new_size, size_t alignment);
+    void (*deallocate)(void* context, void* ptr, size_t size);
+    void* context;
+} string_allocator;
+
+/**
+ * @brief Static initializer for an empty string stored by value
+ *
+ * A zero-filled string is not empty (its tag byte would encode 23
+ * characters), so embedded strings must start from STRING_INIT or
+ * string_init.
+ */
+#define STRING_INIT { .stack = { .data = { [SSO_SIZE] = SSO_SIZE } } }
+
+/**
+ * @brief Non-owning view of a byte range
+ *
+ * A view never allocates or frees memory; it is only valid while the
+ * buffer it points into is alive and unchanged. The data is not guaranteed
+ * to be null-terminated.
+ */
+typedef struct {
+    const char* data;           // First byte of the view
+    size_t length;              // Number of bytes in the view
+} string_view;
+
+/**
+ * @brief Set of byte values laid out for the SIMD membership kernels
+ *
+ * Build one with string_byte_set_from; the fields are private.
+ */
+typedef struct {
+    uint64_t bits[4];           // Bitmap for scalar tests
+    uint8_t low_rows[16];       // Nibble tables for bytes below 0x80
+    uint8_t high_rows[16];      // Nibble tables for bytes from 0x80
+} string_byte_set;
+
+/**
+ * @brief Needle compiled once for repeated searches
+ *
+ * A searcher owns a copy of its needle and the Two-Way tables the find
+ * kernels fall back to, so searching many haystacks for the same needle pays
+ * for strlen and preprocessing only once. It is immutable after creation and
+ * may be shared between threads.
+ */
+typedef struct string_searcher string_searcher;
+
+/**
+ * @brief Set of needles compiled for single-pass multi-pattern search
+ *
+ * Matching is leftmost-longest: of all patterns that occur, the one that
+ * starts first wins, and among those starting at the same offset the
+ * longest. A matcher is immutable after creation and may be shared between
+ * threads.
+ */
+typedef struct string_matcher string_matcher;
+
+/**
+ * @brief Contiguous array of byte strings
+ *
+ * All items share one byte block, each followed by a null byte, indexed by
+ * a table of offsets and lengths. Unlike a string** there is no allocation
+ * per item, and scans and joins read memory in order. Fill one with
+ * string_split_into or string_array_push.
+ */
+typedef struct string_array string_array;
+
+/**
+ * @brief One match reported by a string_matcher
+ */
+typedef struct {
+    size_t offset;              // Index of the first matched byte
+    size_t length;              // Length of the matched pattern
+    size_t pattern;             // Index of the pattern in the array the matcher was built from
+} string_match;
+
+/**
+ * @brief Allocation-free iterator over the pieces of a view
+ *
+ * Pieces are produced one at a time as views into the input, with the same
+ * rules as string_view_split: empty pieces between adjacent delimiters and
+ * after a trailing delimiter are reported. The input must outlive the
+ * tokenizer; the fields are private.
+ */
+typedef struct {
+    string_view input;                  // Whole view being split
+    size_t position;                    // Start of the next piece
+    string_view delim;                  // Delimiter sequence, unless any or searcher is set
+    const string_searcher* searcher;    // Compiled delimiter sequence, or NULL
+    string_byte_set set;                // Delimiter bytes when any is set
+    bool any;                           // Split on any byte of set
+    bool finished;                      // Last piece has been returned
+} string_tokenizer;
+
+/**
+ * @brief Thread-safe interning pool that keeps one canonical string per value
+ *
+ * Interned strings are immutable and live until the pool is freed. Two
+ * strings interned in the same pool are equal exactly when they are the same
+ * pointer, and string_equals uses that to answer without reading their
+ * bytes. Any number of threads may intern into and look up in one pool at
+ * the same time: lookups of values already present take no lock, and inserts
+ * only lock one of many shards.
+ */
+typedef struct string_pool string_pool;
+
+/**
+ * @brief Rope for building and splicing large texts without recopying them
+ *
+ * A balanced tree of string leaves: append, insert, erase and substr take
+ * O(log n) and copy only the bytes they add. Ropes made by string_rope_substr
+ * share leaves with their source, and shared parts are never modified, so
+ * each rope can be edited independently. A single rope is not thread-safe.
+ */
+typedef struct string_rope string_rope;
+
+/**
+ * @brief Iterator over the contiguous chunks of a rope, in order
+ *
+ * The rope must not be modified while it is being iterated; the fields are
+ * private.
+ */
+typedef struct {
+    const string_rope* rope;    // Rope being walked
+    size_t offset;              // Start of the next chunk
+} string_rope_iter;
+
+/**
+ * @brief How string_from_file gets the file's bytes
+ */
+typedef enum {
+    STRING_FILE_READ = 0,       // Read into an owned heap buffer in one copy
+    STRING_FILE_MAP             // Map the file; nothing is copied until the string is modified
+} string_file_mode;
+
+/**
+ * @brief Flags for string_trim_set
+ */
+enum {
+    STRING_TRIM_LEFT = 1 << 0,          // Strip member bytes from the start
+    STRING_TRIM_RIGHT = 1 << 1,         // Strip member bytes from the end
+    STRING_TRIM_BOTH = STRING_TRIM_LEFT | STRING_TRIM_RIGHT,
+    STRING_TRIM_KEEP_BUFFER = 1 << 2    // Never reallocate, free or move back inline
+};
+
+/**
+ * @brief Flags for the URL encoding functions
+ */
+enum {
+    STRING_URL_FORM = 1 << 0            // application/x-www-form-urlencoded: '+' is a space
+};
+
+/**
+ * @brief Zero-copy iterator over the lines of a view
+ *
+ * Lines are split at '\n' and a trailing '\r' is dropped, so CRLF input
+ * reads the same. A final newline does not start an extra empty line. The
+ * input must outlive the iterator; the fields are private.
+ */
+typedef struct {
+    string_view input;          // Whole view being split
+    size_t position;            // Start of the next line
+} string_line_iter;
+
+/**
+ * @brief Allocation and hot-path counters for the calling thread
+ *
+ * Only collected when the library is built with -DSTRING_STATS (make
+ * STATS=1); otherwise every field stays zero. Arena allocations are not
+ * counted, since they never reach the system allocator.
+ */
+typedef struct {
+    uint64_t allocations;       // Headers and buffers taken from the system allocator
+    uint64_t frees;             // Headers and buffers given back
+    uint64_t cache_hits;        // Headers and buffers reused from the thread's cache
+    uint64_t cache_returns;     // Headers and buffers kept in the thread's cache instead of freed
+    uint64_t bytes_allocated;   // Bytes requested by allocations and reallocations
+    uint64_t heap_promotions;   // Small strings moved to the heap
+    uint64_t growth_reallocs;   // Heap buffers grown in place or moved
+    uint64_t shrinks;           // Heap buffers shrunk or folded back into small strings
+    uint64_t simd_calls;        // Kernel calls long enough for a full vector
+    uint64_t scalar_calls;      // Kernel calls handled by scalar code alone
+} string_stats;
+
 // Compile-time constants
-#define STRING_MAX_LENGTH (SIZE_MAX - 1)
+// Heap capacity gives up its top two bytes to the flags and allocator on
+// 64-bit targets and is rounded up to a 64-byte cache line
+#if SIZE_MAX > UINT32_MAX
+#define STRING_MAX_LENGTH ((SIZE_MAX >> 16) - 64)
+#else
+#define STRING_MAX_LENGTH (SIZE_MAX - 64)
+#endif
 
 /**
  * @brief Initialize a new string
@@ -44,6 +267,14 @@ typedef struct {
  */
 [[nodiscard]] string* string_new(const char* initial_value);
 
+/**
+ * @brief Create a new string from a byte range of known length
+ * @param data Bytes to copy (may contain embedded null bytes; NULL only if length is 0)
+ * @param length Number of bytes
+ * @return New string instance or NULL if allocation fails
+ */
+[[nodiscard]] string* string_new_n(const char* data, size_t length);
+
 /**
  * @brief Create a string with a given capacity
  * @param capacity Initial capacity to allocate
@@ -57,6 +288,111 @@ typedef struct {
  */
 void string_free([[maybe_unused]] string* str);
 
+/**
+ * @brief Create a second string sharing str's heap buffer
+ *
+ * The first share moves str to a reference-counted buffer (reallocating only
+ * if it lacks 16 spare bytes or is a file mapping); after that every share
+ * costs one header allocation. Each string may then be read from any thread,
+ * and the first write through one of them (append, set, replace, trim, case
+ * conversion, ...) copies the buffer for that string alone. Small and arena
+ * strings are copied instead.
+ * @param str String to share; its content is unchanged
+ * @return New string instance or NULL if allocation fails
+ */
+[[nodiscard]] string* string_share(string* str);
+
+/**
+ * @brief Copy a string without modifying it
+ * @param str String to copy
+ * @return New string sharing str's buffer if str is already shared, otherwise
+ *         an independent copy; NULL if allocation fails
+ */
+[[nodiscard]] string* string_clone(const string* str);
+
+/**
+ * @brief Initialize a caller-owned string in place
+ *
+ * The header is not allocated, so a string embedded in a struct or on the
+ * stack costs no heap allocation while its content fits in SSO_SIZE.
+ * @param str Storage to initialize (contents are overwritten)
+ * @param initial_value Initial string value (can be NULL)
+ * @return true if successful; on failure str is left as a valid empty string
+ */
+[[nodiscard]] bool string_init(string* str, const char* initial_value);
+
+/**
+ * @brief Initialize a caller-owned string in place with a given capacity
+ * @param str Storage to initialize (contents are overwritten)
+ * @param capacity Initial capacity to allocate
+ * @return true if successful; on failure str is left as a valid empty string
+ */
+[[nodiscard]] bool string_init_with_capacity(string* str, size_t capacity);
+
+/**
+ * @brief Release the heap buffer of a caller-owned string
+ *
+ * The header itself is not freed. str is left as a valid empty string, so
+ * it may be reused or destroyed again.
+ * @param str string to destroy
+ */
+void string_destroy(string* str);
+
+/**
+ * @brief Create an arena
+ * @param block_size Size of each backing block in bytes (0 for the default of 64 KiB)
+ * @return New arena or NULL if allocation fails
+ */
+[[nodiscard]] string_arena* string_arena_new(size_t block_size);
+
+/**
+ * @brief Create an arena whose struct and blocks come from a given allocator
+ * @param block_size Size of each backing block in bytes (0 for the default of 64 KiB)
+ * @param allocator Allocator to use (NULL for the calling thread's allocator)
+ * @return New arena or NULL on failure (errno EINVAL for an incomplete
+ *         allocator, ENOSPC if too many allocators are registered)
+ */
+[[nodiscard]] string_arena* string_arena_new_with_allocator(size_t block_size,
+                                                            const string_allocator* allocator);
+
+/**
+ * @brief Release every string allocated from the arena in O(1) per block
+ *
+ * Standard-size blocks are kept for reuse; all strings, views and arrays
+ * obtained from the arena become invalid.
+ * @param arena Target arena
+ */
+void string_arena_reset(string_arena* arena);
+
+/**
+ * @brief Free an arena, its blocks and every string allocated from it
+ * @param arena Arena to free
+ */
+void string_arena_free(string_arena* arena);
+
+/**
+ * @brief Get the number of bytes currently handed out by an arena
+ * @param arena Target arena
+ * @return Bytes in use, including alignment padding
+ */
+[[nodiscard]] size_t string_arena_used(const string_arena* arena);
+
+/**
+ * @brief Initialize a new string inside an arena
+ * @param arena Arena to allocate the header and data from
+ * @param initial_value Initial string value (can be NULL)
+ * @return New string instance or NULL if allocation fails
+ */
+[[nodiscard]] string* string_new_in(string_arena* arena, const char* initial_value);
+
+/**
+ * @brief Create a string with a given capacity inside an arena
+ * @param arena Arena to allocate the header and data from
+ * @param capacity Initial capacity to allocate
+ * @return New string instance or NULL if allocation fails
+ */
+[[nodiscard]] string* string_with_capacity_in(string_arena* arena, size_t capacity);
+
 /**
  * @brief Get string length
  * @param str Target string
@@ -71,6 +407,26 @@ void string_free([[maybe_unused]] string* str);
  */
 [[nodiscard]] size_t string_capacity(const string* str);
 
+/**
+ * @brief Make room for a given length so later writes up to it do not reallocate
+ *
+ * A shared string gets a private buffer; capacity never shrinks.
+ * @param str Target string
+ * @param length Number of bytes of content to make room for
+ * @return true if successful, false with errno set otherwise (str is unchanged)
+ */
+[[nodiscard]] bool string_reserve(string* str, size_t length);
+
+/**
+ * @brief Release unused capacity
+ *
+ * Strings that fit move back into the inline buffer, others get the smallest
+ * cache-line multiple that holds them. Arena, shared and file-mapped strings
+ * are left as they are, as is str if the smaller buffer cannot be allocated.
+ * @param str Target string
+ */
+void string_shrink_to_fit(string* str);
+
 /**
  * @brief Get C-style string (null-terminated)
  * @param str Target string
@@ -87,12 +443,23 @@ void string_free([[maybe_unused]] string* str);
 
 /**
  * @brief Append string to another
+ *
+ * Uses the stored length, so embedded null bytes are appended too.
  * @param str Target string
- * @param other string to append
+ * @param other string to append; may be str itself
  * @return true if successful, false if allocation fails
  */
 [[nodiscard]] bool string_append(string* str, const string* other);
 
+/**
+ * @brief Append a byte range of known length without scanning it
+ * @param str Target string
+ * @param data Bytes to append (may contain embedded null bytes or point into str)
+ * @param length Number of bytes
+ * @return true if successful, false if allocation fails
+ */
+[[nodiscard]] bool string_append_n(string* str, const char* data, size_t length);
+
 /**
  * @brief Append C-style string to string
  * @param str Target string
@@ -109,6 +476,115 @@ void string_free([[maybe_unused]] string* str);
  */
 [[nodiscard]] bool string_append_char(string* str, char c);
 
+/**
+ * @brief Append the decimal form of a signed integer
+ * @param str Target string
+ * @param value Value to append
+ * @return true if successful, false if allocation fails
+ */
+[[nodiscard]] bool string_append_int(string* str, int64_t value);
+
+/**
+ * @brief Append the decimal form of an unsigned integer
+ * @param str Target string
+ * @param value Value to append
+ * @return true if successful, false if allocation fails
+ */
+[[nodiscard]] bool string_append_uint(string* str, uint64_t value);
+
+/**
+ * @brief Append the shortest decimal form of a double that reads back exactly
+ *
+ * Independent of the locale. The layout follows JavaScript: positional
+ * notation ("42", "0.1", "-1.5") for decimal exponents from -6 to 20 and
+ * scientific notation ("1e+21", "2.5e-8") otherwise; non-finite values are
+ * "inf", "-inf" and "nan".
+ * @param str Target string
+ * @param value Value to append
+ * @return true if successful, false if allocation fails
+ */
+[[nodiscard]] bool string_append_double(string* str, double value);
+
+/**
+ * @brief Append a view escaped for use inside a JSON string literal
+ *
+ * '"', '\\' and control bytes below 0x20 are escaped (\\n style where JSON
+ * has a short form, \\u00XX otherwise); every other byte, including UTF-8
+ * sequences, is copied unchanged. The surrounding quotes are not added.
+ * @param str Target string
+ * @param sv Bytes to escape
+ * @return true if successful, false if allocation fails
+ */
+[[nodiscard]] bool string_append_json_escaped(string* str, string_view sv);
+
+/**
+ * @brief Append the decoded contents of a JSON string literal
+ *
+ * Decodes the backslash escapes of the literal's body (without its quotes),
+ * turning \\uXXXX escapes and surrogate pairs into UTF-8. Other bytes are
+ * copied unchanged.
+ * @param str Target string
+ * @param sv Escaped literal body
+ * @return true if successful, false with errno EINVAL on a malformed escape
+ * or lone surrogate (str is left unchanged)
+ */
+[[nodiscard]] bool string_append_json_unescaped(string* str, string_view sv);
+
+/**
+ * @brief Append a view as an RFC 4180 CSV field
+ *
+ * A field containing a comma, quote, CR or LF is wrapped in quotes with its
+ * quotes doubled; any other field is appended unchanged.
+ * @param str Target string
+ * @param field Field value
+ * @return true if successful, false if allocation fails
+ */
+[[nodiscard]] bool string_append_csv_quoted(string* str, string_view field);
+
+/**
+ * @brief Append the value of an RFC 4180 CSV field
+ *
+ * A quoted field loses its quotes and has doubled quotes collapsed; an
+ * unquoted field is appended unchanged.
+ * @param str Target string
+ * @param field Field exactly as it appears in the record
+ * @return true if successful, false with errno EINVAL if a quoted field is
+ * unterminated or holds a lone quote (str is left unchanged)
+ */
+[[nodiscard]] bool string_append_csv_unquoted(string* str, string_view field);
+
+/**
+ * @brief Append a view percent-encoded for a URL component
+ *
+ * Everything except the RFC 3986 unreserved bytes (letters, digits, '-',
+ * '.', '_' and '~') becomes %XX with uppercase hex digits. With
+ * STRING_URL_FORM spaces become '+' instead.
+ * @param str Target string
+ * @param sv Bytes to encode
+ * @param flags 0 or STRING_URL_FORM
+ * @return true if successful, false if allocation fails
+ */
+[[nodiscard]] bool string_append_url_encoded(string* str, string_view sv, unsigned flags);
+
+/**
+ * @brief Append a percent-decoded view
+ * @param str Target string
+ * @param sv Encoded bytes
+ * @param flags 0, or STRING_URL_FORM to also decode '+' as a space
+ * @return true if successful, false with errno EINVAL on a '%' not followed
+ * by two hex digits (str is left unchanged)
+ */
+[[nodiscard]] bool string_append_url_decoded(string* str, string_view sv, unsigned flags);
+
+/**
+ * @brief Percent-decode a string in place
+ * @param str String to decode
+ * @param flags 0, or STRING_URL_FORM to also decode '+' as a space
+ * @return true if successful, false with errno EINVAL on a '%' not followed
+ * by two hex digits (str is left unchanged)
+ */
+[[nodiscard]] bool string_url_decode(string* str, unsigned flags);
+
 /**
  * @brief Set string content
  * @param str Target string
@@ -117,6 +593,15 @@ void string_free([[maybe_unused]] string* str);
  */
 [[nodiscard]] bool string_set(string* str, const char* cstr);
 
+/**
+ * @brief Set string content from a byte range of known length
+ * @param str Target string
+ * @param data New content (may contain embedded null bytes or point into str)
+ * @param length Number of bytes
+ * @return true if successful, false if allocation fails
+ */
+[[nodiscard]] bool string_set_n(string* str, const char* data, size_t length);
+
 /**
  * @brief Clear string content (set length to 0)
  * @param str Target string
@@ -139,6 +624,45 @@ void string_clear(string* str);
  */
 [[nodiscard]] bool string_equals(const string* str1, const string* str2);
 
+/**
+ * @brief Compare two strings, ignoring ASCII case
+ *
+ * Both sides are compared as if 'A'..'Z' were lowercase; other bytes,
+ * including UTF-8 sequences, must match exactly.
+ * @param str1 First string
+ * @param str2 Second string
+ * @return 0 if equal, <0 if str1 < str2, >0 if str1 > str2
+ */
+[[nodiscard]] int string_compare_icase(const string* str1, const string* str2);
+
+/**
+ * @brief Check two strings for equality, ignoring ASCII case
+ * @param str1 First string
+ * @param str2 Second string
+ * @return true if equal apart from ASCII case
+ */
+[[nodiscard]] bool string_equals_icase(const string* str1, const string* str2);
+
+/**
+ * @brief Hash a string's contents
+ *
+ * Uses a 64-bit wyhash-style function; equal contents always hash equal,
+ * whether they are held in a string or a view. The hash of a heap string is
+ * cached in its spare capacity until it is next modified, and string_equals
+ * uses cached hashes to reject mismatches early. Because the first call
+ * stores the cache, hash a string before sharing it read-only across threads.
+ * @param str String to hash (NULL hashes like an empty string)
+ * @return 64-bit hash
+ */
+[[nodiscard]] uint64_t string_hash(const string* str);
+
+/**
+ * @brief Hash a view with the same function as string_hash
+ * @param sv View to hash
+ * @return 64-bit hash, equal to string_hash of a string with the same bytes
+ */
+[[nodiscard]] uint64_t string_view_hash(string_view sv);
+
 /**
  * @brief Get character at index
  * @param str Target string
@@ -165,6 +689,9 @@ void string_clear(string* str);
 
 /**
  * @brief Create substring
+ *
+ * A suffix longer than SSO_SIZE of a shared string (see string_share) shares
+ * the buffer instead of copying it.
  * @param str Source string
  * @param start Start index
  * @param length Length of substring
@@ -174,12 +701,43 @@ void string_clear(string* str);
 
 /**
  * @brief Trim whitespace from both ends
+ *
+ * Whitespace is the C locale's isspace set. A heap string that ends up
+ * short enough moves back into the inline buffer, and one left mostly
+ * empty is shrunk; see string_trim_set for trimming without either.
  * @param str Target string
  */
 void string_trim(string* str);
 
+/**
+ * @brief Trim whitespace from the start
+ * @param str Target string
+ */
+void string_trim_left(string* str);
+
+/**
+ * @brief Trim whitespace from the end
+ * @param str Target string
+ */
+void string_trim_right(string* str);
+
+/**
+ * @brief Trim the bytes of a set from one or both ends
+ *
+ * With STRING_TRIM_KEEP_BUFFER the string keeps its buffer and capacity,
+ * so a buffer reused across many fields is only ever written in place. A
+ * shared string still gets a buffer of its own, as for any other write.
+ * @param str Target string
+ * @param set Bytes to strip, e.g. from string_byte_set_from
+ * @param flags STRING_TRIM_LEFT and/or STRING_TRIM_RIGHT, optionally with STRING_TRIM_KEEP_BUFFER
+ */
+void string_trim_set(string* str, const string_byte_set* set, unsigned flags);
+
 /**
  * @brief Convert string to uppercase
+ *
+ * Only ASCII letters change. Bytes of UTF-8 multibyte sequences are all
+ * 0x80 or above, so UTF-8 text stays valid and non-ASCII letters are kept.
  * @param str Target string
  */
 void string_to_upper(string* str);
@@ -199,6 +757,29 @@ void string_to_lower(string* str);
  */
 [[nodiscard]] string** string_split(const string* str, const char* delim, size_t* count);
 
+/**
+ * @brief Split string by delimiter, allocating the array and pieces in an arena
+ * @param arena Arena to allocate from
+ * @param str Target string
+ * @param delim Delimiter
+ * @param count Pointer to store number of splits
+ * @return Array of string pointers or NULL if allocation fails; released by resetting the arena
+ */
+[[nodiscard]] string** string_split_in(string_arena* arena, const string* str,
+                                       const char* delim, size_t* count);
+
+/**
+ * @brief Split string by delimiter into a contiguous array
+ *
+ * Appends the pieces string_split would return (none for an empty string
+ * or delimiter), copying them into the array's byte block in one pass.
+ * @param array Array to append to
+ * @param str Target string
+ * @param delim Delimiter
+ * @return true if successful, false if allocation fails (array is left unchanged)
+ */
+[[nodiscard]] bool string_split_into(string_array* array, const string* str, const char* delim);
+
 /**
  * @brief Join strings with delimiter
  * @param strs Array of strings
@@ -208,6 +789,74 @@ void string_to_lower(string* str);
  */
 [[nodiscard]] string* string_join(string** strs, size_t count, const char* delim);
 
+#ifdef STRING_HAVE_IOVEC
+/**
+ * @brief Describe the contents of an array of strings as iovec entries without copying
+ *
+ * Like snprintf, at most iov_count entries are filled and the number the
+ * whole array needs is returned, so a call with no array sizes one. NULL and
+ * empty strings take no entry. Entries point into the strings, which must
+ * stay alive and unmodified until the entries are used.
+ * @param strs Array of strings
+ * @param count Number of strings
+ * @param iov Entries to fill (can be NULL if iov_count is 0)
+ * @param iov_count Number of entries available
+ * @return Number of entries needed
+ */
+[[nodiscard]] size_t string_to_iovec(string** strs, size_t count, struct iovec* iov, size_t iov_count);
+
+/**
+ * @brief Lazy string_join: describe the joined result as iovec entries without copying
+ *
+ * The entries spell out exactly what string_join would return, pointing at
+ * the strings and at delim instead of copying them, at most 2 * count - 1
+ * entries. Sizing and lifetime work as for string_to_iovec; delim must stay
+ * alive as well.
+ * @param strs Array of strings
+ * @param count Number of strings
+ * @param delim Delimiter
+ * @param iov Entries to fill (can be NULL if iov_count is 0)
+ * @param iov_count Number of entries available
+ * @return Number of entries needed
+ */
+[[nodiscard]] size_t string_join_iovec(string** strs, size_t count, const char* delim,
+                                       struct iovec* iov, size_t iov_count);
+
+/**
+ * @brief Write every byte described by iovec entries, retrying after short writes
+ *
+ * Batches of IOV_MAX entries go to writev until all bytes are written; the
+ * entries are advanced past the bytes already written. Meant for blocking
+ * descriptors: a failure may come after part of the data was written.
+ * @param fd File descriptor
+ * @param iov Entries to write; consumed
+ * @param iov_count Number of entries
+ * @return true if everything was written, false with errno set otherwise
+ */
+[[nodiscard]] bool string_writev_fd(int fd, struct iovec* iov, size_t iov_count);
+
+/**
+ * @brief Write a string to a file descriptor, retrying after short writes
+ * @param fd File descriptor
+ * @param str String to write
+ * @return true if everything was written, false with errno set otherwise
+ */
+[[nodiscard]] bool string_write_fd(int fd, const string* str);
+
+/**
+ * @brief Write what string_join would return without building it
+ *
+ * Gathers the strings and delimiters a batch of entries at a time from a
+ * small stack array, so nothing is allocated or copied.
+ * @param fd File descriptor
+ * @param strs Array of strings
+ * @param count Number of strings
+ * @param delim Delimiter
+ * @return true if everything was written, false with errno set otherwise
+ */
+[[nodiscard]] bool string_join_write_fd(int fd, string** strs, size_t count, const char* delim);
+#endif
+
 /**
  * @brief Replace substring
  * @param str Target string
@@ -217,4 +866,835 @@ void string_to_lower(string* str);
  */
 [[nodiscard]] bool string_replace(string* str, const char* old_str, const char* new_str);
 
+/**
+ * @brief Create a view of a null-terminated C string
+ * @param cstr C-style string (can be NULL for an empty view)
+ * @return View of the string's bytes, excluding the terminator
+ */
+[[nodiscard]] string_view string_view_from_cstr(const char* cstr);
+
+/**
+ * @brief Create a view of a string's current contents
+ * @param str Source string (can be NULL for an empty view)
+ * @return View that is invalidated by any modification of str
+ */
+[[nodiscard]] string_view string_as_view(const string* str);
+
+/**
+ * @brief Parse a whole view as a signed decimal integer
+ *
+ * Accepts an optional sign followed by digits and nothing else, independent
+ * of the locale.
+ * @param view View to parse
+ * @param value Receives the value; unchanged on failure
+ * @return true if successful, false with errno EINVAL for malformed input or
+ *         ERANGE for values outside int64_t
+ */
+[[nodiscard]] bool string_view_to_int64(string_view view, int64_t* value);
+
+/**
+ * @brief Parse a whole view as an unsigned decimal integer
+ * @param view View to parse; an optional '+' may precede the digits
+ * @param value Receives the value; unchanged on failure
+ * @return true if successful, false with errno EINVAL or ERANGE as for
+ *         string_view_to_int64
+ */
+[[nodiscard]] bool string_view_to_uint64(string_view view, uint64_t* value);
+
+/**
+ * @brief Parse a whole view as a double, correctly rounded
+ *
+ * Accepts an optional sign, digits with an optional decimal point and an
+ * optional exponent ("1", "-0.5", ".5", "6.02e23"), or "inf", "infinity"
+ * and "nan" in any case. Hexadecimal floats are not accepted. Values too
+ * small for a double round to a subnormal or zero.
+ * @param view View to parse
+ * @param value Receives the value; unchanged on failure
+ * @return true if successful, false with errno EINVAL for malformed input or
+ *         ERANGE if the value overflows
+ */
+[[nodiscard]] bool string_view_to_double(string_view view, double* value);
+
+/**
+ * @brief Parse a whole string as a signed decimal integer, see string_view_to_int64
+ * @param str String to parse
+ * @param value Receives the value; unchanged on failure
+ * @return true if successful, false with errno set otherwise
+ */
+[[nodiscard]] bool string_to_int64(const string* str, int64_t* value);
+
+/**
+ * @brief Parse a whole string as an unsigned decimal integer, see string_view_to_uint64
+ * @param str String to parse
+ * @param value Receives the value; unchanged on failure
+ * @return true if successful, false with errno set otherwise
+ */
+[[nodiscard]] bool string_to_uint64(const string* str, uint64_t* value);
+
+/**
+ * @brief Parse a whole string as a double, see string_view_to_double
+ * @param str String to parse
+ * @param value Receives the value; unchanged on failure
+ * @return true if successful, false with errno set otherwise
+ */
+[[nodiscard]] bool string_to_double(const string* str, double* value);
+
+/**
+ * @brief Narrow a view without copying
+ * @param sv Source view
+ * @param start Start index
+ * @param length Maximum length of the result
+ * @return View of the requested range, clamped to sv; empty if start is out of bounds
+ */
+[[nodiscard]] string_view string_view_substr(string_view sv, size_t start, size_t length);
+
+/**
+ * @brief Find a view inside another view
+ * @param sv View to search
+ * @param needle View to find
+ * @return Index of first occurrence or -1 if not found
+ */
+[[nodiscard]] ptrdiff_t string_view_find(string_view sv, string_view needle);
+
+/**
+ * @brief Check if two views have the same bytes
+ * @param a First view
+ * @param b Second view
+ * @return true if equal, false otherwise
+ */
+[[nodiscard]] bool string_view_equals(string_view a, string_view b);
+
+/**
+ * @brief Compare two views lexicographically by unsigned byte value
+ * @param a First view
+ * @param b Second view
+ * @return 0 if equal, <0 if a < b, >0 if a > b
+ */
+[[nodiscard]] int string_view_compare(string_view a, string_view b);
+
+/**
+ * @brief Split a view by delimiter without allocating
+ * @param sv View to split
+ * @param delim Delimiter (must not be empty)
+ * @param parts Caller-provided array receiving up to max_parts views (can be NULL)
+ * @param max_parts Capacity of parts
+ * @return Total number of pieces, which may exceed max_parts; 0 if delim is empty
+ */
+[[nodiscard]] size_t string_view_split(string_view sv, string_view delim,
+                                       string_view* parts, size_t max_parts);
+
+/**
+ * @brief Build a byte set from the bytes of a view
+ * @param chars Member bytes (may contain embedded null bytes)
+ * @return Set containing every byte of chars
+ */
+[[nodiscard]] string_byte_set string_byte_set_from(string_view chars);
+
+/**
+ * @brief Check whether a byte is in a set
+ * @param set Byte set
+ * @param c Byte to look up
+ * @return true if c is a member, false otherwise
+ */
+[[nodiscard]] bool string_byte_set_contains(const string_byte_set* set, char c);
+
+/**
+ * @brief Find the first byte of a view that belongs to a set
+ * @param sv View to search
+ * @param set Bytes to look for
+ * @return Index of the first member byte or -1 if there is none
+ */
+[[nodiscard]] ptrdiff_t string_view_find_any(string_view sv, const string_byte_set* set);
+
+/**
+ * @brief Start splitting a view on a delimiter sequence
+ * @param tok Tokenizer to initialize
+ * @param input View to split
+ * @param delim Single or multi-byte delimiter; if empty the input is one piece
+ */
+void string_tokenizer_init(string_tokenizer* tok, string_view input, string_view delim);
+
+/**
+ * @brief Start splitting a view on a compiled delimiter
+ * @param tok Tokenizer to initialize
+ * @param input View to split
+ * @param delim Compiled delimiter, which must outlive the tokenizer
+ */
+void string_tokenizer_init_with(string_tokenizer* tok, string_view input, const string_searcher* delim);
+
+/**
+ * @brief Start splitting a view on any of a set of delimiter bytes
+ * @param tok Tokenizer to initialize
+ * @param input View to split
+ * @param chars Delimiter bytes; each occurrence of any of them ends a piece
+ */
+void string_tokenizer_init_any(string_tokenizer* tok, string_view input, string_view chars);
+
+/**
+ * @brief Produce the next piece
+ * @param tok Tokenizer
+ * @param token Receives a view of the piece; its offset is token->data - input.data (can be NULL)
+ * @return true if a piece was produced, false once the input is exhausted
+ */
+[[nodiscard]] bool string_tokenizer_next(string_tokenizer* tok, string_view* token);
+
+/**
+ * @brief Create a new string holding a copy of a view
+ * @param sv View to copy (may contain embedded null bytes)
+ * @return New string instance or NULL if allocation fails
+ */
+[[nodiscard]] string* string_new_view(string_view sv);
+
+/**
+ * @brief Set string content from a view
+ * @param str Target string
+ * @param sv New content; may point into str itself
+ * @return true if successful, false if allocation fails
+ */
+[[nodiscard]] bool string_set_view(string* str, string_view sv);
+
+/**
+ * @brief Append a view to a string
+ * @param str Target string
+ * @param sv View to append; may point into str itself
+ * @return true if successful, false if allocation fails
+ */
+[[nodiscard]] bool string_append_view(string* str, string_view sv);
+
+/**
+ * @brief Find a view in a string
+ * @param str Target string
+ * @param needle View to find
+ * @return Index of first occurrence or -1 if not found
+ */
+[[nodiscard]] ptrdiff_t string_find_view(const string* str, string_view needle);
+
+/**
+ * @brief Find the first occurrence of a view, ignoring ASCII case
+ *
+ * Case is folded inside the vector search loop, so neither side is copied.
+ * Like string_find_view the worst case stays linear.
+ * @param str String to search
+ * @param needle View to find
+ * @return Index of the first occurrence or -1 if not found
+ */
+[[nodiscard]] ptrdiff_t string_find_icase(const string* str, string_view needle);
+
+/**
+ * @brief Compile a C-style needle for repeated searches
+ * @param needle Needle to copy
+ * @return New searcher or NULL if needle is NULL or allocation fails
+ */
+[[nodiscard]] string_searcher* string_searcher_new(const char* needle);
+
+/**
+ * @brief Compile a needle view for repeated searches
+ * @param needle Needle to copy (may contain embedded null bytes)
+ * @return New searcher or NULL if allocation fails
+ */
+[[nodiscard]] string_searcher* string_searcher_new_view(string_view needle);
+
+/**
+ * @brief Free a searcher
+ * @param searcher Searcher to free (can be NULL)
+ */
+void string_searcher_free(string_searcher* searcher);
+
+/**
+ * @brief Get the needle a searcher was built from
+ * @param searcher Source searcher
+ * @return View of the searcher's copy of the needle, valid until it is freed
+ */
+[[nodiscard]] string_view string_searcher_needle(const string_searcher* searcher);
+
+/**
+ * @brief Find the searcher's needle in a view
+ * @param searcher Compiled needle
+ * @param haystack View to search; use string_as_view for a string
+ * @return Index of first occurrence, 0 for an empty needle, or -1 if not found
+ */
+[[nodiscard]] ptrdiff_t string_searcher_find(const string_searcher* searcher, string_view haystack);
+
+/**
+ * @brief Find every non-overlapping occurrence of the searcher's needle
+ * @param searcher Compiled needle (must not be empty)
+ * @param haystack View to search
+ * @param positions Caller-provided array receiving up to max_positions offsets (can be NULL)
+ * @param max_positions Capacity of positions
+ * @return Total number of matches, which may exceed max_positions
+ */
+[[nodiscard]] size_t string_searcher_find_all(const string_searcher* searcher, string_view haystack,
+                                              size_t* positions, size_t max_positions);
+
+/**
+ * @brief Split string by a compiled delimiter
+ * @param str Target string
+ * @param delim Compiled delimiter (must not be empty)
+ * @param count Pointer to store number of splits
+ * @return Array of string pointers or NULL if allocation fails
+ */
+[[nodiscard]] string** string_split_with(const string* str, const string_searcher* delim, size_t* count);
+
+/**
+ * @brief Replace every occurrence of a compiled needle
+ * @param str Target string
+ * @param old Compiled substring to replace
+ * @param new_str Replacement
+ * @return true if successful, false if allocation fails
+ */
+[[nodiscard]] bool string_replace_with(string* str, const string_searcher* old, const char* new_str);
+
+/**
+ * @brief Compile a set of C-style patterns for multi-pattern search
+ * @param patterns Array of non-empty patterns
+ * @param count Number of patterns
+ * @return New matcher or NULL if a pattern is NULL or empty, or allocation fails
+ */
+[[nodiscard]] string_matcher* string_matcher_new(const char* const* patterns, size_t count);
+
+/**
+ * @brief Compile a set of pattern views for multi-pattern search
+ * @param patterns Array of non-empty patterns (may contain embedded null bytes)
+ * @param count Number of patterns
+ * @return New matcher or NULL if a pattern is empty or allocation fails
+ */
+[[nodiscard]] string_matcher* string_matcher_new_views(const string_view* patterns, size_t count);
+
+/**
+ * @brief Free a matcher
+ * @param matcher Matcher to free (can be NULL)
+ */
+void string_matcher_free(string_matcher* matcher);
+
+/**
+ * @brief Get the number of patterns in a matcher
+ * @param matcher Source matcher
+ * @return Pattern count, or 0 if matcher is NULL
+ */
+[[nodiscard]] size_t string_matcher_count(const string_matcher* matcher);
+
+/**
+ * @brief Find the leftmost-longest match of any pattern
+ * @param matcher Compiled patterns
+ * @param haystack View to search
+ * @param match Receives the match
+ * @return true if a pattern was found, false otherwise
+ */
+[[nodiscard]] bool string_matcher_find(const string_matcher* matcher, string_view haystack,
+                                       string_match* match);
+
+/**
+ * @brief Find every non-overlapping match in one pass
+ * @param matcher Compiled patterns
+ * @param haystack View to search
+ * @param matches Caller-provided array receiving up to max_matches matches (can be NULL)
+ * @param max_matches Capacity of matches
+ * @return Total number of matches, which may exceed max_matches
+ */
+[[nodiscard]] size_t string_matcher_find_all(const string_matcher* matcher, string_view haystack,
+                                             string_match* matches, size_t max_matches);
+
+/**
+ * @brief Replace every match of every pattern in a single pass
+ * @param str Target string
+ * @param matcher Compiled patterns
+ * @param replacements One replacement per pattern, by pattern index; NULL deletes the match
+ * @return true if successful, false if allocation fails
+ */
+[[nodiscard]] bool string_replace_many(string* str, const string_matcher* matcher,
+                                       const char* const* replacements);
+
+/**
+ * @brief Create an empty interning pool
+ * @return New pool or NULL if allocation fails
+ */
+[[nodiscard]] string_pool* string_pool_new(void);
+
+/**
+ * @brief Free a pool and every string interned in it
+ * @param pool Pool to free; no other thread may still be using it
+ */
+void string_pool_free(string_pool* pool);
+
+/**
+ * @brief Get the canonical string for a C string, adding it if needed
+ * @param pool Target pool
+ * @param cstr Value to intern
+ * @return Interned string owned by the pool, or NULL if allocation fails
+ */
+[[nodiscard]] const string* string_pool_intern(string_pool* pool, const char* cstr);
+
+/**
+ * @brief Get the canonical string for a view, adding it if needed
+ * @param pool Target pool
+ * @param sv Value to intern; may contain embedded NULs
+ * @return Interned string owned by the pool, or NULL if allocation fails
+ */
+[[nodiscard]] const string* string_pool_intern_view(string_pool* pool, string_view sv);
+
+/**
+ * @brief Look up a value without adding it
+ * @param pool Pool to search
+ * @param sv Value to look up
+ * @return Interned string, or NULL if the value has not been interned
+ */
+[[nodiscard]] const string* string_pool_find(const string_pool* pool, string_view sv);
+
+/**
+ * @brief Get the number of distinct values in a pool
+ * @param pool Pool to count
+ * @return Number of interned strings
+ */
+[[nodiscard]] size_t string_pool_count(const string_pool* pool);
+
+/**
+ * @brief Create an empty rope
+ * @return New rope or NULL if allocation fails
+ */
+[[nodiscard]] string_rope* string_rope_new(void);
+
+/**
+ * @brief Free a rope; leaves shared with other ropes stay alive for them
+ * @param rope Rope to free
+ */
+void string_rope_free(string_rope* rope);
+
+/**
+ * @brief Get the length of a rope
+ * @param rope Target rope
+ * @return Total number of bytes
+ */
+[[nodiscard]] size_t string_rope_length(const string_rope* rope);
+
+/**
+ * @brief Append a copy of a view to a rope
+ *
+ * Short appends are merged into the last leaf, so building a document from
+ * many small pieces costs amortized O(1) per piece.
+ * @param rope Target rope
+ * @param sv Bytes to append
+ * @return true if successful, false if allocation fails (the rope is unchanged)
+ */
+[[nodiscard]] bool string_rope_append(string_rope* rope, string_view sv);
+
+/**
+ * @brief Move a string's buffer into a rope as a new leaf
+ *
+ * Long heap strings are adopted without copying their bytes; short and arena
+ * strings are copied. Either way str is left empty on success.
+ * @param rope Target rope
+ * @param str String to take the contents of
+ * @return true if successful, false if allocation fails (both are unchanged)
+ */
+[[nodiscard]] bool string_rope_append_string(string_rope* rope, string* str);
+
+/**
+ * @brief Insert a copy of a view at a byte offset
+ * @param rope Target rope
+ * @param pos Offset to insert at (at most the length)
+ * @param sv Bytes to insert
+ * @return true if successful, false if pos is out of range or allocation fails
+ */
+[[nodiscard]] bool string_rope_insert(string_rope* rope, size_t pos, string_view sv);
+
+/**
+ * @brief Remove a range of bytes
+ * @param rope Target rope
+ * @param pos Offset of the first byte to remove (at most the length)
+ * @param length Number of bytes to remove; clamped to the end of the rope
+ * @return true if successful, false if pos is out of range or allocation fails
+ */
+[[nodiscard]] bool string_rope_erase(string_rope* rope, size_t pos, size_t length);
+
+/**
+ * @brief Create a rope holding a range of another, sharing its leaves
+ * @param rope Source rope
+ * @param start Offset of the first byte; past the end gives an empty rope
+ * @param length Number of bytes; clamped to the end of the rope
+ * @return New rope or NULL if allocation fails
+ */
+[[nodiscard]] string_rope* string_rope_substr(const string_rope* rope, size_t start, size_t length);
+
+/**
+ * @brief Get the byte at an offset in O(log n)
+ * @param rope Target rope
+ * @param index Offset of the byte
+ * @return Byte at index, or '\0' if index is out of bounds
+ */
+[[nodiscard]] char string_rope_char_at(const string_rope* rope, size_t index);
+
+/**
+ * @brief Collapse a rope into a single contiguous string
+ *
+ * The bytes are copied once, into a leaf that then replaces the whole tree,
+ * so flattening again before the next edit is free.
+ * @param rope Target rope
+ * @return String owned by the rope, valid until the rope is next modified or
+ *         freed, or NULL if allocation fails
+ */
+[[nodiscard]] const string* string_rope_flatten(string_rope* rope);
+
+/**
+ * @brief Start iterating over the chunks of a rope
+ * @param iter Iterator to initialize
+ * @param rope Rope to walk
+ */
+void string_rope_iter_init(string_rope_iter* iter, const string_rope* rope);
+
+/**
+ * @brief Get the next chunk of a rope without copying it
+ * @param iter Iterator
+ * @param chunk Receives a view of the chunk (can be NULL)
+ * @return true if a chunk was produced, false once the rope is exhausted
+ */
+[[nodiscard]] bool string_rope_iter_next(string_rope_iter* iter, string_view* chunk);
+
+/**
+ * @brief Load a whole file into a string
+ *
+ * STRING_FILE_MAP maps regular files privately and hints sequential access,
+ * so loading costs no copy and the pages are shared with the page cache. The
+ * string behaves like any other: modifying it copies only the touched pages,
+ * and growing it moves it to the heap. The file should not be changed by
+ * others while it is mapped. Pipes, empty files and platforms without mmap
+ * fall back to STRING_FILE_READ.
+ * @param path File to load
+ * @param mode STRING_FILE_READ or STRING_FILE_MAP
+ * @return New string, or NULL with errno set if the file cannot be read
+ */
+[[nodiscard]] string* string_from_file(const char* path, string_file_mode mode);
+
+/**
+ * @brief Start iterating over the lines of a view
+ * @param iter Iterator to initialize
+ * @param input View to split, e.g. string_as_view of a mapped file
+ */
+void string_line_iter_init(string_line_iter* iter, string_view input);
+
+/**
+ * @brief Get the next line as a view into the input
+ * @param iter Iterator
+ * @param line Receives the line without its terminator (can be NULL)
+ * @return true if a line was produced, false once the input is exhausted
+ */
+[[nodiscard]] bool string_line_iter_next(string_line_iter* iter, string_view* line);
+
+/**
+ * @brief Check that a string is well-formed UTF-8
+ *
+ * Overlong forms, surrogates, code points past U+10FFFF and truncated
+ * sequences are rejected. Heap strings found to be pure ASCII remember it
+ * until they are next modified, which makes repeated checks and
+ * string_utf8_length free.
+ * @param str String to check
+ * @return true if valid, false if not or if str is NULL
+ */
+[[nodiscard]] bool string_utf8_validate(const string* str);
+
+/**
+ * @brief Check that a view is well-formed UTF-8
+ * @param sv View to check
+ * @return true if valid, false if not or if sv.data is NULL
+ */
+[[nodiscard]] bool string_view_utf8_validate(string_view sv);
+
+/**
+ * @brief Count the code points of a string
+ *
+ * Every byte that is not a continuation byte starts a code point, so
+ * invalid input is counted without failing.
+ * @param str String to measure
+ * @return Number of code points
+ */
+[[nodiscard]] size_t string_utf8_length(const string* str);
+
+/**
+ * @brief Count the code points of a view
+ * @param sv View to measure
+ * @return Number of code points
+ */
+[[nodiscard]] size_t string_view_utf8_length(string_view sv);
+
+/**
+ * @brief Extract a substring by code point positions
+ *
+ * Like string_substr, but start and length count code points, so the
+ * result never splits a multibyte sequence.
+ * @param str Source string
+ * @param start First code point
+ * @param length Maximum number of code points
+ * @return New string, or NULL if start is past the last code point
+ */
+[[nodiscard]] string* string_utf8_substr(const string* str, size_t start, size_t length);
+
+/**
+ * @brief Convert to uppercase using several threads
+ *
+ * The buffer is split into 256 KiB chunks that the calling thread and up to
+ * threads - 1 workers convert with the active SIMD kernel. Strings under
+ * 1 MiB are converted on the calling thread alone.
+ * @param str Target string
+ * @param threads Thread count including the caller (0 for one per online CPU)
+ */
+void string_to_upper_parallel(string* str, unsigned threads);
+
+/**
+ * @brief Convert to lowercase using several threads
+ * @param str Target string
+ * @param threads Thread count including the caller (0 for one per online CPU)
+ */
+void string_to_lower_parallel(string* str, unsigned threads);
+
+/**
+ * @brief Find the first occurrence of a view using several threads
+ *
+ * Matches spanning chunk boundaries are found, and the result is always the
+ * earliest one, as with string_find_view.
+ * @param str String to search
+ * @param needle View to find
+ * @param threads Thread count including the caller (0 for one per online CPU)
+ * @return Index of the first occurrence or -1 if not found
+ */
+[[nodiscard]] ptrdiff_t string_find_parallel(const string* str, string_view needle, unsigned threads);
+
+/**
+ * @brief Count non-overlapping occurrences of a view
+ *
+ * Occurrences are taken left to right, as string_replace does, so "aa"
+ * occurs twice in "aaaaa".
+ * @param str String to search
+ * @param needle View to count
+ * @return Number of occurrences; 0 for an empty needle
+ */
+[[nodiscard]] size_t string_count(const string* str, string_view needle);
+
+/**
+ * @brief Count non-overlapping occurrences of a view using several threads
+ * @param str String to search
+ * @param needle View to count
+ * @param threads Thread count including the caller (0 for one per online CPU)
+ * @return Same result as string_count
+ */
+[[nodiscard]] size_t string_count_parallel(const string* str, string_view needle, unsigned threads);
+
+/**
+ * @brief Sort an array of strings into string_compare order
+ *
+ * A multikey quicksort that keeps each string's next 8 bytes inline as a
+ * big-endian integer, so most comparisons never touch the string data.
+ * NULL entries sort first. The sort is not stable.
+ * @param strings Array to sort in place, e.g. the result of string_split
+ * @param count Number of entries
+ */
+void string_array_sort(string** strings, size_t count);
+
+/**
+ * @brief Sort an array of strings using several threads
+ *
+ * Arrays of 64Ki strings or more are bucketed on their first two bytes and
+ * the buckets sorted concurrently; smaller ones are sorted on the calling
+ * thread.
+ * @param strings Array to sort in place
+ * @param count Number of entries
+ * @param threads Thread count including the caller (0 for one per online CPU)
+ */
+void string_array_sort_parallel(string** strings, size_t count, unsigned threads);
+
+/**
+ * @brief Remove adjacent duplicates from a sorted array of strings
+ *
+ * The removed strings are freed with string_free; entries past the returned
+ * count are left unspecified.
+ * @param strings Sorted array, compacted in place
+ * @param count Number of entries
+ * @return Number of distinct strings now at the front of the array
+ */
+[[nodiscard]] size_t string_array_unique(string** strings, size_t count);
+
+/**
+ * @brief Create an empty contiguous string array
+ * @return New array or NULL if allocation fails
+ */
+[[nodiscard]] string_array* string_array_new(void);
+
+/**
+ * @brief Free a string array and its bytes
+ * @param array Array to free (can be NULL)
+ */
+void string_array_free(string_array* array);
+
+/**
+ * @brief Remove every item, keeping the memory for reuse
+ * @param array Array to clear
+ */
+void string_array_clear(string_array* array);
+
+/**
+ * @brief Get the number of items
+ * @param array Array (can be NULL)
+ * @return Item count
+ */
+[[nodiscard]] size_t string_array_count(const string_array* array);
+
+/**
+ * @brief Get one item
+ *
+ * The view's bytes are followed by a null byte and stay valid until the
+ * array is next modified.
+ * @param array Array
+ * @param index Item index
+ * @return View of the item, or an empty view if index is out of range
+ */
+[[nodiscard]] string_view string_array_get(const string_array* array, size_t index);
+
+/**
+ * @brief Append a copy of a view
+ * @param array Array to append to
+ * @param sv Bytes to copy (may point into the array itself)
+ * @return true if successful, false if allocation fails
+ */
+[[nodiscard]] bool string_array_push(string_array* array, string_view sv);
+
+/**
+ * @brief Join the items of an array with a delimiter
+ * @param array Array
+ * @param delim Delimiter
+ * @return New joined string (empty for an empty array) or NULL if allocation fails
+ */
+[[nodiscard]] string* string_array_join(const string_array* array, const char* delim);
+
+/**
+ * @brief Sort the items of an array into string_compare order
+ *
+ * Uses the multikey quicksort of string_array_sort. Only the offset table is
+ * reordered; the bytes stay where they are.
+ * @param array Array to sort
+ * @return true if successful, false if allocation fails (order is unchanged)
+ */
+[[nodiscard]] bool string_array_sort_items(string_array* array);
+
+/**
+ * @brief Remove adjacent duplicate items from a sorted array
+ *
+ * The bytes of removed items are reclaimed only by string_array_clear.
+ * @param array Sorted array, compacted in place
+ * @return Number of items left
+ */
+size_t string_array_unique_items(string_array* array);
+
+/**
+ * @brief Find the first item equal to a view
+ *
+ * Scans the offset table in order and only compares the bytes of items of
+ * the right length.
+ * @param array Array to search
+ * @param sv Value to look for
+ * @return Index of the first equal item or -1 if there is none
+ */
+[[nodiscard]] ptrdiff_t string_array_find(const string_array* array, string_view sv);
+
+/**
+ * @brief Binary search a sorted array for a view
+ * @param array Array in string_compare order, e.g. after string_array_sort_items
+ * @param sv Value to look for
+ * @return Index of an equal item or -1 if there is none
+ */
+[[nodiscard]] ptrdiff_t string_array_find_sorted(const string_array* array, string_view sv);
+
+/**
+ * @brief SIMD instruction sets the kernels can be dispatched to
+ *
+ * The widest level supported by the running CPU is selected when the library
+ * is loaded, so a single binary can be shipped to heterogeneous hardware.
+ */
+typedef enum {
+    STRING_SIMD_SCALAR = 0,     // Portable C implementation
+    STRING_SIMD_SSE42,          // x86 SSE4.2, 16 bytes per iteration
+    STRING_SIMD_AVX2,           // x86 AVX2, 32 bytes per iteration
+    STRING_SIMD_AVX512,         // x86 AVX-512BW, 64 bytes per iteration
+    STRING_SIMD_NEON            // AArch64 Advanced SIMD, 16 bytes per iteration
+} string_simd_level;
+
+/**
+ * @brief Get the SIMD level used by compare, equals, find and case conversion
+ * @return Currently active SIMD level
+ */
+[[nodiscard]] string_simd_level string_simd_get_level(void);
+
+/**
+ * @brief Force a specific SIMD level (for testing and benchmarking)
+ * @param level Level to activate
+ * @return true if the level is available on this build and CPU, false otherwise
+ */
+[[nodiscard]] bool string_simd_set_level(string_simd_level level);
+
+/**
+ * @brief Check whether a SIMD level can run on this build and CPU
+ * @param level Level to check
+ * @return true if supported, false otherwise
+ */
+[[nodiscard]] bool string_simd_level_supported(string_simd_level level);
+
+/**
+ * @brief Get a human-readable name for a SIMD level
+ * @param level Level to name
+ * @return Static string such as "avx2"
+ */
+[[nodiscard]] const char* string_simd_level_name(string_simd_level level);
+
+/**
+ * @brief Get the calling thread's instrumentation counters
+ * @return Counters accumulated since the thread started or last reset
+ */
+[[nodiscard]] string_stats string_stats_get(void);
+
+/**
+ * @brief Zero the calling thread's instrumentation counters
+ */
+void string_stats_reset(void);
+
+/**
+ * @brief Check whether the library was built with instrumentation counters
+ * @return true if built with STRING_STATS, false if the counters are compiled out
+ */
+[[nodiscard]] bool string_stats_enabled(void);
+
+/**
+ * @brief Set the allocator for string headers and buffers on every thread
+ *
+ * Buffers remember their allocator, so existing ones are still released
+ * through the allocator that produced them. Headers from string_new do not,
+ * so this must be called while no heap-allocated string headers are alive.
+ * Up to 255 distinct allocators can be registered over a process lifetime.
+ * @param allocator Allocator to install (NULL restores malloc)
+ * @return true on success, false with errno EINVAL for an allocator without
+ *         allocate or deallocate, or ENOSPC if the registry is full
+ */
+[[nodiscard]] bool string_set_allocator(const string_allocator* allocator);
+
+/**
+ * @brief Set the allocator for buffers created on the calling thread
+ *
+ * Takes precedence over string_set_allocator for string buffers and for
+ * arenas created without an explicit allocator; headers still use the global
+ * allocator. Buffers may be freed or grown on any thread.
+ * @param allocator Allocator to install (NULL to follow the global allocator)
+ * @return true on success, false as for string_set_allocator
+ */
+[[nodiscard]] bool string_set_thread_allocator(const string_allocator* allocator);
+
+/**
+ * @brief Free the headers and buffers cached by the calling thread
+ *
+ * Each thread keeps a few freed buffers of every cache-line multiple up to
+ * 4 KiB (8 KiB per size, at most 16 buffers), plus freed string headers, for
+ * reuse by later strings; the cache is released automatically when the
+ * thread exits. Only buffers from the C library allocator are cached.
+ */
+void string_buffer_cache_release(void);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* STRING_LIB_H */
\ No newline at end of file
@@ -0,0 +1,173 @@
+/**
+ * @file test_libstring.cpp
+ * @brief Tests for the C++ wrapper in libstring.hpp
+ */
+#include "libstring.hpp"
+
+#include <cassert>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+static_assert(!std::is_copy_constructible_v<libstring::string>);
+static_assert(!std::is_copy_assignable_v<libstring::string>);
+static_assert(std::is_nothrow_move_constructible_v<libstring::string>);
+static_assert(std::is_nothrow_move_assignable_v<libstring::string>);
+static_assert(std::is_convertible_v<std::string_view, libstring::string>);
+static_assert(std::is_convertible_v<libstring::string, std::string_view>);
+
+static void test_construction() {
+    printf("\n=== C++ Wrapper Construction Tests ===\n");
+
+    libstring::string empty;
+    assert(empty.empty() && empty.length() == 0 && empty.cstr()[0] == '\0');
+
+    // Inline and heap values, from every view-like source
+    libstring::string small = "short";
+    libstring::string heap = std::string(100, 'x');
+    libstring::string from_view = std::string_view("view bytes");
+    assert(small.length() == 5 && small == "short");
+    assert(heap.length() == 100 && heap.char_at(99) == 'x' && heap.char_at(100) == '\0');
+    assert(from_view == std::string_view("view bytes"));
+    assert(small.length() == string_length(small.get()));
+    assert(heap.cstr() == string_cstr(heap.get()));
+
+    // Embedded null bytes survive the view round trip
+    const char bytes[] = { 'a', '\0', 'b' };
+    libstring::string embedded = std::string_view(bytes, 3);
+    assert(embedded.length() == 3 && embedded[2] == 'b');
+
+    libstring::string copy = heap.clone();
+    assert(copy == heap && copy.cstr() != heap.cstr());
+
+    printf("C++ wrapper construction tests passed\n");
+}
+
+static void test_moves() {
+    printf("\n=== C++ Wrapper Move Tests ===\n");
+
+    // A heap move steals the buffer
+    libstring::string heap = std::string(200, 'h');
+    const char* buffer = heap.cstr();
+    libstring::string stolen = std::move(heap);
+    assert(stolen.cstr() == buffer && stolen.length() == 200);
+    assert(heap.empty() && heap.cstr() != buffer);
+
+    // An inline move carries the bytes along
+    libstring::string small = "inline";
+    libstring::string moved = std::move(small);
+    assert(moved == "inline" && small.empty());
+
+    // Assignment frees what was there, and a moved-from string is reusable
+    moved = std::move(stolen);
+    assert(moved.length() == 200 && moved.cstr() == buffer && stolen.empty());
+    stolen.append("again");
+    assert(stolen == "again");
+    moved = "assigned";
+    assert(moved == "assigned");
+
+    // Self-move leaves the value alone
+    libstring::string& alias = moved;
+    moved = std::move(alias);
+    assert(moved == "assigned");
+
+    // Containers relocate by moving without allocating
+    std::vector<libstring::string> items;
+    for (int i = 0; i < 100; i++) {
+        libstring::string item = "item ";
+        item.append_int(i);
+        items.push_back(std::move(item));
+    }
+    assert(items[42] == "item 42" && items.size() == 100);
+
+    printf("C++ wrapper move tests passed\n");
+}
+
+static void test_modifiers() {
+    printf("\n=== C++ Wrapper Modifier Tests ===\n");
+
+    libstring::string str;
+    str += "Hello";
+    str += ',';
+    str.push_back(' ');
+    str.append(std::string("world")).append_double(2.5);
+    assert(str == "Hello, world2.5");
+    assert(str.find("world") == 7 && str.find("absent") == libstring::string::npos);
+
+    str.to_upper();
+    assert(str == "HELLO, WORLD2.5");
+    str.to_lower();
+    assert(str == std::string("hello, world2.5"));
+
+    str.reserve(1000);
+    assert(str.capacity() >= 1000);
+    str.shrink_to_fit();
+    assert(str.capacity() < 1000 && str == "hello, world2.5");
+
+    str.clear();
+    assert(str.empty());
+
+    // The wrapped struct works with the C API directly
+    assert(string_append_cstr(str.get(), "from C"));
+    assert(str == "from C");
+
+    bool threw = false;
+    try {
+        str.reserve(SIZE_MAX);
+    } catch (const std::length_error&) {
+        threw = true;
+    }
+    assert(threw);
+
+    printf("C++ wrapper modifier tests passed\n");
+}
+
+static void test_lookup() {
+    printf("\n=== C++ Wrapper Lookup Tests ===\n");
+
+    // Comparisons against every view-like type
+    libstring::string a = "apple", b = "banana";
+    assert(a < b && b > a && a <= a && a >= a && a != b);
+    assert(a == "apple" && "apple" == a && a != "apples");
+    assert(a == std::string("apple") && std::string_view("apple") == a);
+    assert(a < std::string_view("apples") && std::string_view("ap") < a);
+
+    // A string and a view of the same bytes hash alike
+    std::hash<libstring::string> hasher;
+    libstring::string long_key = std::string(64, 'k');
+    assert(hasher(a) == hasher(std::string_view("apple")));
+    assert(hasher(long_key) == hasher(std::string(64, 'k')));
+    assert(hasher("apple") == libstring::hash{}(a));
+
+    std::unordered_map<libstring::string, int> counts;
+    counts.emplace("alpha", 1);
+    counts.emplace(std::string(40, 'z'), 2);
+    assert(counts.at(libstring::string("alpha")) == 1);
+#if __cplusplus >= 202002L
+    // Heterogeneous lookup: no temporary key is built
+    assert(counts.find(std::string_view("alpha"))->second == 1);
+    assert(counts.find("missing") == counts.end());
+#endif
+
+    std::map<libstring::string, int, std::less<>> ordered;
+    ordered.emplace("b", 2);
+    ordered.emplace("a", 1);
+    assert(ordered.begin()->first == "a");
+    assert(ordered.find(std::string_view("b"))->second == 2);
+    assert(ordered.find("c") == ordered.end());
+
+    printf("C++ wrapper lookup tests passed\n");
+}
+
+int main() {
+    test_construction();
+    test_moves();
+    test_modifiers();
+    test_lookup();
+    printf("\nAll C++ wrapper tests completed.\n");
+    return 0;
+}
@@ -3,12 +3,20 @@
  * @brief Test program for the custom C23 string library
  * @author GitHub Copilot
  */
-#define _POSIX_C_SOURCE 199309L  // For CLOCK_MONOTONIC
+#define _GNU_SOURCE  // For mkstemp
 #include "string_lib.h"
 #include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <math.h>
+#include <string.h>
+#include <ctype.h>
 #include <assert.h>
-#include <time.h>     // For clock functions
-#include <unistd.h>   // For POSIX definitions including CLOCK_MONOTONIC
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
 
 // Utility function to print string info
 void print_string_info(const char* label, const string* str) {
@@ -121,6 +129,16 @@ void test_split_join() {
         string_free(parts[i]);
     }
     free(parts);
+    
+    // A trailing delimiter yields a final empty piece
+    str = string_new("a,b,");
+    parts = string_split(str, ",", &count);
+    assert(count == 3 && parts[2] && string_is_empty(parts[2]));
+    for (size_t i = 0; i < count; i++) {
+        string_free(parts[i]);
+    }
+    free(parts);
+    string_free(str);
 }
 
 // Test error handling and edge cases
@@ -143,146 +161,2588 @@ void test_edge_cases() {
     string_free(empty);
 }
 
-// ========================= BENCHMARK FUNCTIONS =========================
+// Test non-owning views
+void test_binary_safe() {
+    printf("\n=== Length-aware APIs ===\n");
+    
+    // Embedded NULs survive every length-aware entry point
+    const char payload[] = { 'a', '\0', 'b', '\0', 'c' };
+    string* str = string_new_n(payload, sizeof(payload));
+    assert(str && string_length(str) == 5 && memcmp(string_cstr(str), payload, 5) == 0);
+    assert(string_append_n(str, payload, sizeof(payload)) && string_length(str) == 10);
+    assert(memcmp(string_cstr(str) + 5, payload, 5) == 0 && string_cstr(str)[10] == '\0');
+    
+    // string_append uses the stored length, including appending to itself
+    assert(string_append(str, str) && string_length(str) == 20);
+    assert(memcmp(string_cstr(str) + 15, payload, 5) == 0);
+    
+    // Set from a byte range, including one inside the string
+    assert(string_set_n(str, "xyz", 2) && string_length(str) == 2 && strcmp(string_cstr(str), "xy") == 0);
+    string* heap = string_new("a long enough string to live on the heap");
+    assert(string_set_n(heap, string_cstr(heap) + 2, 4) && strcmp(string_cstr(heap), "long") == 0);
+    assert(string_append_n(heap, string_cstr(heap), 4) && strcmp(string_cstr(heap), "longlong") == 0);
+    
+    // NULL data is only valid for an empty range
+    assert(string_set_n(str, NULL, 0) && string_length(str) == 0);
+    assert(!string_append_n(str, NULL, 1) && !string_set_n(str, NULL, 1) && !string_new_n(NULL, 1));
+    string* empty = string_new_n(NULL, 0);
+    assert(empty && string_length(empty) == 0);
+    
+    // Join copies pieces by length, so NULs inside them are kept
+    string* parts[3] = { string_new_n(payload, 3), NULL, string_new_n(payload + 2, 3) };
+    string* joined = string_join(parts, 3, "|");
+    [[maybe_unused]] const char expected[] = { 'a', '\0', 'b', '|', 'b', '\0', 'c' };
+    assert(joined && string_length(joined) == sizeof(expected));
+    assert(memcmp(string_cstr(joined), expected, sizeof(expected)) == 0);
+    
+    printf("Binary-safe length: %zu\n", string_length(joined));
+    string_free(joined);
+    string_free(parts[0]);
+    string_free(parts[2]);
+    string_free(empty);
+    string_free(heap);
+    string_free(str);
+}
 
-/**
- * Get current time in nanoseconds
- */
-static long long get_time_ns() {
-    struct timespec ts;
-    clock_gettime(CLOCK_MONOTONIC, &ts);
-    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+void test_string_views() {
+    printf("\n=== String Views ===\n");
+    
+    string* str = string_new("GET /index.html HTTP/1.1");
+    string_view sv = string_as_view(str);
+    
+    // Substrings and search without allocation
+    string_view method = string_view_substr(sv, 0, 3);
+    printf("Method: %.*s\n", (int)method.length, method.data);
+    assert(string_view_equals(method, string_view_from_cstr("GET")));
+    assert(string_view_find(sv, string_view_from_cstr("HTTP")) == 16);
+    assert(string_view_find(sv, string_view_from_cstr("FTP")) == -1);
+    assert(string_view_substr(sv, 100, 5).length == 0);
+    assert(string_view_substr(sv, 20, 100).length == 4);
+    
+    // Ordering matches string_compare, including prefixes
+    assert(string_view_compare(string_view_from_cstr("abc"), string_view_from_cstr("abd")) < 0);
+    assert(string_view_compare(string_view_from_cstr("abc"), string_view_from_cstr("ab")) > 0);
+    assert(string_view_compare(method, string_view_from_cstr("GET")) == 0);
+    
+    // Split into caller-owned storage
+    string_view parts[4];
+    size_t count = string_view_split(sv, string_view_from_cstr(" "), parts, 4);
+    assert(count == 3);
+    for (size_t i = 0; i < count; i++) {
+        printf("  [%zu]: \"%.*s\"\n", i, (int)parts[i].length, parts[i].data);
+    }
+    assert(string_view_equals(parts[1], string_view_from_cstr("/index.html")));
+    assert(string_view_split(string_view_from_cstr("a,,b,"), string_view_from_cstr(","), NULL, 0) == 4);
+    
+    // Existing operations accept views as input
+    string* path = string_new_view(parts[1]);
+    print_string_info("Path", path);
+    assert(string_find_view(str, parts[2]) == 16);
+    assert(string_find(str, path) == 4);
+    
+    // Views that point into the target string itself
+    assert(string_append_view(path, string_as_view(path)));
+    assert(strcmp(string_cstr(path), "/index.html/index.html") == 0);
+    assert(string_set_view(path, string_view_substr(string_as_view(path), 1, 5)));
+    assert(strcmp(string_cstr(path), "index") == 0);
+    
+    // Embedded null bytes are preserved
+    string* binary = string_new_view((string_view){ "a\0b", 3 });
+    assert(string_length(binary) == 3 && string_char_at(binary, 2) == 'b');
+    
+    string_free(binary);
+    string_free(path);
+    string_free(str);
 }
 
-/**
- * Print benchmark results
- */
-static void print_benchmark_result(const char* operation, long long elapsed_ns, size_t iterations) {
-    double elapsed_ms = elapsed_ns / 1000000.0;
-    double ops_per_sec = (iterations * 1000.0) / elapsed_ms;
-    printf("%-20s | %10.3f ms | %12.0f ops/sec | %8zu iterations\n", 
-           operation, elapsed_ms, ops_per_sec, iterations);
+// Test the compact layout around the small string boundary
+void test_sso_layout() {
+    printf("\n=== Compact SSO Layout ===\n");
+    printf("sizeof(string) = %zu\n", sizeof(string));
+    assert(sizeof(string) == SSO_SIZE + 1);
+    
+    // Exactly SSO_SIZE characters still fit inline
+    const char* full = "abcdefghijklmnopqrstuvw";
+    assert(strlen(full) == SSO_SIZE);
+    string* str = string_new(full);
+    assert(string_length(str) == SSO_SIZE);
+    assert(string_capacity(str) == SSO_SIZE);
+    assert(strcmp(string_cstr(str), full) == 0);
+    print_string_info("Full inline", str);
+    
+    // Growing by one character moves it to the heap
+    assert(string_append_char(str, 'x'));
+    assert(string_length(str) == SSO_SIZE + 1);
+    assert(string_capacity(str) > SSO_SIZE);
+    assert(string_cstr(str)[SSO_SIZE] == 'x' && string_cstr(str)[SSO_SIZE + 1] == '\0');
+    
+    // Shrinking brings it back inline
+    assert(string_replace(str, "x", ""));
+    assert(string_capacity(str) == SSO_SIZE);
+    assert(strcmp(string_cstr(str), full) == 0);
+    
+    // Appends one character at a time across the boundary
+    string_clear(str);
+    for (int i = 0; i < 40; i++) {
+        assert(string_append_char(str, (char)('a' + i % 26)));
+        assert(string_length(str) == (size_t)i + 1);
+        assert(string_cstr(str)[i + 1] == '\0');
+    }
+    
+    // Trim moves a heap string back into the inline buffer
+    assert(string_set(str, "          padded to force a heap buffer          "));
+    string_trim(str);
+    assert(strcmp(string_cstr(str), "padded to force a heap buffer") == 0);
+    assert(string_set(str, "    twenty-three characters    "));
+    string_trim(str);
+    assert(string_length(str) == SSO_SIZE && string_capacity(str) == SSO_SIZE);
+    
+    // Substrings at the boundary
+    string* sub = string_substr(str, 0, SSO_SIZE);
+    assert(string_equals(sub, str));
+    string_free(sub);
+    
+    string_free(str);
 }
 
-/**
- * Benchmark string creation and destruction
- */
-void benchmark_create_free() {
-    const size_t iterations = 100000;
-    long long start = get_time_ns();
+// Test strings stored by value in caller-owned memory
+typedef struct {
+    int id;
+    string name;
+    string value;
+} header_field;
+
+void test_embedded_strings() {
+    printf("\n=== Embedded Strings ===\n");
+    
+    // Static initializer gives a valid empty string
+    string empty = STRING_INIT;
+    assert(string_is_empty(&empty));
+    assert(strcmp(string_cstr(&empty), "") == 0);
+    assert(string_append_cstr(&empty, "filled in place"));
+    print_string_info("From STRING_INIT", &empty);
+    string_destroy(&empty);
+    
+    // Strings embedded in a struct work with every operation
+    header_field field = { .id = 1 };
+    assert(string_init(&field.name, "Content-Type"));
+    assert(string_init(&field.value, "text/html"));
+    string_to_lower(&field.name);
+    assert(strcmp(string_cstr(&field.name), "content-type") == 0);
+    assert(string_find_cstr(&field.value, "html") == 5);
+    
+    // Growing past SSO allocates only the data buffer
+    assert(string_append_cstr(&field.value, "; charset=utf-8; boundary=something-long"));
+    assert(string_capacity(&field.value) > SSO_SIZE);
+    print_string_info("Embedded value", &field.value);
+    
+    // Destroy leaves a reusable empty string
+    string_destroy(&field.value);
+    assert(string_is_empty(&field.value));
+    assert(string_set(&field.value, "reused"));
+    string_destroy(&field.value);
+    string_destroy(&field.value);
+    string_destroy(&field.name);
+    
+    // Preallocated capacity without a heap header
+    string buffer;
+    assert(string_init_with_capacity(&buffer, 1000));
+    assert(string_capacity(&buffer) >= 1000 && string_is_empty(&buffer));
+    string_destroy(&buffer);
+}
+
+// Test arena allocation and bulk release
+void test_arena() {
+    printf("\n=== Arena Allocation ===\n");
+    
+    string_arena* arena = string_arena_new(4096);
+    assert(arena);
+    
+    // Small strings live in the arena header; large ones get aligned arena buffers
+    [[maybe_unused]] string* small = string_new_in(arena, "short");
+    string* big = string_with_capacity_in(arena, 100);
+    assert(small && big);
+    assert(((uintptr_t)string_cstr(big) % 64) == 0);
+    
+    // Growth past the SSO buffer and past the initial capacity stays in the arena
+    for (int i = 0; i < 50; i++) {
+        assert(string_append_cstr(small, "-grow"));
+        assert(string_append_cstr(big, "0123456789"));
+    }
+    assert(string_length(small) == 5 + 50 * 5);
+    assert(string_length(big) == 500);
+    assert(((uintptr_t)string_cstr(small) % 64) == 0);
+    printf("Arena string length: %zu, capacity: %zu\n", string_length(big), string_capacity(big));
+    
+    // Split output and its array come from the arena too
+    string* csv = string_new_in(arena, "alpha,beta,gamma,delta");
+    size_t count = 0;
+    string** parts = string_split_in(arena, csv, ",", &count);
+    assert(parts && count == 4);
+    assert(strcmp(string_cstr(parts[3]), "delta") == 0);
     
-    for (size_t i = 0; i < iterations; i++) {
-        string* str = string_new("Hello, World!");
+    // string_free is a no-op for arena strings
+    string_free(parts[0]);
+    printf("Arena bytes in use: %zu\n", string_arena_used(arena));
+    
+    // One reset releases everything; the arena is reusable afterwards
+    string_arena_reset(arena);
+    assert(string_arena_used(arena) == 0);
+    [[maybe_unused]] string* again = string_new_in(arena, "reused after reset");
+    assert(strcmp(string_cstr(again), "reused after reset") == 0);
+    assert(string_arena_used(arena) > 0);
+    
+    string_arena_free(arena);
+}
+
+// Check one SIMD level against plain memcmp/ASCII reference results
+static void check_simd_kernels(void) {
+    static const size_t lengths[] = {0, 1, 15, 16, 17, 31, 32, 33, 63, 64, 65, 127, 200};
+    
+    for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+        size_t len = lengths[l];
+        char buf[256];
+        for (size_t i = 0; i < len; i++) buf[i] = (char)('a' + (i * 7) % 26);
+        buf[len] = '\0';
+        
+        string* a = string_new(buf);
+        string* b = string_new(buf);
+        assert(string_equals(a, b));
+        assert(string_compare(a, b) == 0);
+        
+        // Differences at every position must be found with the right sign
+        for (size_t pos = 0; pos < len; pos++) {
+            char saved = buf[pos];
+            buf[pos] = 'z' + 1;
+            assert(string_set(b, buf));
+            assert(!string_equals(a, b));
+            assert(string_compare(a, b) < 0);
+            assert(string_compare(b, a) > 0);
+            buf[pos] = saved;
+        }
+        assert(string_set(b, buf));
+        
+        // Prefixes compare by length
+        if (len > 0) {
+            string* prefix = string_substr(a, 0, len - 1);
+            if (!prefix) prefix = string_new("");
+            assert(string_compare(prefix, a) < 0);
+            assert(string_compare(a, prefix) > 0);
+            string_free(prefix);
+        }
+        
+        // Every needle at every offset is located like memmem would
+        for (size_t start = 0; start < len; start += 5) {
+            for (size_t nlen = 1; start + nlen <= len && nlen <= 40; nlen += 3) {
+                char needle[64];
+                memcpy(needle, buf + start, nlen);
+                needle[nlen] = '\0';
+                [[maybe_unused]] const char* expected = strstr(buf, needle);
+                assert(string_find_cstr(a, needle) == expected - buf);
+            }
+        }
+        assert(string_find_cstr(a, "#") == -1);
+        
+        // Case conversion touches only ASCII letters
+        char mixed[256];
+        for (size_t i = 0; i < len; i++) mixed[i] = (char)(i * 37 + 11);
+        mixed[len] = '\0';
+        for (size_t i = 0; i < len; i++) if (!mixed[i]) mixed[i] = '@';
+        assert(string_set(b, mixed));
+        string_to_upper(b);
+        for (size_t i = 0; i < len; i++) {
+            [[maybe_unused]] char c = mixed[i];
+            assert(string_char_at(b, i) == ((c >= 'a' && c <= 'z') ? c - 32 : c));
+        }
+        string_to_lower(b);
+        for (size_t i = 0; i < len; i++) {
+            [[maybe_unused]] char c = mixed[i];
+            assert(string_char_at(b, i) == ((c >= 'A' && c <= 'Z') ? c + 32 : c));
+        }
+        
+        string_free(a);
+        string_free(b);
+    }
+}
+
+// Naive reference search the kernels are checked against
+[[maybe_unused]] static ptrdiff_t reference_find(const char* hay, size_t hay_len, const char* needle, size_t needle_len) {
+    for (size_t i = 0; i + needle_len <= hay_len; i++) {
+        if (memcmp(hay + i, needle, needle_len) == 0) return (ptrdiff_t)i;
+    }
+    return -1;
+}
+
+// Small alphabets produce many partial matches, and long runs of one byte
+// push the first/last byte filter into its Two-Way fallback
+static void check_find_worst_case(void) {
+    char hay[512];
+    unsigned int seed = 12345;
+    for (size_t i = 0; i < sizeof(hay); i++) {
+        seed = seed * 1103515245u + 12345u;
+        hay[i] = (char)('a' + ((seed >> 16) & 1));
+    }
+    
+    for (size_t hay_len = 0; hay_len <= sizeof(hay); hay_len += 37) {
+        [[maybe_unused]] string_view sv = { hay, hay_len };
+        for (size_t nlen = 1; nlen <= 80 && nlen <= hay_len; nlen++) {
+            for (size_t start = 0; start + nlen <= hay_len; start += 29) {
+                [[maybe_unused]] string_view needle = { hay + start, nlen };
+                assert(string_view_find(sv, needle) == reference_find(hay, hay_len, hay + start, nlen));
+            }
+            char absent[80];
+            memset(absent, 'a', nlen);
+            absent[nlen - 1] = 'c';
+            assert(string_view_find(sv, (string_view){ absent, nlen }) == -1);
+        }
+    }
+    
+    const size_t run = 1 << 16;
+    char* big = malloc(run + 1);
+    char* needle = malloc(2048);
+    assert(big && needle);
+    memset(big, 'a', run);
+    static const size_t needle_lengths[] = {2, 3, 16, 33, 64, 100, 1000, 2000};
+    for (size_t n = 0; n < sizeof(needle_lengths) / sizeof(needle_lengths[0]); n++) {
+        size_t nlen = needle_lengths[n];
+        memset(needle, 'a', nlen - 1);
+        needle[nlen - 1] = 'b';
+        
+        big[run] = 'a';
+        assert(string_view_find((string_view){ big, run + 1 }, (string_view){ needle, nlen }) == -1);
+        big[run] = 'b';
+        assert(string_view_find((string_view){ big, run + 1 }, (string_view){ needle, nlen }) ==
+               (ptrdiff_t)(run + 1 - nlen));
+        
+        // Periodic needle whose period breaks only at the end
+        for (size_t i = 0; i < nlen; i++) needle[i] = (i & 1) ? 'b' : 'a';
+        needle[nlen - 1] = 'c';
+        for (size_t i = 0; i < run; i++) big[i] = (i & 1) ? 'b' : 'a';
+        assert(string_view_find((string_view){ big, run }, (string_view){ needle, nlen }) == -1);
+        memset(big, 'a', run);
+    }
+    free(needle);
+    free(big);
+}
+
+// Reference replacement of every non-overlapping occurrence
+static void reference_replace(char* out, const char* in, const char* old_str, const char* new_str) {
+    size_t old_len = strlen(old_str), new_len = strlen(new_str);
+    while (*in) {
+        if (strncmp(in, old_str, old_len) == 0) {
+            memcpy(out, new_str, new_len);
+            out += new_len;
+            in += old_len;
+        } else {
+            *out++ = *in++;
+        }
+    }
+    *out = '\0';
+}
+
+// Test replacement with many matches in the growing, shrinking and
+// same-size paths
+void test_replace() {
+    printf("\n=== Replace ===\n");
+    
+    static const char* cases[][3] = {
+        { "a{x}b{x}c{x}", "{x}", "value" },     // Growing, several matches
+        { "{x}{x}{x}", "{x}", "longer-value" },  // Matches back to back
+        { "aaaa", "aa", "b" },                   // Overlapping candidates
+        { "aaaaa", "aa", "aaa" },
+        { "hello world", "o", "0" },             // Same size
+        { "xyz", "xyz", "" },                    // Whole string removed
+        { "no match", "zz", "long replacement" },
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        char expected[128];
+        reference_replace(expected, cases[i][0], cases[i][1], cases[i][2]);
+        string* str = string_new(cases[i][0]);
+        assert(string_replace(str, cases[i][1], cases[i][2]));
+        assert(strcmp(string_cstr(str), expected) == 0);
+        assert(string_length(str) == strlen(expected));
         string_free(str);
     }
     
-    long long end = get_time_ns();
-    print_benchmark_result("Create/Free", end - start, iterations);
+    // Thousands of placeholders spill the match buffer to the heap
+    const size_t placeholders = 5000;
+    string* tmpl = string_new("");
+    char* expected = malloc(placeholders * 16 + 1);
+    assert(tmpl && expected);
+    for (size_t i = 0; i < placeholders; i++) assert(string_append_cstr(tmpl, "<$>, "));
+    string* grown = string_new(string_cstr(tmpl));
+    assert(string_replace(grown, "$", "value"));
+    reference_replace(expected, string_cstr(tmpl), "$", "value");
+    assert(strcmp(string_cstr(grown), expected) == 0);
+    assert(string_replace(grown, "<value>", "x"));
+    reference_replace(expected, string_cstr(tmpl), "<$>", "x");
+    assert(strcmp(string_cstr(grown), expected) == 0);
+    printf("Expanded %zu placeholders: %zu -> %zu bytes\n", placeholders,
+           string_length(tmpl), string_length(tmpl) + placeholders * 4);
+    string_free(grown);
+    string_free(tmpl);
+    free(expected);
+    
+    // The replacement may live inside the string being rewritten
+    string* self = string_new("ab-ab-ab");
+    assert(string_replace(self, "-", string_cstr(self)));
+    assert(strcmp(string_cstr(self), "abab-ab-ababab-ab-abab") == 0);
+    string_free(self);
 }
 
-/**
- * Benchmark string append operations
- */
-void benchmark_append() {
-    const size_t iterations = 50000;
-    const char* test_str = " additional text";
-    long long start = get_time_ns();
-    
-    string* str = string_new("Initial content");
-    for (size_t i = 0; i < iterations; i++) {
-        if (!string_append_cstr(str, test_str)) {
-            printf("Error: append failed at iteration %zu\n", i);
-            break;
+// Test every SIMD dispatch level available on this machine
+void test_simd_dispatch() {
+    printf("\n=== SIMD Dispatch ===\n");
+    
+    string_simd_level detected = string_simd_get_level();
+    printf("Detected level: %s\n", string_simd_level_name(detected));
+    
+    for (int level = STRING_SIMD_SCALAR; level <= STRING_SIMD_NEON; level++) {
+        if (!string_simd_level_supported(level)) {
+            printf("  %-8s unsupported\n", string_simd_level_name(level));
+            continue;
+        }
+        assert(string_simd_set_level(level));
+        assert(string_simd_get_level() == (string_simd_level)level);
+        check_simd_kernels();
+        check_find_worst_case();
+        printf("  %-8s ok\n", string_simd_level_name(level));
+    }
+    
+    assert(string_simd_set_level(detected));
+}
+
+// Test compiled needles for repeated searches
+void test_searcher() {
+    printf("\n=== Searcher ===\n");
+    
+    string_searcher* searcher = string_searcher_new("needle");
+    assert(searcher);
+    assert(string_searcher_needle(searcher).length == 6);
+    
+    static const char* records[] = {
+        "no match here", "a needle in a haystack", "needle", "needl", "haystack needle"
+    };
+    [[maybe_unused]] static const ptrdiff_t expected[] = {-1, 2, 0, -1, 9};
+    for (size_t i = 0; i < sizeof(records) / sizeof(records[0]); i++) {
+        assert(string_searcher_find(searcher, string_view_from_cstr(records[i])) == expected[i]);
+    }
+    string_searcher_free(searcher);
+    
+    // Matches are non-overlapping and counted past the capacity of positions
+    searcher = string_searcher_new("aa");
+    [[maybe_unused]] size_t positions[2];
+    assert(string_searcher_find_all(searcher, string_view_from_cstr("aaaaa"), positions, 2) == 2);
+    assert(positions[0] == 0 && positions[1] == 2);
+    assert(string_searcher_find_all(searcher, string_view_from_cstr("xaaxaaxaa"), positions, 2) == 3);
+    assert(positions[0] == 1 && positions[1] == 4);
+    assert(string_searcher_find_all(searcher, string_view_from_cstr("a"), NULL, 0) == 0);
+    string_searcher_free(searcher);
+    
+    // Needles may contain embedded null bytes
+    searcher = string_searcher_new_view((string_view){ "b\0c", 3 });
+    assert(string_searcher_find(searcher, (string_view){ "ab\0cd", 5 }) == 1);
+    assert(string_searcher_find(searcher, string_view_from_cstr("abc")) == -1);
+    string_searcher_free(searcher);
+    
+    // An empty needle matches at 0 but cannot split or enumerate
+    searcher = string_searcher_new("");
+    assert(string_searcher_find(searcher, string_view_from_cstr("abc")) == 0);
+    assert(string_searcher_find_all(searcher, string_view_from_cstr("abc"), NULL, 0) == 0);
+    string_searcher_free(searcher);
+    assert(!string_searcher_new(NULL));
+    
+    // Split and replace with a compiled needle agree with their C-string forms
+    string_searcher* comma = string_searcher_new(", ");
+    string* csv = string_new("one, two, , three, ");
+    size_t count = 0, expected_count = 0;
+    string** parts = string_split_with(csv, comma, &count);
+    string** reference = string_split(csv, ", ", &expected_count);
+    assert(parts && reference && count == expected_count && count == 5);
+    for (size_t i = 0; i < count; i++) {
+        assert(string_equals(parts[i], reference[i]));
+        string_free(parts[i]);
+        string_free(reference[i]);
+    }
+    free(parts);
+    free(reference);
+    
+    assert(string_replace_with(csv, comma, ";"));
+    assert(strcmp(string_cstr(csv), "one;two;;three;") == 0);
+    printf("Replaced: %s\n", string_cstr(csv));
+    string_free(csv);
+    string_searcher_free(comma);
+}
+
+// Reference leftmost-longest search the matcher is checked against
+static bool reference_match(const string_view* patterns, size_t count, string_view hay,
+                            size_t from, string_match* match) {
+    for (size_t start = from; start < hay.length; start++) {
+        bool found = false;
+        for (size_t p = 0; p < count; p++) {
+            if (patterns[p].length > hay.length - start) continue;
+            if (memcmp(hay.data + start, patterns[p].data, patterns[p].length) != 0) continue;
+            if (!found || patterns[p].length > match->length) {
+                *match = (string_match){ start, patterns[p].length, p };
+                found = true;
+            }
+        }
+        if (found) return true;
+    }
+    return false;
+}
+
+// Random pattern sets over small alphabets, with few and many first bytes
+static void check_matcher_random(void) {
+    unsigned int seed = 777;
+    char pool[64][8];
+    string_view patterns[64];
+    char hay[300];
+    
+    for (int round = 0; round < 40; round++) {
+        size_t count = 1 + (size_t)round % 24;
+        int alphabet = (round & 1) ? 3 : 20;
+        for (size_t p = 0; p < count; p++) {
+            seed = seed * 1103515245u + 12345u;
+            size_t len = 1 + (seed >> 16) % 6;
+            for (size_t j = 0; j < len; j++) {
+                seed = seed * 1103515245u + 12345u;
+                pool[p][j] = (char)(0x70 + (seed >> 16) % alphabet);
+            }
+            patterns[p] = (string_view){ pool[p], len };
+        }
+        for (size_t i = 0; i < sizeof(hay); i++) {
+            seed = seed * 1103515245u + 12345u;
+            hay[i] = (char)(0x70 + (seed >> 16) % alphabet);
+        }
+        
+        string_matcher* matcher = string_matcher_new_views(patterns, count);
+        assert(matcher);
+        string_view sv = { hay, sizeof(hay) };
+        size_t pos = 0;
+        [[maybe_unused]] string_match expected, actual;
+        while (reference_match(patterns, count, sv, pos, &expected)) {
+            assert(string_matcher_find(matcher, string_view_substr(sv, pos, SIZE_MAX), &actual));
+            assert(actual.offset + pos == expected.offset && actual.length == expected.length);
+            assert(patterns[actual.pattern].length == expected.length);
+            pos = expected.offset + expected.length;
+        }
+        assert(!string_matcher_find(matcher, string_view_substr(sv, pos, SIZE_MAX), &actual));
+        string_matcher_free(matcher);
+    }
+    
+    // Single-byte patterns exercise the byte-set prefilter on every offset,
+    // including bytes with the top bit set
+    static const char bytes[] = { 'a', ';', (char)0x80, (char)0xFF, '\t', 'Z' };
+    string_view singles[sizeof(bytes)];
+    for (size_t i = 0; i < sizeof(bytes); i++) singles[i] = (string_view){ &bytes[i], 1 };
+    string_matcher* matcher = string_matcher_new_views(singles, sizeof(bytes));
+    assert(matcher);
+    for (size_t pos = 0; pos < 200; pos++) {
+        char buf[200];
+        memset(buf, 'b', sizeof(buf));
+        buf[pos] = bytes[pos % sizeof(bytes)];
+        [[maybe_unused]] string_match match;
+        assert(string_matcher_find(matcher, (string_view){ buf, sizeof(buf) }, &match));
+        assert(match.offset == pos && match.pattern == pos % sizeof(bytes));
+        buf[pos] = 'b';
+        assert(!string_matcher_find(matcher, (string_view){ buf, sizeof(buf) }, &match));
+    }
+    string_matcher_free(matcher);
+}
+
+// Test multi-pattern search and replacement
+void test_matcher() {
+    printf("\n=== Multi-pattern Matcher ===\n");
+    
+    // Leftmost wins over longest, longest breaks ties at the same offset
+    static const char* words[] = { "he", "she", "his", "hers" };
+    string_matcher* matcher = string_matcher_new(words, 4);
+    assert(matcher && string_matcher_count(matcher) == 4);
+    [[maybe_unused]] string_match match;
+    assert(string_matcher_find(matcher, string_view_from_cstr("ushers"), &match));
+    assert(match.offset == 1 && match.length == 3 && match.pattern == 1);
+    assert(string_matcher_find(matcher, string_view_from_cstr("hershey"), &match));
+    assert(match.offset == 0 && match.pattern == 3);
+    assert(!string_matcher_find(matcher, string_view_from_cstr("nothing"), &match));
+    string_matcher_free(matcher);
+    
+    static const char* nested[] = { "a", "ab", "abc", "bcd" };
+    matcher = string_matcher_new(nested, 4);
+    [[maybe_unused]] string_match matches[4];
+    assert(string_matcher_find_all(matcher, string_view_from_cstr("abcdabab"), matches, 4) == 3);
+    assert(matches[0].offset == 0 && matches[0].pattern == 2);
+    assert(matches[1].offset == 4 && matches[1].pattern == 1);
+    assert(matches[2].offset == 6 && matches[2].pattern == 1);
+    assert(string_matcher_find_all(matcher, string_view_from_cstr("xbcdx"), NULL, 0) == 1);
+    string_matcher_free(matcher);
+    
+    // Empty patterns are rejected
+    [[maybe_unused]] static const char* invalid[] = { "ok", "" };
+    assert(!string_matcher_new(invalid, 2));
+    assert(!string_matcher_new(invalid, 0));
+    
+    [[maybe_unused]] string_simd_level detected = string_simd_get_level();
+    for (int level = STRING_SIMD_SCALAR; level <= STRING_SIMD_NEON; level++) {
+        if (!string_simd_level_supported(level)) continue;
+        assert(string_simd_set_level(level));
+        check_matcher_random();
+    }
+    assert(string_simd_set_level(detected));
+    
+    // Every pattern is rewritten in one pass; replacements may grow or shrink
+    static const char* markers[] = { "{name}", "{email}", "\\n", "secret" };
+    [[maybe_unused]] static const char* values[] = { "Ada Lovelace", "ada@example.com", "\n", NULL };
+    matcher = string_matcher_new(markers, 4);
+    string* text = string_new("To: {name} <{email}>\\nsecret plans for {name}");
+    assert(string_replace_many(text, matcher, values));
+    assert(strcmp(string_cstr(text), "To: Ada Lovelace <ada@example.com>\n plans for Ada Lovelace") == 0);
+    assert(string_replace_many(text, matcher, values));
+    printf("Replaced: %s\n", string_cstr(text));
+    string_free(text);
+    
+    // Shrinking back into the small buffer, and arena strings
+    text = string_new("secret secret secret secret");
+    assert(string_replace_many(text, matcher, values));
+    assert(strcmp(string_cstr(text), "   ") == 0);
+    string_free(text);
+    
+    string_arena* arena = string_arena_new(0);
+    text = string_new_in(arena, "{name}: {name}, {email}");
+    assert(string_replace_many(text, matcher, values));
+    assert(strcmp(string_cstr(text), "Ada Lovelace: Ada Lovelace, ada@example.com") == 0);
+    string_arena_free(arena);
+    string_matcher_free(matcher);
+}
+
+// Collect tokenizer output into a fixed array of views
+static size_t collect_tokens(string_tokenizer* tok, string_view* out, size_t max) {
+    size_t count = 0;
+    string_view token;
+    while (string_tokenizer_next(tok, &token)) {
+        if (count < max) out[count] = token;
+        count++;
+    }
+    return count;
+}
+
+// Test allocation-free tokenizing with all three delimiter kinds
+void test_tokenizer() {
+    printf("\n=== Tokenizer ===\n");
+    
+    string_tokenizer tok;
+    string_view tokens[16];
+    string_view parts[16];
+    
+    // Single-byte delimiter, with empty and trailing pieces like string_view_split
+    string_view csv = string_view_from_cstr("id,name,,email,");
+    string_tokenizer_init(&tok, csv, string_view_from_cstr(","));
+    size_t count = collect_tokens(&tok, tokens, 16);
+    [[maybe_unused]] size_t expected = string_view_split(csv, string_view_from_cstr(","), parts, 16);
+    assert(count == expected && count == 5);
+    for (size_t i = 0; i < count; i++) assert(string_view_equals(tokens[i], parts[i]));
+    assert(tokens[3].data - csv.data == 9);
+    assert(!string_tokenizer_next(&tok, NULL));
+    
+    // Multi-byte delimiter, directly and through a compiled searcher
+    string_view log = string_view_from_cstr("GET /a :: 200 :: 12ms");
+    string_tokenizer_init(&tok, log, string_view_from_cstr(" :: "));
+    assert(collect_tokens(&tok, tokens, 16) == 3);
+    assert(string_view_equals(tokens[1], string_view_from_cstr("200")));
+    
+    string_searcher* sep = string_searcher_new(" :: ");
+    string_tokenizer_init_with(&tok, log, sep);
+    assert(collect_tokens(&tok, tokens, 16) == 3);
+    assert(string_view_equals(tokens[2], string_view_from_cstr("12ms")));
+    string_searcher_free(sep);
+    
+    // Any byte of a set; long inputs go through the SIMD set kernels
+    char text[200];
+    for (size_t i = 0; i < sizeof(text); i++) text[i] = (i % 7 == 6) ? " \t\n"[i % 3] : 'w';
+    string_tokenizer_init_any(&tok, (string_view){ text, sizeof(text) }, string_view_from_cstr(" \t\n"));
+    count = collect_tokens(&tok, tokens, 16);
+    assert(count == sizeof(text) / 7 + 1);
+    for (size_t i = 0; i < 16; i++) assert(tokens[i].length == 6 && tokens[i].data == text + i * 7);
+    
+    // Empty input is one empty piece; an empty delimiter never splits
+    string_tokenizer_init(&tok, string_view_from_cstr(""), string_view_from_cstr(","));
+    assert(collect_tokens(&tok, tokens, 16) == 1 && tokens[0].length == 0);
+    string_tokenizer_init(&tok, csv, string_view_from_cstr(""));
+    assert(collect_tokens(&tok, tokens, 16) == 1 && tokens[0].length == csv.length);
+    
+    [[maybe_unused]] string_byte_set set = string_byte_set_from(string_view_from_cstr("@."));
+    assert(string_byte_set_contains(&set, '@') && !string_byte_set_contains(&set, 'a'));
+    assert(string_view_find_any(string_view_from_cstr("user@example.com"), &set) == 4);
+    assert(string_view_find_any(string_view_from_cstr("nothing"), &set) == -1);
+    printf("Tokens: %zu\n", count);
+}
+
+void test_hash() {
+    printf("\n=== Hashing ===\n");
+    
+    // Same bytes hash the same in every representation
+    string* small = string_new("key");
+    string* heap = string_with_capacity(128);
+    assert(string_set(heap, "key"));
+    assert(string_hash(small) == string_hash(heap));
+    assert(string_hash(heap) == string_view_hash(string_view_from_cstr("key")));
+    assert(string_hash(small) != string_hash(NULL));
+    assert(string_hash(NULL) == string_view_hash(string_view_from_cstr("")));
+    
+    // Every length through the tail and 48-byte paths, and every byte counts
+    char buf[160];
+    for (size_t i = 0; i < sizeof(buf); i++) buf[i] = (char)('a' + i % 26);
+    for (size_t len = 0; len < sizeof(buf); len++) {
+        [[maybe_unused]] uint64_t hash = string_view_hash((string_view){ buf, len });
+        assert(hash != string_view_hash((string_view){ buf, len + 1 }));
+        for (size_t i = 0; i < len; i++) {
+            buf[i] ^= 1;
+            assert(hash != string_view_hash((string_view){ buf, len }));
+            buf[i] ^= 1;
         }
     }
+    
+    // Embedded NULs are hashed, not treated as terminators
+    [[maybe_unused]] uint64_t with_nul = string_view_hash((string_view){ "a\0b", 3 });
+    assert(with_nul != string_view_hash((string_view){ "a\0c", 3 }));
+    assert(with_nul != string_view_hash((string_view){ "a", 1 }));
+    
+    // A cached hash follows every mutation
+    string* str = string_with_capacity(128);
+    assert(string_set(str, "Hello World"));
+    [[maybe_unused]] uint64_t before = string_hash(str);
+    assert(string_hash(str) == before);
+    assert(string_append_cstr(str, "!"));
+    assert(string_hash(str) == string_view_hash(string_view_from_cstr("Hello World!")));
+    string_to_upper(str);
+    assert(string_hash(str) == string_view_hash(string_view_from_cstr("HELLO WORLD!")));
+    string_to_lower(str);
+    assert(string_hash(str) == string_view_hash(string_view_from_cstr("hello world!")));
+    assert(string_replace(str, "world", "there"));
+    assert(string_hash(str) == string_view_hash(string_view_from_cstr("hello there!")));
+    assert(string_set(str, "  padded  "));
+    (void)string_hash(str);
+    string_trim(str);
+    assert(string_hash(str) == string_view_hash(string_view_from_cstr("padded")));
+    string_clear(str);
+    assert(string_hash(str) == string_hash(NULL));
+    
+    // Cached hashes only ever reject; equal contents still compare equal
+    string* a = string_with_capacity(128);
+    string* b = string_with_capacity(128);
+    assert(string_set(a, "same contents") && string_set(b, "same contents"));
+    (void)string_hash(a);
+    (void)string_hash(b);
+    assert(string_equals(a, b));
+    assert(string_set(b, "same Contents"));
+    (void)string_hash(b);
+    assert(!string_equals(a, b));
+    assert(string_set(b, "same contents"));
+    assert(string_equals(a, b));
+    
+    printf("hash(\"key\") = %016llx\n", (unsigned long long)string_hash(small));
+    string_free(small);
+    string_free(heap);
     string_free(str);
+    string_free(a);
+    string_free(b);
+}
+
+// One thread's share of the concurrent interning test: intern every label,
+// starting at a different offset so threads race on different values
+typedef struct {
+    string_pool* pool;
+    const string** interned;
+    size_t count;
+    size_t offset;
+} intern_job;
+
+static void* intern_worker(void* arg) {
+    intern_job* job = arg;
+    char key[32];
+    for (size_t i = 0; i < job->count; i++) {
+        size_t index = (i + job->offset) % job->count;
+        snprintf(key, sizeof(key), "label-%zu", index);
+        job->interned[index] = string_pool_intern(job->pool, key);
+    }
+    return NULL;
+}
+
+void test_pool() {
+    printf("\n=== Interning Pool ===\n");
+    
+    string_pool* pool = string_pool_new();
+    assert(pool);
+    
+    // One canonical string per value, with its contents and hash intact
+    [[maybe_unused]] const string* a = string_pool_intern(pool, "content-type");
+    [[maybe_unused]] const string* b = string_pool_intern_view(pool, string_view_substr(string_view_from_cstr("x-content-type"), 2, 12));
+    assert(a && a == b);
+    assert(strcmp(string_cstr(a), "content-type") == 0 && string_length(a) == 12);
+    assert(string_hash(a) == string_view_hash(string_view_from_cstr("content-type")));
+    assert(string_pool_find(pool, string_view_from_cstr("content-type")) == a);
+    assert(!string_pool_find(pool, string_view_from_cstr("content-length")));
+    
+    [[maybe_unused]] const string* other = string_pool_intern(pool, "content-length");
+    assert(other && other != a && !string_equals(a, other));
+    assert(string_pool_count(pool) == 2);
+    
+    // Interned strings still compare by value against everything else
+    string* plain = string_new("content-type");
+    assert(string_equals(a, plain) && string_compare(a, plain) == 0);
+    string_pool* second = string_pool_new();
+    [[maybe_unused]] const string* twin = string_pool_intern(second, "content-type");
+    assert(twin && twin != a && string_equals(a, twin));
+    string_pool_free(second);
+    string_free(plain);
+    
+    // Empty values and embedded NULs are values like any other
+    [[maybe_unused]] const string* empty = string_pool_intern(pool, "");
+    assert(empty && string_length(empty) == 0 && string_pool_intern_view(pool, (string_view){ NULL, 0 }) == empty);
+    [[maybe_unused]] const string* nul = string_pool_intern_view(pool, (string_view){ "a\0b", 3 });
+    [[maybe_unused]] const string* prefix = string_pool_intern(pool, "a");
+    assert(nul && string_length(nul) == 3 && prefix && nul != prefix);
+    
+    // Threads interning the same labels concurrently all get the same strings
+    enum { THREADS = 4, LABELS = 5000 };
+    static const string* interned[THREADS][LABELS];
+    pthread_t threads[THREADS];
+    intern_job jobs[THREADS];
+    for (size_t t = 0; t < THREADS; t++) {
+        jobs[t] = (intern_job){ pool, interned[t], LABELS, t * LABELS / THREADS };
+        [[maybe_unused]] int rc = pthread_create(&threads[t], NULL, intern_worker, &jobs[t]);
+        assert(rc == 0);
+    }
+    for (size_t t = 0; t < THREADS; t++) pthread_join(threads[t], NULL);
+    
+    char key[32];
+    for (size_t i = 0; i < LABELS; i++) {
+        snprintf(key, sizeof(key), "label-%zu", i);
+        assert(interned[0][i] && strcmp(string_cstr(interned[0][i]), key) == 0);
+        for (size_t t = 1; t < THREADS; t++) assert(interned[t][i] == interned[0][i]);
+    }
+    assert(string_pool_count(pool) == LABELS + 5);
     
-    long long end = get_time_ns();
-    print_benchmark_result("Append", end - start, iterations);
+    printf("Interned: %zu values\n", string_pool_count(pool));
+    string_pool_free(pool);
 }
 
-/**
- * Benchmark string find operations
- */
-void benchmark_find() {
-    const size_t iterations = 100000;
-    string* str = string_new("This is a test string to search for substrings within");
-    const char* needle = "string";
-    long long start = get_time_ns();
-    
-    for (size_t i = 0; i < iterations; i++) {
-        ptrdiff_t pos = string_find_cstr(str, needle);
-        // Using volatile to prevent compiler optimizing away the loop
-        volatile ptrdiff_t _ = pos;
-        (void)_;
+// Check a rope against the bytes it should hold, through chunks, char_at
+// and flatten
+static void check_rope(string_rope* rope, [[maybe_unused]] const char* expected, size_t length) {
+    assert(string_rope_length(rope) == length);
+    
+    string_rope_iter iter;
+    string_view chunk;
+    size_t offset = 0;
+    string_rope_iter_init(&iter, rope);
+    while (string_rope_iter_next(&iter, &chunk)) {
+        assert(chunk.length > 0 && offset + chunk.length <= length);
+        assert(memcmp(chunk.data, expected + offset, chunk.length) == 0);
+        offset += chunk.length;
+    }
+    assert(offset == length);
+    if (length) assert(string_rope_char_at(rope, length / 2) == expected[length / 2]);
+    assert(string_rope_char_at(rope, length) == '\0');
+}
+
+void test_rope() {
+    printf("\n=== Rope ===\n");
+    
+    string_rope* rope = string_rope_new();
+    assert(rope && string_rope_length(rope) == 0);
+    assert(!string_rope_insert(rope, 1, string_view_from_cstr("x")));
+    
+    assert(string_rope_append(rope, string_view_from_cstr("Hello")));
+    assert(string_rope_append(rope, string_view_from_cstr("World")));
+    assert(string_rope_insert(rope, 5, string_view_from_cstr(", ")));
+    assert(string_rope_insert(rope, 0, string_view_from_cstr(">> ")));
+    check_rope(rope, ">> Hello, World", 15);
+    
+    // Substrings share leaves, and editing either side leaves the other alone
+    string_rope* sub = string_rope_substr(rope, 3, 5);
+    assert(string_rope_erase(rope, 0, 3));
+    assert(string_rope_append(rope, string_view_from_cstr("!")));
+    check_rope(sub, "Hello", 5);
+    check_rope(rope, "Hello, World!", 13);
+    assert(string_rope_append(sub, string_view_from_cstr(" there")));
+    check_rope(sub, "Hello there", 11);
+    check_rope(rope, "Hello, World!", 13);
+    string_rope_free(sub);
+    
+    // Flattening once makes the next flatten free
+    [[maybe_unused]] const string* flat = string_rope_flatten(rope);
+    assert(flat && strcmp(string_cstr(flat), "Hello, World!") == 0);
+    assert(string_rope_flatten(rope) == flat);
+    
+    // Long heap strings are adopted without copying
+    string* big = string_with_capacity(8192);
+    while (string_length(big) < 6000) {
+        if (!string_append_cstr(big, "0123456789")) break;
+    }
+    [[maybe_unused]] const char* big_data = string_cstr(big);
+    assert(string_rope_append_string(rope, big) && string_length(big) == 0);
+    string_rope_iter iter;
+    string_view chunk = { NULL, 0 };
+    string_rope_iter_init(&iter, rope);
+    while (string_rope_iter_next(&iter, &chunk) && chunk.data != big_data) {}
+    assert(chunk.data == big_data && chunk.length == 6000);
+    string_free(big);
+    
+    assert(string_rope_erase(rope, 0, SIZE_MAX) && string_rope_length(rope) == 0);
+    flat = string_rope_flatten(rope);
+    assert(flat && string_length(flat) == 0);
+    
+    // Random edits against a flat reference buffer
+    size_t capacity = 1 << 16;
+    char* reference = malloc(capacity);
+    char piece[64];
+    size_t length = 0;
+    uint32_t seed = 12345;
+    for (size_t op = 0; op < 3000; op++) {
+        seed = seed * 1103515245u + 12345u;
+        size_t n = 1 + (seed >> 16) % sizeof(piece);
+        for (size_t i = 0; i < n; i++) piece[i] = (char)('a' + (op + i) % 26);
+        seed = seed * 1103515245u + 12345u;
+        size_t pos = length ? (seed >> 8) % (length + 1) : 0;
+        
+        switch (op % 5) {
+            case 0: case 1:
+                if (length + n > capacity) break;
+                assert(string_rope_append(rope, (string_view){ piece, n }));
+                memcpy(reference + length, piece, n);
+                length += n;
+                break;
+            case 2: case 3:
+                if (length + n > capacity) break;
+                assert(string_rope_insert(rope, pos, (string_view){ piece, n }));
+                memmove(reference + pos + n, reference + pos, length - pos);
+                memcpy(reference + pos, piece, n);
+                length += n;
+                break;
+            default: {
+                size_t erase = (n > length - pos) ? length - pos : n;
+                assert(string_rope_erase(rope, pos, n));
+                memmove(reference + pos, reference + pos + erase, length - pos - erase);
+                length -= erase;
+                break;
+            }
+        }
+        if (op % 500 == 0) {
+            string_rope* part = string_rope_substr(rope, pos, 200);
+            size_t part_len = (length - pos < 200) ? length - pos : 200;
+            check_rope(part, reference + pos, part_len);
+            string_rope_free(part);
+        }
+    }
+    check_rope(rope, reference, length);
+    flat = string_rope_flatten(rope);
+    assert(flat && string_length(flat) == length && memcmp(string_cstr(flat), reference, length) == 0);
+    
+    printf("Rope length after random edits: %zu\n", length);
+    free(reference);
+    string_rope_free(rope);
+}
+
+// Write bytes to a fresh temporary file and return its path in path
+static bool write_temp_file(char* path, size_t path_size, const char* data, size_t length) {
+    snprintf(path, path_size, "/tmp/libstring_test_XXXXXX");
+    int fd = mkstemp(path);
+    if (fd < 0) return false;
+    bool ok = write(fd, data, length) == (ssize_t)length;
+    close(fd);
+    return ok;
+}
+
+void test_file_loading() {
+    printf("\n=== File Loading ===\n");
+    
+    // A page-sized file has no slack after its last byte, so it checks that
+    // the mapping still ends in a terminator
+    long page = sysconf(_SC_PAGESIZE);
+    size_t length = page > 0 ? (size_t)page : 4096;
+    char* content = malloc(length);
+    for (size_t i = 0; i < length; i++) content[i] = (i % 64 == 63) ? '\n' : (char)('a' + i % 26);
+    content[100] = '\0';
+    
+    char path[64];
+    [[maybe_unused]] bool written = write_temp_file(path, sizeof(path), content, length);
+    assert(written);
+    
+    string* read = string_from_file(path, STRING_FILE_READ);
+    string* mapped = string_from_file(path, STRING_FILE_MAP);
+    assert(read && mapped);
+    assert(string_length(read) == length && string_length(mapped) == length);
+    assert(memcmp(string_cstr(read), content, length) == 0 && string_cstr(read)[length] == '\0');
+    assert(memcmp(string_cstr(mapped), content, length) == 0 && string_cstr(mapped)[length] == '\0');
+    assert(string_equals(read, mapped) && string_hash(read) == string_hash(mapped));
+    
+    // Modifying a mapped string never writes to the file
+    string_to_upper(mapped);
+    assert(string_cstr(mapped)[0] == 'A');
+    assert(string_append_cstr(mapped, "tail") && string_length(mapped) == length + 4);
+    string_free(mapped);
+    string* again = string_from_file(path, STRING_FILE_MAP);
+    assert(again && string_equals(again, read));
+    string_trim(again);
+    string_free(again);
+    
+    // Mapped strings shrink to small ones like any other
+    mapped = string_from_file(path, STRING_FILE_MAP);
+    assert(mapped && string_replace(mapped, string_cstr(read), "tiny"));
+    assert(strcmp(string_cstr(mapped), "tiny") == 0);
+    string_free(mapped);
+    unlink(path);
+    
+    // Empty files and missing paths
+    written = write_temp_file(path, sizeof(path), "", 0);
+    assert(written);
+    string* empty = string_from_file(path, STRING_FILE_MAP);
+    assert(empty && string_length(empty) == 0);
+    string_free(empty);
+    unlink(path);
+    errno = 0;
+    assert(!string_from_file(path, STRING_FILE_READ) && errno == ENOENT);
+    
+    // Lines come out as views into the input, CRLF or not
+    string_line_iter iter;
+    string_view line;
+    string_view lines[8];
+    size_t count = 0;
+    string_view text = string_view_from_cstr("first\nsecond\r\n\nlast");
+    string_line_iter_init(&iter, text);
+    while (count < 8 && string_line_iter_next(&iter, &lines[count])) count++;
+    assert(count == 4);
+    assert(string_view_equals(lines[1], string_view_from_cstr("second")) && lines[2].length == 0);
+    assert(string_view_equals(lines[3], string_view_from_cstr("last")) && lines[3].data == text.data + 15);
+    
+    string_line_iter_init(&iter, string_view_from_cstr("only\n"));
+    assert(string_line_iter_next(&iter, &line) && line.length == 4 && !string_line_iter_next(&iter, &line));
+    string_line_iter_init(&iter, string_view_from_cstr(""));
+    assert(!string_line_iter_next(&iter, &line));
+    
+    count = 0;
+    string_line_iter_init(&iter, string_as_view(read));
+    while (string_line_iter_next(&iter, &line)) count++;
+    assert(count == length / 64);
+    
+    printf("Loaded %zu bytes, %zu lines\n", string_length(read), count);
+    string_free(read);
+    free(content);
+}
+
+static void* share_worker(void* arg) {
+    string* copy = string_clone(arg);
+    assert(copy && string_cstr(copy) == string_cstr(arg));
+    [[maybe_unused]] uint64_t hash = string_hash(copy);
+    assert(hash == string_hash(arg));
+    string_to_upper(copy);
+    assert(string_cstr(copy) != string_cstr(arg) && string_cstr(copy)[0] == 'S');
+    string_free(copy);
+    return NULL;
+}
+
+void test_share() {
+    printf("\nTesting shared buffers...\n");
+    
+    char payload[256];
+    for (size_t i = 0; i < sizeof(payload) - 1; i++) payload[i] = (char)('a' + i % 26);
+    payload[sizeof(payload) - 1] = '\0';
+    
+    string* a = string_new(payload);
+    [[maybe_unused]] uint64_t hash = string_hash(a);
+    string* b = string_share(a);
+    string* c = string_clone(b);
+    assert(b && c);
+    assert(string_cstr(b) == string_cstr(a) && string_cstr(c) == string_cstr(a));
+    assert(string_equals(a, b) && string_hash(b) == hash && string_capacity(b) == string_length(b));
+    
+    // The first write copies the buffer for that string only
+    assert(string_append_cstr(b, "!"));
+    assert(string_cstr(b) != string_cstr(a) && string_length(b) == sizeof(payload));
+    assert(strcmp(string_cstr(a), payload) == 0 && strcmp(string_cstr(c), payload) == 0);
+    string_to_upper(c);
+    assert(string_cstr(c)[0] == 'A' && string_cstr(a)[0] == 'a');
+    string_free(c);
+    
+    // Long suffixes share the buffer, other substrings are copied
+    string* suffix = string_substr(a, 100, SIZE_MAX);
+    string* prefix = string_substr(a, 0, 100);
+    assert(suffix && prefix);
+    assert(string_cstr(suffix) == string_cstr(a) + 100 && strcmp(string_cstr(suffix), payload + 100) == 0);
+    assert(string_cstr(prefix) != string_cstr(a) && memcmp(string_cstr(prefix), payload, 100) == 0);
+    string* tail = string_substr(a, sizeof(payload) - 11, 10);
+    assert(tail && strcmp(string_cstr(tail), payload + sizeof(payload) - 11) == 0);
+    string_free(tail);
+    
+    // Replace, set from its own bytes, trim and clear all detach first
+    string* d = string_clone(a);
+    assert(string_replace(d, "abc", "-") && string_cstr(a)[0] == 'a' && string_cstr(d)[0] == '-');
+    string_free(d);
+    d = string_clone(suffix);
+    assert(string_set_n(d, string_cstr(d) + 10, 50));
+    assert(string_length(d) == 50 && memcmp(string_cstr(d), payload + 110, 50) == 0);
+    assert(strcmp(string_cstr(suffix), payload + 100) == 0);
+    string_free(d);
+    string* padded = string_new("   padded with enough spaces to live on the heap   ");
+    d = string_share(padded);
+    string_trim(d);
+    assert(strcmp(string_cstr(d), "padded with enough spaces to live on the heap") == 0);
+    assert(string_cstr(padded)[0] == ' ');
+    string_free(d);
+    string_free(padded);
+    d = string_clone(a);
+    string_clear(d);
+    assert(string_length(d) == 0 && string_length(a) == sizeof(payload) - 1);
+    string_free(d);
+    
+    // The last owner writes in place
+    string_free(a);
+    [[maybe_unused]] const char* before = string_cstr(suffix);
+    string_to_upper(suffix);
+    assert(string_cstr(suffix) == before - 100 && string_cstr(suffix)[0] == 'W');
+    string_free(suffix);
+    string_free(prefix);
+    string_free(b);
+    
+    // Small and arena strings are copied
+    string* small = string_new("tiny");
+    string* small_copy = string_share(small);
+    assert(small_copy && string_cstr(small_copy) != string_cstr(small) && string_equals(small, small_copy));
+    string_free(small_copy);
+    string_free(small);
+    string_arena* arena = string_arena_new(0);
+    string* local = string_new_in(arena, payload);
+    string* escaped = string_share(local);
+    assert(escaped && string_equals(escaped, local));
+    string_arena_free(arena);
+    assert(strcmp(string_cstr(escaped), payload) == 0);
+    string_free(escaped);
+    
+    // A mapped file moves to the heap on its first share
+    char path[64];
+    [[maybe_unused]] bool written = write_temp_file(path, sizeof(path), payload, sizeof(payload) - 1);
+    assert(written);
+    string* mapped = string_from_file(path, STRING_FILE_MAP);
+    string* mapped_copy = mapped ? string_share(mapped) : NULL;
+    assert(mapped_copy && string_cstr(mapped_copy) == string_cstr(mapped));
+    assert(strcmp(string_cstr(mapped_copy), payload) == 0);
+    string_free(mapped);
+    string_free(mapped_copy);
+    unlink(path);
+    
+    // Threads read their own handles and detach independently
+    string* shared = string_new("shared across threads, long enough for the heap");
+    string* handle = string_share(shared);
+    pthread_t threads[4];
+    for (int i = 0; i < 4; i++) {
+        [[maybe_unused]] int rc = pthread_create(&threads[i], NULL, share_worker, handle);
+        assert(rc == 0);
+    }
+    for (int i = 0; i < 4; i++) pthread_join(threads[i], NULL);
+    assert(strcmp(string_cstr(shared), "shared across threads, long enough for the heap") == 0);
+    string_free(handle);
+    string_free(shared);
+    
+    printf("Shares, suffix substrings and copy on write\n");
+}
+
+void test_parallel() {
+    printf("\nTesting parallel bulk kernels...\n");
+    
+    // Several chunks of letters that can never spell the needle, plus a
+    // needle written across every 64 KiB boundary, chunk boundaries included
+    const size_t length = 3 * 1024 * 1024 + 123;
+    char* text = malloc(length + 1);
+    assert(text);
+    uint32_t seed = 12345;
+    for (size_t i = 0; i < length; i++) {
+        seed = seed * 1103515245 + 12345;
+        text[i] = (char)('a' + (seed >> 16) % 8);
+    }
+    text[length] = '\0';
+    size_t planted = 0;
+    for (size_t pos = 65536 - 3; pos + 6 <= length; pos += 65536) {
+        memcpy(text + pos, "needle", 6);
+        planted++;
+    }
+    
+    string* str = string_new_n(text, length);
+    [[maybe_unused]] string_view needle = string_view_from_cstr("needle");
+    const unsigned thread_counts[] = { 0, 1, 2, 3, 7 };
+    assert(string_count(str, needle) == planted);
+    for (size_t i = 0; i < sizeof(thread_counts) / sizeof(thread_counts[0]); i++) {
+        [[maybe_unused]] unsigned threads = thread_counts[i];
+        assert(string_find_parallel(str, needle, threads) == 65536 - 3);
+        assert(string_count_parallel(str, needle, threads) == planted);
+        assert(string_find_parallel(str, string_view_from_cstr("zebra"), threads) == -1);
+        assert(string_find_parallel(str, string_view_from_cstr(""), threads) == 0);
+        assert(string_count_parallel(str, string_view_from_cstr(""), threads) == 0);
+    }
+    
+    // Only the last match, straddling the end of a chunk
+    memcpy(text + length - 4, "zzzz", 4);
+    assert(string_set_n(str, text, length));
+    assert(string_find_parallel(str, string_view_from_cstr("zzz"), 0) == (ptrdiff_t)(length - 4));
+    assert(string_count_parallel(str, string_view_from_cstr("zzz"), 0) == 1);
+    
+    // Matches that can overlap each other must be counted as string_count does
+    string_view periodic[] = { string_view_from_cstr("aa"), string_view_from_cstr("aaa"),
+                               string_view_from_cstr("abab"), string_view_from_cstr("ab") };
+    for (size_t i = 0; i < length; i++) text[i] = (i % 7 == 6 || i % 263 == 0) ? 'b' : 'a';
+    assert(string_set_n(str, text, length));
+    for (size_t i = 0; i < sizeof(periodic) / sizeof(periodic[0]); i++) {
+        assert(string_count_parallel(str, periodic[i], 3) == string_count(str, periodic[i]));
+        assert(string_find_parallel(str, periodic[i], 3) == string_find_view(str, periodic[i]));
     }
+    memset(text, 'a', length);
+    assert(string_set_n(str, text, length));
+    assert(string_count(str, periodic[0]) == length / 2);
+    assert(string_count_parallel(str, periodic[0], 4) == length / 2);
+    assert(string_count_parallel(str, periodic[1], 4) == length / 3);
+    [[maybe_unused]] string_view pair = { text + 10, 2 };
+    assert(string_count_parallel(str, pair, 4) == length / 2);
+    
+    // Case conversion matches the single-threaded kernels, and a shared
+    // buffer is copied first
+    for (size_t i = 0; i < length; i++) text[i] = (char)(' ' + i % 95);
+    assert(string_set_n(str, text, length));
+    string* expected = string_new_n(text, length);
+    string* shared = string_share(str);
+    string_to_upper(expected);
+    string_to_upper_parallel(str, 0);
+    assert(string_equals(str, expected) && strcmp(string_cstr(shared), text) == 0);
+    string_to_lower(expected);
+    string_to_lower_parallel(str, 3);
+    assert(string_equals(str, expected));
+    
+    // Short strings run inline
+    string* small = string_new("MiXeD");
+    string_to_lower_parallel(small, 8);
+    assert(strcmp(string_cstr(small), "mixed") == 0);
+    assert(string_count_parallel(small, string_view_from_cstr("x"), 8) == 1);
+    
+    printf("Parallel find, count and case conversion agree with the sequential ones\n");
+    string_free(small);
+    string_free(shared);
+    string_free(expected);
     string_free(str);
+    free(text);
+}
+
+static int compare_for_qsort(const void* a, const void* b) {
+    return string_compare(*(string* const*)a, *(string* const*)b);
+}
+
+void test_array_sort() {
+    printf("\nTesting array sort and unique...\n");
+    
+    // Short keys over a tiny alphabet (embedded nulls and 0xff included) so
+    // there are many duplicates and many keys that are prefixes of others;
+    // half share a long common prefix to push the sort past several digits
+    const size_t count = 70000;
+    const char alphabet[] = { 'a', 'b', '\0', (char)0xff };
+    string** ref = malloc(count * sizeof(string*));
+    string** seq = malloc(count * sizeof(string*));
+    string** par = malloc(count * sizeof(string*));
+    assert(ref && seq && par);
+    uint32_t seed = 7;
+    for (size_t i = 0; i < count; i++) {
+        char key[64];
+        size_t length = 0;
+        seed = seed * 1103515245 + 12345;
+        if (seed & 0x10000) {
+            memcpy(key, "a-common-prefix-", 16);
+            length = 16;
+        }
+        seed = seed * 1103515245 + 12345;
+        size_t tail = (seed >> 16) % 20;
+        for (size_t j = 0; j < tail; j++) {
+            seed = seed * 1103515245 + 12345;
+            key[length++] = alphabet[(seed >> 16) % 4];
+        }
+        ref[i] = seq[i] = par[i] = string_new_n(key, length);
+        assert(ref[i]);
+    }
+    
+    qsort(ref, count, sizeof(string*), compare_for_qsort);
+    string_array_sort(seq, count);
+    string_array_sort_parallel(par, count, 3);
+    for (size_t i = 0; i < count; i++) {
+        assert(string_compare(seq[i], ref[i]) == 0);
+        assert(string_compare(par[i], ref[i]) == 0);
+    }
+    
+    size_t distinct = 1;
+    for (size_t i = 1; i < count; i++) distinct += string_compare(ref[i - 1], ref[i]) != 0;
+    [[maybe_unused]] size_t kept = string_array_unique(seq, count);
+    assert(kept == distinct);
+    for (size_t i = 1; i < kept; i++) assert(string_compare(seq[i - 1], seq[i]) < 0);
+    for (size_t i = 0; i < kept; i++) string_free(seq[i]);
+    
+    // Keys sharing a long prefix still spread over the parallel buckets
+    for (size_t i = 0; i < count; i++) {
+        char key[32];
+        seed = seed * 1103515245 + 12345;
+        int length = snprintf(key, sizeof(key), "shared/prefix/%u", seed >> 12);
+        par[i] = string_new_n(key, (size_t)length);
+    }
+    string_array_sort_parallel(par, count, 4);
+    for (size_t i = 1; i < count; i++) assert(string_compare(par[i - 1], par[i]) <= 0);
+    for (size_t i = 0; i < count; i++) string_free(par[i]);
     
-    long long end = get_time_ns();
-    print_benchmark_result("Find", end - start, iterations);
+    // NULL entries first, empty strings next, prefixes before extensions
+    string* words[] = { string_new("banana"), NULL, string_new(""), string_new("band"),
+                        string_new("ban"), NULL, string_new("banana") };
+    size_t word_count = sizeof(words) / sizeof(words[0]);
+    string_array_sort(words, word_count);
+    assert(!words[0] && !words[1] && string_length(words[2]) == 0);
+    assert(strcmp(string_cstr(words[3]), "ban") == 0 && strcmp(string_cstr(words[6]), "band") == 0);
+    word_count = string_array_unique(words, word_count);
+    assert(word_count == 5 && !words[0] && strcmp(string_cstr(words[3]), "banana") == 0);
+    for (size_t i = 0; i < word_count; i++) string_free(words[i]);
+    
+    printf("Sorted %zu keys, %zu distinct\n", count, distinct);
+    free(ref);
+    free(seq);
+    free(par);
 }
 
-/**
- * Benchmark string manipulation operations
- */
-void benchmark_manipulations() {
-    const size_t iterations = 10000;
-    long long start = get_time_ns();
+// Encode a code point, or return 0 for surrogates and values past U+10FFFF
+static size_t utf8_encode(uint32_t cp, char* out) {
+    if (cp < 0x80) {
+        out[0] = (char)cp;
+        return 1;
+    }
+    if (cp < 0x800) {
+        out[0] = (char)(0xC0 | cp >> 6);
+        out[1] = (char)(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    if ((cp >= 0xD800 && cp <= 0xDFFF) || cp > 0x10FFFF) return 0;
+    if (cp < 0x10000) {
+        out[0] = (char)(0xE0 | cp >> 12);
+        out[1] = (char)(0x80 | (cp >> 6 & 0x3F));
+        out[2] = (char)(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    out[0] = (char)(0xF0 | cp >> 18);
+    out[1] = (char)(0x80 | (cp >> 12 & 0x3F));
+    out[2] = (char)(0x80 | (cp >> 6 & 0x3F));
+    out[3] = (char)(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+static bool utf8_valid_at(const char* data, size_t length) {
+    return string_view_utf8_validate((string_view){ data, length });
+}
+
+// Known sequences, each also placed so it straddles every vector boundary
+static void check_utf8_cases(void) {
+    static const struct { const char* bytes; size_t length; bool valid; } cases[] = {
+        { "", 0, true },
+        { "plain ascii", 11, true },
+        { "\xC2\x80", 2, true },
+        { "\xDF\xBF", 2, true },
+        { "\xE0\xA0\x80", 3, true },
+        { "\xED\x9F\xBF", 3, true },
+        { "\xEE\x80\x80", 3, true },
+        { "\xEF\xBF\xBF", 3, true },
+        { "\xF0\x90\x80\x80", 4, true },
+        { "\xF4\x8F\xBF\xBF", 4, true },
+        { "\xC0\x80", 2, false },             // Overlong NUL
+        { "\xC1\xBF", 2, false },
+        { "\xE0\x80\x80", 3, false },         // Overlong 3-byte
+        { "\xE0\x9F\xBF", 3, false },
+        { "\xF0\x80\x80\x80", 4, false },     // Overlong 4-byte
+        { "\xF0\x8F\xBF\xBF", 4, false },
+        { "\xED\xA0\x80", 3, false },         // Surrogates
+        { "\xED\xBF\xBF", 3, false },
+        { "\xF4\x90\x80\x80", 4, false },     // Past U+10FFFF
+        { "\xF5\x80\x80\x80", 4, false },
+        { "\xFF", 1, false },
+        { "\x80", 1, false },                 // Stray continuations
+        { "a\xBF" "b", 3, false },
+        { "\xC2", 1, false },                 // Truncated
+        { "\xE2\x82", 2, false },
+        { "\xF0\x9F\x98", 3, false },
+        { "\xC2" "a", 2, false },
+        { "\xE2\x82" "a", 3, false },
+        { "\xC2\x80\x80", 3, false },         // One continuation too many
+        { "\xF0\x9F\x98\x80\x80", 5, false },
+    };
     
-    for (size_t i = 0; i < iterations; i++) {
-        string* str = string_new("  hello, World! This is a TEST string.  ");
-        string_trim(str);
-        string_to_upper(str);
-        string_to_lower(str);
-        if (!string_replace(str, "test", "benchmark")) {
-            printf("Error: replace failed at iteration %zu\n", i);
+    char buffer[200];
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        assert(utf8_valid_at(cases[i].bytes, cases[i].length) == cases[i].valid);
+        
+        for (size_t offset = 0; offset + cases[i].length <= 140; offset++) {
+            memset(buffer, 'x', sizeof(buffer));
+            memcpy(buffer + offset, cases[i].bytes, cases[i].length);
+            // Alone at the end, and followed by ASCII up to a later boundary
+            assert(utf8_valid_at(buffer, offset + cases[i].length) == cases[i].valid);
+            assert(utf8_valid_at(buffer, sizeof(buffer)) == cases[i].valid);
         }
-        string_free(str);
     }
+}
+
+void test_utf8() {
+    printf("\nTesting UTF-8 validation and code points...\n");
+    
+    // Random mixes of 1 to 4 byte sequences, some with a corrupted byte;
+    // every SIMD level must agree with the scalar kernels
+    char text[600];
+    uint32_t seed = 11;
+    [[maybe_unused]] bool results[400];
+    [[maybe_unused]] size_t lengths[400];
+    [[maybe_unused]] string_simd_level detected = string_simd_get_level();
+    
+    for (int level = STRING_SIMD_SCALAR; level <= STRING_SIMD_NEON; level++) {
+        if (!string_simd_level_supported(level)) continue;
+        assert(string_simd_set_level(level));
+        check_utf8_cases();
+        
+        seed = 11;
+        for (size_t round = 0; round < 400; round++) {
+            size_t length = 0;
+            seed = seed * 1103515245 + 12345;
+            size_t count = (seed >> 16) % 150;
+            for (size_t i = 0; i < count; i++) {
+                seed = seed * 1103515245 + 12345;
+                uint32_t r = seed >> 8;
+                uint32_t limits[] = { 0x80, 0x800, 0x10000, 0x110000 };
+                uint32_t cp = r % limits[r >> 20 & 3];
+                // Mostly ASCII runs, as in real text
+                if (r >> 22 & 1) cp &= 0x7F;
+                length += utf8_encode(cp, text + length);
+            }
+            seed = seed * 1103515245 + 12345;
+            if (length && (seed >> 16) % 3 == 0) {
+                seed = seed * 1103515245 + 12345;
+                text[(seed >> 8) % length] = (char)(seed >> 24);
+            }
+            
+            bool valid = utf8_valid_at(text, length);
+            size_t code_points = string_view_utf8_length((string_view){ text, length });
+            if (level == STRING_SIMD_SCALAR) {
+                results[round] = valid;
+                lengths[round] = code_points;
+            } else {
+                assert(valid == results[round]);
+                assert(code_points == lengths[round]);
+            }
+        }
+    }
+    assert(string_simd_set_level(detected));
+    
+    // Code point length and substrings
+    string* mixed = string_new("h\xC3\xA9llo, w\xC3\xB6rld \xE2\x82\xAC \xF0\x9F\x98\x80!");
+    assert(string_utf8_validate(mixed));
+    assert(string_utf8_length(mixed) == 17);
+    string* part = string_utf8_substr(mixed, 1, 4);
+    assert(part && strcmp(string_cstr(part), "\xC3\xA9llo") == 0);
+    string_free(part);
+    part = string_utf8_substr(mixed, 13, 100);
+    assert(part && strcmp(string_cstr(part), "\xE2\x82\xAC \xF0\x9F\x98\x80!") == 0);
+    string_free(part);
+    part = string_utf8_substr(mixed, 16, 0);
+    assert(part && string_length(part) == 0);
+    string_free(part);
+    assert(!string_utf8_substr(mixed, 17, 1));
+    
+    // Case mapping leaves multibyte sequences alone
+    string_to_upper(mixed);
+    assert(strcmp(string_cstr(mixed), "H\xC3\xA9LLO, W\xC3\xB6RLD \xE2\x82\xAC \xF0\x9F\x98\x80!") == 0);
+    assert(string_utf8_validate(mixed));
+    string_free(mixed);
+    
+    // Long text, so substr skips whole blocks before walking
+    string* text_str = string_new("");
+    for (int i = 0; i < 100; i++) {
+        assert(string_append_cstr(text_str, "ab\xCE\xB1\xE2\x82\xAC"));    // 4 code points, 7 bytes
+    }
+    assert(string_utf8_length(text_str) == 400);
+    part = string_utf8_substr(text_str, 201, 3);
+    assert(part && strcmp(string_cstr(part), "b\xCE\xB1\xE2\x82\xAC") == 0);
+    string_free(part);
     
-    long long end = get_time_ns();
-    print_benchmark_result("Manipulations", end - start, iterations);
+    assert(!string_utf8_validate(NULL));
+    assert(string_utf8_length(NULL) == 0);
+    
+    // The ASCII flag is cached and dropped on the next change
+    string* ascii = string_new("a heap string made only of ASCII letters");
+    assert(string_utf8_validate(ascii));
+    assert(string_utf8_validate(ascii));
+    assert(string_utf8_length(ascii) == string_length(ascii));
+    assert(string_append_cstr(ascii, "\xE2\x82"));
+    assert(!string_utf8_validate(ascii));
+    assert(string_append_cstr(ascii, "\xAC"));
+    assert(string_utf8_validate(ascii));
+    assert(string_utf8_length(ascii) == string_length(ascii) - 2);
+    part = string_utf8_substr(ascii, 2, 4);
+    assert(part && strcmp(string_cstr(part), "heap") == 0);
+    string_free(part);
+    string_free(ascii);
+    
+    string_free(text_str);
+    printf("UTF-8 tests passed\n");
 }
 
-/**
- * Benchmark string split and join operations
- */
-void benchmark_split_join() {
-    const size_t iterations = 10000;
-    long long start = get_time_ns();
+[[maybe_unused]] static int sign(int value) {
+    return (value > 0) - (value < 0);
+}
+
+// Case-insensitive results must match folding copies and using the exact
+// functions, at every SIMD level
+void test_icase() {
+    printf("\nTesting case-insensitive compare, equals and find...\n");
     
-    for (size_t i = 0; i < iterations; i++) {
-        string* str = string_new("one,two,three,four,five,six,seven");
-        size_t count = 0;
-        string** parts = string_split(str, ",", &count);
+    // Letters plus the bytes just outside 'A'..'Z' and 'a'..'z', and
+    // Latin-1 letters that must not fold
+    const char alphabet[] = { 'a', 'A', 'b', 'B', '@', '[', '`', '{', (char)0xC1, (char)0xE1 };
+    [[maybe_unused]] string_simd_level detected = string_simd_get_level();
+    
+    for (int level = STRING_SIMD_SCALAR; level <= STRING_SIMD_NEON; level++) {
+        if (!string_simd_level_supported(level)) continue;
+        assert(string_simd_set_level(level));
+        
+        uint32_t seed = 5;
+        char text[300], other[300];
+        for (int round = 0; round < 2000; round++) {
+            seed = seed * 1103515245 + 12345;
+            size_t length = (seed >> 16) % 200;
+            for (size_t i = 0; i < length; i++) {
+                seed = seed * 1103515245 + 12345;
+                text[i] = alphabet[(seed >> 16) % (seed >> 31 ? 4 : 10)];
+                // The other side differs mostly in case, sometimes in value
+                seed = seed * 1103515245 + 12345;
+                unsigned pick = (seed >> 16) % 64;
+                other[i] = pick == 0 ? alphabet[(seed >> 8) % 10] : (char)(pick & 1 ? text[i] ^ 0x20 : text[i]);
+            }
+            seed = seed * 1103515245 + 12345;
+            size_t other_length = (seed >> 16) % 8 == 0 ? (seed >> 20) % (length + 1) : length;
+            
+            string* a = string_new_n(text, length);
+            string* b = string_new_n(other, other_length);
+            string* folded_a = string_clone(a);
+            string* folded_b = string_clone(b);
+            string_to_lower(folded_a);
+            string_to_lower(folded_b);
+            assert(sign(string_compare_icase(a, b)) == sign(string_compare(folded_a, folded_b)));
+            assert(string_equals_icase(a, b) == string_equals(folded_a, folded_b));
+            
+            // Needles taken from the other side, so most are present
+            seed = seed * 1103515245 + 12345;
+            size_t start = other_length ? (seed >> 16) % other_length : 0;
+            size_t needle_length = (seed >> 24) % 12 + 1;
+            if (start + needle_length > other_length) needle_length = other_length - start;
+            string_view needle = { other + start, needle_length };
+            string* folded_needle = string_new_n(needle.data, needle.length);
+            string_to_lower(folded_needle);
+            assert(string_find_icase(a, needle) == string_find(folded_a, folded_needle));
+            
+            string_free(folded_needle);
+            string_free(folded_b);
+            string_free(folded_a);
+            string_free(b);
+            string_free(a);
+        }
+        
+        // Many near misses use up the verification budget and switch to
+        // the folded Two-Way search
+        size_t haystack_length = 100000;
+        char* haystack = malloc(haystack_length + 1);
+        assert(haystack);
+        for (size_t i = 0; i < haystack_length; i++) haystack[i] = (i % 3) ? 'a' : 'A';
+        string* hay = string_new_n(haystack, haystack_length);
+        char pattern[64];
+        memset(pattern, 'A', sizeof(pattern));
+        pattern[0] = 'a';
+        pattern[32] = 'b';
+        assert(string_find_icase(hay, (string_view){ pattern, sizeof(pattern) }) == -1);
+        haystack[haystack_length - sizeof(pattern) + 32] = 'B';
+        assert(string_set_n(hay, haystack, haystack_length));
+        assert(string_find_icase(hay, (string_view){ pattern, sizeof(pattern) }) ==
+               (ptrdiff_t)(haystack_length - sizeof(pattern)));
+        string_free(hay);
+        free(haystack);
+    }
+    assert(string_simd_set_level(detected));
+    
+    string* header = string_new("Content-Type");
+    string* lower = string_new("content-type");
+    string* other = string_new("content-typf");
+    assert(string_equals_icase(header, lower));
+    assert(!string_equals_icase(header, other));
+    assert(string_compare_icase(header, other) < 0);
+    assert(string_compare_icase(header, header) == 0);
+    assert(string_find_icase(header, string_view_from_cstr("TYPE")) == 8);
+    assert(string_find_icase(header, string_view_from_cstr("")) == 0);
+    assert(string_find_icase(header, string_view_from_cstr("types")) == -1);
+    assert(string_compare_icase(NULL, header) < 0);
+    assert(!string_equals_icase(NULL, header));
+    assert(string_find_icase(NULL, string_view_from_cstr("a")) == -1);
+    string_free(other);
+    string_free(lower);
+    string_free(header);
+    
+    printf("Case-insensitive tests passed\n");
+}
+
+// Reference trim with the C locale's isspace
+static void reference_trim(const char* text, size_t length, bool left, bool right,
+                           size_t* start, size_t* end) {
+    *start = 0;
+    *end = length;
+    while (left && *start < *end && isspace((unsigned char)text[*start])) (*start)++;
+    while (right && *end > *start && isspace((unsigned char)text[*end - 1])) (*end)--;
+}
+
+void test_trim_variants() {
+    printf("\nTesting trim variants...\n");
+    
+    // Runs of whitespace long enough to cross several vectors, mixed with
+    // bytes just outside the set
+    const char alphabet[] = { ' ', '\t', '\n', '\v', '\f', '\r', 'x', '\x1f', '!', (char)0xa0 };
+    const string_byte_set spaces = string_byte_set_from(string_view_from_cstr(" \t\n\v\f\r"));
+    [[maybe_unused]] string_simd_level detected = string_simd_get_level();
+    
+    for (int level = STRING_SIMD_SCALAR; level <= STRING_SIMD_NEON; level++) {
+        if (!string_simd_level_supported(level)) continue;
+        assert(string_simd_set_level(level));
         
-        string* joined = string_join(parts, count, "-");
+        uint32_t seed = 9;
+        char text[400];
+        for (int round = 0; round < 1500; round++) {
+            seed = seed * 1103515245 + 12345;
+            size_t length = (seed >> 16) % 300;
+            seed = seed * 1103515245 + 12345;
+            size_t lead = length ? (seed >> 16) % (length + 1) : 0;
+            for (size_t i = 0; i < length; i++) {
+                seed = seed * 1103515245 + 12345;
+                // Whitespace at the ends, anything in the middle
+                bool edge = i < lead || i >= length - lead / 2;
+                text[i] = alphabet[(seed >> 16) % (edge ? 6 : 10)];
+            }
+            
+            for (int mode = 0; mode < 4; mode++) {
+                string* str = string_new_n(text, length);
+                assert(str);
+                if (mode == 0) string_trim(str);
+                if (mode == 1) string_trim_left(str);
+                if (mode == 2) string_trim_right(str);
+                if (mode == 3) string_trim_set(str, &spaces, STRING_TRIM_BOTH);
+                
+                size_t start, end;
+                reference_trim(text, length, mode != 2, mode != 1, &start, &end);
+                assert(string_length(str) == end - start);
+                assert(memcmp(string_cstr(str), text + start, end - start) == 0);
+                string_free(str);
+            }
+        }
+    }
+    assert(string_simd_set_level(detected));
+    
+    // Custom sets, one end at a time
+    string* str = string_new("--==field==--");
+    const string_byte_set dashes = string_byte_set_from(string_view_from_cstr("-="));
+    string_trim_set(str, &dashes, STRING_TRIM_RIGHT);
+    assert(strcmp(string_cstr(str), "--==field") == 0);
+    string_trim_set(str, &dashes, STRING_TRIM_LEFT);
+    assert(strcmp(string_cstr(str), "field") == 0);
+    string_trim_set(str, &dashes, STRING_TRIM_KEEP_BUFFER);
+    assert(strcmp(string_cstr(str), "field") == 0);
+    string_free(str);
+    
+    // Keeping the buffer: no move back inline and no shrink, even when the
+    // result would fit in the inline buffer
+    str = string_with_capacity(4096);
+    assert(string_set(str, "      a long padded field that stays on its heap buffer      "));
+    [[maybe_unused]] const char* buffer = string_cstr(str);
+    [[maybe_unused]] size_t capacity = string_capacity(str);
+    string_trim_set(str, &spaces, STRING_TRIM_BOTH | STRING_TRIM_KEEP_BUFFER);
+    assert(strcmp(string_cstr(str), "a long padded field that stays on its heap buffer") == 0);
+    assert(string_cstr(str) == buffer && string_capacity(str) == capacity);
+    assert(string_set(str, "   short   "));
+    string_trim_set(str, &spaces, STRING_TRIM_BOTH | STRING_TRIM_KEEP_BUFFER);
+    assert(strcmp(string_cstr(str), "short") == 0);
+    assert(string_cstr(str) == buffer && string_capacity(str) == capacity);
+    
+    // Without the flag the same string moves back inline
+    string_trim(str);
+    assert(string_cstr(str) != buffer && string_capacity(str) == SSO_SIZE);
+    assert(strcmp(string_cstr(str), "short") == 0);
+    
+    // Everything trimmed
+    assert(string_set(str, " \t\r\n "));
+    string_trim_left(str);
+    assert(string_length(str) == 0);
+    string_trim_set(NULL, &spaces, STRING_TRIM_BOTH);
+    string_trim_set(str, NULL, STRING_TRIM_BOTH);
+    string_free(str);
+    
+    printf("Trim variant tests passed\n");
+}
+
+// Allocator that counts its traffic and insists on the alignment it is asked for
+typedef struct {
+    _Atomic size_t allocations;
+    _Atomic size_t frees;
+    _Atomic ptrdiff_t live;         // Bytes handed out and not yet returned
+} counting_state;
+
+static void* counting_allocate(void* context, size_t size, size_t alignment) {
+    counting_state* state = context;
+    void* ptr = alignment <= _Alignof(max_align_t)
+        ? malloc(size)
+        : aligned_alloc(alignment, (size + alignment - 1) & ~(alignment - 1));
+    assert(((uintptr_t)ptr & (alignment - 1)) == 0);
+    if (ptr) {
+        state->allocations++;
+        state->live += (ptrdiff_t)size;
+    }
+    return ptr;
+}
+
+static void* counting_reallocate(void* context, void* ptr, size_t old_size, size_t new_size, size_t alignment) {
+    void* moved = counting_allocate(context, new_size, alignment);
+    if (!moved) return NULL;
+    memcpy(moved, ptr, old_size < new_size ? old_size : new_size);
+    counting_state* state = context;
+    state->frees++;
+    state->live -= (ptrdiff_t)old_size;
+    free(ptr);
+    return moved;
+}
+
+static void counting_deallocate(void* context, void* ptr, size_t size) {
+    counting_state* state = context;
+    state->frees++;
+    state->live -= (ptrdiff_t)size;
+    free(ptr);
+}
+
+// Grow a string one piece at a time, checking the buffer stays on a cache line
+static void grow_aligned(string* str, size_t rounds) {
+    [[maybe_unused]] size_t start = string_length(str);
+    for (size_t i = 0; i < rounds; i++) {
+        assert(string_append_cstr(str, "0123456789abcdef0123456789"));
+        if (string_capacity(str) > SSO_SIZE) {
+            assert(((uintptr_t)string_cstr(str) & 63) == 0);
+        }
+    }
+    assert(string_length(str) == start + rounds * 26);
+}
+
+static void* thread_allocator_worker(void* arg) {
+    [[maybe_unused]] string_allocator* allocator = arg;
+    assert(string_set_thread_allocator(allocator));
+    string* str = string_new("built on another thread with its own allocator");
+    grow_aligned(str, 40);
+    assert(string_set_thread_allocator(NULL));
+    return str;
+}
+
+void test_allocator() {
+    printf("\n=== Allocator Tests ===\n");
+    
+    // Growth keeps 64-byte alignment with the C library allocator too
+    string* str = string_new("");
+    grow_aligned(str, 500);
+    string_free(str);
+    
+    // Global allocator: headers, buffers and shared buffers all go through it
+    counting_state global = { 0 };
+    [[maybe_unused]] string_allocator counting = { counting_allocate, counting_reallocate, counting_deallocate, &global };
+    assert(string_set_allocator(&counting));
+    str = string_new("head");
+    grow_aligned(str, 200);
+    string* shared = string_share(str);
+    assert(shared && string_equals(shared, str));
+    string_free(str);
+    assert(global.live > 0);
+    string_free(shared);
+    assert(global.allocations > 0 && global.allocations == global.frees && global.live == 0);
+    assert(string_set_allocator(NULL));
+    
+    // Per-thread allocator without reallocate; the buffer outlives the
+    // thread and is grown and freed here through the allocator that made it
+    counting_state local = { 0 };
+    string_allocator fallback = { counting_allocate, NULL, counting_deallocate, &local };
+    pthread_t thread;
+    [[maybe_unused]] int rc = pthread_create(&thread, NULL, thread_allocator_worker, &fallback);
+    assert(rc == 0);
+    void* result;
+    pthread_join(thread, &result);
+    str = result;
+    [[maybe_unused]] size_t allocations = local.allocations;
+    grow_aligned(str, 100);
+    assert(local.allocations > allocations);
+    assert(strncmp(string_cstr(str), "built on another thread", 23) == 0);
+    string_free(str);
+    assert(local.live == 0 && local.allocations == local.frees);
+    
+    // Arena blocks and the arena itself
+    counting_state blocks = { 0 };
+    string_allocator arena_allocator = { counting_allocate, counting_reallocate, counting_deallocate, &blocks };
+    string_arena* arena = string_arena_new_with_allocator(4096, &arena_allocator);
+    assert(arena);
+    for (int i = 0; i < 64; i++) {
+        [[maybe_unused]] string* item = string_new_in(arena, "arena string with enough bytes to leave the inline buffer");
+        assert(item);
+    }
+    [[maybe_unused]] string* big = string_with_capacity_in(arena, 100000);
+    assert(big && ((uintptr_t)string_cstr(big) & 63) == 0);
+    string_arena_reset(arena);
+    assert(blocks.live > 0);
+    [[maybe_unused]] size_t arena_allocations = blocks.allocations;
+    assert(string_new_in(arena, "reuses a spare block"));
+    assert(blocks.allocations == arena_allocations);
+    string_arena_free(arena);
+    assert(blocks.live == 0 && blocks.allocations == blocks.frees);
+    
+    // Incomplete allocators are refused
+    [[maybe_unused]] string_allocator incomplete = { NULL, NULL, counting_deallocate, &global };
+    errno = 0;
+    assert(!string_set_allocator(&incomplete) && errno == EINVAL);
+    errno = 0;
+    assert(!string_set_thread_allocator(&incomplete) && errno == EINVAL);
+    errno = 0;
+    assert(!string_arena_new_with_allocator(0, &incomplete) && errno == EINVAL);
+    
+    printf("Allocator tests passed\n");
+}
+
+static void* cache_worker(void* arg) {
+    // Leaves a full cache behind for thread exit to release
+    (void)arg;
+    for (int i = 0; i < 64; i++) {
+        string* str = string_with_capacity((size_t)(i % 20) * 64);
+        assert(str && string_append_cstr(str, "payload"));
+        string_free(str);
+    }
+    return NULL;
+}
+
+void test_reserve_shrink() {
+    printf("\n=== Reserve, Shrink and Buffer Cache Tests ===\n");
+    
+    // Reserving makes later appends stay in one buffer
+    string* str = string_new("seed");
+    assert(string_reserve(str, 1000));
+    assert(string_capacity(str) >= 1001 && strcmp(string_cstr(str), "seed") == 0);
+    [[maybe_unused]] const char* buffer = string_cstr(str);
+    while (string_length(str) + 10 <= 1000) {
+        [[maybe_unused]] bool ok = string_append_cstr(str, "0123456789");
+        assert(ok);
+        if (!ok) break;
+    }
+    assert(string_cstr(str) == buffer);
+    assert(string_reserve(str, 10) && string_cstr(str) == buffer);
+    errno = 0;
+    assert(!string_reserve(str, SIZE_MAX) && errno == EOVERFLOW);
+    assert(!string_reserve(NULL, 1));
+    
+    // Shrinking goes to the smallest cache-line multiple, then back inline
+    assert(string_set(str, "a hundred bytes or so, a hundred bytes or so, a hundred bytes or so, a hundred bytes"));
+    [[maybe_unused]] size_t length = string_length(str);
+    string_shrink_to_fit(str);
+    assert(string_capacity(str) == (length + 1 + 63) / 64 * 64);
+    assert(((uintptr_t)string_cstr(str) & 63) == 0);
+    assert(string_length(str) == length && string_cstr(str)[0] == 'a');
+    string_shrink_to_fit(str);
+    assert(string_capacity(str) == (length + 1 + 63) / 64 * 64);
+    assert(string_set(str, "tiny"));
+    string_shrink_to_fit(str);
+    assert(string_capacity(str) == SSO_SIZE && strcmp(string_cstr(str), "tiny") == 0);
+    string_shrink_to_fit(str);
+    string_shrink_to_fit(NULL);
+    
+    // Shared strings keep their buffer
+    assert(string_reserve(str, 500) && string_set(str, "shared text that is longer than the inline buffer"));
+    string* shared = string_share(str);
+    string_shrink_to_fit(str);
+    assert(string_cstr(str) == string_cstr(shared));
+    string_free(shared);
+    string_free(str);
+    
+    // A freed buffer is handed to the next string of the same size class
+    string_buffer_cache_release();
+    string* first = string_with_capacity(300);
+    buffer = string_cstr(first);
+    string_free(first);
+    string* second = string_with_capacity(300);
+    assert(string_cstr(second) == buffer);
+    string* other = string_with_capacity(700);
+    assert(string_cstr(other) != buffer);
+    string_free(other);
+    string_free(second);
+    
+    // Buffers too large for the cache and those of custom allocators bypass it
+    string* large = string_with_capacity(64 * 1024);
+    assert(large);
+    string_free(large);
+    string_buffer_cache_release();
+    
+    pthread_t thread;
+    [[maybe_unused]] int rc = pthread_create(&thread, NULL, cache_worker, NULL);
+    assert(rc == 0);
+    pthread_join(thread, NULL);
+    
+    printf("Reserve, shrink and buffer cache tests passed\n");
+}
+
+// Significant digits in a formatted double: those of the mantissa without
+// leading zeros or the zeros an integer is padded with
+[[maybe_unused]] static int significant_digits(const char* text) {
+    const char* first = NULL;
+    const char* last = NULL;
+    for (const char* p = text; *p && *p != 'e'; p++) {
+        if (*p < '1' || *p > '9') continue;
+        if (!first) first = p;
+        last = p;
+    }
+    if (!first) return 1;
+    int count = 0;
+    for (const char* p = first; p <= last; p++) count += *p != '.';
+    return count;
+}
+
+static uint64_t number_seed = 88172645463325252ull;
+
+static uint64_t next_random(void) {
+    number_seed ^= number_seed << 13;
+    number_seed ^= number_seed >> 7;
+    number_seed ^= number_seed << 17;
+    return number_seed;
+}
+
+static double double_from_bits(uint64_t bits) {
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static bool same_double(double a, double b) {
+    return memcmp(&a, &b, sizeof(a)) == 0;
+}
+
+// Parse text with the library and with strtod and insist on the same bits
+static void check_parse_double(const char* text) {
+    errno = 0;
+    double expected = strtod(text, NULL);
+    double parsed = 12345.0;
+    errno = 0;
+    [[maybe_unused]] bool ok = string_view_to_double(string_view_from_cstr(text), &parsed);
+    if (isinf(expected) && !isinf(parsed)) {
+        assert(!ok && errno == ERANGE && parsed == 12345.0);
+        return;
+    }
+    assert(ok && same_double(parsed, expected));
+}
+
+void test_numbers() {
+    printf("\n=== Numeric Formatting and Parsing Tests ===\n");
+    char expected[64];
+    
+    // Integers, appended across the inline boundary
+    static const int64_t ints[] = { 0, 1, -1, 9, 10, -99, 100, 12345678, -1234567890123456789, INT64_MAX, INT64_MIN };
+    for (size_t i = 0; i < sizeof(ints) / sizeof(ints[0]); i++) {
+        string* str = string_new("value=");
+        assert(string_append_int(str, ints[i]));
+        snprintf(expected, sizeof(expected), "value=%" PRId64, ints[i]);
+        assert(strcmp(string_cstr(str), expected) == 0);
+        [[maybe_unused]] int64_t back = 0;
+        [[maybe_unused]] string_view digits = { string_cstr(str) + 6, string_length(str) - 6 };
+        assert(string_view_to_int64(digits, &back) && back == ints[i]);
+        string_free(str);
+    }
+    string* str = string_new("");
+    for (int i = 0; i < 20000; i++) {
+        uint64_t v = next_random() >> (next_random() % 64);
+        string_clear(str);
+        assert(string_append_uint(str, v));
+        snprintf(expected, sizeof(expected), "%" PRIu64, v);
+        assert(strcmp(string_cstr(str), expected) == 0);
+        [[maybe_unused]] uint64_t back = 0;
+        assert(string_to_uint64(str, &back) && back == v);
         
+        int64_t signed_value = (int64_t)v * ((i & 1) ? -1 : 1);
+        string_clear(str);
+        assert(string_append_int(str, signed_value));
+        snprintf(expected, sizeof(expected), "%" PRId64, signed_value);
+        assert(strcmp(string_cstr(str), expected) == 0);
+        [[maybe_unused]] int64_t signed_back = 0;
+        assert(string_to_int64(str, &signed_back) && signed_back == signed_value);
+    }
+    assert(string_append_uint(str, UINT64_MAX));
+    string_free(str);
+    
+    // Integer parsing edge cases
+    [[maybe_unused]] int64_t i64 = 7;
+    [[maybe_unused]] uint64_t u64 = 7;
+    assert(string_view_to_int64(string_view_from_cstr("-9223372036854775808"), &i64) && i64 == INT64_MIN);
+    assert(string_view_to_int64(string_view_from_cstr("+000000000000000000000042"), &i64) && i64 == 42);
+    assert(string_view_to_uint64(string_view_from_cstr("18446744073709551615"), &u64) && u64 == UINT64_MAX);
+    static const char* bad_ints[] = { "", "+", "-", "12a", " 1", "1 ", "1.0", "0x10", "--1", "123456789012345678x" };
+    for (size_t i = 0; i < sizeof(bad_ints) / sizeof(bad_ints[0]); i++) {
+        errno = 0;
+        assert(!string_view_to_int64(string_view_from_cstr(bad_ints[i]), &i64) && errno == EINVAL);
+    }
+    errno = 0;
+    assert(!string_view_to_int64(string_view_from_cstr("9223372036854775808"), &i64) && errno == ERANGE);
+    errno = 0;
+    assert(!string_view_to_int64(string_view_from_cstr("-9223372036854775809"), &i64) && errno == ERANGE);
+    errno = 0;
+    assert(!string_view_to_uint64(string_view_from_cstr("18446744073709551616"), &u64) && errno == ERANGE);
+    errno = 0;
+    assert(!string_view_to_uint64(string_view_from_cstr("-1"), &u64) && errno == EINVAL);
+    assert(!string_to_int64(NULL, &i64) && !string_to_double(NULL, NULL));
+    
+    // Doubles: layout
+    static const struct { double value; const char* text; } layouts[] = {
+        { 0.0, "0" }, { -0.0, "-0" }, { 1.0, "1" }, { -1.5, "-1.5" }, { 0.1, "0.1" },
+        { 0.3, "0.3" }, { 1.0 / 3.0, "0.3333333333333333" }, { 123.456, "123.456" },
+        { 1e20, "100000000000000000000" }, { 1e21, "1e+21" }, { 1.5e300, "1.5e+300" },
+        { 0.000001, "0.000001" }, { 1e-7, "1e-7" }, { 2.5e-8, "2.5e-8" },
+        { 9007199254740992.0, "9007199254740992" }, { 5e-324, "5e-324" },
+        { 1.7976931348623157e308, "1.7976931348623157e+308" },
+        { 2.2250738585072014e-308, "2.2250738585072014e-308" },
+        { HUGE_VAL, "inf" }, { -HUGE_VAL, "-inf" }, { NAN, "nan" },
+    };
+    for (size_t i = 0; i < sizeof(layouts) / sizeof(layouts[0]); i++) {
+        str = string_new("");
+        assert(string_append_double(str, layouts[i].value));
+        assert(strcmp(string_cstr(str), layouts[i].text) == 0);
+        [[maybe_unused]] double back;
+        assert(string_to_double(str, &back));
+        assert(same_double(back, layouts[i].value) || (isnan(back) && isnan(layouts[i].value)));
         string_free(str);
-        string_free(joined);
-        for (size_t j = 0; j < count; j++) {
-            string_free(parts[j]);
+    }
+    
+    // Doubles: random bit patterns and subnormals print the fewest digits
+    // that read back, and read back through both parsers
+    str = string_new("");
+    for (int i = 0; i < 30000; i++) {
+        uint64_t bits = next_random();
+        if (i % 8 == 0) bits &= 0x800FFFFFFFFFFFFFull;
+        if (i % 16 == 1) bits = (next_random() % 2000) | (0x3FFull << 52);
+        double value = double_from_bits(bits);
+        if (!isfinite(value)) continue;
+        
+        string_clear(str);
+        assert(string_append_double(str, value));
+        [[maybe_unused]] const char* text = string_cstr(str);
+        assert(same_double(strtod(text, NULL), value));
+        [[maybe_unused]] double back;
+        assert(string_to_double(str, &back) && same_double(back, value));
+        
+        int shortest = 1;
+        for (; shortest < 17; shortest++) {
+            snprintf(expected, sizeof(expected), "%.*e", shortest - 1, value);
+            if (same_double(strtod(expected, NULL), value)) break;
+        }
+        assert(significant_digits(text) == shortest);
+    }
+    string_free(str);
+    
+    // Parsing agrees with strtod on other layouts, long inputs and extremes
+    static const char* formats[] = { "%.17g", "%.16g", "%.15g", "%.6e", "%.30e", "%.3f", "%.40f" };
+    for (int i = 0; i < 20000; i++) {
+        double value = double_from_bits(next_random() & ~(1ull << 62));
+        if (!isfinite(value)) continue;
+        char text[512];
+        snprintf(text, sizeof(text), formats[i % 7], (i % 7 == 5) ? value * 1e-3 : value);
+        check_parse_double(text);
+    }
+    for (int i = 0; i < 20000; i++) {
+        char text[128];
+        int length = 0;
+        int digits = 1 + (int)(next_random() % 40);
+        for (int d = 0; d < digits; d++) {
+            text[length++] = (char)('0' + next_random() % 10);
+            if (d == 0 && (i & 1)) text[length++] = '.';
+        }
+        snprintf(text + length, sizeof(text) - (size_t)length, "e%d", (int)(next_random() % 680) - 360);
+        check_parse_double(text);
+    }
+    static const char* hard[] = {
+        "9007199254740993", "9007199254740993.0000000000000000000000001", "9007199254740995",
+        "2.2250738585072011e-308", "2.2250738585072012e-308", "4.9406564584124654e-324",
+        "2.4703282292062327e-324", "2.4703282292062328e-324", "1e-400", "-1e-400", "1e308",
+        "1.7976931348623157e308", "1.7976931348623158e308", "1.7976931348623159e308", "1e309",
+        "-1e400", "0.000000000000000000000000000000000000000000001", "123456789012345678901234567890",
+        "0", "-0", "+0.0e10", ".5", "5.", "1E5", "1e+5", "1e-5", "00000000000000000000000000001.5",
+        "7.2057594037927933e16", "3.0517578125e-05", "1.00000000000000011102230246251565404236316680908203125",
+        "1.00000000000000011102230246251565404236316680908203124", "1.00000000000000011102230246251565404236316680908203126",
+        "inf", "-Infinity", "NaN", "1e99999999999", "1e-99999999999",
+    };
+    for (size_t i = 0; i < sizeof(hard) / sizeof(hard[0]); i++) check_parse_double(hard[i]);
+    
+    // Halfway between zero and the smallest subnormal rounds to even, just
+    // above it does not; both need every one of the 751 digits
+    char halfway[1200] = "0.";
+    for (int i = 0; i < 323; i++) strcat(halfway, "0");
+    strcat(halfway, "24703282292062327208828439643411068618252990130716238221279284125033775363510437593264991818081799618989828234772285886546332835517796989819938739800539093906315035659515570226392290858392449105184435931802849936536152500319370457678249219365623669863658480757001585769269903706311928279558551332927834338409351978015531246597263579574622766465272827220056374006485499977096599470454020828166226237857393450736339007967761930577506740176324673600968951340535537458516661134223766678604162159680461914467291840300530057530849048765391711386591646239524912623653881879636239373280423891018672348497668235089863388587925628302755995657524455507255189313690836254779186948667994968324049705821028513185451396213837722826145437693412532098591327667236328125");
+    check_parse_double(halfway);
+    [[maybe_unused]] double tiny;
+    assert(string_view_to_double(string_view_from_cstr(halfway), &tiny) && tiny == 0.0);
+    strcat(halfway, "1");
+    check_parse_double(halfway);
+    assert(string_view_to_double(string_view_from_cstr(halfway), &tiny) && tiny == 5e-324);
+    
+    static const char* bad_doubles[] = { "", "-", "+", ".", "e5", "1e", "1e+", "1.2.3", " 1", "1 ", "0x10", "infx", "nanx", "1,5" };
+    for (size_t i = 0; i < sizeof(bad_doubles) / sizeof(bad_doubles[0]); i++) {
+        [[maybe_unused]] double untouched = 1.25;
+        errno = 0;
+        assert(!string_view_to_double(string_view_from_cstr(bad_doubles[i]), &untouched));
+        assert(errno == EINVAL && untouched == 1.25);
+    }
+    
+    printf("Numeric formatting and parsing tests passed\n");
+}
+
+// Concatenate what iovec entries describe
+static string* gather_iovec(const struct iovec* iov, size_t count) {
+    string* out = string_new("");
+    for (size_t i = 0; i < count; i++) {
+        assert(iov[i].iov_len > 0);
+        if (!string_append_n(out, iov[i].iov_base, iov[i].iov_len)) break;
+    }
+    return out;
+}
+
+void test_iovec() {
+    printf("\n=== Scatter/Gather Output Tests ===\n");
+    
+    // Mixed inline, heap and missing pieces, joined lazily and eagerly
+    string* pieces[6] = {
+        string_new("alpha"), NULL, string_new(""),
+        string_new("a heap piece that is well past the inline buffer"), string_new("z"), NULL,
+    };
+    static const char* delims[] = { ", ", "" };
+    for (size_t d = 0; d < 2; d++) {
+        for (size_t count = 1; count <= 6; count++) {
+            struct iovec iov[16];
+            size_t needed = string_join_iovec(pieces, count, delims[d], NULL, 0);
+            assert(needed <= 2 * count - 1);
+            assert(string_join_iovec(pieces, count, delims[d], iov, 16) == needed);
+            string* lazy = gather_iovec(iov, needed);
+            string* eager = string_join(pieces, count, delims[d]);
+            assert(string_equals(lazy, eager));
+            string_free(eager);
+            string_free(lazy);
+        }
+    }
+    
+    // A short array is filled only with whole pieces
+    [[maybe_unused]] struct iovec small[3];
+    assert(string_join_iovec(pieces, 5, "-", small, 3) == 6);
+    assert(small[0].iov_len == 5 && small[1].iov_len == 1 && small[2].iov_len == 1);
+    
+    // Export skips what has no bytes
+    [[maybe_unused]] struct iovec exported[6];
+    assert(string_to_iovec(pieces, 6, exported, 6) == 3);
+    assert(exported[0].iov_base == string_cstr(pieces[0]) && exported[2].iov_len == 1);
+    assert(string_to_iovec(pieces, 6, NULL, 0) == 3);
+    assert(string_to_iovec(NULL, 6, NULL, 0) == 0);
+    for (size_t i = 0; i < 6; i++) string_free(pieces[i]);
+    
+    // Writing more entries than one writev takes, to a file
+    const size_t count = 3000;
+    string** lines = malloc(count * sizeof(string*));
+    for (size_t i = 0; i < count; i++) {
+        lines[i] = string_new("line ");
+        assert(string_append_uint(lines[i], i));
+    }
+    char path[64];
+    assert(write_temp_file(path, sizeof(path), "", 0));
+    int fd = open(path, O_WRONLY | O_TRUNC);
+    assert(fd >= 0);
+    assert(string_join_write_fd(fd, lines, count, "\n"));
+    
+    size_t needed = string_join_iovec(lines, count, "\n", NULL, 0);
+    struct iovec* iov = malloc(needed * sizeof(struct iovec));
+    assert(string_join_iovec(lines, count, "\n", iov, needed) == needed);
+    assert(string_write_fd(fd, lines[0]));
+    assert(string_writev_fd(fd, iov, needed));
+    close(fd);
+    
+    string* joined = string_join(lines, count, "\n");
+    string* expected = string_clone(joined);
+    assert(string_append(expected, lines[0]) && string_append(expected, joined));
+    string* written = string_from_file(path, STRING_FILE_READ);
+    assert(written && string_equals(written, expected));
+    unlink(path);
+    
+    errno = 0;
+    assert(!string_write_fd(-1, joined) && errno == EBADF);
+    errno = 0;
+    assert(!string_write_fd(1, NULL) && errno == EINVAL);
+    
+    string_free(written);
+    string_free(expected);
+    string_free(joined);
+    free(iov);
+    for (size_t i = 0; i < count; i++) string_free(lines[i]);
+    free(lines);
+    
+    printf("Scatter/gather output tests passed\n");
+}
+
+// Escape one view into a new string, asserting success
+static string* escape_with(bool (*append)(string*, string_view), const char* bytes, size_t len) {
+    string* out = string_new("");
+    [[maybe_unused]] bool ok = append(out, (string_view){ bytes, len });
+    assert(ok);
+    return out;
+}
+
+void test_escaping() {
+    printf("\n=== Escaping Tests ===\n");
+    
+    // JSON: short forms, \u00XX for other controls, UTF-8 passes through
+    static const char json_raw[] = "say \"hi\"\\\n\t\x01\x1f caf\xc3\xa9";
+    string* json = escape_with(string_append_json_escaped, json_raw, sizeof(json_raw) - 1);
+    assert(strcmp(string_cstr(json), "say \\\"hi\\\"\\\\\\n\\t\\u0001\\u001f caf\xc3\xa9") == 0);
+    string* back = escape_with(string_append_json_unescaped, string_cstr(json), string_length(json));
+    assert(string_length(back) == sizeof(json_raw) - 1 && memcmp(string_cstr(back), json_raw, sizeof(json_raw) - 1) == 0);
+    string_free(back);
+    string_free(json);
+    
+    // Every single byte, embedded nulls included, escapes exactly when JSON requires it
+    for (int c = 0; c < 256; c++) {
+        char byte = (char)c;
+        string* one = escape_with(string_append_json_escaped, &byte, 1);
+        [[maybe_unused]] bool special = c < 0x20 || c == '"' || c == '\\';
+        assert(special ? string_cstr(one)[0] == '\\' : (string_length(one) == 1 && string_cstr(one)[0] == byte));
+        string* round = escape_with(string_append_json_unescaped, string_cstr(one), string_length(one));
+        assert(string_length(round) == 1 && string_cstr(round)[0] == byte);
+        string_free(round);
+        string_free(one);
+    }
+    
+    // Escapes across the vector block boundaries of a long heap string
+    string* longer = string_new("");
+    for (int i = 0; i < 300; i++) assert(string_append_cstr(longer, (i % 37) ? "abcdefgh" : "\"\n"));
+    string* long_escaped = escape_with(string_append_json_escaped, string_cstr(longer), string_length(longer));
+    string* long_back = escape_with(string_append_json_unescaped, string_cstr(long_escaped), string_length(long_escaped));
+    assert(string_equals(long_back, longer));
+    string_free(long_back);
+    string_free(long_escaped);
+    
+    // \u escapes decode to UTF-8, pairs included
+    string* decoded = escape_with(string_append_json_unescaped, "\\u0041\\u00e9\\u20AC\\ud83d\\ude00\\/", 32);
+    assert(strcmp(string_cstr(decoded), "A\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80/") == 0);
+    string_free(decoded);
+    
+    // Malformed escapes fail and leave the target alone
+    static const char* bad_json[] = { "\\", "a\\x", "\\u12", "\\u12g4", "\\ud83d", "\\ud83dx", "\\ude00", "\\ud83d\\u0041" };
+    string* target = string_new("kept");
+    for (size_t i = 0; i < sizeof(bad_json) / sizeof(bad_json[0]); i++) {
+        errno = 0;
+        assert(!string_append_json_unescaped(target, string_view_from_cstr(bad_json[i])) && errno == EINVAL);
+        assert(strcmp(string_cstr(target), "kept") == 0);
+    }
+    
+    // Appending a string to itself reads the bytes from before the growth
+    assert(string_append_cstr(longer, "\t"));
+    [[maybe_unused]] size_t before = string_length(longer);
+    assert(string_append_json_escaped(longer, string_as_view(longer)));
+    assert(string_length(longer) == 2 * before + 1 + 2 * 9);
+    string_free(longer);
+    
+    // CSV: quote only when needed, doubling quotes
+    string* csv = string_new("");
+    assert(string_append_csv_quoted(csv, string_view_from_cstr("plain")));
+    assert(string_append_char(csv, ','));
+    assert(string_append_csv_quoted(csv, string_view_from_cstr("a,b")));
+    assert(string_append_char(csv, ','));
+    assert(string_append_csv_quoted(csv, string_view_from_cstr("say \"hi\"\r\n")));
+    assert(string_append_char(csv, ','));
+    assert(string_append_csv_quoted(csv, string_view_from_cstr("\"")));
+    assert(string_append_char(csv, ','));
+    assert(string_append_csv_quoted(csv, string_view_from_cstr("")));
+    assert(strcmp(string_cstr(csv), "plain,\"a,b\",\"say \"\"hi\"\"\r\n\",\"\"\"\",") == 0);
+    
+    static const char* fields[][2] = {
+        { "plain", "plain" }, { "\"a,b\"", "a,b" }, { "\"say \"\"hi\"\"\"", "say \"hi\"" },
+        { "\"\"\"\"", "\"" }, { "\"\"", "" }, { "", "" },
+    };
+    for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+        string* value = escape_with(string_append_csv_unquoted, fields[i][0], strlen(fields[i][0]));
+        assert(strcmp(string_cstr(value), fields[i][1]) == 0);
+        string_free(value);
+    }
+    static const char* bad_csv[] = { "\"", "\"open", "\"a\"b\"", "\"x\"\"" };
+    for (size_t i = 0; i < sizeof(bad_csv) / sizeof(bad_csv[0]); i++) {
+        errno = 0;
+        assert(!string_append_csv_unquoted(target, string_view_from_cstr(bad_csv[i])) && errno == EINVAL);
+        assert(strcmp(string_cstr(target), "kept") == 0);
+    }
+    string_free(csv);
+    
+    // URL: only unreserved bytes survive, uppercase hex, '+' with the form flag
+    string* url = string_new("");
+    assert(string_append_url_encoded(url, string_view_from_cstr("a b/c?d=e&f~g.h_i-J9\xc3\xa9"), 0));
+    assert(strcmp(string_cstr(url), "a%20b%2Fc%3Fd%3De%26f~g.h_i-J9%C3%A9") == 0);
+    string* form = string_new("");
+    assert(string_append_url_encoded(form, string_view_from_cstr("a b+c"), STRING_URL_FORM));
+    assert(strcmp(string_cstr(form), "a+b%2Bc") == 0);
+    for (int c = 0; c < 256; c++) {
+        [[maybe_unused]] char byte = (char)c;
+        string* one = string_new("");
+        assert(string_append_url_encoded(one, (string_view){ &byte, 1 }, 0));
+        [[maybe_unused]] bool unreserved = isalnum(c) || c == '-' || c == '.' || c == '_' || c == '~';
+        assert(string_length(one) == (unreserved ? 1u : 3u));
+        assert(string_url_decode(one, 0) && string_length(one) == 1 && string_cstr(one)[0] == byte);
+        string_free(one);
+    }
+    
+    assert(string_url_decode(url, 0));
+    assert(strcmp(string_cstr(url), "a b/c?d=e&f~g.h_i-J9\xc3\xa9") == 0);
+    assert(string_url_decode(form, STRING_URL_FORM) && strcmp(string_cstr(form), "a b+c") == 0);
+    
+    string* plus = string_new("");
+    assert(string_append_url_decoded(plus, string_view_from_cstr("1+1%3d2"), 0));
+    assert(string_append_url_decoded(plus, string_view_from_cstr("+%7e"), STRING_URL_FORM));
+    assert(strcmp(string_cstr(plus), "1+1=2 ~") == 0);
+    string_free(plus);
+    
+    static const char* bad_url[] = { "%", "ab%4", "%g0", "%0g", "50%" };
+    for (size_t i = 0; i < sizeof(bad_url) / sizeof(bad_url[0]); i++) {
+        errno = 0;
+        assert(!string_append_url_decoded(target, string_view_from_cstr(bad_url[i]), 0) && errno == EINVAL);
+        assert(strcmp(string_cstr(target), "kept") == 0);
+        string* in_place = string_new(bad_url[i]);
+        errno = 0;
+        assert(!string_url_decode(in_place, 0) && errno == EINVAL);
+        assert(strcmp(string_cstr(in_place), bad_url[i]) == 0);
+        string_free(in_place);
+    }
+    
+    // Random mixes of clean and special bytes round-trip under every kernel
+    const char alphabet[] = { 'a', 'Z', '0', '~', ' ', '"', '\\', '\n', ',', '%', '+', '\x01', (char)0xe9 };
+    [[maybe_unused]] string_simd_level detected = string_simd_get_level();
+    for (int level = STRING_SIMD_SCALAR; level <= STRING_SIMD_NEON; level++) {
+        if (!string_simd_level_supported(level)) continue;
+        assert(string_simd_set_level(level));
+        
+        uint32_t seed = 17;
+        char text[300];
+        for (int round = 0; round < 400; round++) {
+            seed = seed * 1103515245 + 12345;
+            size_t length = (seed >> 16) % sizeof(text);
+            for (size_t i = 0; i < length; i++) {
+                seed = seed * 1103515245 + 12345;
+                // Mostly clean bytes, so runs of every length appear
+                text[i] = (seed >> 16) % 4 ? 'q' : alphabet[(seed >> 20) % sizeof(alphabet)];
+            }
+            [[maybe_unused]] string_view raw = { text, length };
+            
+            string* encoded = escape_with(string_append_json_escaped, text, length);
+            string* decoded = escape_with(string_append_json_unescaped, string_cstr(encoded), string_length(encoded));
+            assert(string_view_equals(string_as_view(decoded), raw));
+            string_free(decoded);
+            string_free(encoded);
+            
+            encoded = escape_with(string_append_csv_quoted, text, length);
+            decoded = escape_with(string_append_csv_unquoted, string_cstr(encoded), string_length(encoded));
+            assert(string_view_equals(string_as_view(decoded), raw));
+            string_free(decoded);
+            string_free(encoded);
+            
+            for (unsigned flags = 0; flags <= STRING_URL_FORM; flags++) {
+                encoded = string_new("");
+                assert(string_append_url_encoded(encoded, raw, flags));
+                assert(string_url_decode(encoded, flags));
+                assert(string_view_equals(string_as_view(encoded), raw));
+                string_free(encoded);
+            }
+        }
+    }
+    assert(string_simd_set_level(detected));
+    
+    assert(!string_append_json_escaped(NULL, string_view_from_cstr("x")));
+    assert(!string_url_decode(NULL, 0));
+    string_free(target);
+    string_free(form);
+    string_free(url);
+    
+    printf("Escaping tests passed\n");
+}
+
+void test_string_array() {
+    printf("\n=== Contiguous String Array Tests ===\n");
+    
+    // Split output matches string_split piece for piece, empty pieces included
+    static const char* inputs[] = { "a,b,,c,", ",", "single", "x,,y", "a<>b<>c" };
+    static const char* delims[] = { ",", ",", ",", ",,", "<>" };
+    string_array* array = string_array_new();
+    assert(array && string_array_count(array) == 0);
+    for (size_t t = 0; t < sizeof(inputs) / sizeof(inputs[0]); t++) {
+        string* str = string_new(inputs[t]);
+        size_t count = 0;
+        string** parts = string_split(str, delims[t], &count);
+        string_array_clear(array);
+        assert(string_split_into(array, str, delims[t]));
+        assert(string_array_count(array) == count);
+        for (size_t i = 0; i < count; i++) {
+            [[maybe_unused]] string_view item = string_array_get(array, i);
+            assert(string_view_equals(item, string_as_view(parts[i])));
+            assert(item.data[item.length] == '\0');
+            string_free(parts[i]);
         }
         free(parts);
+        
+        string* rejoined = string_array_join(array, delims[t]);
+        assert(rejoined && string_equals(rejoined, str));
+        string_free(rejoined);
+        string_free(str);
+    }
+    
+    // Nothing to split, and out-of-range reads
+    string* empty = string_new("");
+    string_array_clear(array);
+    assert(string_split_into(array, empty, ",") && string_array_count(array) == 0);
+    assert(!string_split_into(array, empty, NULL));
+    assert(string_array_get(array, 0).length == 0);
+    string* none = string_array_join(array, ",");
+    assert(none && string_length(none) == 0);
+    string_free(none);
+    string_free(empty);
+    
+    // Pushing a view of an item copies it even when the block moves
+    assert(string_array_push(array, string_view_from_cstr("seed")));
+    for (int i = 0; i < 200; i++) assert(string_array_push(array, string_array_get(array, (size_t)i)));
+    assert(string_array_count(array) == 201);
+    assert(string_view_equals(string_array_get(array, 200), string_view_from_cstr("seed")));
+    assert(string_array_push(array, (string_view){ NULL, 0 }));
+    assert(!string_array_push(array, (string_view){ NULL, 3 }));
+    
+    // Sort, dedupe and look up agree with the string** versions
+    string_array_clear(array);
+    const size_t count = 5000;
+    string** ref = malloc(count * sizeof(string*));
+    uint32_t seed = 11;
+    for (size_t i = 0; i < count; i++) {
+        char key[40];
+        seed = seed * 1103515245 + 12345;
+        size_t length = (size_t)snprintf(key, sizeof(key), "%s%u", (seed & 0x10000) ? "key/" : "", (seed >> 20) % 900);
+        if (seed & 0x20000) key[length - 1] = '\0';    // Embedded nulls
+        ref[i] = string_new_n(key, length);
+        assert(string_array_push(array, (string_view){ key, length }));
     }
+    assert(string_array_find(array, string_as_view(ref[42])) <= 42);
+    assert(string_array_find(array, string_view_from_cstr("absent")) == -1);
     
-    long long end = get_time_ns();
-    print_benchmark_result("Split/Join", end - start, iterations);
+    string_array_sort(ref, count);
+    assert(string_array_sort_items(array));
+    for (size_t i = 0; i < count; i++) {
+        assert(string_view_equals(string_array_get(array, i), string_as_view(ref[i])));
+    }
+    [[maybe_unused]] size_t kept = string_array_unique(ref, count);
+    assert(string_array_unique_items(array) == kept && string_array_count(array) == kept);
+    for (size_t i = 0; i < kept; i++) {
+        assert(string_view_equals(string_array_get(array, i), string_as_view(ref[i])));
+        assert(string_array_find_sorted(array, string_as_view(ref[i])) == (ptrdiff_t)i);
+        assert(string_array_find(array, string_as_view(ref[i])) == (ptrdiff_t)i);
+        string_free(ref[i]);
+    }
+    assert(string_array_find_sorted(array, string_view_from_cstr("key/x")) == -1);
+    assert(string_array_find_sorted(array, string_view_from_cstr("")) == -1);
+    free(ref);
+    
+    assert(string_array_count(NULL) == 0);
+    assert(string_array_find(NULL, string_view_from_cstr("a")) == -1);
+    string_array_free(array);
+    string_array_free(NULL);
+    
+    printf("Contiguous string array tests passed\n");
 }
 
-/**
- * Run all benchmarks
- */
-void run_benchmarks() {
-    printf("\n=== STRING LIBRARY BENCHMARKS ===\n");
-    printf("%-20s | %10s | %12s | %8s\n", "Operation", "Time (ms)", "Ops/sec", "Iterations");
-    printf("---------------------------------------------------------------\n");
+static void* stats_worker(void* arg) {
+    string_stats_reset();
+    string* str = string_new("worker");
+    string_free(str);
+    *(string_stats*)arg = string_stats_get();
+    return NULL;
+}
+
+void test_stats() {
+    printf("\nTesting instrumentation counters...\n");
     
-    benchmark_create_free();
-    benchmark_append();
-    benchmark_find();
-    benchmark_manipulations();
-    benchmark_split_join();
+    string_buffer_cache_release();
+    string_stats_reset();
+    string* str = string_new("short");
+    assert(str);
+    [[maybe_unused]] string_stats stats = string_stats_get();
+    if (!string_stats_enabled()) {
+        // Counters are compiled out and stay zero
+        assert(string_append_cstr(str, "a long enough tail to need the heap"));
+        string_to_upper(str);
+        string_free(str);
+        stats = string_stats_get();
+        assert(stats.allocations == 0 && stats.frees == 0 && stats.bytes_allocated == 0);
+        assert(stats.simd_calls == 0 && stats.scalar_calls == 0);
+        printf("Counters disabled in this build\n");
+        return;
+    }
+    assert(stats.allocations == 1 && stats.bytes_allocated == sizeof(string));
+    assert(stats.heap_promotions == 0);
+    
+    // Outgrowing the small buffer promotes once, then the heap buffer grows
+    assert(string_append_cstr(str, "a long enough tail to need the heap"));
+    stats = string_stats_get();
+    assert(stats.heap_promotions == 1 && stats.allocations == 2 && stats.growth_reallocs == 0);
+    for (int i = 0; i < 8; i++) assert(string_append_cstr(str, "0123456789abcdef0123456789abcdef"));
+    stats = string_stats_get();
+    assert(stats.heap_promotions == 1 && stats.growth_reallocs > 0);
+    assert(stats.bytes_allocated >= sizeof(string) + string_length(str));
+    
+    // Long kernel calls count as SIMD on any vector level, short ones as scalar
+    string_stats_reset();
+    string_to_upper(str);
+    string* tiny = string_new("ab");
+    string_to_upper(tiny);
+    stats = string_stats_get();
+    if (string_simd_get_level() == STRING_SIMD_SCALAR) {
+        assert(stats.simd_calls == 0 && stats.scalar_calls == 2);
+    } else {
+        assert(stats.simd_calls == 1 && stats.scalar_calls == 1);
+    }
+    
+    // Folding back into a small string counts as a shrink
+    assert(string_set(str, "small again"));
+    string_trim(str);
+    stats = string_stats_get();
+    assert(stats.shrinks == 1);
+    
+    // Both are small again, so only their headers are left to free; they
+    // stay in the thread's cache until it is released
+    string_stats_reset();
+    string_free(tiny);
+    string_free(str);
+    stats = string_stats_get();
+    assert(stats.cache_returns == 2 && stats.frees == 0 && stats.allocations == 0);
+    str = string_new("reused header");
+    stats = string_stats_get();
+    assert(stats.cache_hits == 1 && stats.allocations == 0);
+    string_free(str);
+    string_buffer_cache_release();
+    stats = string_stats_get();
+    assert(stats.frees > 0);
+    
+    // Counters belong to the calling thread
+    string_stats worker;
+    pthread_t thread;
+    [[maybe_unused]] int rc = pthread_create(&thread, NULL, stats_worker, &worker);
+    assert(rc == 0);
+    pthread_join(thread, NULL);
+    assert(worker.allocations == 1 && worker.frees + worker.cache_returns == 1);
+    assert(string_stats_get().allocations == 0);
+    
+    printf("Counters track allocations, promotions and kernel calls per thread\n");
 }
 
 int main() {
@@ -292,13 +2752,37 @@ int main() {
     // Run tests
     test_basic_operations();
     test_manipulation();
+    test_binary_safe();
+    test_replace();
     test_substring();
     test_split_join();
     test_edge_cases();
+    test_simd_dispatch();
+    test_string_views();
+    test_sso_layout();
+    test_embedded_strings();
+    test_arena();
+    test_searcher();
+    test_matcher();
+    test_tokenizer();
+    test_hash();
+    test_pool();
+    test_rope();
+    test_file_loading();
+    test_share();
+    test_parallel();
+    test_array_sort();
+    test_utf8();
+    test_icase();
+    test_trim_variants();
+    test_allocator();
+    test_reserve_shrink();
+    test_numbers();
+    test_iovec();
+    test_escaping();
+    test_string_array();
+    test_stats();
     
-    // Run benchmarks
-    run_benchmarks();
-    
-    printf("\nAll tests and benchmarks completed.\n");
+    printf("\nAll tests completed.\n");
     return 0;
 }
\ No newline at end of file